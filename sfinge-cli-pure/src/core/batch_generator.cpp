@@ -1,10 +1,16 @@
 #include "batch_generator.h"
+#include "raster/gray8.h"
+#include "raster/random.h"
+#include "raster/blur_pyramid.h"
+#include "raster/checksum.h"
 #include <thread>
-#include <queue>
+#include <memory>
 #include <filesystem>
 #include <iostream>
+#include <iomanip>
 #include <cmath>
 #include <algorithm>
+#include <cstring>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -12,17 +18,159 @@
 
 namespace SFinGe {
 
-BatchGenerator::BatchGenerator() : m_rng(std::random_device{}()) {}
+namespace {
+
+inline Raster::Gray8View grayView(Image& image) {
+    return {image.data(), image.width(), image.width(), image.height()};
+}
+
+inline Raster::ConstGray8View constGrayView(const Image& image) {
+    return {image.data(), image.width(), image.width(), image.height()};
+}
+
+// Every generation parameter of an identity, keyed like the GUI's parameter JSON
+void addParameters(Raster::ManifestRecord& record, const FingerprintParameters& params) {
+    const ShapeParameters& shape = params.shape;
+    record.addInt("shape.left", shape.left);
+    record.addInt("shape.right", shape.right);
+    record.addInt("shape.top", shape.top);
+    record.addInt("shape.middle", shape.middle);
+    record.addInt("shape.bottom", shape.bottom);
+    record.addInt("shape.fingerType", static_cast<int>(shape.fingerType));
+    
+    const DensityParameters& density = params.density;
+    record.addReal("density.minFrequency", density.minFrequency);
+    record.addReal("density.maxFrequency", density.maxFrequency);
+    record.addReal("density.zoom", density.zoom);
+    record.addReal("density.amplify", density.amplify);
+    
+    const OrientationParameters& orientation = params.orientation;
+    record.addInt("orientation.nCores", orientation.nCores);
+    record.addInt("orientation.nDeltas", orientation.nDeltas);
+    record.addReal("orientation.verticalBiasStrength", orientation.verticalBiasStrength);
+    record.addReal("orientation.verticalBiasRadius", orientation.verticalBiasRadius);
+    record.addReal("orientation.coreConvergenceStrength", orientation.coreConvergenceStrength);
+    record.addReal("orientation.coreConvergenceRadius", orientation.coreConvergenceRadius);
+    record.addReal("orientation.coreConvergenceProbability", orientation.coreConvergenceProbability);
+    record.addReal("orientation.anisotropyFactorX", orientation.anisotropyFactorX);
+    record.addReal("orientation.anisotropyFactorY", orientation.anisotropyFactorY);
+    record.addInt("orientation.method", static_cast<int>(orientation.method));
+    record.addInt("orientation.fomfeOrderM", orientation.fomfeOrderM);
+    record.addInt("orientation.fomfeOrderN", orientation.fomfeOrderN);
+    record.addInt("orientation.legendreOrder", orientation.legendreOrder);
+    record.addReal("orientation.archAmplitude", orientation.archAmplitude);
+    record.addReal("orientation.tentedArchPeakInfluenceDecay", orientation.tentedArchPeakInfluenceDecay);
+    record.addReal("orientation.loopVerticalBiasStrength", orientation.loopVerticalBiasStrength);
+    record.addReal("orientation.loopEdgeBlendFactor", orientation.loopEdgeBlendFactor);
+    record.addReal("orientation.loopVerticalBiasRadiusFactor", orientation.loopVerticalBiasRadiusFactor);
+    record.addReal("orientation.whorlSpiralFactor", orientation.whorlSpiralFactor);
+    record.addReal("orientation.whorlEdgeDecayFactor", orientation.whorlEdgeDecayFactor);
+    record.addReal("orientation.twinLoopSmoothing", orientation.twinLoopSmoothing);
+    record.addReal("orientation.centralPocketConcentration", orientation.centralPocketConcentration);
+    record.addReal("orientation.accidentalIrregularity", orientation.accidentalIrregularity);
+    record.addReal("orientation.smoothingSigma", orientation.smoothingSigma);
+    record.addBool("orientation.enableSmoothing", orientation.enableSmoothing);
+    
+    const RidgeParameters& ridge = params.ridge;
+    record.addInt("ridge.gaborFilterSize", ridge.gaborFilterSize);
+    record.addInt("ridge.cacheDegrees", ridge.cacheDegrees);
+    record.addInt("ridge.cacheFrequencies", ridge.cacheFrequencies);
+    record.addInt("ridge.maxIterations", ridge.maxIterations);
+    
+    const RenderingParameters& rendering = params.rendering;
+    record.addReal("rendering.backgroundNoiseFrequency", rendering.backgroundNoiseFrequency);
+    record.addReal("rendering.backgroundNoiseAmplitude", rendering.backgroundNoiseAmplitude);
+    record.addReal("rendering.ridgeNoiseFrequency", rendering.ridgeNoiseFrequency);
+    record.addReal("rendering.ridgeNoiseAmplitude", rendering.ridgeNoiseAmplitude);
+    record.addReal("rendering.valleyNoiseFrequency", rendering.valleyNoiseFrequency);
+    record.addReal("rendering.valleyNoiseAmplitude", rendering.valleyNoiseAmplitude);
+    record.addBool("rendering.enablePores", rendering.enablePores);
+    record.addReal("rendering.poreDensity", rendering.poreDensity);
+    record.addReal("rendering.minPoreSize", rendering.minPoreSize);
+    record.addReal("rendering.maxPoreSize", rendering.maxPoreSize);
+    record.addReal("rendering.minPoreIntensity", rendering.minPoreIntensity);
+    record.addReal("rendering.maxPoreIntensity", rendering.maxPoreIntensity);
+    record.addReal("rendering.finalBlurSigma", rendering.finalBlurSigma);
+    record.addReal("rendering.contrastPercentileLower", rendering.contrastPercentileLower);
+    record.addReal("rendering.contrastPercentileUpper", rendering.contrastPercentileUpper);
+    
+    const VariationParameters& variation = params.variation;
+    record.addBool("variation.enablePlasticDistortion", variation.enablePlasticDistortion);
+    record.addReal("variation.plasticDistortionStrength", variation.plasticDistortionStrength);
+    record.addInt("variation.plasticDistortionBumps", variation.plasticDistortionBumps);
+    record.addBool("variation.enableLensDistortion", variation.enableLensDistortion);
+    record.addReal("variation.lensDistortionK1", variation.lensDistortionK1);
+    record.addReal("variation.lensDistortionK2", variation.lensDistortionK2);
+    record.addBool("variation.enableRotation", variation.enableRotation);
+    record.addReal("variation.maxRotationAngle", variation.maxRotationAngle);
+    record.addBool("variation.enableTranslation", variation.enableTranslation);
+    record.addReal("variation.maxTranslationX", variation.maxTranslationX);
+    record.addReal("variation.maxTranslationY", variation.maxTranslationY);
+    record.addBool("variation.enableSkinCondition", variation.enableSkinCondition);
+    record.addReal("variation.skinConditionFactor", variation.skinConditionFactor);
+    record.addInt("variation.skinConditionRadius", variation.skinConditionRadius);
+    record.addBool("variation.skinConditionDiscKernel", variation.skinConditionDiscKernel);
+    
+    const MinutiaeParameters& minutiae = params.minutiae;
+    record.addBool("minutiae.useContinuousPhase", minutiae.useContinuousPhase);
+    record.addReal("minutiae.phaseNoiseLevel", minutiae.phaseNoiseLevel);
+    record.addBool("minutiae.useQualityMask", minutiae.useQualityMask);
+    record.addText("minutiae.minutiaeDensity", minutiae.minutiaeDensity);
+    record.addReal("minutiae.coherenceThreshold", minutiae.coherenceThreshold);
+    record.addInt("minutiae.qualityWindowSize", minutiae.qualityWindowSize);
+    record.addReal("minutiae.frequencySmoothSigma", minutiae.frequencySmoothSigma);
+    record.addBool("minutiae.enableExplicitMinutiae", minutiae.enableExplicitMinutiae);
+    record.addInt("minutiae.targetMinutiae", minutiae.targetMinutiae);
+    record.addReal("minutiae.insertionProbability", minutiae.insertionProbability);
+    record.addReal("minutiae.removalProbability", minutiae.removalProbability);
+}
+
+bool writeBytes(const std::string& path, const std::vector<uint8_t>& data) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = (std::fclose(file) == 0) && ok;
+    return ok;
+}
+
+std::vector<double> pointCoordinates(const std::vector<SingularPoint>& points) {
+    std::vector<double> values;
+    values.reserve(2 * points.size());
+    for (const SingularPoint& point : points) {
+        values.push_back(point.x);
+        values.push_back(point.y);
+    }
+    return values;
+}
+
+// Memory model for --memory-budget, in bytes per pixel of the base image. At
+// its peak an identity holds the shape, density (float) and orientation
+// (double) maps, the orientation stage's copy of the shape map, its double
+// field and four double smoothing buffers, and the uint8 base; the ridge stage
+// that follows needs less. A version holds copies and warp/blur buffers of the
+// uint8 base.
+constexpr uint64_t kIdentityBytesPerPixel = 64;
+constexpr uint64_t kVersionBytesPerPixel = 8;
+constexpr uint64_t kSharedBytes = 8ull << 20;  // Gabor filter bank, mask planes, allocator bookkeeping
+
+// Largest base image createBaseFingerprint() draws: every shape extent at its maximum
+constexpr uint64_t kMaxBasePixels = (530 + 530) * (510 + 255 + 510);
+
+} // namespace
+
+BatchGenerator::BatchGenerator() {}
 
 void BatchGenerator::setBatchConfig(const BatchConfig& config) {
     m_config = config;
 }
 
-FingerprintClass BatchGenerator::selectClassByPopulation() {
+FingerprintClass BatchGenerator::selectClassByPopulation(std::mt19937& rng) {
     // Population distribution (approximate):
     // Loops: 60-65%, Whorls: 30-35%, Arches: 5%
     std::uniform_real_distribution<double> dist(0.0, 1.0);
-    double r = dist(m_rng);
+    double r = dist(rng);
     
     if (r < 0.025) return FingerprintClass::Arch;
     if (r < 0.05) return FingerprintClass::TentedArch;
@@ -43,34 +191,37 @@ FingerprintInstance BatchGenerator::createBaseFingerprint(int index) {
     
     instance.baseParams.reset();
     
+    // Seed from the absolute index, so a range started elsewhere (-s) renders the same
+    instance.seed = Raster::identitySeed(m_config.seed, static_cast<uint64_t>(identity(index)));
+    std::mt19937 rng;
+    Raster::seedEngine(rng, Raster::streamSeed(instance.seed, Raster::SeedStream::Parameters));
+    
     std::uniform_int_distribution<int> shapeDist(-30, 30);
-    instance.baseParams.shape.left = 500 + shapeDist(m_rng);
-    instance.baseParams.shape.right = 500 + shapeDist(m_rng);
-    instance.baseParams.shape.top = 480 + shapeDist(m_rng);
-    instance.baseParams.shape.middle = 240 + shapeDist(m_rng) / 2;
-    instance.baseParams.shape.bottom = 480 + shapeDist(m_rng);
+    instance.baseParams.shape.left = 500 + shapeDist(rng);
+    instance.baseParams.shape.right = 500 + shapeDist(rng);
+    instance.baseParams.shape.top = 480 + shapeDist(rng);
+    instance.baseParams.shape.middle = 240 + shapeDist(rng) / 2;
+    instance.baseParams.shape.bottom = 480 + shapeDist(rng);
     
     int width = instance.baseParams.shape.left + instance.baseParams.shape.right;
     int height = instance.baseParams.shape.top + instance.baseParams.shape.middle + 
                  instance.baseParams.shape.bottom;
     
-    FingerprintClass selectedClass = selectClassByPopulation();
+    FingerprintClass selectedClass = selectClassByPopulation(rng);
     
+    instance.basePoints.reseed(Raster::streamSeed(instance.seed, Raster::SeedStream::SingularPoints));
     instance.basePoints.generateRandomPoints(selectedClass, width, height);
     instance.baseParams.classification.fingerprintClass = selectedClass;
     
     instance.baseParams.orientation.loopEdgeBlendFactor = 0.0;
     instance.baseParams.orientation.whorlEdgeDecayFactor = 0.0;
     instance.baseParams.orientation.quietMode = m_config.quietMode;
+    instance.baseParams.minutiae = m_config.minutiae;
     
     return instance;
 }
 
-VersionTransform BatchGenerator::generateVersionTransform(int versionIndex) {
-    return generateVersionTransformLocal(versionIndex, m_rng);
-}
-
-VersionTransform BatchGenerator::generateVersionTransformLocal(int versionIndex, std::mt19937& rng) {
+VersionTransform BatchGenerator::generateVersionTransform(int versionIndex, std::mt19937& rng) {
     VersionTransform transform;
     
     std::uniform_real_distribution<double> dist01(0.0, 1.0);
@@ -94,8 +245,8 @@ VersionTransform BatchGenerator::generateVersionTransformLocal(int versionIndex,
     transform.homographyAngle = (dist01(rng) - 0.5) * 20.0;
     
     // Crop region - aumentado para preservar mais área útil
-    transform.cropWidth = 750;
-    transform.cropHeight = 900;
+    transform.cropWidth = kCropWidth;
+    transform.cropHeight = kCropHeight;
     
     // Blur
     transform.applyBlur = true;
@@ -104,259 +255,82 @@ VersionTransform BatchGenerator::generateVersionTransformLocal(int versionIndex,
     transform.blurCenterX = 50.0 + dist01(rng) * 400.0;
     transform.blurCenterY = 50.0 + dist01(rng) * 500.0;
     
+    // Noise seed (drawn from the version's RNG; the kernel keys the Philox stream with it)
+    transform.noiseSeed = (static_cast<uint64_t>(rng()) << 32) | rng();
+    
+    // Defocus strength: sigma between 1 and maxBlurSigma
+    transform.blurSigma = 1.0 + dist01(rng) * std::max(0.0, m_config.maxBlurSigma - 1.0);
+    
     return transform;
 }
 
-Image BatchGenerator::applyNoise(const Image& image, double noiseLevel) {
+Image BatchGenerator::applyNoise(const Image& image, double noiseLevel, uint64_t seed) {
     Image result = image.copy();
-    std::uniform_real_distribution<double> dist(-0.5, 0.5);
-    
-    for (int y = 0; y < result.height(); ++y) {
-        for (int x = 0; x < result.width(); ++x) {
-            uint8_t gray = result.pixel(x, y);
-            double noise = dist(m_rng) * 255.0 * noiseLevel;
-            int newGray = std::clamp(static_cast<int>(gray + noise), 0, 255);
-            result.setPixel(x, y, static_cast<uint8_t>(newGray));
-        }
-    }
-    
+    Raster::addUniformNoise(grayView(result), noiseLevel,
+                            Raster::RandomStream(seed, 0, Raster::NoiseStage::VersionNoise));
     return result;
 }
 
-Image BatchGenerator::applyBlur(const Image& image, int radius, double centerX, double centerY) {
+Image BatchGenerator::applyBlur(const Image& image, int radius, double centerX, double centerY, double sigma) {
     Image result = image.copy();
-    
-    const double kernel[3][3] = {
-        {1.0/16, 2.0/16, 1.0/16},
-        {2.0/16, 4.0/16, 2.0/16},
-        {1.0/16, 2.0/16, 1.0/16}
-    };
-    
-    for (int y = 0; y < image.height(); ++y) {
-        for (int x = 0; x < image.width(); ++x) {
-            double dx = x - centerX;
-            double dy = y - centerY;
-            double dist = std::sqrt(dx*dx + dy*dy);
-            
-            if (dist <= radius) {
-                double blurIntensity = 1.0 - (dist / radius);
-                
-                double sum = 0;
-                for (int ky = -1; ky <= 1; ++ky) {
-                    for (int kx = -1; kx <= 1; ++kx) {
-                        int px = std::clamp(x + kx, 0, image.width() - 1);
-                        int py = std::clamp(y + ky, 0, image.height() - 1);
-                        sum += image.pixel(px, py) * kernel[ky + 1][kx + 1];
-                    }
-                }
-                
-                uint8_t original = image.pixel(x, y);
-                int blurred = static_cast<int>(original * (1-blurIntensity) + sum * blurIntensity);
-                result.setPixel(x, y, static_cast<uint8_t>(std::clamp(blurred, 0, 255)));
-            }
-        }
-    }
-    
+    Raster::radialDefocus(constGrayView(image), grayView(result), radius, centerX, centerY, sigma);
     return result;
 }
 
 Image BatchGenerator::applyLensDistortion(const Image& image, double k) {
     Image result(image.width(), image.height());
-    result.fill(255);
-    
-    int width = image.width();
-    int height = image.height();
-    double cx = width / 2.0;
-    double cy = height / 2.0;
-    
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            double nx = (x - cx) / cx;
-            double ny = (y - cy) / cy;
-            double r = std::sqrt(nx * nx + ny * ny);
-            
-            if (r < 0.001) {
-                result.setPixel(x, y, image.pixel(x, y));
-                continue;
-            }
-            
-            double rDistorted = r * (1.0 + k * r * r);
-            
-            double srcX = cx + (nx / r) * rDistorted * cx;
-            double srcY = cy + (ny / r) * rDistorted * cy;
-            
-            if (srcX >= 0 && srcX < width - 1 && srcY >= 0 && srcY < height - 1) {
-                int x0 = static_cast<int>(srcX);
-                int y0 = static_cast<int>(srcY);
-                double fx = srcX - x0;
-                double fy = srcY - y0;
-                
-                double p00 = image.pixel(x0, y0);
-                double p10 = image.pixel(x0 + 1, y0);
-                double p01 = image.pixel(x0, y0 + 1);
-                double p11 = image.pixel(x0 + 1, y0 + 1);
-                
-                double gray = p00 * (1 - fx) * (1 - fy) +
-                             p10 * fx * (1 - fy) +
-                             p01 * (1 - fx) * fy +
-                             p11 * fx * fy;
-                
-                result.setPixel(x, y, static_cast<uint8_t>(std::clamp(gray, 0.0, 255.0)));
-            }
-        }
-    }
-    
+    Raster::lensDistortion(constGrayView(image), grayView(result), k);
     return result;
 }
 
 Image BatchGenerator::applyHomography(const Image& image, double shiftX, double shiftY, double angle) {
     Image result(image.width(), image.height());
-    result.fill(255);
-    
-    double rad = angle * M_PI / 180.0;
-    double cosA = std::cos(rad);
-    double sinA = std::sin(rad);
-    
-    int width = image.width();
-    int height = image.height();
-    double cx = width / 2.0;
-    double cy = height / 2.0;
-    
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            double nx = x - cx;
-            double ny = y - cy;
-            
-            double srcX = nx * cosA - ny * sinA * 0.3 + shiftX + cx;
-            double srcY = nx * sinA * 0.3 + ny * cosA + shiftY + cy;
-            
-            if (srcX >= 0 && srcX < width - 1 && srcY >= 0 && srcY < height - 1) {
-                int x0 = static_cast<int>(srcX);
-                int y0 = static_cast<int>(srcY);
-                double fx = srcX - x0;
-                double fy = srcY - y0;
-                
-                double p00 = image.pixel(x0, y0);
-                double p10 = image.pixel(x0 + 1, y0);
-                double p01 = image.pixel(x0, y0 + 1);
-                double p11 = image.pixel(x0 + 1, y0 + 1);
-                
-                double gray = p00 * (1 - fx) * (1 - fy) +
-                             p10 * fx * (1 - fy) +
-                             p01 * (1 - fx) * fy +
-                             p11 * fx * fy;
-                
-                result.setPixel(x, y, static_cast<uint8_t>(std::clamp(gray, 0.0, 255.0)));
-            }
-        }
-    }
-    
+    Raster::homography(constGrayView(image), grayView(result), shiftX, shiftY, angle);
     return result;
 }
 
 Image BatchGenerator::applyRotation(const Image& image, double angle) {
     Image result(image.width(), image.height());
-    result.fill(255);
-    
-    double rad = angle * M_PI / 180.0;
-    double cosA = std::cos(rad);
-    double sinA = std::sin(rad);
-    
-    int width = image.width();
-    int height = image.height();
-    double cx = width / 2.0;
-    double cy = height / 2.0;
-    
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            double nx = x - cx;
-            double ny = y - cy;
-            
-            double srcX = nx * cosA + ny * sinA + cx;
-            double srcY = -nx * sinA + ny * cosA + cy;
-            
-            if (srcX >= 0 && srcX < width - 1 && srcY >= 0 && srcY < height - 1) {
-                int x0 = static_cast<int>(srcX);
-                int y0 = static_cast<int>(srcY);
-                double fx = srcX - x0;
-                double fy = srcY - y0;
-                
-                double p00 = image.pixel(x0, y0);
-                double p10 = image.pixel(x0 + 1, y0);
-                double p01 = image.pixel(x0, y0 + 1);
-                double p11 = image.pixel(x0 + 1, y0 + 1);
-                
-                double gray = p00 * (1 - fx) * (1 - fy) +
-                             p10 * fx * (1 - fy) +
-                             p01 * (1 - fx) * fy +
-                             p11 * fx * fy;
-                
-                result.setPixel(x, y, static_cast<uint8_t>(std::clamp(gray, 0.0, 255.0)));
-            }
-        }
-    }
-    
+    Raster::rotation(constGrayView(image), grayView(result), angle);
     return result;
 }
 
 Image BatchGenerator::applyCrop(const Image& image, int targetWidth, int targetHeight) {
-    int startX = (image.width() - targetWidth) / 2;
-    int startY = (image.height() - targetHeight) / 2;
-    
-    startX = std::max(0, startX);
-    startY = std::max(0, startY);
+    int startX = std::max(0, (image.width() - targetWidth) / 2);
+    int startY = std::max(0, (image.height() - targetHeight) / 2);
     
     Image result(targetWidth, targetHeight);
-    result.fill(255);
-    
-    for (int y = 0; y < targetHeight && (startY + y) < image.height(); ++y) {
-        for (int x = 0; x < targetWidth && (startX + x) < image.width(); ++x) {
-            result.setPixel(x, y, image.pixel(startX + x, startY + y));
-        }
-    }
-    
+    Raster::copyRegion(constGrayView(image), startX, startY, grayView(result));
     return result;
 }
 
 Image BatchGenerator::applyEllipticalMask(const Image& image) {
     Image result = image.copy();
     
-    int width = image.width();
-    int height = image.height();
-    double cx = width / 2.0;
-    double cy = height / 2.0;
-    double rx = width / 2.0 * 0.95;
-    double ry = height / 2.0 * 0.95;
-    
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            double dx = (x - cx) / rx;
-            double dy = (y - cy) / ry;
-            double dist = std::sqrt(dx * dx + dy * dy);
-            
-            if (dist > 1.0) {
-                result.setPixel(x, y, 255);
-            } else if (dist > 0.85) {
-                double fade = (dist - 0.85) / 0.15;
-                uint8_t original = image.pixel(x, y);
-                uint8_t blended = static_cast<uint8_t>(original * (1 - fade) + 255 * fade);
-                result.setPixel(x, y, blended);
-            }
-        }
-    }
+    Raster::EllipticalMask mask;
+    mask.radiusX = image.width() / 2.0 * 0.95;
+    mask.radiusY = image.height() / 2.0 * 0.95;
+    mask.fadeStart = 0.85;
+    mask.smoothstep = false;
     
+    Raster::applyEllipticalMask(grayView(result), mask);
     return result;
 }
 
 Image BatchGenerator::applyVersionTransforms(const Image& baseImage, const VersionTransform& transform) {
+    if (m_config.fusedWarp &&
+        baseImage.width() >= transform.cropWidth && baseImage.height() >= transform.cropHeight) {
+        return applyFusedVersionTransforms(baseImage, transform);
+    }
+    
     Image result = baseImage.copy();
     
     if (transform.noiseLevel > 0.001) {
-        result = applyNoise(result, transform.noiseLevel);
+        result = applyNoise(result, transform.noiseLevel, transform.noiseSeed);
     }
     
     if (transform.applyBlur && transform.blurRadius > 0) {
-        result = applyBlur(result, transform.blurRadius, transform.blurCenterX, transform.blurCenterY);
+        result = applyBlur(result, transform.blurRadius, transform.blurCenterX, transform.blurCenterY, transform.blurSigma);
     }
     
     if (std::abs(transform.lensDistortion) > 0.001) {
@@ -380,16 +354,553 @@ Image BatchGenerator::applyVersionTransforms(const Image& baseImage, const Versi
     return result;
 }
 
+Image BatchGenerator::applyFusedVersionTransforms(const Image& baseImage, const VersionTransform& transform) {
+    // Same chain as applyVersionTransforms, composed into one inverse mapping:
+    // only the crop pixels are resampled, once
+    Raster::VersionWarp warp;
+    warp.sourceWidth = baseImage.width();
+    warp.sourceHeight = baseImage.height();
+    warp.cropX = (baseImage.width() - transform.cropWidth) / 2;
+    warp.cropY = (baseImage.height() - transform.cropHeight) / 2;
+    
+    warp.rotation = std::abs(transform.rotation) > 0.1;
+    warp.rotationDegrees = transform.rotation;
+    warp.homography = std::abs(transform.homographyAngle) > 0.1 ||
+                      std::abs(transform.homographyShiftX) > 0.1 ||
+                      std::abs(transform.homographyShiftY) > 0.1;
+    warp.homographyDegrees = transform.homographyAngle;
+    warp.homographyShiftX = transform.homographyShiftX;
+    warp.homographyShiftY = transform.homographyShiftY;
+    warp.lens = std::abs(transform.lensDistortion) > 0.001;
+    warp.lensK = transform.lensDistortion;
+    
+    // Noise and blur only over the part of the base the output reads
+    Raster::WarpFootprint footprint =
+        Raster::versionWarpFootprint(warp, transform.cropWidth, transform.cropHeight);
+    Image region;
+    if (!footprint.isEmpty()) {
+        region = Image(footprint.width(), footprint.height());
+        for (int y = 0; y < footprint.height(); ++y) {
+            std::memcpy(region.data() + static_cast<size_t>(y) * region.width(),
+                        baseImage.data() + static_cast<size_t>(footprint.y0 + y) * baseImage.width() + footprint.x0,
+                        footprint.width());
+        }
+        
+        if (transform.noiseLevel > 0.001) {
+            region = applyNoise(region, transform.noiseLevel, transform.noiseSeed);
+        }
+        if (transform.applyBlur && transform.blurRadius > 0) {
+            region = applyBlur(region, transform.blurRadius,
+                               transform.blurCenterX - footprint.x0, transform.blurCenterY - footprint.y0,
+                               transform.blurSigma);
+        }
+    }
+    
+    Image result(transform.cropWidth, transform.cropHeight);
+    Raster::applyVersionWarp(region.isNull() ? nullptr : region.data(), region.width(), footprint,
+                             result.data(), result.width(), result.width(), result.height(),
+                             warp, m_config.warpInterpolation);
+    result.setDPI(500);
+    
+    return result;
+}
+
+// Container outputs are named after the first identity of the range, like the images
+std::string BatchGenerator::outputStem() const {
+    char stem[512];
+    snprintf(stem, sizeof(stem), "%s/%s_%04d", m_config.outputDirectory.c_str(),
+             m_config.filenamePrefix.c_str(), m_config.startIndex);
+    return stem;
+}
+
+bool BatchGenerator::openTensorOutput() {
+    // v0 is the uncropped base image and has no fixed size, so it has no slot
+    if (!m_config.skipOriginal) {
+        std::cerr << "NPY output holds the cropped versions only; use --skip-original\n";
+        return false;
+    }
+    
+    const std::string path = outputStem() + ".npy";
+    const std::vector<uint64_t> shape = {static_cast<uint64_t>(m_config.numFingerprints),
+                                         static_cast<uint64_t>(m_config.versionsPerFingerprint),
+                                         kCropHeight, kCropWidth};
+    std::error_code ec;
+    const bool existing = m_resumed && std::filesystem::exists(path, ec);
+    m_tensor = std::make_unique<Raster::NpyFile>();
+    if (!(existing ? m_tensor->reopen(path, shape) : m_tensor->create(path, shape))) {
+        std::cerr << "NPY output failed: " << m_tensor->error() << "\n";
+        m_tensor.reset();
+        return false;
+    }
+    m_labels.assign(m_config.numFingerprints, IdentityLabel());
+    
+    if (!m_config.quietMode) {
+        std::cout << "Tensor: " << path << " [" << m_config.numFingerprints << ", "
+                  << m_config.versionsPerFingerprint << ", " << kCropHeight << ", " << kCropWidth << "] uint8\n";
+    }
+    return true;
+}
+
+bool BatchGenerator::closeTensorOutput() {
+    bool ok = m_tensor->close();
+    if (!ok) {
+        std::cerr << "NPY output failed: " << m_tensor->error() << "\n";
+    }
+    m_tensor.reset();
+    
+    // Row n describes tensor[n]; identities that never ran (cancelled batch) are left out
+    static const char* const kClassNames[] = {"none", "arch", "tented_arch", "left_loop", "right_loop",
+                                              "whorl", "twin_loop", "central_pocket", "accidental"};
+    const std::string path = outputStem() + "_labels.csv";
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        std::cerr << "Cannot write " << path << "\n";
+        return false;
+    }
+    std::fprintf(file, "index,identity,class,class_name,seed\n");
+    for (size_t n = 0; n < m_labels.size(); ++n) {
+        const IdentityLabel& label = m_labels[n];
+        if (!label.valid) {
+            continue;
+        }
+        int cls = static_cast<int>(label.fingerprintClass);
+        std::fprintf(file, "%zu,%d,%d,%s,%llu\n", n, identity(static_cast<int>(n)), cls,
+                     (cls >= 0 && cls <= 8) ? kClassNames[cls] : "unknown",
+                     static_cast<unsigned long long>(label.seed));
+    }
+    ok = (std::fclose(file) == 0) && ok;
+    m_labels.clear();
+    return ok;
+}
+
+// Frames go straight to stdout; main sends every message to stderr meanwhile
+bool BatchGenerator::openStreamOutput() {
+    m_stream = std::make_unique<Raster::FrameStreamWriter>();
+    if (!m_stream->open(1, m_config.filenamePrefix)) {
+        std::cerr << "Stream output failed: " << m_stream->error() << "\n";
+        m_stream.reset();
+        return false;
+    }
+    if (!m_config.quietMode) {
+        const bool raw = m_config.outputFormat == OutputFormat::Npy;
+        std::cout << "Stream: stdout, "
+                  << (raw ? "raw uint8" : m_config.imageCodec == ImageCodec::Wsq ? "WSQ" : "PNG") << " frames\n";
+    }
+    return true;
+}
+
+bool BatchGenerator::closeStreamOutput() {
+    bool ok = m_stream->close();
+    if (!ok) {
+        std::cerr << "Stream output failed: " << m_stream->error() << "\n";
+    } else if (!m_config.quietMode) {
+        std::cout << "Stream: " << m_stream->frameCount() << " frames, " << (m_stream->bytesWritten() >> 20)
+                  << " MiB, " << std::fixed << std::setprecision(2) << m_stream->blockedSeconds()
+                  << " s writing to the reader\n";
+    }
+    m_stream.reset();
+    return ok;
+}
+
+// The ring holds fixed-size slots, so like the tensor it takes the cropped versions only
+bool BatchGenerator::openRingOutput(int numWorkers) {
+    if (!m_config.skipOriginal) {
+        std::cerr << "A shared-memory ring holds the cropped versions only; use --skip-original\n";
+        return false;
+    }
+    const int slots = m_config.ringSlots > 0 ? m_config.ringSlots : 4 * numWorkers;
+    const uint64_t frames = static_cast<uint64_t>(m_config.numFingerprints) * m_config.versionsPerFingerprint;
+    m_ring = std::make_unique<Raster::ShmRingWriter>();
+    if (!m_ring->create(m_config.ringName, slots, kCropWidth, kCropHeight, frames, m_config.filenamePrefix)) {
+        std::cerr << "Ring output failed: " << m_ring->error() << "\n";
+        m_ring.reset();
+        return false;
+    }
+    if (!m_config.quietMode) {
+        std::cout << "Ring: " << m_ring->name() << ", " << slots << " slots of " << kCropWidth << "x" << kCropHeight
+                  << " uint8 (" << ((static_cast<uint64_t>(slots) * m_ring->frameBytes()) >> 20) << " MiB)\n";
+    }
+    return true;
+}
+
+// Waits for the consumer to read every frame before the segment name goes away
+bool BatchGenerator::closeRingOutput() {
+    if (m_cancelled) {
+        m_ring->abort("the batch was cancelled");
+    }
+    bool ok = m_ring->close();
+    if (!ok) {
+        std::cerr << "Ring output failed: " << m_ring->error() << "\n";
+    } else if (!m_config.quietMode) {
+        std::cout << "Ring: " << m_ring->frameCount() << " frames, workers waited " << std::fixed
+                  << std::setprecision(2) << m_ring->blockedSeconds() << " s for free slots\n";
+    }
+    m_ring.reset();
+    return ok;
+}
+
+bool BatchGenerator::openManifest() {
+    const std::string path = outputStem() + ".manifest";
+    std::error_code ec;
+    const bool existing = m_resumed && std::filesystem::exists(path, ec);
+    m_manifest = std::make_unique<Raster::ManifestWriter>();
+    if (!(existing ? m_manifest->reopen(path) : m_manifest->create(path))) {
+        std::cerr << "Manifest output failed: " << m_manifest->error() << "\n";
+        m_manifest.reset();
+        return false;
+    }
+    if (existing) {
+        // A resumed batch appends to its manifest, which already starts with the batch record
+        if (!m_config.quietMode) {
+            std::cout << "Manifest: " << path << " (appending)\n";
+        }
+        return true;
+    }
+    
+    // One batch record first: how every identity and version below was produced
+    Raster::ManifestRecord record;
+    record.addUInt("seed", m_config.seed);
+    record.addInt("startIndex", m_config.startIndex);
+    record.addInt("fingerprints", m_config.numFingerprints);
+    record.addInt("identityStride", m_config.identityStride);
+    record.addInt("shard", m_config.shardIndex);
+    record.addInt("shards", m_config.shardCount);
+    record.addInt("rangeStart", m_config.rangeStart);
+    record.addInt("rangeCount", m_config.rangeCount);
+    record.addInt("versionsPerFingerprint", m_config.versionsPerFingerprint);
+    record.addBool("skipOriginal", m_config.skipOriginal);
+    record.addBool("ellipticalMask", m_config.applyEllipticalMask);
+    record.addBool("fusedWarp", m_config.fusedWarp);
+    record.addInt("warpInterpolation", static_cast<int>(m_config.warpInterpolation));
+    record.addReal("maxBlurSigma", m_config.maxBlurSigma);
+    record.addInt("cropWidth", kCropWidth);
+    record.addInt("cropHeight", kCropHeight);
+    record.addText("prefix", m_config.filenamePrefix);
+    record.addText("codec", m_config.imageCodec == ImageCodec::Wsq ? "wsq" : "png");
+    record.addReal("wsqBitrate", m_config.wsqBitrate);
+    record.addText("format", m_config.outputFormat == OutputFormat::Npy    ? "npy"
+                             : m_config.outputFormat == OutputFormat::Shards ? "shards"
+                                                                             : "files");
+    m_manifest->append("batch", record);
+    
+    if (!m_config.quietMode) {
+        std::cout << "Manifest: " << path << "\n";
+    }
+    return true;
+}
+
+bool BatchGenerator::closeManifest() {
+    bool ok = m_manifest->close();
+    if (!ok) {
+        std::cerr << "Manifest output failed: " << m_manifest->error() << "\n";
+    } else if (!m_config.quietMode) {
+        std::cout << "Manifest: " << m_manifest->recordCount() << " records\n";
+    }
+    m_manifest.reset();
+    return ok;
+}
+
+// Runs on the identity task once the base image exists (minutiae are a by-product of it)
+void BatchGenerator::appendIdentityRecord(const FingerprintInstance& instance, int fpIndex,
+                                          const std::vector<Minutia>& minutiae) {
+    Raster::ManifestRecord record;
+    record.addInt("identity", identity(fpIndex));
+    record.addUInt("seed", instance.seed);
+    record.addInt("class", static_cast<int>(instance.baseParams.classification.fingerprintClass));
+    addParameters(record, instance.baseParams);
+    record.addTuples("cores", {"x", "y"}, pointCoordinates(instance.basePoints.getCores()));
+    record.addTuples("deltas", {"x", "y"}, pointCoordinates(instance.basePoints.getDeltas()));
+    
+    std::vector<double> values;
+    values.reserve(5 * minutiae.size());
+    for (const Minutia& minutia : minutiae) {
+        values.insert(values.end(), {minutia.x, minutia.y, minutia.angle,
+                                     static_cast<double>(minutia.type), minutia.quality});
+    }
+    record.addTuples("minutiae", {"x", "y", "angle", "type", "quality"}, values);
+    m_manifest->append("identity", record);
+}
+
+// Runs on a writer thread after the image is stored, so each record matches a file.
+// v0 is the untransformed base image, already described by its identity record.
+void BatchGenerator::appendVersionRecord(int fpIndex, int versionIndex, const VersionTransform& transform) {
+    if (versionIndex == 0) {
+        return;
+    }
+    Raster::ManifestRecord record;
+    record.addInt("identity", identity(fpIndex));
+    record.addInt("version", versionIndex);
+    record.addReal("rotation", transform.rotation);
+    record.addReal("noiseLevel", transform.noiseLevel);
+    record.addUInt("noiseSeed", transform.noiseSeed);
+    record.addReal("lensDistortion", transform.lensDistortion);
+    record.addBool("usePincushion", transform.usePincushion);
+    record.addReal("homographyShiftX", transform.homographyShiftX);
+    record.addReal("homographyShiftY", transform.homographyShiftY);
+    record.addReal("homographyAngle", transform.homographyAngle);
+    record.addInt("cropWidth", transform.cropWidth);
+    record.addInt("cropHeight", transform.cropHeight);
+    record.addBool("applyBlur", transform.applyBlur);
+    record.addInt("blurRadius", transform.blurRadius);
+    record.addReal("blurCenterX", transform.blurCenterX);
+    record.addReal("blurCenterY", transform.blurCenterY);
+    record.addReal("blurSigma", transform.blurSigma);
+    m_manifest->append("version", record);
+}
+
+// Everything that decides which images a batch writes, and where: a journal
+// only resumes the batch that wrote it
+uint32_t BatchGenerator::configHash() const {
+    const MinutiaeParameters& minutiae = m_config.minutiae;
+    char numbers[512];
+    snprintf(numbers, sizeof(numbers), "%d %d %d %d %d %d %d %d %.17g %d %d %.17g %d | %d %.17g %d %.17g %d %.17g |",
+             m_config.startIndex, m_config.identityStride, m_config.numFingerprints, m_config.versionsPerFingerprint,
+             m_config.skipOriginal, m_config.applyEllipticalMask, m_config.fusedWarp,
+             static_cast<int>(m_config.warpInterpolation), m_config.maxBlurSigma,
+             static_cast<int>(m_config.outputFormat), static_cast<int>(m_config.imageCodec),
+             m_config.wsqBitrate, m_config.saveParameters,
+             minutiae.useContinuousPhase, minutiae.phaseNoiseLevel, minutiae.useQualityMask,
+             minutiae.coherenceThreshold, minutiae.qualityWindowSize, minutiae.frequencySmoothSigma);
+    const std::string text = std::string(numbers) + m_config.filenamePrefix + "|" + minutiae.minutiaeDensity;
+    return Raster::crc32(0, text.data(), text.size());
+}
+
+// Always written, so any batch can be resumed; --resume reads it back first
+bool BatchGenerator::openJournal() {
+    const std::string path = outputStem() + ".journal";
+    m_journal = std::make_unique<Raster::CompletionJournal>();
+    m_done.assign(static_cast<size_t>(m_config.numFingerprints) * (m_config.versionsPerFingerprint + 1), 0);
+    m_resumed = false;
+    m_firstShard = 0;
+    
+    std::error_code ec;
+    if (!m_config.resume || !std::filesystem::exists(path, ec)) {
+        if (!m_journal->create(path, m_config.seed, configHash())) {
+            std::cerr << "Journal failed: " << m_journal->error() << "\n";
+            m_journal.reset();
+            return false;
+        }
+        return true;
+    }
+    
+    if (!m_journal->resume(path)) {
+        std::cerr << "Journal failed: " << m_journal->error() << "\n";
+        m_journal.reset();
+        return false;
+    }
+    if (m_journal->configHash() != configHash()) {
+        std::cerr << path << " belongs to a batch with other options; rerun with the same options\n";
+        m_journal.reset();
+        return false;
+    }
+    if (m_config.fixedSeed && m_config.seed != m_journal->seed()) {
+        std::cerr << path << " belongs to a batch with seed " << m_journal->seed() << "\n";
+        m_journal.reset();
+        return false;
+    }
+    m_config.seed = m_journal->seed();
+    m_resumed = true;
+    
+    int done = 0;
+    for (const Raster::JournalEntry& entry : m_journal->completed()) {
+        const int offset = static_cast<int>(entry.identity) - m_config.startIndex;
+        const int fpIndex = offset / m_config.identityStride;
+        if (offset < 0 || offset % m_config.identityStride != 0 || fpIndex >= m_config.numFingerprints ||
+            entry.version > m_config.versionsPerFingerprint) {
+            continue;
+        }
+        uint8_t& slot = m_done[static_cast<size_t>(fpIndex) * (m_config.versionsPerFingerprint + 1) + entry.version];
+        done += slot ? 0 : 1;
+        slot = 1;
+        m_firstShard = std::max(m_firstShard, static_cast<int>(entry.shard));
+    }
+    if (!m_config.quietMode) {
+        std::cout << "Resuming: " << done << " images already written (seed " << m_config.seed << ")\n";
+    }
+    return true;
+}
+
+bool BatchGenerator::closeJournal() {
+    bool ok = m_journal->close();
+    if (!ok) {
+        std::cerr << "Journal failed: " << m_journal->error() << "\n";
+    }
+    m_journal.reset();
+    m_written.reset();
+    m_done.clear();
+    return ok;
+}
+
+// Runs before each journal commit: the entries it writes must describe data on disk.
+// Shards need nothing here, their entries are journaled once the shard is sealed.
+bool BatchGenerator::syncOutput() {
+    bool ok = true;
+    if (m_config.outputFormat == OutputFormat::Npy) {
+        ok = m_tensor->sync();
+    } else if (m_written) {
+        ok = m_written->sync();
+    }
+    if (m_manifest) {
+        ok = m_manifest->sync() && ok;
+    }
+    return ok;
+}
+
+bool BatchGenerator::isDone(int fpIndex, int versionIndex) const {
+    return !m_done.empty() && m_done[static_cast<size_t>(fpIndex) * (m_config.versionsPerFingerprint + 1) + versionIndex] != 0;
+}
+
+void BatchGenerator::recordCompletion(int fpIndex, int versionIndex, uint32_t crc) {
+    if (!m_journal) {
+        return;  // A stream leaves nothing on disk to resume
+    }
+    Raster::JournalEntry entry;
+    entry.identity = static_cast<uint32_t>(identity(fpIndex));
+    entry.version = static_cast<uint16_t>(versionIndex);
+    entry.crc = crc;
+    m_journal->record(entry);  // A failure latches the journal and shows up in closeJournal()
+}
+
 bool BatchGenerator::saveFingerprint(const Image& image, const FingerprintInstance& instance, 
-                                     int fpIndex, int versionIndex) {
-    char filename[512];
-    int actualIndex = m_config.startIndex + fpIndex;
-    snprintf(filename, sizeof(filename), "%s/%s_%04d_v%02d.png",
-             m_config.outputDirectory.c_str(),
+                                     int fpIndex, int versionIndex, uint32_t& crc) {
+    char name[512];
+    int actualIndex = identity(fpIndex);
+    const bool wsq = m_config.imageCodec == ImageCodec::Wsq;
+    snprintf(name, sizeof(name), "%s_%04d_v%02d.%s",
              m_config.filenamePrefix.c_str(),
-             actualIndex, versionIndex);
+             actualIndex, versionIndex, wsq ? "wsq" : "png");
     
-    return image.save(filename);
+    // Slots are laid out identity-major: [fpIndex][versionIndex - 1]
+    if (m_tensor) {
+        uint64_t slot = static_cast<uint64_t>(fpIndex) * m_config.versionsPerFingerprint + (versionIndex - 1);
+        crc = Raster::crc32(0, image.data(), static_cast<size_t>(image.width()) * image.height());
+        return m_tensor->writeSlot(slot, constGrayView(image));
+    }
+    const bool streaming = m_config.streamOutput;
+    if (streaming && m_config.outputFormat == OutputFormat::Npy) {
+        const size_t size = static_cast<size_t>(image.width()) * image.height();
+        crc = Raster::crc32(0, image.data(), size);
+        return streamFrame(image, fpIndex, versionIndex, Raster::FrameFormat::Gray8, image.data(), size, crc);
+    }
+    
+    // Runs on a writer thread: each one keeps its own encoder buffers
+    const std::vector<uint8_t>* data;
+    if (wsq) {
+        data = &Raster::WsqWriter::forThread().encode(constGrayView(image), m_config.wsqBitrate, image.getDPI());
+        if (data->empty()) {
+            return false;
+        }
+    } else {
+        Raster::PngWriter& writer = Raster::PngWriter::forThread();
+        writer.setProfile(m_config.pngProfile);
+        data = &writer.encode(constGrayView(image), image.getDPI());
+    }
+    crc = Raster::crc32(0, data->data(), data->size());
+    
+    if (streaming) {
+        return streamFrame(image, fpIndex, versionIndex, wsq ? Raster::FrameFormat::Wsq : Raster::FrameFormat::Png,
+                           data->data(), data->size(), crc);
+    }
+    if (m_shards) {
+        // The tag brings the item back to the seal callback, which journals it
+        const uint64_t tag = (static_cast<uint64_t>(fpIndex) << 16) | static_cast<uint64_t>(versionIndex);
+        return m_shards->append(name, data->data(), data->size(), tag);
+    }
+    if (!writeBytes(m_config.outputDirectory + "/" + name, *data)) {
+        return false;
+    }
+    if (m_written) {
+        m_written->add(name);
+    }
+    return true;
+}
+
+// A reader that went away fails every later frame, so the batch stops instead of rendering for nobody
+bool BatchGenerator::streamFrame(const Image& image, int fpIndex, int versionIndex, Raster::FrameFormat format,
+                                 const void* data, size_t size, uint32_t crc) {
+    Raster::FrameHeader header;
+    header.identity = static_cast<uint32_t>(identity(fpIndex));
+    header.version = static_cast<uint16_t>(versionIndex);
+    header.format = format;
+    header.width = static_cast<uint32_t>(image.width());
+    header.height = static_cast<uint32_t>(image.height());
+    header.length = size;
+    header.crc = crc;
+    if (!(m_frameCallback ? m_frameCallback(header, data) : m_stream->write(header, data))) {
+        m_cancelled = true;
+        return false;
+    }
+    return true;
+}
+
+// Runs on the worker that rendered the image: the crop goes straight into a free slot, with
+// no encoder, write queue or pipe in between
+bool BatchGenerator::writeRingFrame(const Image& image, int fpIndex, int versionIndex) {
+    const size_t size = static_cast<size_t>(image.width()) * image.height();
+    if (size > m_ring->frameBytes()) {
+        m_ring->abort("an image is larger than a ring slot");
+        m_cancelled = true;
+        return false;
+    }
+    uint64_t sequence = 0;
+    uint8_t* slot = m_ring->acquire(sequence);
+    if (!slot) {
+        m_cancelled = true;  // The consumer went away: stop rendering for nobody
+        return false;
+    }
+    std::memcpy(slot, image.data(), size);
+    
+    Raster::FrameHeader header;
+    header.identity = static_cast<uint32_t>(identity(fpIndex));
+    header.version = static_cast<uint16_t>(versionIndex);
+    header.format = Raster::FrameFormat::Gray8;
+    header.width = static_cast<uint32_t>(image.width());
+    header.height = static_cast<uint32_t>(image.height());
+    header.length = size;
+    header.crc = Raster::crc32(0, slot, size);
+    m_ring->publish(sequence, header);
+    return true;
+}
+
+VersionTransform BatchGenerator::versionTransform(const FingerprintInstance& instance, int versionIndex) {
+    std::mt19937 versionRng;
+    Raster::seedEngine(versionRng, Raster::versionSeed(instance.seed, versionIndex));
+    return generateVersionTransform(versionIndex, versionRng);
+}
+
+Image BatchGenerator::renderVersion(const Image& baseFingerprint, const VersionTransform& transform,
+                                    int versionIndex) {
+    Image transformedFingerprint;
+    
+    if (versionIndex == 0) {
+        transformedFingerprint = baseFingerprint.copy();
+    } else {
+        transformedFingerprint = applyVersionTransforms(baseFingerprint, transform);
+    }
+    
+    if (m_config.applyEllipticalMask) {
+        transformedFingerprint = applyEllipticalMask(transformedFingerprint);
+    }
+    
+    return transformedFingerprint;
+}
+
+Raster::MemoryModel BatchGenerator::memoryModel() const {
+    const uint64_t crop = static_cast<uint64_t>(kCropWidth) * kCropHeight;
+    Raster::MemoryModel model;
+    model.baseline = Raster::privateRss() + kSharedBytes;
+    model.perIdentity = kIdentityBytesPerPixel * kMaxBasePixels;
+    model.perWorker = kVersionBytesPerPixel * kMaxBasePixels + crop;  // The finished crop being encoded
+    if (m_config.writeQueueDepth > 0) {
+        model.baseline += static_cast<uint64_t>(m_config.writeQueueDepth) * crop;
+    } else {
+        model.perWorker += 2 * crop;  // Its share of the write queue
+    }
+    return model;
+}
+
+Raster::WriteQueueStats BatchGenerator::writerStats() const {
+    return m_writer ? m_writer->stats() : m_writerStats;
 }
 
 bool BatchGenerator::generateBatch() {
@@ -397,105 +908,263 @@ bool BatchGenerator::generateBatch() {
     m_generated = 0;
     
     // Create output directory
-    std::filesystem::create_directories(m_config.outputDirectory);
+    const bool ring = !m_config.ringName.empty();
+    if (!m_config.streamOutput && !ring) {
+        std::filesystem::create_directories(m_config.outputDirectory);
+    }
     
     int numWorkers = m_numWorkers > 0 ? m_numWorkers : std::thread::hardware_concurrency();
+    if (m_pool) numWorkers = m_pool->size();
     if (numWorkers < 1) numWorkers = 1;
     
+    // A memory budget caps the identities in flight (and, past that, the workers
+    // of an own pool) so the estimated peak fits
+    m_memoryPlan = Raster::MemoryPlan();
+    m_memoryPlan.workers = numWorkers;
+    m_memoryPlan.identities = std::max(1, m_config.numFingerprints);
+    m_memoryPeak = 0;
+    if (m_config.memoryBudget > 0) {
+        Raster::returnLargeBlocks();
+        m_memoryPlan = Raster::planMemory(memoryModel(), m_config.memoryBudget, numWorkers, m_pool != nullptr);
+        numWorkers = m_memoryPlan.workers;
+        if (!m_memoryPlan.fits) {
+            std::cerr << "Warning: the memory budget (" << (m_config.memoryBudget >> 20) << " MiB) is below the "
+                      << (m_memoryPlan.estimate >> 20) << " MiB estimated for " << numWorkers
+                      << " worker(s) and one identity; continuing with that\n";
+        }
+    }
+    
     if (!m_config.quietMode) {
         std::cout << "Starting parallel batch generation with " << numWorkers << " workers\n";
         std::cout << "Total fingerprints: " << m_config.numFingerprints << "\n";
+        if (m_config.memoryBudget > 0) {
+            std::cout << "Memory budget: " << (m_config.memoryBudget >> 20) << " MiB, estimated peak "
+                      << (m_memoryPlan.estimate >> 20) << " MiB with " << m_memoryPlan.identities
+                      << " identities in flight\n";
+        }
     }
     
-    // Pre-create all fingerprint instances
-    std::vector<FingerprintInstance> instances(m_config.numFingerprints);
-    for (int i = 0; i < m_config.numFingerprints && !m_cancelled; ++i) {
-        instances[i] = createBaseFingerprint(i);
+    if (m_config.streamOutput || ring) {
+        // Nothing touches the disk: no journal, tensor or manifest, the frames carry it all
+        m_done.clear();
+        if (ring ? !openRingOutput(numWorkers) : (!m_frameCallback && !openStreamOutput())) {
+            return false;
+        }
+    } else {
+        if (!openJournal()) {
+            return false;
+        }
+        if (m_config.outputFormat == OutputFormat::Npy && !openTensorOutput()) {
+            m_journal.reset();
+            return false;
+        }
+        if (m_config.saveParameters && !openManifest()) {
+            m_tensor.reset();
+            m_journal.reset();
+            return false;
+        }
+        if (m_config.outputFormat == OutputFormat::Files) {
+            m_written = std::make_unique<Raster::FileSyncList>(m_config.outputDirectory);
+        }
+        m_journal->setSyncCallback([this]() { return syncOutput(); });
     }
     
-    // Task queue
-    std::queue<int> taskQueue;
-    for (int i = 0; i < m_config.numFingerprints; ++i) {
-        taskQueue.push(i);
+    // Encoding and writing run on their own threads behind a bounded queue, so
+    // compute workers never wait on deflate or write(); when the disk falls
+    // behind, a full queue blocks them instead of piling up images.
+    int numWriters = m_config.writerThreads > 0 ? m_config.writerThreads : std::max(1, numWorkers / 4);
+    int queueDepth = m_config.writeQueueDepth > 0 ? m_config.writeQueueDepth : 2 * numWorkers;
+    m_writer = std::make_unique<Raster::WriteQueue>(numWriters, queueDepth);
+    
+    if (m_config.outputFormat == OutputFormat::Shards) {
+        m_shards = std::make_unique<Raster::ShardWriter>(outputStem(), m_config.shardBytes, m_firstShard);
+        m_shards->setSealCallback([this](int index, const std::vector<Raster::ShardEntry>& entries) {
+            if (index + 1 > 0xFFFF) {
+                return;  // Past what the journal can name: left to be redone on resume
+            }
+            std::vector<Raster::JournalEntry> done;
+            done.reserve(entries.size());
+            for (const Raster::ShardEntry& entry : entries) {
+                Raster::JournalEntry item;
+                item.identity = static_cast<uint32_t>(identity(static_cast<int>(entry.tag >> 16)));
+                item.version = static_cast<uint16_t>(entry.tag & 0xFFFF);
+                item.shard = static_cast<uint16_t>(index + 1);
+                item.crc = entry.crc;
+                done.push_back(item);
+            }
+            m_journal->commit(done);  // The whole shard or none of it, so resume never splits one
+        });
     }
     
-    std::mutex queueMutex;
+    // Work-stealing pool: one task per identity renders the base image and then
+    // spawns one task per version. The spawning worker runs its versions first
+    // (LIFO) while idle workers steal the rest, so a long tail of versions of a
+    // few identities still spreads over every core. The ridge stage splits its
+    // Gabor iterations over the same pool.
+    std::unique_ptr<Raster::TaskPool> ownPool;
+    if (!m_pool) {
+        ownPool = std::make_unique<Raster::TaskPool>(numWorkers);
+    }
+    Raster::TaskPool& pool = m_pool ? *m_pool : *ownPool;
     std::atomic<int> completedFps(0);
+    const int startIdx = m_config.skipOriginal ? 1 : 0;
+    const int versionCount = m_config.versionsPerFingerprint - startIdx + 1;
     
-    // Worker function - cada thread tem seu próprio RNG para evitar race conditions
-    auto workerFunc = [&]() {
-        // RNG local por thread para evitar race conditions
-        std::random_device rd;
-        std::mt19937 localRng(rd());
-        
-        while (!m_cancelled) {
-            int taskIndex;
-            bool hasTask = false;
+    // Identities enter the pool as earlier ones finish, at most the limit at a
+    // time: all of them up front without a budget, the plan's count with one.
+    // The monitor lowers that count if the measured memory still goes over.
+    std::unique_ptr<Raster::MemoryMonitor> monitor;
+    if (m_config.memoryBudget > 0) {
+        monitor = std::make_unique<Raster::MemoryMonitor>(m_config.memoryBudget, m_memoryPlan.identities);
+    }
+    std::mutex admitMutex;
+    int nextIdentity = 0;
+    int inFlight = 0;
+    std::function<void(int)> spawnIdentity;
+    auto admitIdentities = [&]() {
+        std::lock_guard<std::mutex> lock(admitMutex);
+        const int limit = monitor ? monitor->limit() : m_config.numFingerprints;
+        while (inFlight < limit && nextIdentity < m_config.numFingerprints) {
+            ++inFlight;
+            spawnIdentity(nextIdentity++);
+        }
+    };
+    
+    // No RNG state lives in the workers: every draw comes from the identity/version
+    // seeds, so any worker produces the same images
+    auto finishIdentity = [&]() {
+        int fpCompleted = completedFps.fetch_add(1) + 1;
+        if (m_progressCallback) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_progressCallback(fpCompleted, m_config.numFingerprints, m_generated.load());
+        }
+        if (monitor) {
+            monitor->identityFinished();
+        }
+        {
+            std::lock_guard<std::mutex> lock(admitMutex);
+            --inFlight;
+        }
+        admitIdentities();
+    };
+    
+    spawnIdentity = [this, &pool, &finishIdentity, startIdx, versionCount](int fpIdx) {
+        pool.spawn([this, &pool, &finishIdentity, fpIdx, startIdx, versionCount]() {
+            if (m_cancelled) {
+                return;
+            }
             
-            {
-                std::lock_guard<std::mutex> lock(queueMutex);
-                if (!taskQueue.empty()) {
-                    taskIndex = taskQueue.front();
-                    taskQueue.pop();
-                    hasTask = true;
-                }
+            auto instance = std::make_shared<const FingerprintInstance>(createBaseFingerprint(fpIdx));
+            if (m_tensor) {
+                IdentityLabel& label = m_labels[fpIdx];  // One slot per identity task, no lock
+                label.fingerprintClass = instance->baseParams.classification.fingerprintClass;
+                label.seed = instance->seed;
+                label.valid = true;
             }
             
-            if (!hasTask) break;
+            // A resumed batch renders only the versions missing from its journal
+            int missing = 0;
+            for (int verIdx = startIdx; verIdx <= m_config.versionsPerFingerprint; ++verIdx) {
+                missing += isDone(fpIdx, verIdx) ? 0 : 1;
+            }
+            if (missing == 0) {
+                finishIdentity();
+                return;
+            }
             
-            // CRIAR NOVO GENERATOR PARA CADA TAREFA para garantir isolamento total
             FingerprintGenerator localGenerator;
+            localGenerator.setParameters(instance->baseParams);
+            localGenerator.setSingularPoints(instance->basePoints);
+            localGenerator.setSeed(instance->seed);
             
-            // Configure generator
-            localGenerator.setParameters(instances[taskIndex].baseParams);
-            localGenerator.setSingularPoints(instances[taskIndex].basePoints);
-            
-            // Generate base image
-            Image baseFingerprint = localGenerator.generateFingerprint();
+            // Shared by the version tasks; freed when the last one finishes
+            auto baseFingerprint = std::make_shared<const Image>(localGenerator.generateFingerprint());
+            if (m_manifest && missing == versionCount) {
+                appendIdentityRecord(*instance, fpIdx, localGenerator.getMinutiae());
+            }
+            auto remaining = std::make_shared<std::atomic<int>>(missing);
             
-            // Generate all versions
-            int startIdx = m_config.skipOriginal ? 1 : 0;
-            for (int verIdx = startIdx; verIdx <= m_config.versionsPerFingerprint && !m_cancelled; ++verIdx) {
-                Image transformedFingerprint;
-                
-                if (verIdx == 0) {
-                    transformedFingerprint = baseFingerprint.copy();
-                } else {
-                    VersionTransform transform = generateVersionTransformLocal(verIdx, localRng);
-                    transformedFingerprint = applyVersionTransforms(baseFingerprint, transform);
-                }
-                
-                if (m_config.applyEllipticalMask) {
-                    transformedFingerprint = applyEllipticalMask(transformedFingerprint);
-                }
-                
-                if (!saveFingerprint(transformedFingerprint, instances[taskIndex], taskIndex, verIdx)) {
+            for (int verIdx = startIdx; verIdx <= m_config.versionsPerFingerprint; ++verIdx) {
+                if (isDone(fpIdx, verIdx)) {
                     continue;
                 }
-                
-                m_generated.fetch_add(1);
-            }
-            
-            int fpCompleted = completedFps.fetch_add(1) + 1;
-            
-            if (m_progressCallback) {
-                m_progressCallback(fpCompleted, m_config.numFingerprints, m_generated.load());
+                pool.spawn([this, &finishIdentity, instance, baseFingerprint, remaining, fpIdx, verIdx]() {
+                    if (!m_cancelled) {
+                        const VersionTransform transform = verIdx > 0 ? versionTransform(*instance, verIdx)
+                                                                      : VersionTransform();
+                        Image image = renderVersion(*baseFingerprint, transform, verIdx);
+                        if (m_ring) {
+                            if (writeRingFrame(image, fpIdx, verIdx)) {
+                                m_generated.fetch_add(1);
+                            }
+                        } else {
+                            m_writer->push([this, image = std::move(image), instance, transform, fpIdx, verIdx]() {
+                                uint32_t crc = 0;
+                                if (!saveFingerprint(image, *instance, fpIdx, verIdx, crc)) {
+                                    return false;
+                                }
+                                if (m_manifest) {
+                                    appendVersionRecord(fpIdx, verIdx, transform);
+                                }
+                                if (!m_shards) {
+                                    recordCompletion(fpIdx, verIdx, crc);
+                                }
+                                m_generated.fetch_add(1);
+                                return true;
+                            });
+                        }
+                    }
+                    if (remaining->fetch_sub(1) == 1) {
+                        finishIdentity();
+                    }
+                });
             }
-        }
+        });
     };
+    admitIdentities();
     
-    // Create and start threads
-    std::vector<std::thread> threads;
-    for (int i = 0; i < numWorkers; ++i) {
-        threads.emplace_back(workerFunc);
+    pool.wait();
+    m_writer->finish();
+    m_writerStats = m_writer->stats();
+    m_writer.reset();
+    if (monitor) {
+        monitor->stop();
+        m_memoryPeak = monitor->peak();
+        if (monitor->cuts() > 0 && !m_config.quietMode) {
+            std::cout << "Memory: measured use went over the budget, identities in flight lowered to "
+                      << monitor->limit() << "\n";
+        }
     }
     
-    // Wait for completion
-    for (auto& t : threads) {
-        t.join();
+    bool ok = true;
+    if (m_shards) {
+        if (!m_shards->close()) {
+            std::cerr << "Shard output failed: " << m_shards->error() << "\n";
+            ok = false;
+        } else if (!m_config.quietMode) {
+            std::cout << "Shards: " << m_shards->entryCount() << " images in "
+                      << m_shards->shardCount() << " files\n";
+        }
+        m_shards.reset();
+    }
+    if (m_stream && !closeStreamOutput()) {
+        ok = false;
+    }
+    if (m_ring && !closeRingOutput()) {
+        ok = false;
+    }
+    // Last commit before the outputs it syncs are closed
+    if (m_journal && !closeJournal()) {
+        ok = false;
+    }
+    if (m_tensor && !closeTensorOutput()) {
+        ok = false;
+    }
+    if (m_manifest && !closeManifest()) {
+        ok = false;
     }
     
-    return !m_cancelled;
+    return ok && !m_cancelled;
 }
 
 } // namespace SFinGe
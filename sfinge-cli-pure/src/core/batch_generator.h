@@ -7,10 +7,24 @@
 #include <mutex>
 #include <random>
 #include <functional>
+#include <memory>
 #include "image.h"
 #include "fingerprint_generator.h"
 #include "models/singular_points.h"
 #include "models/fingerprint_parameters.h"
+#include "raster/warp.h"
+#include "raster/write_queue.h"
+#include "raster/png_writer.h"
+#include "raster/shard.h"
+#include "raster/npy_file.h"
+#include "raster/wsq.h"
+#include "raster/manifest.h"
+#include "raster/journal.h"
+#include "raster/partition.h"
+#include "raster/frame_stream.h"
+#include "raster/shm_ring.h"
+#include "raster/task_pool.h"
+#include "raster/memory_budget.h"
 
 namespace SFinGe {
 
@@ -28,26 +42,64 @@ struct VersionTransform {
     int blurRadius = 0;
     double blurCenterX = 0.0;
     double blurCenterY = 0.0;
+    uint64_t noiseSeed = 0;
+    double blurSigma = 1.0;
+};
+
+enum class OutputFormat {
+    Files,   // One PNG per version
+    Shards,  // PNGs packed into large indexed shard files (raster/shard.h)
+    Npy      // Raw uint8 tensor [N, versions, H, W] written in place (raster/npy_file.h)
+};
+
+enum class ImageCodec {
+    Png,  // Lossless (raster/png_writer.h)
+    Wsq   // FBI wavelet scalar quantization, lossy (raster/wsq.h)
 };
 
 struct BatchConfig {
     int numFingerprints = 10;
     int versionsPerFingerprint = 3;
     int startIndex = 0;
+    int identityStride = 1;  // Identity of item n is startIndex + n * identityStride
+    int shardIndex = 0;      // Node partition (--shard K/N) this batch is part of
+    int shardCount = 1;
+    int rangeStart = 0;      // Whole partitioned range, recorded so the nodes can be merged
+    int rangeCount = 0;
+    uint64_t seed = 0;  // Master seed; identity N and its versions derive theirs from (seed, N)
+    bool fixedSeed = true;  // false: a resumed batch takes the seed stored in its journal
     bool usePopulationDistribution = true;
     bool skipOriginal = true;
     bool applyEllipticalMask = true;
     bool quietMode = false;
+    bool fusedWarp = false;  // Lens/homography/rotation/crop as a single resample
+    Raster::Interpolation warpInterpolation = Raster::Interpolation::Bilinear;
+    double maxBlurSigma = 1.0;  // Max defocus sigma drawn per version (1 = light blur)
+    int writerThreads = 0;      // PNG encode/write threads (0 = one per four workers)
+    int writeQueueDepth = 0;    // Finished images waiting for a writer (0 = two per worker)
+    Raster::PngProfile pngProfile = Raster::PngProfile::Balanced;  // Encoder speed/size trade-off
+    OutputFormat outputFormat = OutputFormat::Files;
+    ImageCodec imageCodec = ImageCodec::Png;  // Encoding of files and shard entries
+    double wsqBitrate = Raster::WsqWriter::kDefaultBitrate;  // Bits per pixel
+    uint64_t shardBytes = 1ull << 30;  // A new shard file starts past this size
     
     std::string outputDirectory = "./output";
+    bool streamOutput = false;    // Frames on stdout instead of files (raster/frame_stream.h); Npy sends raw pixels
+    std::string ringName;         // Raw crops into this shared-memory ring instead of files (raster/shm_ring.h)
+    int ringSlots = 0;            // Ring size in images (0 = four per worker)
     std::string filenamePrefix = "fingerprint";
-    bool saveParameters = false;
+    bool saveParameters = false;  // Ground-truth manifest next to the images (raster/manifest.h)
+    bool resume = false;          // Skip the images the completion journal lists (raster/journal.h)
+    uint64_t memoryBudget = 0;    // Private memory the batch may use, in bytes (0 = no limit; raster/memory_budget.h)
+    
+    MinutiaeParameters minutiae;  // Método de geração de minúcias (linha de comando)
 };
 
 struct FingerprintInstance {
     FingerprintParameters baseParams;
     SingularPoints basePoints;
     std::string identifier;
+    uint64_t seed = 0;  // Identity seed (every stage of this fingerprint derives from it)
 };
 
 class BatchGenerator {
@@ -56,36 +108,104 @@ public:
     
     void setBatchConfig(const BatchConfig& config);
     void setNumWorkers(int workers) { m_numWorkers = workers; }
+    // Runs the batch on a pool that outlives it (a server keeps its workers warm); null = own pool
+    void setTaskPool(Raster::TaskPool* pool) { m_pool = pool; }
+    
+    // With streamOutput, frames go here instead of stdout (called from the writer threads)
+    using FrameCallback = std::function<bool(const Raster::FrameHeader& header, const void* data)>;
+    void setFrameCallback(FrameCallback callback) { m_frameCallback = std::move(callback); }
     
     bool generateBatch();
     void cancel() { m_cancelled = true; }
     
     using ProgressCallback = std::function<void(int, int, int)>;
     void setProgressCallback(ProgressCallback callback) { m_progressCallback = callback; }
+    
+    // Writer stage counters: live while generateBatch() runs (e.g. from the
+    // progress callback), final values afterwards
+    Raster::WriteQueueStats writerStats() const;
+    
+    // With memoryBudget: the parallelism the batch ran with and the largest
+    // private memory it used (sampled; Raster::peakRss() has the process peak)
+    const Raster::MemoryPlan& memoryPlan() const { return m_memoryPlan; }
+    uint64_t memoryPeak() const { return m_memoryPeak; }
 
 private:
+    // Every version is cropped to this size (also the NPY slot shape)
+    static constexpr int kCropWidth = 750;
+    static constexpr int kCropHeight = 900;
+    
+    struct IdentityLabel {
+        bool valid = false;
+        FingerprintClass fingerprintClass = FingerprintClass::None;
+        uint64_t seed = 0;
+    };
+    
+    int identity(int fpIndex) const { return m_config.startIndex + fpIndex * m_config.identityStride; }
+    std::string outputStem() const;
+    bool openTensorOutput();
+    bool closeTensorOutput();
+    bool openStreamOutput();
+    bool closeStreamOutput();
+    Raster::MemoryModel memoryModel() const;  // Peak of a batch by workers and identities in flight
+    bool openRingOutput(int numWorkers);
+    bool closeRingOutput();
+    bool openManifest();
+    bool closeManifest();
+    void appendIdentityRecord(const FingerprintInstance& instance, int fpIndex, const std::vector<Minutia>& minutiae);
+    void appendVersionRecord(int fpIndex, int versionIndex, const VersionTransform& transform);
+    uint32_t configHash() const;
+    bool openJournal();
+    bool closeJournal();
+    bool syncOutput();
+    bool isDone(int fpIndex, int versionIndex) const;
+    void recordCompletion(int fpIndex, int versionIndex, uint32_t crc);
+    
     FingerprintInstance createBaseFingerprint(int index);
-    VersionTransform generateVersionTransform(int versionIndex);
-    VersionTransform generateVersionTransformLocal(int versionIndex, std::mt19937& rng);
+    VersionTransform generateVersionTransform(int versionIndex, std::mt19937& rng);
+    VersionTransform versionTransform(const FingerprintInstance& instance, int versionIndex);  // Seeded from (identity, version)
     Image applyVersionTransforms(const Image& baseImage, const VersionTransform& transform);
-    Image applyNoise(const Image& image, double noiseLevel);
-    Image applyBlur(const Image& image, int radius, double centerX, double centerY);
+    Image applyFusedVersionTransforms(const Image& baseImage, const VersionTransform& transform);
+    Image applyNoise(const Image& image, double noiseLevel, uint64_t seed);
+    Image applyBlur(const Image& image, int radius, double centerX, double centerY, double sigma);
     Image applyLensDistortion(const Image& image, double k);
     Image applyHomography(const Image& image, double shiftX, double shiftY, double angle);
     Image applyRotation(const Image& image, double angle);
     Image applyCrop(const Image& image, int targetWidth, int targetHeight);
     Image applyEllipticalMask(const Image& image);
-    bool saveFingerprint(const Image& image, const FingerprintInstance& instance, int fpIndex, int versionIndex);
-    FingerprintClass selectClassByPopulation();
+    Image renderVersion(const Image& baseFingerprint, const VersionTransform& transform, int versionIndex);
+    bool saveFingerprint(const Image& image, const FingerprintInstance& instance, int fpIndex, int versionIndex,
+                         uint32_t& crc);
+    bool streamFrame(const Image& image, int fpIndex, int versionIndex, Raster::FrameFormat format,
+                     const void* data, size_t size, uint32_t crc);
+    bool writeRingFrame(const Image& image, int fpIndex, int versionIndex);
+    FingerprintClass selectClassByPopulation(std::mt19937& rng);
     
     BatchConfig m_config;
     int m_numWorkers = 0;
+    Raster::TaskPool* m_pool = nullptr;
+    FrameCallback m_frameCallback;
     std::atomic<bool> m_cancelled{false};
     std::atomic<int> m_generated{0};
-    std::mutex m_mutex;
-    std::mt19937 m_rng;
+    std::mutex m_mutex;  // Serializes progress callbacks from the workers
     
     ProgressCallback m_progressCallback;
+    
+    std::unique_ptr<Raster::WriteQueue> m_writer;
+    Raster::WriteQueueStats m_writerStats;
+    Raster::MemoryPlan m_memoryPlan;
+    uint64_t m_memoryPeak = 0;
+    std::unique_ptr<Raster::ShardWriter> m_shards;  // Set while a sharded batch runs
+    std::unique_ptr<Raster::NpyFile> m_tensor;      // Set while an NPY batch runs
+    std::unique_ptr<Raster::FrameStreamWriter> m_stream;  // Set while a batch streams to stdout
+    std::unique_ptr<Raster::ShmRingWriter> m_ring;        // Set while a batch feeds a shared-memory ring
+    std::vector<IdentityLabel> m_labels;            // Per identity, for the NPY labels file
+    std::unique_ptr<Raster::ManifestWriter> m_manifest;  // Set while a batch saves its parameters
+    std::unique_ptr<Raster::CompletionJournal> m_journal;  // Set while a batch runs
+    std::unique_ptr<Raster::FileSyncList> m_written;       // Files awaiting the next journal commit
+    std::vector<uint8_t> m_done;  // [fpIndex * (versions + 1) + version], from a resumed journal
+    bool m_resumed = false;
+    int m_firstShard = 0;         // Shards below it are sealed and listed in the journal
 };
 
 } // namespace SFinGe
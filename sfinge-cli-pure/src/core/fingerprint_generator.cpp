@@ -1,4 +1,5 @@
 #include "fingerprint_generator.h"
+#include "raster/random.h"
 #include <cmath>
 #include <algorithm>
 
@@ -9,7 +10,7 @@
 namespace SFinGe {
 
 FingerprintGenerator::FingerprintGenerator() 
-    : m_width(0), m_height(0), m_rng(std::random_device{}()) {
+    : m_width(0), m_height(0) {
 }
 
 void FingerprintGenerator::setParameters(const FingerprintParameters& params) {
@@ -73,19 +74,16 @@ void FingerprintGenerator::generateOrientationMap() {
 }
 
 Image FingerprintGenerator::generateFingerprint() {
-    // Reinicializar RNG para garantir isolamento entre threads
-    std::random_device rd;
-    m_rng.seed(rd());
-    
-    // Reinicializar RNG do orientation generator
-    m_orientationGenerator.reseed();
+    // Todas as etapas partem da semente da identidade: o resultado não depende
+    // de qual worker gera a impressão nem do que ele gerou antes
+    Raster::seedEngine(m_rng, Raster::streamSeed(m_seed, Raster::SeedStream::Density));
+    m_orientationGenerator.reseed(Raster::streamSeed(m_seed, Raster::SeedStream::Orientation));
     
     generateShapeMap();
     generateDensityMap();
     generateOrientationMap();
     
-    // Reinicializar RNG do ridge generator para evitar contaminação entre threads
-    m_ridgeGenerator.reseed();
+    m_ridgeGenerator.reseed(Raster::streamSeed(m_seed, Raster::SeedStream::Ridge));
     
     // Configure ridge generator
     m_ridgeGenerator.setParameters(m_params.ridge, m_params.density, 
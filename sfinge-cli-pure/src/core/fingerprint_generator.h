@@ -17,8 +17,14 @@ public:
     void setParameters(const FingerprintParameters& params);
     void setSingularPoints(const SingularPoints& points);
     
+    // Semente da identidade; cada etapa (densidade, orientação, cristas) deriva a sua
+    void setSeed(uint64_t seed) { m_seed = seed; }
+    
     Image generateFingerprint();
     
+    // Minúcias da última generateFingerprint(), em coordenadas da imagem base
+    const std::vector<Minutia>& getMinutiae() const { return m_ridgeGenerator.getMinutiae(); }
+    
 private:
     void generateShapeMap();
     void generateDensityMap();
@@ -37,6 +43,7 @@ private:
     OrientationGenerator m_orientationGenerator;
     RidgeGenerator m_ridgeGenerator;
     std::mt19937 m_rng;
+    uint64_t m_seed = 0;
 };
 
 } // namespace SFinGe
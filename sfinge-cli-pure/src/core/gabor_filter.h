@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <cmath>
+#include <memory>
 
 namespace SFinGe {
 
@@ -26,6 +27,10 @@ public:
     GaborFilterCache(int cacheDegrees, int cacheFrequencies, 
                      double minFreq, double maxFreq, int filterSize);
     
+    // Banco pronto para estes parâmetros, construído uma vez por processo e compartilhado entre threads
+    static std::shared_ptr<const GaborFilterCache> shared(int cacheDegrees, int cacheFrequencies,
+                                                          double minFreq, double maxFreq, int filterSize);
+    
     const GaborFilter& getFilter(int degreeIndex, int freqIndex) const;
     
     int getCacheDegrees() const { return m_cacheDegrees; }
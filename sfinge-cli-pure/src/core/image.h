@@ -15,6 +15,8 @@ public:
     Image(int width, int height);
     Image(const Image& other);
     Image& operator=(const Image& other);
+    Image(Image&& other) noexcept = default;      // Moves the buffer (write queue, result = f(result))
+    Image& operator=(Image&& other) noexcept = default;
     
     int width() const { return m_width; }
     int height() const { return m_height; }
@@ -1,4 +1,5 @@
 #include "minutiae_generator.h"
+#include "raster/random.h"
 #include <cmath>
 #include <algorithm>
 
@@ -9,12 +10,11 @@
 namespace SFinGe {
 
 MinutiaeGenerator::MinutiaeGenerator() 
-    : m_width(0), m_height(0), m_coreX(0), m_coreY(0), m_rng(std::random_device{}()) {
+    : m_width(0), m_height(0), m_coreX(0), m_coreY(0) {
 }
 
-void MinutiaeGenerator::reseed() {
-    std::random_device rd;
-    m_rng.seed(rd());
+void MinutiaeGenerator::reseed(uint64_t seed) {
+    Raster::seedEngine(m_rng, seed);
 }
 
 void MinutiaeGenerator::setParameters(const MinutiaeParameters& params) {
@@ -242,6 +242,15 @@ void MinutiaeGenerator::insertBifurcation(std::vector<float>& ridgeMap, const Mi
     }
 }
 
+void MinutiaeGenerator::insertRidgeEndingImproved(std::vector<float>& ridgeMap, const Minutia& m) {
+    // No campo de fase contínuo a inserção explícita usa o mesmo traçado do método original
+    insertRidgeEnding(ridgeMap, m);
+}
+
+void MinutiaeGenerator::insertBifurcationImproved(std::vector<float>& ridgeMap, const Minutia& m) {
+    insertBifurcation(ridgeMap, m);
+}
+
 void MinutiaeGenerator::applyMinutiae(std::vector<float>& ridgeMap) {
     if ((!m_params.enableExplicitMinutiae && !m_params.useContinuousPhase) || m_minutiae.empty()) {
         return;
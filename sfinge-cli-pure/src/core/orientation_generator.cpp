@@ -1,4 +1,5 @@
 #include "orientation_generator.h"
+#include "raster/random.h"
 #include <cmath>
 #include <algorithm>
 #include <iostream>
@@ -10,8 +11,7 @@
 namespace SFinGe {
 
 OrientationGenerator::OrientationGenerator() 
-    : m_width(0), m_height(0), m_fpClass(FingerprintClass::RightLoop),
-      m_rng(std::random_device{}()) {
+    : m_width(0), m_height(0), m_fpClass(FingerprintClass::RightLoop) {
 }
 
 void OrientationGenerator::setSingularPoints(const SingularPoints& points) {
@@ -397,9 +397,8 @@ Image OrientationGenerator::generate() {
     return image;
 }
 
-void OrientationGenerator::reseed() {
-    std::random_device rd;
-    m_rng.seed(rd());
+void OrientationGenerator::reseed(uint64_t seed) {
+    Raster::seedEngine(m_rng, seed);
 }
 
 } // namespace SFinGe
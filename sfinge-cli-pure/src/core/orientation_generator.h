@@ -1,6 +1,7 @@
 #ifndef ORIENTATION_GENERATOR_H
 #define ORIENTATION_GENERATOR_H
 
+#include <cstdint>
 #include <vector>
 #include <random>
 #include "image.h"
@@ -13,7 +14,7 @@ class OrientationGenerator {
 public:
     OrientationGenerator();
     
-    void reseed();
+    void reseed(uint64_t seed);
     
     void setSingularPoints(const SingularPoints& points);
     void setShapeMap(const std::vector<float>& shapeMap, int width, int height);
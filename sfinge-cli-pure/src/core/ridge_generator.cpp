@@ -1,4 +1,7 @@
 #include "ridge_generator.h"
+#include "raster/morphology.h"
+#include "raster/quantize.h"
+#include "raster/task_pool.h"
 #include <cmath>
 #include <algorithm>
 #include <random>
@@ -10,15 +13,14 @@
 namespace SFinGe {
 
 RidgeGenerator::RidgeGenerator() 
-    : m_width(0), m_height(0), m_coreX(0), m_coreY(0), m_rng(std::random_device{}()) {
+    : m_width(0), m_height(0), m_coreX(0), m_coreY(0) {
     m_perm.resize(512);
-    reseed();
+    reseed(0);
 }
 
-void RidgeGenerator::reseed() {
-    // Reinicializar RNG com nova seed do sistema
-    std::random_device rd;
-    m_rng.seed(rd());
+void RidgeGenerator::reseed(uint64_t seed) {
+    m_seed = seed;
+    Raster::seedEngine(m_rng, seed);
     
     // Reinicializar tabela de permutação para Perlin noise
     std::vector<int> p(256);
@@ -28,6 +30,11 @@ void RidgeGenerator::reseed() {
         m_perm[i] = p[i];
         m_perm[256 + i] = p[i];
     }
+    setNoiseKey(Raster::streamSeed(seed, Raster::SeedStream::PixelNoise), 0);
+}
+
+void RidgeGenerator::setNoiseKey(uint64_t seed, uint32_t image) {
+    m_noiseStream = Raster::RandomStream(seed, image, Raster::NoiseStage::RidgeNoise);
 }
 
 void RidgeGenerator::setMinutiaeParameters(const MinutiaeParameters& params) {
@@ -90,9 +97,10 @@ double RidgeGenerator::applyFilter(const GaborFilter& filter, int x, int y,
 
 void RidgeGenerator::generateRidgeMap() {
     int filterSize = m_params.gaborFilterSize * 2 + 1;
-    GaborFilterCache cache(m_params.cacheDegrees, m_params.cacheFrequencies,
-                          m_densityParams.minFrequency, m_densityParams.maxFrequency,
-                          filterSize);
+    const std::shared_ptr<const GaborFilterCache> bank = GaborFilterCache::shared(
+        m_params.cacheDegrees, m_params.cacheFrequencies,
+        m_densityParams.minFrequency, m_densityParams.maxFrequency, filterSize);
+    const GaborFilterCache& cache = *bank;
     
     m_ridgeMap.resize(m_width * m_height);
     
@@ -117,36 +125,40 @@ void RidgeGenerator::generateRidgeMap() {
     for (int iteration = 0; iteration < m_params.maxIterations; ++iteration) {
         std::fill(newRidge.begin(), newRidge.end(), 0.0f);
         
-        for (int j = 0; j < m_height; ++j) {
-            for (int i = 0; i < m_width; ++i) {
-                int idx = j * m_width + i;
-                
-                if (m_shapeMap[idx] < 0.1f) {
-                    continue;
+        // Iteração de Jacobi (lê m_ridgeMap, escreve newRidge): linhas independentes,
+        // divididas no pool de tarefas do lote quando houver um
+        Raster::parallelFor(0, m_height, kRowsPerTask, [&](int j0, int j1) {
+            for (int j = j0; j < j1; ++j) {
+                for (int i = 0; i < m_width; ++i) {
+                    int idx = j * m_width + i;
+                    
+                    if (m_shapeMap[idx] < 0.1f) {
+                        continue;
+                    }
+                    
+                    double theta = m_orientationMap[idx];
+                    double thetaNorm = theta;
+                    if (thetaNorm < 0) thetaNorm += 2.0 * M_PI;
+                    
+                    double freq = m_densityMap[idx];
+                    
+                    int degIdx = std::min(static_cast<int>(thetaNorm / (2.0 * M_PI) * m_params.cacheDegrees), 
+                                         m_params.cacheDegrees - 1);
+                    int freqIdx = std::min(static_cast<int>((freq - m_densityParams.minFrequency) / 
+                                          (m_densityParams.maxFrequency - m_densityParams.minFrequency) * 
+                                          m_params.cacheFrequencies), 
+                                         m_params.cacheFrequencies - 1);
+                    
+                    if (degIdx < 0) degIdx = 0;
+                    if (freqIdx < 0) freqIdx = 0;
+                    
+                    const GaborFilter& filter = cache.getFilter(degIdx, freqIdx);
+                    double response = applyFilter(filter, i, j, m_ridgeMap);
+                    
+                    newRidge[idx] = response > 0.0 ? 1.0f : 0.0f;
                 }
-                
-                double theta = m_orientationMap[idx];
-                double thetaNorm = theta;
-                if (thetaNorm < 0) thetaNorm += 2.0 * M_PI;
-                
-                double freq = m_densityMap[idx];
-                
-                int degIdx = std::min(static_cast<int>(thetaNorm / (2.0 * M_PI) * m_params.cacheDegrees), 
-                                     m_params.cacheDegrees - 1);
-                int freqIdx = std::min(static_cast<int>((freq - m_densityParams.minFrequency) / 
-                                      (m_densityParams.maxFrequency - m_densityParams.minFrequency) * 
-                                      m_params.cacheFrequencies), 
-                                     m_params.cacheFrequencies - 1);
-                
-                if (degIdx < 0) degIdx = 0;
-                if (freqIdx < 0) freqIdx = 0;
-                
-                const GaborFilter& filter = cache.getFilter(degIdx, freqIdx);
-                double response = applyFilter(filter, i, j, m_ridgeMap);
-                
-                newRidge[idx] = response > 0.0 ? 1.0f : 0.0f;
             }
-        }
+        });
         
         // Copiar resultado da iteração (early stopping desabilitado para mais iterações)
         m_ridgeMap = newRidge;
@@ -162,7 +174,7 @@ Image RidgeGenerator::generate() {
     
     // Gerar e aplicar minúcias - método original ou melhorado
     if (m_minutiaeParams.enableExplicitMinutiae || m_minutiaeParams.useContinuousPhase) {
-        m_minutiaeGenerator.reseed();
+        m_minutiaeGenerator.reseed(Raster::streamSeed(m_seed, Raster::SeedStream::Minutiae));
         m_minutiaeGenerator.setParameters(m_minutiaeParams);
         m_minutiaeGenerator.setOrientationMap(m_orientationMap, m_width, m_height);
         m_minutiaeGenerator.setShapeMap(m_shapeMap);
@@ -177,14 +189,10 @@ Image RidgeGenerator::generate() {
     
     Image image(m_width, m_height);
     
-    for (int j = 0; j < m_height; ++j) {
-        for (int i = 0; i < m_width; ++i) {
-            int idx = j * m_width + i;
-            int gray = static_cast<int>(255 * (1.0f - rendered[idx]));
-            gray = std::clamp(gray, 0, 255);
-            image.setPixel(i, j, static_cast<uint8_t>(gray));
-        }
-    }
+    // Inverter (cristas = escuro) e quantizar direto no buffer da imagem
+    Raster::QuantizeOptions options;
+    options.invert = true;
+    Raster::quantizePlane(rendered.data(), m_width, m_height, image.data(), m_width, options);
     
     return image;
 }
@@ -294,17 +302,19 @@ double RidgeGenerator::perlinNoise(double x, double y) {
 }
 
 void RidgeGenerator::applyGaussianNoise(std::vector<float>& image, double amplitude) {
-    std::normal_distribution<double> noise(0.0, amplitude);
+    // Amostras N(0, amplitude) de uma linha por vez, indexadas pelo pixel
+    std::vector<float> gaussian(m_width);
     
     for (int j = 0; j < m_height; ++j) {
+        Raster::fillNormal(m_noiseStream, static_cast<uint64_t>(j) * m_width, gaussian.data(),
+                           gaussian.size(), 0.0f, static_cast<float>(amplitude));
         for (int i = 0; i < m_width; ++i) {
             int idx = j * m_width + i;
             if (m_shapeMap[idx] > 0.1f) {
                 double perlin = perlinNoise(i * m_renderParams.ridgeNoiseFrequency,
                                             j * m_renderParams.ridgeNoiseFrequency);
-                double gaussian = noise(m_rng);
                 
-                image[idx] += static_cast<float>(perlin * amplitude * 0.5 + gaussian);
+                image[idx] += static_cast<float>(perlin * amplitude * 0.5 + gaussian[i]);
                 image[idx] = std::clamp(image[idx], 0.0f, 1.0f);
             }
         }
@@ -378,45 +388,33 @@ void RidgeGenerator::applyElasticDistortion(std::vector<float>& image) {
 }
 
 void RidgeGenerator::applySkinCondition(std::vector<float>& image) {
+    // Simula pele úmida (dilatação) ou seca (erosão)
     double factor = m_varParams.skinConditionFactor;
     if (std::abs(factor) < 0.01) return;
     
-    std::vector<float> result(m_width * m_height);
-    int kernelSize = 3;
-    int halfK = kernelSize / 2;
+    // factor > 0: úmida (dilata cristas = mais escuro = max)
+    // factor < 0: seca (erode cristas = menos escuro = min)
+    Raster::MorphologyOptions morph;
+    morph.radius = std::max(1, m_varParams.skinConditionRadius);
+    morph.shape = m_varParams.skinConditionDiscKernel ? Raster::StructuringElement::Disc
+                                                      : Raster::StructuringElement::Rectangle;
+    
+    std::vector<float> filtered(m_width * m_height);
+    if (factor > 0) {
+        Raster::maxFilter(image.data(), filtered.data(), m_width, m_height, morph);
+    } else {
+        Raster::minFilter(image.data(), filtered.data(), m_width, m_height, morph);
+    }
     
-    for (int j = 0; j < m_height; ++j) {
-        for (int i = 0; i < m_width; ++i) {
-            int idx = j * m_width + i;
-            
-            if (m_shapeMap[idx] < 0.1f) {
-                result[idx] = 0.0f;
-                continue;
-            }
-            
-            float minVal = 1.0f, maxVal = 0.0f;
-            
-            for (int dy = -halfK; dy <= halfK; ++dy) {
-                for (int dx = -halfK; dx <= halfK; ++dx) {
-                    int ni = std::clamp(i + dx, 0, m_width - 1);
-                    int nj = std::clamp(j + dy, 0, m_height - 1);
-                    float val = image[nj * m_width + ni];
-                    minVal = std::min(minVal, val);
-                    maxVal = std::max(maxVal, val);
-                }
-            }
-            
-            float original = image[idx];
-            if (factor > 0) {
-                result[idx] = original + static_cast<float>(factor * (maxVal - original));
-            } else {
-                result[idx] = original + static_cast<float>((-factor) * (minVal - original));
-            }
-            result[idx] = std::clamp(result[idx], 0.0f, 1.0f);
+    float strength = static_cast<float>(std::abs(factor));
+    for (int idx = 0; idx < m_width * m_height; ++idx) {
+        if (m_shapeMap[idx] < 0.1f) {
+            image[idx] = 0.0f;
+            continue;
         }
+        float original = image[idx];
+        image[idx] = std::clamp(original + strength * (filtered[idx] - original), 0.0f, 1.0f);
     }
-    
-    image = result;
 }
 
 }
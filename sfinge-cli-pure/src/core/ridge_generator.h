@@ -5,6 +5,7 @@
 #include <random>
 #include "image.h"
 #include "models/fingerprint_parameters.h"
+#include "raster/random.h"
 #include "gabor_filter.h"
 #include "minutiae_generator.h"
 
@@ -14,8 +15,9 @@ class RidgeGenerator {
 public:
     RidgeGenerator();
     
-    // Reinicializa o RNG com nova seed - DEVE ser chamado antes de cada geração
-    void reseed();
+    // Reinicializa o RNG com a semente da etapa Ridge - DEVE ser chamado antes de cada geração
+    // (minúcias e ruído por pixel derivam suas sementes desta)
+    void reseed(uint64_t seed);
     
     void setParameters(const RidgeParameters& params, const DensityParameters& densityParams,
                         const RenderingParameters& renderParams, const VariationParameters& varParams);
@@ -25,6 +27,9 @@ public:
     void setShapeMap(const std::vector<float>& shapeMap);
     void setCorePosition(double coreX, double coreY);
     
+    // Chave do ruído por pixel desta impressão (reseed() a deriva da semente)
+    void setNoiseKey(uint64_t seed, uint32_t image);
+    
     Image generate();
     
     std::vector<float> getRidgeMap() const { return m_ridgeMap; }
@@ -36,6 +41,9 @@ public:
     const std::vector<Minutia>& getMinutiae() const { return m_minutiaeGenerator.getMinutiae(); }
     
 private:
+    // Linhas por tarefa nas iterações de Gabor (parallelFor)
+    static constexpr int kRowsPerTask = 16;
+    
     void generateRidgeMap();
     double applyFilter(const GaborFilter& filter, int x, int y, const std::vector<float>& image);
     std::vector<float> renderFingerprint(const std::vector<float>& binaryRidge);
@@ -65,6 +73,8 @@ private:
     
     std::vector<int> m_perm;
     std::mt19937 m_rng;
+    uint64_t m_seed = 0;
+    Raster::RandomStream m_noiseStream;
     MinutiaeGenerator m_minutiaeGenerator;
 };
 
@@ -4,22 +4,55 @@
 #include <string>
 #include <cstring>
 #include <thread>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
 #include "core/batch_generator.h"
+#include "raster/serve.h"
 
 void printUsage() {
     std::cout << "SFINGE CLI Pure - Synthetic Fingerprint Generator (No Qt Dependencies)\n\n";
     std::cout << "Usage:\n";
-    std::cout << "  sfinge-cli [options]\n\n";
+    std::cout << "  sfinge-cli [options]\n";
+    std::cout << "  sfinge-cli shard list <file.shard>...\n";
+    std::cout << "  sfinge-cli shard extract <file.shard> <dir> [key...]\n";
+    std::cout << "  sfinge-cli manifest jsonl <file.manifest> [out.jsonl]\n";
+    std::cout << "  sfinge-cli merge <out.manifest> <node.manifest>...\n";
+    std::cout << "  sfinge-cli stream list <file|->\n";
+    std::cout << "  sfinge-cli stream extract <file|-> <dir>\n";
+    std::cout << "  sfinge-cli ring read <name> [dir]\n";
+    std::cout << "  sfinge-cli serve <socket> [-j <count>] [--max-queue <count>]\n\n";
     std::cout << "Options:\n";
     std::cout << "  -n, --num <count>       Number of fingerprints (default: 10)\n";
     std::cout << "  -v, --versions <count>  Versions per fingerprint (default: 3)\n";
-    std::cout << "  -o, --output <dir>      Output directory (default: ./output)\n";
+    std::cout << "  -o, --output <dir>      Output directory, - for a frame stream on stdout, or shm:<name> for a\n";
+    std::cout << "                          shared-memory ring of raw crops (raster/sfinge_ring.h; default: ./output)\n";
+    std::cout << "  --ring-slots <count>    Images the shm: ring holds (default: 4 x jobs)\n";
     std::cout << "  -p, --prefix <name>     Filename prefix (default: fingerprint)\n";
     std::cout << "  -s, --start <index>     Start index (default: 0)\n";
     std::cout << "  -j, --jobs <count>      Parallel jobs (default: CPU cores)\n";
+    std::cout << "  --writers <count>       PNG encode/write threads (default: jobs / 4, min 1)\n";
+    std::cout << "  --write-queue <count>   Finished images waiting to be written (default: 2 x jobs)\n";
+    std::cout << "  --memory-budget <MiB>   Cap identities in flight (then jobs) so the estimated peak fits\n";
+    std::cout << "  --png-profile <p>       PNG encoding: fast|balanced|small (default: balanced)\n";
+    std::cout << "  --format <f>            Output: files (one image each) | shards | npy (default: files);\n";
+    std::cout << "                          with -o -, files streams encoded frames and npy raw uint8 frames\n";
+    std::cout << "  --codec <c>             Image encoding for files/shards: png|wsq (default: png)\n";
+    std::cout << "  --wsq-bitrate <bpp>     WSQ target bits per pixel (default: 0.75, about 15:1)\n";
+    std::cout << "  --shard-size <MiB>      Size at which a new shard file starts (default: 1024)\n";
+    std::cout << "  --seed <n>              Master seed; same seed + index = same image (default: random)\n";
     std::cout << "  --skip-original         Skip v0 (original) images\n";
     std::cout << "  --no-mask               Disable elliptical mask\n";
-    std::cout << "  --save-params           Save parameters JSON\n";
+    std::cout << "  --save-params           Write a ground-truth manifest (parameters, minutiae, transforms)\n";
+    std::cout << "  --shard <K/N>           Node K of N: generate only this node's part of -s/-n (needs --seed)\n";
+    std::cout << "  --shard-mode <m>        Node partition: contiguous|strided (default: contiguous)\n";
+    std::cout << "  --resume                Continue an interrupted batch from its journal (same options)\n";
+    std::cout << "  --fused-warp            Single-resample lens/perspective/rotation/crop\n";
+    std::cout << "  --warp-interp <mode>    Fused warp interpolation: bilinear|bicubic (default: bilinear)\n";
+    std::cout << "  --max-blur-sigma <px>   Max defocus sigma at the blur centre (default: 1)\n";
     std::cout << "  --continuous-phase     Use continuous phase (improved method)\n";
     std::cout << "  --phase-noise <level>   Phase noise level (0.0-1.0, default: 0.1)\n";
     std::cout << "  --use-quality-mask     Use quality mask for minutiae\n";
@@ -31,10 +64,205 @@ void printUsage() {
     std::cout << "  -h, --help              Show this help\n";
 }
 
+namespace {
+
+// Writes a served frame under its batch file name (raw pixels get a PGM header, as in `stream extract`)
+bool writeFrameFile(const std::string& path, const SFinGe::Raster::FrameHeader& header, const void* data) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    bool ok = file != nullptr;
+    if (ok && header.format == SFinGe::Raster::FrameFormat::Gray8) {
+        ok = std::fprintf(file, "P5\n%u %u\n255\n", static_cast<unsigned>(header.width),
+                          static_cast<unsigned>(header.height)) > 0;
+    }
+    ok = ok && std::fwrite(data, 1, static_cast<size_t>(header.length), file) == header.length;
+    ok = file && (std::fclose(file) == 0) && ok;
+    return ok;
+}
+
+// One `serve` request: the batch options of the command line as JSON fields, run on the
+// server's persistent pool. Frames come back through the stream hook, so nothing but the
+// images themselves (files mode) touches the disk.
+SFinGe::Raster::ServeResult serveRequest(const SFinGe::Raster::ServeRequest& request,
+                                         SFinGe::Raster::TaskPool& pool) {
+    SFinGe::Raster::ServeResult result;
+    auto reject = [&result](const std::string& error) {
+        result.error = error;
+        return result;
+    };
+    
+    SFinGe::BatchConfig config;
+    config.quietMode = true;
+    config.numFingerprints = 1;
+    config.versionsPerFingerprint = 1;
+    config.streamOutput = true;
+    int64_t number = 0;
+    bool flag = false;
+    if (request.has("start") && (!request.integer("start", number) || number < 0 || number > 9999999)) {
+        return reject("start must be an integer from 0 to 9999999");
+    }
+    config.startIndex = static_cast<int>(number);
+    if (request.has("count") && (!request.integer("count", number) || number < 1 || number > 10000)) {
+        return reject("count must be an integer from 1 to 10000");
+    }
+    config.numFingerprints = request.has("count") ? static_cast<int>(number) : 1;
+    if (request.has("versions") && (!request.integer("versions", number) || number < 1 || number > 99)) {
+        return reject("versions must be an integer from 1 to 99");
+    }
+    config.versionsPerFingerprint = request.has("versions") ? static_cast<int>(number) : 1;
+    if (request.flag("skipOriginal", flag)) {
+        config.skipOriginal = flag;
+    }
+    if (request.flag("mask", flag)) {
+        config.applyEllipticalMask = flag;
+    }
+    if (request.flag("fusedWarp", flag)) {
+        config.fusedWarp = flag;
+    }
+    request.real("maxBlurSigma", config.maxBlurSigma);
+    config.filenamePrefix = request.text("prefix", config.filenamePrefix);
+    if (config.filenamePrefix.empty() || config.filenamePrefix.find_first_of("/\\:") != std::string::npos) {
+        return reject("prefix must be a plain file name");
+    }
+    
+    // Without a seed a fresh one is drawn and returned, so the request can be repeated
+    if (request.has("seed") && !request.unsignedInteger("seed", config.seed)) {
+        return reject("seed must be an unsigned 64-bit integer");
+    }
+    if (!request.has("seed")) {
+        std::random_device rd;
+        config.seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+    }
+    result.seed = config.seed;
+    
+    const std::string codec = request.text("codec", "png");
+    if (codec == "wsq") {
+        config.imageCodec = SFinGe::ImageCodec::Wsq;
+    } else if (codec == "raw") {
+        config.outputFormat = SFinGe::OutputFormat::Npy;  // A stream sends raw uint8 frames for npy
+    } else if (codec != "png") {
+        return reject("codec must be png, wsq or raw");
+    }
+    
+    // "inline" returns the encoded images in the response; anything else is a directory
+    const std::string output = request.text("output", "inline");
+    const bool inlineData = output == "inline";
+    const int imageCount = config.numFingerprints * (config.versionsPerFingerprint + (config.skipOriginal ? 0 : 1));
+    if (inlineData && imageCount > SFinGe::Raster::kMaxInlineImages) {
+        return reject("more than " + std::to_string(SFinGe::Raster::kMaxInlineImages) +
+                      " images need a directory output");
+    }
+    if (!inlineData) {
+        std::error_code ec;
+        std::filesystem::create_directories(output, ec);
+        if (ec) {
+            return reject("cannot create " + output + ": " + ec.message());
+        }
+    }
+    
+    std::mutex mutex;
+    std::string writeError;
+    SFinGe::BatchGenerator generator;
+    generator.setBatchConfig(config);
+    generator.setTaskPool(&pool);
+    generator.setFrameCallback([&](const SFinGe::Raster::FrameHeader& header, const void* data) {
+        SFinGe::Raster::ServeImage image;
+        image.header = header;
+        if (inlineData) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            image.data.assign(bytes, bytes + header.length);
+        } else {
+            const char* extension = header.format == SFinGe::Raster::FrameFormat::Gray8 ? "pgm"
+                                    : header.format == SFinGe::Raster::FrameFormat::Wsq  ? "wsq"
+                                                                                         : "png";
+            char name[64];
+            std::snprintf(name, sizeof(name), "_%04u_v%02u.%s", static_cast<unsigned>(header.identity),
+                          static_cast<unsigned>(header.version), extension);
+            image.path = (std::filesystem::path(output) / (config.filenamePrefix + name)).string();
+            if (!writeFrameFile(image.path, header, data)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                writeError = "cannot write " + image.path;
+                return false;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        result.images.push_back(std::move(image));
+        return true;
+    });
+    
+    if (!generator.generateBatch()) {
+        result.images.clear();
+        return reject(writeError.empty() ? "generation failed" : writeError);
+    }
+    
+    // Frames arrive in completion order; the response lists them in batch order
+    std::sort(result.images.begin(), result.images.end(),
+              [](const SFinGe::Raster::ServeImage& a, const SFinGe::Raster::ServeImage& b) {
+                  return a.header.identity != b.header.identity ? a.header.identity < b.header.identity
+                                                                : a.header.version < b.header.version;
+              });
+    result.ok = true;
+    return result;
+}
+
+// sfinge-cli serve <socket> [-j N] [--max-queue N]: one process, one pool, many requests
+int runServe(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: sfinge-cli serve <socket> [-j <count>] [--max-queue <count>]\n";
+        return 2;
+    }
+    SFinGe::Raster::ServeOptions options;
+    options.socketPath = argv[2];
+    int jobs = std::thread::hardware_concurrency();
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+            jobs = std::stoi(argv[++i]);
+        } else if (arg == "--max-queue" && i + 1 < argc) {
+            options.maxQueue = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+        } else {
+            std::cerr << "Unknown serve option: " << arg << "\n";
+            return 2;
+        }
+    }
+    if (jobs < 1) jobs = 1;
+    
+    // Built once: the workers' thread-local scratch, the shared Gabor banks and the
+    // warp geometry plans stay warm from one request to the next
+    SFinGe::Raster::TaskPool pool(jobs);
+    std::cerr << "Workers: " << pool.size() << ", queue limit " << options.maxQueue << "\n";
+    return SFinGe::Raster::runServer(options, [&pool](const SFinGe::Raster::ServeRequest& request) {
+        return serveRequest(request, pool);
+    });
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "shard") {
+        return SFinGe::Raster::runShardTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && std::string(argv[1]) == "manifest") {
+        return SFinGe::Raster::runManifestTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && std::string(argv[1]) == "stream") {
+        return SFinGe::Raster::runStreamTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && std::string(argv[1]) == "merge") {
+        return SFinGe::Raster::runMergeTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && std::string(argv[1]) == "ring") {
+        return SFinGe::Raster::runRingTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && std::string(argv[1]) == "serve") {
+        return runServe(argc, argv);
+    }
+    
     SFinGe::BatchConfig config;
     int jobs = std::thread::hardware_concurrency();
     bool quietMode = false;
+    bool seedSet = false;
+    bool sharded = false;
+    SFinGe::Raster::PartitionMode partitionMode = SFinGe::Raster::PartitionMode::Contiguous;
     
     // Parse arguments
     for (int i = 1; i < argc; ++i) {
@@ -62,6 +290,68 @@ int main(int argc, char* argv[]) {
         else if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
             jobs = std::stoi(argv[++i]);
         }
+        else if ((arg == "--ring-slots") && i + 1 < argc) {
+            config.ringSlots = std::stoi(argv[++i]);
+        }
+        else if ((arg == "--writers") && i + 1 < argc) {
+            config.writerThreads = std::stoi(argv[++i]);
+        }
+        else if ((arg == "--write-queue") && i + 1 < argc) {
+            config.writeQueueDepth = std::stoi(argv[++i]);
+        }
+        else if ((arg == "--memory-budget") && i + 1 < argc) {
+            const long long mib = std::stoll(argv[++i]);
+            if (mib <= 0) {
+                std::cerr << "Memory budget must be positive (MiB)\n";
+                return 1;
+            }
+            config.memoryBudget = static_cast<uint64_t>(mib) << 20;
+        }
+        else if ((arg == "--png-profile") && i + 1 < argc) {
+            std::string profile = argv[++i];
+            if (!SFinGe::Raster::parsePngProfile(profile, config.pngProfile)) {
+                std::cerr << "Unknown PNG profile: " << profile << " (use fast, balanced or small)\n";
+                return 1;
+            }
+        }
+        else if ((arg == "--format") && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "files") {
+                config.outputFormat = SFinGe::OutputFormat::Files;
+            } else if (format == "shards") {
+                config.outputFormat = SFinGe::OutputFormat::Shards;
+            } else if (format == "npy") {
+                config.outputFormat = SFinGe::OutputFormat::Npy;
+            } else {
+                std::cerr << "Unknown output format: " << format << " (use files, shards or npy)\n";
+                return 1;
+            }
+        }
+        else if ((arg == "--codec") && i + 1 < argc) {
+            std::string codec = argv[++i];
+            if (codec == "png") {
+                config.imageCodec = SFinGe::ImageCodec::Png;
+            } else if (codec == "wsq") {
+                config.imageCodec = SFinGe::ImageCodec::Wsq;
+            } else {
+                std::cerr << "Unknown codec: " << codec << " (use png or wsq)\n";
+                return 1;
+            }
+        }
+        else if ((arg == "--wsq-bitrate") && i + 1 < argc) {
+            config.wsqBitrate = std::stod(argv[++i]);
+            if (!(config.wsqBitrate > 0.0)) {
+                std::cerr << "WSQ bitrate must be positive\n";
+                return 1;
+            }
+        }
+        else if ((arg == "--shard-size") && i + 1 < argc) {
+            config.shardBytes = std::stoull(argv[++i]) << 20;
+        }
+        else if ((arg == "--seed") && i + 1 < argc) {
+            config.seed = std::stoull(argv[++i]);
+            seedSet = true;
+        }
         else if (arg == "--skip-original") {
             config.skipOriginal = true;
         }
@@ -71,6 +361,39 @@ int main(int argc, char* argv[]) {
         else if (arg == "--save-params") {
             config.saveParameters = true;
         }
+        else if ((arg == "--shard") && i + 1 < argc) {
+            std::string spec = argv[++i];
+            if (!SFinGe::Raster::parseShardSpec(spec, config.shardIndex, config.shardCount)) {
+                std::cerr << "Invalid shard: " << spec << " (use K/N with 0 <= K < N)\n";
+                return 1;
+            }
+            sharded = true;
+        }
+        else if ((arg == "--shard-mode") && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "contiguous") {
+                partitionMode = SFinGe::Raster::PartitionMode::Contiguous;
+            } else if (mode == "strided") {
+                partitionMode = SFinGe::Raster::PartitionMode::Strided;
+            } else {
+                std::cerr << "Unknown shard mode: " << mode << " (use contiguous or strided)\n";
+                return 1;
+            }
+        }
+        else if (arg == "--resume") {
+            config.resume = true;
+        }
+        else if (arg == "--fused-warp") {
+            config.fusedWarp = true;
+        }
+        else if ((arg == "--warp-interp") && i + 1 < argc) {
+            std::string mode = argv[++i];
+            config.warpInterpolation = (mode == "bicubic") ? SFinGe::Raster::Interpolation::Bicubic
+                                                           : SFinGe::Raster::Interpolation::Bilinear;
+        }
+        else if ((arg == "--max-blur-sigma") && i + 1 < argc) {
+            config.maxBlurSigma = std::stod(argv[++i]);
+        }
         else if (arg == "--continuous-phase") {
             config.minutiae.useContinuousPhase = true;
         }
@@ -99,14 +422,87 @@ int main(int argc, char* argv[]) {
     
     config.quietMode = quietMode;
     
+    // stdout carries the frames, so every message goes to stderr
+    config.streamOutput = config.outputDirectory == "-";
+    if (config.streamOutput) {
+        if (config.outputFormat == SFinGe::OutputFormat::Shards) {
+            std::cerr << "A stream (-o -) takes --format files or npy\n";
+            return 1;
+        }
+        if (config.resume || config.saveParameters || sharded) {
+            std::cerr << "A stream (-o -) leaves nothing on disk: no --resume, --save-params or --shard\n";
+            return 1;
+        }
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+    
+    // A local consumer maps the ring and reads the crops in place; the frames carry identity and version
+    if (config.outputDirectory.compare(0, 4, "shm:") == 0) {
+        config.ringName = config.outputDirectory.substr(4);
+        if (config.outputFormat != SFinGe::OutputFormat::Files) {
+            std::cerr << "A ring (-o shm:) carries raw uint8 crops; drop --format\n";
+            return 1;
+        }
+        if (config.resume || config.saveParameters || sharded) {
+            std::cerr << "A ring (-o shm:) leaves nothing on disk: no --resume, --save-params or --shard\n";
+            return 1;
+        }
+    }
+    
+    // -s/-n describe the whole batch; a node generates its own part of it and records the rest,
+    // so `merge` can check that the nodes' manifests add up to the batch
+    config.rangeStart = config.startIndex;
+    config.rangeCount = config.numFingerprints;
+    if (sharded) {
+        if (!seedSet) {
+            std::cerr << "--shard needs --seed: every node must draw from the same master seed\n";
+            return 1;
+        }
+        const SFinGe::Raster::IdentityRange range = SFinGe::Raster::partitionRange(
+            config.rangeStart, config.rangeCount, config.shardIndex, config.shardCount, partitionMode);
+        config.startIndex = range.start;
+        config.numFingerprints = range.count;
+        config.identityStride = range.stride;
+        config.saveParameters = true;
+    }
+    
+    // Without --seed a fresh master seed is drawn once and printed, so the run can be repeated;
+    // a resumed batch keeps the seed in its journal instead
+    config.fixedSeed = seedSet || !config.resume;
+    if (!seedSet) {
+        std::random_device rd;
+        config.seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+    }
+    
     if (jobs < 1) jobs = 1;
     
     std::cout << "=== SFINGE CLI Pure - Batch Generation ===\n";
     std::cout << "Fingerprints: " << config.numFingerprints << "\n";
+    if (sharded) {
+        std::cout << "Node: " << config.shardIndex << "/" << config.shardCount << " of " << config.rangeCount
+                  << " from " << config.rangeStart << " (first " << config.startIndex << ", step "
+                  << config.identityStride << ")\n";
+    }
     std::cout << "Versions per FP: " << config.versionsPerFingerprint << "\n";
     std::cout << "Skip original: " << (config.skipOriginal ? "yes" : "no") << "\n";
     std::cout << "Output: " << config.outputDirectory << "\n";
     std::cout << "Parallel jobs: " << jobs << "\n";
+    if (config.memoryBudget > 0) {
+        std::cout << "Memory budget: " << (config.memoryBudget >> 20) << " MiB\n";
+    }
+    if (config.fixedSeed) {
+        std::cout << "Seed: " << config.seed << "\n";
+    } else {
+        std::cout << "Seed: from the journal (" << config.seed << " if starting fresh)\n";
+    }
+    if (config.imageCodec == SFinGe::ImageCodec::Wsq) {
+        std::cout << "Codec: WSQ at " << config.wsqBitrate << " bpp\n";
+    } else {
+        std::cout << "PNG profile: " << SFinGe::Raster::pngProfileName(config.pngProfile) << "\n";
+    }
+    if (config.outputFormat == SFinGe::OutputFormat::Shards) {
+        std::cout << "Output format: shards of " << (config.shardBytes >> 20) << " MiB\n";
+    }
     std::cout << "Minutiae method: " << (config.minutiae.useContinuousPhase ? "continuous phase" : "original") << "\n";
     if (config.minutiae.useContinuousPhase) {
         std::cout << "Phase noise: " << config.minutiae.phaseNoiseLevel << "\n";
@@ -138,10 +534,12 @@ int main(int argc, char* argv[]) {
             int remainingSec = static_cast<int>(remaining);
             
             double imgsPerSec = (elapsed > 0) ? (imgCount * 1000.0 / elapsed) : 0;
+            SFinGe::Raster::WriteQueueStats writer = generator.writerStats();
             
             std::cout << "\rFP [" << fpCompleted << "/" << totalFps << "] "
                       << "Images: " << imgCount << " | "
                       << std::fixed << std::setprecision(2) << imgsPerSec << " img/s | "
+                      << "Write queue: " << writer.depth << "/" << writer.capacity << " | "
                       << "Elapsed: " << static_cast<int>(elapsedSec) << "s, ETA: "
                       << remainingSec / 60 << ":" << std::setfill('0') << std::setw(2) << remainingSec % 60
                       << "          " << std::flush;
@@ -156,5 +554,24 @@ int main(int argc, char* argv[]) {
     std::cout << "\n\nBatch completed!\n";
     std::cout << "Elapsed time: " << totalMs / 1000 << "." << totalMs % 1000 << " seconds\n";
     
+    SFinGe::Raster::WriteQueueStats writer = generator.writerStats();
+    std::cout << "Writers: " << writer.writers << " threads, "
+              << std::fixed << std::setprecision(1) << writer.utilization() * 100.0 << "% busy, "
+              << "queue peak " << writer.maxDepth << "/" << writer.capacity << ", "
+              << "workers blocked " << std::setprecision(2) << writer.producerWaitSeconds << " s";
+    if (writer.failed > 0) {
+        std::cout << ", " << writer.failed << " write failures";
+    }
+    std::cout << "\n";
+    
+    std::cout << "Peak RSS: " << (SFinGe::Raster::peakRss() >> 20) << " MiB";
+    if (config.memoryBudget > 0) {
+        const SFinGe::Raster::MemoryPlan& plan = generator.memoryPlan();
+        std::cout << ", private " << (generator.memoryPeak() >> 20) << " MiB of the "
+                  << (config.memoryBudget >> 20) << " MiB budget (estimated " << (plan.estimate >> 20) << " MiB: "
+                  << plan.workers << " workers, " << plan.identities << " identities in flight)";
+    }
+    std::cout << "\n";
+    
     return success ? 0 : 1;
 }
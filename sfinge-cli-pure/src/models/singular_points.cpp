@@ -1,10 +1,11 @@
 #include "singular_points.h"
+#include "raster/random.h"
 #include <cmath>
 #include <iostream>
 
 namespace SFinGe {
 
-SingularPoints::SingularPoints() : m_rng(std::random_device{}()) {}
+SingularPoints::SingularPoints() {}
 
 void SingularPoints::addCore(double x, double y) {
     m_cores.push_back({x, y});
@@ -148,9 +149,8 @@ void SingularPoints::suggestPoints(FingerprintClass fpClass, int width, int heig
     generateRandomPoints(fpClass, width, height);
 }
 
-void SingularPoints::reseed() {
-    std::random_device rd;
-    m_rng.seed(rd());
+void SingularPoints::reseed(uint64_t seed) {
+    Raster::seedEngine(m_rng, seed);
 }
 
 } // namespace SFinGe
@@ -1,6 +1,7 @@
 #ifndef SINGULAR_POINTS_H
 #define SINGULAR_POINTS_H
 
+#include <cstdint>
 #include <vector>
 #include <random>
 #include "fingerprint_parameters.h"
@@ -16,7 +17,8 @@ class SingularPoints {
 public:
     SingularPoints();
     
-    void reseed();
+    // Reinicializa o RNG com a semente dada (etapa SingularPoints da identidade)
+    void reseed(uint64_t seed);
     
     void addCore(double x, double y);
     void addDelta(double x, double y);
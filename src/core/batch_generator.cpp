@@ -1,18 +1,21 @@
 #include "batch_generator.h"
+#include "raster/gray8.h"
+#include "raster/blur_pyramid.h"
+#include "raster/random.h"
+#include "raster/png_writer.h"
+#include "raster/checksum.h"
 #include <QDir>
 #include <QFile>
-#include <QJsonDocument>
-#include <QJsonObject>
 #include <QRandomGenerator>
-#include <QTransform>
 #include <QPainter>
 #include <QThread>
-#include <QMetaObject>
 #include <QDebug>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstring>
+#include <memory>
 #include <random>
-#include <thread>
-#include <vector>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -20,10 +23,155 @@
 
 namespace SFinGe {
 
+namespace {
+
+// As transformações de versão trabalham direto nas scanlines em Grayscale8
+inline QImage toGrayscale8(const QImage& image) {
+    return image.format() == QImage::Format_Grayscale8
+        ? image : image.convertToFormat(QImage::Format_Grayscale8);
+}
+
+inline Raster::Gray8View grayView(QImage& image) {
+    return {image.bits(), static_cast<int>(image.bytesPerLine()), image.width(), image.height()};
+}
+
+inline Raster::ConstGray8View constGrayView(const QImage& image) {
+    return {image.constBits(), static_cast<int>(image.bytesPerLine()), image.width(), image.height()};
+}
+
+// Gerador local para uma semente derivada: nenhum sorteio do lote usa estado global
+QRandomGenerator seededGenerator(quint64 seed) {
+    const quint32 words[2] = {static_cast<quint32>(seed), static_cast<quint32>(seed >> 32)};
+    return QRandomGenerator(words, 2);
+}
+
+// Todos os parâmetros de geração da identidade, com as chaves do JSON de parâmetros
+void addParameters(Raster::ManifestRecord& record, const FingerprintParameters& params) {
+    const ShapeParameters& shape = params.shape;
+    record.addInt("shape.left", shape.left);
+    record.addInt("shape.right", shape.right);
+    record.addInt("shape.top", shape.top);
+    record.addInt("shape.middle", shape.middle);
+    record.addInt("shape.bottom", shape.bottom);
+    record.addInt("shape.fingerType", static_cast<int>(shape.fingerType));
+    
+    const DensityParameters& density = params.density;
+    record.addReal("density.minFrequency", density.minFrequency);
+    record.addReal("density.maxFrequency", density.maxFrequency);
+    record.addReal("density.zoom", density.zoom);
+    record.addReal("density.amplify", density.amplify);
+    
+    const OrientationParameters& orientation = params.orientation;
+    record.addInt("orientation.nCores", orientation.nCores);
+    record.addInt("orientation.nDeltas", orientation.nDeltas);
+    record.addReal("orientation.verticalBiasStrength", orientation.verticalBiasStrength);
+    record.addReal("orientation.verticalBiasRadius", orientation.verticalBiasRadius);
+    record.addReal("orientation.coreConvergenceStrength", orientation.coreConvergenceStrength);
+    record.addReal("orientation.coreConvergenceRadius", orientation.coreConvergenceRadius);
+    record.addReal("orientation.coreConvergenceProbability", orientation.coreConvergenceProbability);
+    record.addReal("orientation.anisotropyFactorX", orientation.anisotropyFactorX);
+    record.addReal("orientation.anisotropyFactorY", orientation.anisotropyFactorY);
+    record.addInt("orientation.method", static_cast<int>(orientation.method));
+    record.addInt("orientation.fomfeOrderM", orientation.fomfeOrderM);
+    record.addInt("orientation.fomfeOrderN", orientation.fomfeOrderN);
+    record.addInt("orientation.legendreOrder", orientation.legendreOrder);
+    record.addReal("orientation.archAmplitude", orientation.archAmplitude);
+    record.addReal("orientation.tentedArchPeakInfluenceDecay", orientation.tentedArchPeakInfluenceDecay);
+    record.addReal("orientation.loopVerticalBiasStrength", orientation.loopVerticalBiasStrength);
+    record.addReal("orientation.loopEdgeBlendFactor", orientation.loopEdgeBlendFactor);
+    record.addReal("orientation.loopVerticalBiasRadiusFactor", orientation.loopVerticalBiasRadiusFactor);
+    record.addReal("orientation.whorlSpiralFactor", orientation.whorlSpiralFactor);
+    record.addReal("orientation.whorlEdgeDecayFactor", orientation.whorlEdgeDecayFactor);
+    record.addReal("orientation.twinLoopSmoothing", orientation.twinLoopSmoothing);
+    record.addReal("orientation.centralPocketConcentration", orientation.centralPocketConcentration);
+    record.addReal("orientation.accidentalIrregularity", orientation.accidentalIrregularity);
+    record.addReal("orientation.smoothingSigma", orientation.smoothingSigma);
+    record.addBool("orientation.enableSmoothing", orientation.enableSmoothing);
+    
+    const RidgeParameters& ridge = params.ridge;
+    record.addInt("ridge.gaborFilterSize", ridge.gaborFilterSize);
+    record.addInt("ridge.cacheDegrees", ridge.cacheDegrees);
+    record.addInt("ridge.cacheFrequencies", ridge.cacheFrequencies);
+    record.addInt("ridge.maxIterations", ridge.maxIterations);
+    
+    const RenderingParameters& rendering = params.rendering;
+    record.addReal("rendering.backgroundNoiseFrequency", rendering.backgroundNoiseFrequency);
+    record.addReal("rendering.backgroundNoiseAmplitude", rendering.backgroundNoiseAmplitude);
+    record.addReal("rendering.ridgeNoiseFrequency", rendering.ridgeNoiseFrequency);
+    record.addReal("rendering.ridgeNoiseAmplitude", rendering.ridgeNoiseAmplitude);
+    record.addReal("rendering.valleyNoiseFrequency", rendering.valleyNoiseFrequency);
+    record.addReal("rendering.valleyNoiseAmplitude", rendering.valleyNoiseAmplitude);
+    record.addBool("rendering.enablePores", rendering.enablePores);
+    record.addReal("rendering.poreDensity", rendering.poreDensity);
+    record.addReal("rendering.minPoreSize", rendering.minPoreSize);
+    record.addReal("rendering.maxPoreSize", rendering.maxPoreSize);
+    record.addReal("rendering.minPoreIntensity", rendering.minPoreIntensity);
+    record.addReal("rendering.maxPoreIntensity", rendering.maxPoreIntensity);
+    record.addReal("rendering.finalBlurSigma", rendering.finalBlurSigma);
+    record.addReal("rendering.contrastPercentileLower", rendering.contrastPercentileLower);
+    record.addReal("rendering.contrastPercentileUpper", rendering.contrastPercentileUpper);
+    
+    const VariationParameters& variation = params.variation;
+    record.addBool("variation.enablePlasticDistortion", variation.enablePlasticDistortion);
+    record.addReal("variation.plasticDistortionStrength", variation.plasticDistortionStrength);
+    record.addInt("variation.plasticDistortionBumps", variation.plasticDistortionBumps);
+    record.addBool("variation.enableLensDistortion", variation.enableLensDistortion);
+    record.addReal("variation.lensDistortionK1", variation.lensDistortionK1);
+    record.addReal("variation.lensDistortionK2", variation.lensDistortionK2);
+    record.addBool("variation.enableRotation", variation.enableRotation);
+    record.addReal("variation.maxRotationAngle", variation.maxRotationAngle);
+    record.addBool("variation.enableTranslation", variation.enableTranslation);
+    record.addReal("variation.maxTranslationX", variation.maxTranslationX);
+    record.addReal("variation.maxTranslationY", variation.maxTranslationY);
+    record.addBool("variation.enableSkinCondition", variation.enableSkinCondition);
+    record.addReal("variation.skinConditionFactor", variation.skinConditionFactor);
+    record.addInt("variation.skinConditionRadius", variation.skinConditionRadius);
+    record.addBool("variation.skinConditionDiscKernel", variation.skinConditionDiscKernel);
+    
+    const MinutiaeParameters& minutiae = params.minutiae;
+    record.addBool("minutiae.useContinuousPhase", minutiae.useContinuousPhase);
+    record.addReal("minutiae.phaseNoiseLevel", minutiae.phaseNoiseLevel);
+    record.addBool("minutiae.useQualityMask", minutiae.useQualityMask);
+    record.addText("minutiae.minutiaeDensity", minutiae.minutiaeDensity.toStdString());
+    record.addInt("minutiae.customBifurcations", minutiae.customBifurcations);
+    record.addInt("minutiae.customEndings", minutiae.customEndings);
+    record.addReal("minutiae.coherenceThreshold", minutiae.coherenceThreshold);
+    record.addInt("minutiae.qualityWindowSize", minutiae.qualityWindowSize);
+    record.addReal("minutiae.frequencySmoothSigma", minutiae.frequencySmoothSigma);
+    record.addBool("minutiae.enableExplicitMinutiae", minutiae.enableExplicitMinutiae);
+    record.addInt("minutiae.targetMinutiae", minutiae.targetMinutiae);
+    record.addReal("minutiae.insertionProbability", minutiae.insertionProbability);
+    record.addReal("minutiae.removalProbability", minutiae.removalProbability);
+}
+
+std::vector<double> pointCoordinates(const std::vector<SingularPoint>& points) {
+    std::vector<double> values;
+    values.reserve(2 * points.size());
+    for (const SingularPoint& point : points) {
+        values.push_back(point.x);
+        values.push_back(point.y);
+    }
+    return values;
+}
+
+// Modelo de memória do --memory-budget, em bytes por pixel da imagem base. No
+// pico uma identidade tem os mapas de forma, densidade (float) e orientação
+// (double), a cópia da forma do OrientationGenerator, o campo e os quatro
+// buffers de suavização dele (double) e a base em 8 bits; o estágio de cristas
+// que vem depois precisa de menos. Uma versão tem cópias e buffers de
+// warp/desfoque da base em 8 bits.
+constexpr quint64 kIdentityBytesPerPixel = 64;
+constexpr quint64 kVersionBytesPerPixel = 8;
+constexpr quint64 kSharedBytes = 8ull << 20;  // Banco de filtros de Gabor, planos de máscara, o alocador
+
+// Maior imagem base que createBaseFingerprint() sorteia: todas as medidas da forma no máximo
+constexpr quint64 kMaxBasePixels = (530 + 530) * (510 + 260 + 510);
+
+}
+
 BatchGenerator::BatchGenerator(QObject* parent)
     : QObject(parent)
     , m_generator(new FingerprintGenerator(this))
-    , m_cancelled(false)
     , m_firstImageTime(0) {
 }
 
@@ -34,10 +182,19 @@ void BatchGenerator::setBatchConfig(const BatchConfig& config) {
     m_config = config;
 }
 
+void BatchGenerator::resolveMasterSeed() {
+    // Entropia do sistema só uma vez por lote; daqui em diante tudo deriva da semente
+    m_masterSeed = m_config.fixedSeed ? m_config.seed : QRandomGenerator::system()->generate64();
+    if (!m_config.quietMode) {
+        qDebug() << "Master seed:" << m_masterSeed;
+    }
+}
+
 bool BatchGenerator::generateBatch() {
     m_cancelled = false;
     m_firstImageTime = 0;
     m_timer.start();
+    resolveMasterSeed();
     
     // Criar diretório de saída
     QDir dir(m_config.outputDirectory);
@@ -48,6 +205,10 @@ bool BatchGenerator::generateBatch() {
         }
     }
     
+    if (m_config.saveParameters && !openManifest()) {
+        return false;
+    }
+    
     // Total = numFingerprints * (N versões + original se não pular)
     int imagesPerFingerprint = m_config.versionsPerFingerprint + (m_config.skipOriginal ? 0 : 1);
     int totalImages = m_config.numFingerprints * imagesPerFingerprint;
@@ -64,9 +225,13 @@ bool BatchGenerator::generateBatch() {
         // Configurar gerador com impressão base
         m_generator->setParameters(baseInstance.baseParams);
         m_generator->setSingularPoints(baseInstance.basePoints);
+        m_generator->setSeed(baseInstance.seed);
         
         // Gerar impressão base UMA VEZ
         QImage baseFingerprint = m_generator->generateFingerprint();
+        if (m_manifest) {
+            appendIdentityRecord(baseInstance, fpIdx, m_generator->getMinutiae());
+        }
         
         // Gerar versões: v0=original (1000x1200) + N versões transformadas (500x600)
         // Se versionsPerFingerprint=3 e skipOriginal=false, gera 4 imagens: v0 + v1,v2,v3
@@ -87,6 +252,7 @@ bool BatchGenerator::generateBatch() {
             emit progressUpdated(generated, totalImages, statusMsg);
             
             QImage transformedFingerprint;
+            VersionTransform transform;
             
             if (verIdx == 0) {
                 // Versão 1 (v0): ORIGINAL COMPLETA 1000x1200 SEM recorte
@@ -95,7 +261,7 @@ bool BatchGenerator::generateBatch() {
                 transformedFingerprint.setDotsPerMeterY(500 * 39.3701);
             } else {
                 // Versões 2+ (v1+): aplicar transformações PERCEPTÍVEIS + recorte 500x600
-                VersionTransform transform = generateVersionTransform(verIdx);
+                transform = generateVersionTransform(baseInstance.seed, verIdx);
                 transformedFingerprint = applyVersionTransforms(baseFingerprint, transform);
             }
             
@@ -105,41 +271,38 @@ bool BatchGenerator::generateBatch() {
             }
             
             // Salvar imagem
-            if (!saveFingerprint(transformedFingerprint, baseInstance, fpIdx, verIdx)) {
+            quint32 crc = 0;
+            if (!saveFingerprint(transformedFingerprint, baseInstance, fpIdx, verIdx, crc)) {
                 emit error(tr("Failed to save fingerprint %1 version %2").arg(fpIdx + 1).arg(verIdx));
                 continue;
             }
             
-            // Salvar parâmetros se solicitado
-            if (m_config.saveParameters) {
-                QString paramFile = QString("%1/%2_%3_v%4_params.json")
-                    .arg(m_config.outputDirectory)
-                    .arg(m_config.filenamePrefix)
-                    .arg(fpIdx + 1, 3, 10, QChar('0'))
-                    .arg(verIdx);  // v0, v1, v2, v3... (sem +1)
-                    
-                saveParameters(baseInstance.baseParams, baseInstance.basePoints, paramFile);
+            if (m_manifest) {
+                appendVersionRecord(fpIdx, verIdx, transform);
             }
             
             generated++;
         }
     }
     
-    if (!m_cancelled) {
+    const bool outputOk = !m_manifest || closeManifest();
+    if (!m_cancelled && outputOk) {
         emit batchCompleted(generated);
     }
     
-    return !m_cancelled;
+    return !m_cancelled && outputOk;
 }
 
 bool BatchGenerator::generateBatchParallel() {
     m_cancelled = false;
     m_generated.storeRelaxed(0);
     m_timer.start();
+    resolveMasterSeed();
     
     // Criar diretório de saída
     QDir dir(m_config.outputDirectory);
-    if (!dir.exists()) {
+    const bool ring = !m_config.ringName.isEmpty();
+    if (!m_config.streamOutput && !ring && !dir.exists()) {
         if (!dir.mkpath(".")) {
             emit error(tr("Failed to create output directory"));
             return false;
@@ -147,228 +310,333 @@ bool BatchGenerator::generateBatchParallel() {
     }
     
     int numWorkers = m_numWorkers > 0 ? m_numWorkers : QThread::idealThreadCount();
+    if (m_pool) {
+        numWorkers = m_pool->size();
+    }
     int imagesPerFingerprint = m_config.versionsPerFingerprint + (m_config.skipOriginal ? 0 : 1);
     int totalImages = m_config.numFingerprints * imagesPerFingerprint;
     
+    // Um orçamento de memória limita as identidades em voo (e, além disso, os
+    // workers do pool próprio) para o pico estimado caber nele
+    m_memoryPlan = Raster::MemoryPlan();
+    m_memoryPlan.workers = numWorkers;
+    m_memoryPlan.identities = std::max(1, m_config.numFingerprints);
+    m_memoryPeak = 0;
+    if (m_config.memoryBudget > 0) {
+        Raster::returnLargeBlocks();
+        m_memoryPlan = Raster::planMemory(memoryModel(), m_config.memoryBudget, numWorkers, m_pool != nullptr);
+        numWorkers = m_memoryPlan.workers;
+        if (!m_memoryPlan.fits) {
+            qWarning() << "Memory budget of" << (m_config.memoryBudget >> 20) << "MiB is below the"
+                       << (m_memoryPlan.estimate >> 20) << "MiB estimated for" << numWorkers
+                       << "worker(s) and one identity; continuing with that";
+        }
+    }
+    
     if (!m_config.quietMode) {
         qDebug() << "Starting parallel batch generation with" << numWorkers << "workers";
         qDebug() << "Total fingerprints:" << m_config.numFingerprints << "Total images:" << totalImages;
+        if (m_config.memoryBudget > 0) {
+            qDebug() << "Memory budget:" << (m_config.memoryBudget >> 20) << "MiB, estimated peak"
+                     << (m_memoryPlan.estimate >> 20) << "MiB with" << m_memoryPlan.identities
+                     << "identities in flight";
+        }
     }
     
-    // Pré-criar todas as instâncias de impressão digital
-    std::vector<FingerprintInstance> instances(m_config.numFingerprints);
-    for (int i = 0; i < m_config.numFingerprints && !m_cancelled; ++i) {
-        instances[i] = createBaseFingerprint(i);
+    if (m_config.streamOutput || ring) {
+        // Nada vai para o disco: sem diário, tensor nem manifesto, os quadros levam tudo
+        m_done.clear();
+        if (ring ? !openRingOutput(numWorkers) : (!m_frameCallback && !openStreamOutput())) {
+            return false;
+        }
+    } else {
+        if (!openJournal()) {
+            return false;
+        }
+        if (m_config.outputFormat == OutputFormat::Npy && !openTensorOutput()) {
+            m_journal.reset();
+            return false;
+        }
+        if (m_config.saveParameters && !openManifest()) {
+            m_tensor.reset();
+            m_journal.reset();
+            return false;
+        }
+        if (m_config.outputFormat == OutputFormat::Files) {
+            m_written = std::make_unique<Raster::FileSyncList>(m_config.outputDirectory.toStdString());
+        }
+        m_journal->setSyncCallback([this]() { return syncOutput(); });
     }
     
-    // Criar fila de tarefas para geração das imagens base (v0)
-    // Cada tarefa gera uma impressão base e todas as suas versões
-    struct BaseTask {
-        int fpIndex;
-        FingerprintInstance instance;
-    };
-    
-    QQueue<BaseTask> baseTasks;
-    for (int i = 0; i < m_config.numFingerprints; ++i) {
-        baseTasks.enqueue({i, instances[i]});
+    // Codificação PNG e gravação rodam em threads próprias atrás de uma fila
+    // limitada: os workers não esperam deflate nem write(), e se o disco não
+    // acompanha a fila cheia os bloqueia em vez de acumular imagens
+    int numWriters = m_config.writerThreads > 0 ? m_config.writerThreads : std::max(1, numWorkers / 4);
+    int queueDepth = m_config.writeQueueDepth > 0 ? m_config.writeQueueDepth : 2 * numWorkers;
+    m_writer = std::make_unique<Raster::WriteQueue>(numWriters, queueDepth);
+    
+    if (m_config.outputFormat == OutputFormat::Shards) {
+        m_shards = std::make_unique<Raster::ShardWriter>(outputStem().toStdString(), m_config.shardBytes,
+                                                         m_firstShard);
+        // Entradas de shard vão para o diário quando o shard está selado no disco
+        m_shards->setSealCallback([this](int index, const std::vector<Raster::ShardEntry>& entries) {
+            if (index + 1 > 0xFFFF) {
+                return;  // Além do que o diário consegue nomear: refeito ao retomar
+            }
+            std::vector<Raster::JournalEntry> done;
+            done.reserve(entries.size());
+            for (const Raster::ShardEntry& entry : entries) {
+                Raster::JournalEntry item;
+                item.identity = static_cast<quint32>(identity(static_cast<int>(entry.tag >> 16)));
+                item.version = static_cast<quint16>(entry.tag & 0xFFFF);
+                item.shard = static_cast<quint16>(index + 1);
+                item.crc = entry.crc;
+                done.push_back(item);
+            }
+            m_journal->commit(done);  // O shard inteiro ou nada dele: o resume nunca parte um shard
+        });
     }
     
-    QMutex taskMutex;
-    QMutex progressMutex;
+    // Pool com roubo de tarefas: cada identidade é uma tarefa que gera a imagem
+    // base e cria uma tarefa por versão. O worker que criou as versões as
+    // executa primeiro (LIFO) e os ociosos roubam o restante, então a cauda do
+    // lote (poucas identidades com muitas versões) continua usando todos os
+    // núcleos. As iterações de Gabor do RidgeGenerator dividem linhas no mesmo pool.
+    std::unique_ptr<Raster::TaskPool> ownPool;
+    if (!m_pool) {
+        ownPool = std::make_unique<Raster::TaskPool>(numWorkers);
+    }
+    Raster::TaskPool& pool = m_pool ? *m_pool : *ownPool;
     QAtomicInt completedFps(0);
+    const int startIdx = m_config.skipOriginal ? 1 : 0;
+    const int versionCount = m_config.versionsPerFingerprint - startIdx + 1;
+    
+    // As identidades entram no pool conforme as anteriores terminam, no máximo
+    // o limite ao mesmo tempo: todas de uma vez sem orçamento, as do plano com
+    // ele. O monitor baixa esse número se a memória medida ainda passar.
+    std::unique_ptr<Raster::MemoryMonitor> monitor;
+    if (m_config.memoryBudget > 0) {
+        monitor = std::make_unique<Raster::MemoryMonitor>(m_config.memoryBudget, m_memoryPlan.identities);
+    }
+    QMutex admitMutex;
+    int nextIdentity = 0;
+    int inFlight = 0;
+    std::function<void(int)> spawnIdentity;
+    auto admitIdentities = [&]() {
+        QMutexLocker locker(&admitMutex);
+        const int limit = monitor ? monitor->limit() : m_config.numFingerprints;
+        while (inFlight < limit && nextIdentity < m_config.numFingerprints) {
+            ++inFlight;
+            spawnIdentity(nextIdentity++);
+        }
+    };
     
-    // Função de processamento para cada worker
-    auto workerFunc = [&]() {
-        // Cada thread precisa de seu próprio FingerprintGenerator
-        FingerprintGenerator localGenerator;
-        
-        while (!m_cancelled) {
-            BaseTask task;
-            bool hasTask = false;
+    auto finishFingerprint = [&]() {
+        // Emitir progresso ao completar cada digital
+        int fpCompleted = completedFps.fetchAndAddRelaxed(1) + 1;
+        int imgCompleted = m_generated.loadRelaxed();
+        {
+            QMutexLocker locker(&m_progressMutex);
+            emit progressUpdated(fpCompleted, m_config.numFingerprints, QString::number(imgCompleted));
+        }
+        if (monitor) {
+            monitor->identityFinished();
+        }
+        {
+            QMutexLocker locker(&admitMutex);
+            --inFlight;
+        }
+        admitIdentities();
+    };
+    
+    spawnIdentity = [this, &pool, &finishFingerprint, startIdx, versionCount](int fpIdx) {
+        pool.spawn([this, &pool, &finishFingerprint, fpIdx, startIdx, versionCount]() {
+            if (m_cancelled) {
+                return;
+            }
             
-            {
-                QMutexLocker locker(&taskMutex);
-                if (!baseTasks.isEmpty()) {
-                    task = baseTasks.dequeue();
-                    hasTask = true;
-                }
+            auto instance = std::make_shared<const FingerprintInstance>(createBaseFingerprint(fpIdx));
+            if (m_tensor) {
+                IdentityLabel& label = m_labels[fpIdx];  // Posição exclusiva desta tarefa, sem trava
+                label.fingerprintClass = instance->baseParams.classification.fingerprintClass;
+                label.seed = instance->seed;
+                label.valid = true;
             }
             
-            if (!hasTask) break;
+            // Num lote retomado só as versões que faltam no diário são renderizadas
+            int missing = 0;
+            for (int verIdx = startIdx; verIdx <= m_config.versionsPerFingerprint; ++verIdx) {
+                missing += isDone(fpIdx, verIdx) ? 0 : 1;
+            }
+            if (missing == 0) {
+                finishFingerprint();
+                return;
+            }
             
-            // Configurar gerador local
-            localGenerator.setParameters(task.instance.baseParams);
-            localGenerator.setSingularPoints(task.instance.basePoints);
+            // Gerador próprio da tarefa; todos os sorteios derivam da semente da identidade
+            FingerprintGenerator localGenerator;
+            localGenerator.setParameters(instance->baseParams);
+            localGenerator.setSingularPoints(instance->basePoints);
+            localGenerator.setSeed(instance->seed);
             
-            // Gerar imagem base
-            QImage baseFingerprint = localGenerator.generateFingerprint();
+            // Compartilhada pelas tarefas de versão; liberada quando a última termina
+            auto baseFingerprint = std::make_shared<const QImage>(localGenerator.generateFingerprint());
+            if (m_manifest && missing == versionCount) {
+                appendIdentityRecord(*instance, fpIdx, localGenerator.getMinutiae());
+            }
+            auto remaining = std::make_shared<std::atomic<int>>(missing);
             
-            // Gerar todas as versões desta impressão
-            int startIdx = m_config.skipOriginal ? 1 : 0;
-            for (int verIdx = startIdx; verIdx <= m_config.versionsPerFingerprint && !m_cancelled; ++verIdx) {
-                QImage transformedFingerprint;
-                
-                if (verIdx == 0) {
-                    transformedFingerprint = baseFingerprint.copy();
-                    transformedFingerprint.setDotsPerMeterX(500 * 39.3701);
-                    transformedFingerprint.setDotsPerMeterY(500 * 39.3701);
-                } else {
-                    VersionTransform transform = generateVersionTransform(verIdx);
-                    transformedFingerprint = applyVersionTransforms(baseFingerprint, transform);
-                }
-                
-                if (m_config.applyEllipticalMask) {
-                    transformedFingerprint = applyEllipticalMask(transformedFingerprint);
-                }
-                
-                // Salvar imagem
-                if (!saveFingerprint(transformedFingerprint, task.instance, task.fpIndex, verIdx)) {
-                    qWarning() << "Failed to save fingerprint" << task.fpIndex + 1 << "version" << verIdx;
+            for (int verIdx = startIdx; verIdx <= m_config.versionsPerFingerprint; ++verIdx) {
+                if (isDone(fpIdx, verIdx)) {
                     continue;
                 }
-                
-                // Salvar parâmetros se solicitado
-                if (m_config.saveParameters) {
-                    int actualIndex = m_config.startIndex + task.fpIndex;
-                    QString paramFile = QString("%1/%2_%3_v%4_params.json")
-                        .arg(m_config.outputDirectory)
-                        .arg(m_config.filenamePrefix)
-                        .arg(actualIndex, 4, 10, QChar('0'))
-                        .arg(verIdx);
-                    saveParameters(task.instance.baseParams, task.instance.basePoints, paramFile);
-                }
-                
-                m_generated.fetchAndAddRelaxed(1);
-            }
-            
-            // Emitir progresso ao completar cada digital
-            int fpCompleted = completedFps.fetchAndAddRelaxed(1) + 1;
-            int imgCompleted = m_generated.loadRelaxed();
-            {
-                QMutexLocker locker(&progressMutex);
-                emit progressUpdated(fpCompleted, m_config.numFingerprints, QString::number(imgCompleted));
+                pool.spawn([this, &finishFingerprint, instance, baseFingerprint, remaining, fpIdx, verIdx]() {
+                    if (!m_cancelled) {
+                        const VersionTransform transform = verIdx > 0
+                            ? generateVersionTransform(instance->seed, verIdx) : VersionTransform();
+                        QImage image = renderVersion(*baseFingerprint, transform, verIdx);
+                        if (m_ring) {
+                            if (writeRingFrame(image, fpIdx, verIdx)) {
+                                m_generated.fetchAndAddRelaxed(1);
+                            }
+                        } else {
+                            m_writer->push([this, image, instance, transform, fpIdx, verIdx]() {
+                                if (!writeVersion(image, *instance, transform, fpIdx, verIdx)) {
+                                    return false;
+                                }
+                                m_generated.fetchAndAddRelaxed(1);
+                                return true;
+                            });
+                        }
+                    }
+                    if (remaining->fetch_sub(1) == 1) {
+                        finishFingerprint();
+                    }
+                });
             }
-        }
+        });
     };
+    admitIdentities();
+    
+    pool.wait();
+    m_writer->finish();
+    m_writerStats = m_writer->stats();
+    m_writer.reset();
+    if (monitor) {
+        monitor->stop();
+        m_memoryPeak = monitor->peak();
+        if (monitor->cuts() > 0 && !m_config.quietMode) {
+            qDebug() << "Memory: measured use went over the budget, identities in flight lowered to"
+                     << monitor->limit();
+        }
+    }
     
-    // Criar e iniciar threads
-    std::vector<std::thread> threads;
-    for (int i = 0; i < numWorkers; ++i) {
-        threads.emplace_back(workerFunc);
+    if (!m_config.quietMode) {
+        qDebug() << "Writers:" << m_writerStats.writers << "busy" << m_writerStats.utilization() * 100.0 << "%"
+                 << "queue peak" << m_writerStats.maxDepth << "/" << m_writerStats.capacity
+                 << "workers blocked" << m_writerStats.producerWaitSeconds << "s";
     }
     
-    // Aguardar conclusão
-    for (auto& t : threads) {
-        t.join();
+    bool outputOk = true;
+    if (m_shards) {
+        outputOk = m_shards->close();
+        if (!outputOk) {
+            emit error(tr("Shard output failed: %1").arg(QString::fromStdString(m_shards->error())));
+        } else if (!m_config.quietMode) {
+            qDebug() << "Shards:" << m_shards->entryCount() << "entries in" << m_shards->shardCount() << "files";
+        }
+        m_shards.reset();
+    }
+    if (m_stream && !closeStreamOutput()) {
+        outputOk = false;
+    }
+    if (m_ring && !closeRingOutput()) {
+        outputOk = false;
+    }
+    // Último commit antes de fechar as saídas que ele sincroniza
+    if (m_journal && !closeJournal()) {
+        outputOk = false;
+    }
+    if (m_tensor && !closeTensorOutput()) {
+        outputOk = false;
+    }
+    if (m_manifest && !closeManifest()) {
+        outputOk = false;
     }
     
     int generated = m_generated.loadRelaxed();
-    if (!m_cancelled) {
+    if (!m_cancelled && outputOk) {
         emit batchCompleted(generated);
     }
     
-    return !m_cancelled;
+    return !m_cancelled && outputOk;
 }
 
 void BatchGenerator::cancel() {
     m_cancelled = true;
 }
 
-// Implementação da classe WorkerThread
-BatchGenerator::WorkerThread::WorkerThread(BatchGenerator* generator, int workerId)
-    : m_generator(generator)
-    , m_workerId(workerId)
-    , m_running(true)
-{
-}
-
-void BatchGenerator::WorkerThread::stop() {
-    m_running = false;
+QImage BatchGenerator::renderVersion(const QImage& baseFingerprint, const VersionTransform& transform,
+                                     int versionIndex) const {
+    QImage transformedFingerprint;
+    
+    if (versionIndex == 0) {
+        // v0: original completa, sem recorte
+        transformedFingerprint = baseFingerprint.copy();
+        transformedFingerprint.setDotsPerMeterX(500 * 39.3701);
+        transformedFingerprint.setDotsPerMeterY(500 * 39.3701);
+    } else {
+        transformedFingerprint = applyVersionTransforms(baseFingerprint, transform);
+    }
+    
+    if (m_config.applyEllipticalMask) {
+        transformedFingerprint = applyEllipticalMask(transformedFingerprint);
+    }
+    
+    return transformedFingerprint;
 }
 
-void BatchGenerator::WorkerThread::run() {
-    if (!m_generator->m_config.quietMode) qDebug() << "Worker" << m_workerId << "started processing";
-    int tasksProcessed = 0;
+bool BatchGenerator::writeVersion(const QImage& image, const FingerprintInstance& instance,
+                                  const VersionTransform& transform, int fpIndex, int versionIndex) {
+    quint32 crc = 0;
+    if (!saveFingerprint(image, instance, fpIndex, versionIndex, crc)) {
+        qWarning() << "Failed to save fingerprint" << fpIndex + 1 << "version" << versionIndex;
+        return false;
+    }
     
-    while (m_running && !m_generator->m_cancelled) {
-        // Esperar por tarefa disponível (timeout de 1 segundo para permitir cancelamento)
-        if (!m_generator->m_queueSemaphore.tryAcquire(1, 1000)) {
-            continue;  // Timeout, verificar se deve continuar
-        }
-        
-        // Obter tarefa da fila
-        FingerprintTask task;
-        bool hasTask = false;
-        {
-            QMutexLocker locker(&m_generator->m_queueMutex);
-            if (!m_generator->m_taskQueue.isEmpty()) {
-                task = m_generator->m_taskQueue.dequeue();
-                hasTask = true;
-            }
-        }
-        
-        if (!hasTask) {
-            continue;  // Fila vazia, continuar esperando
-        }
-        
-        // Processar tarefa
-        if (m_generator->m_cancelled) {
-            break;
-        }
-        
-        QImage transformedFingerprint;
-        
-        if (task.versionIndex == 0) {
-            // Versão 1 (v0): ORIGINAL COMPLETA 1000x1200 SEM recorte
-            transformedFingerprint = task.baseFingerprint.copy();
-            transformedFingerprint.setDotsPerMeterX(500 * 39.3701);
-            transformedFingerprint.setDotsPerMeterY(500 * 39.3701);
-        } else {
-            // Versões 2+ (v1+): aplicar transformações PERCEPTÍVEIS + recorte 500x600
-            VersionTransform transform = m_generator->generateVersionTransform(task.versionIndex);
-            transformedFingerprint = m_generator->applyVersionTransforms(task.baseFingerprint, transform);
-        }
-        
-        // Aplicar máscara elíptica se habilitado
-        if (m_generator->m_config.applyEllipticalMask) {
-            transformedFingerprint = m_generator->applyEllipticalMask(transformedFingerprint);
-        }
-        
-        // Salvar imagem
-        if (!m_generator->m_cancelled) {
-            if (!m_generator->saveFingerprint(transformedFingerprint, task.instance, task.fpIndex, task.versionIndex)) {
-                // Erro ao salvar - emitir sinal na thread principal
-                QMetaObject::invokeMethod(m_generator, [task]() {
-                    // Note: Esta é uma simplificação - idealmente deveríamos passar o generator
-                    // mas para evitar complexidade com QMetaObject, apenas logamos o erro
-                    qWarning() << "Failed to save fingerprint" << task.fpIndex + 1 << "version" << task.versionIndex;
-                }, Qt::QueuedConnection);
-            }
-            
-            // Salvar parâmetros se solicitado
-            if (m_generator->m_config.saveParameters) {
-                int actualIndex = m_generator->m_config.startIndex + task.fpIndex;
-                QString paramFile = QString("%1/%2_%3_v%4_params.json")
-                    .arg(m_generator->m_config.outputDirectory)
-                    .arg(m_generator->m_config.filenamePrefix)
-                    .arg(actualIndex, 4, 10, QChar('0'))
-                    .arg(task.versionIndex);
-                    
-                m_generator->saveParameters(task.instance.baseParams, task.instance.basePoints, paramFile);
-            }
-            
-            // Incrementar contador de imagens geradas
-            m_generator->m_generated.fetchAndAddRelaxed(1);
-            tasksProcessed++;
-            
-            qDebug() << "Worker" << m_workerId << "processed task" << tasksProcessed 
-                     << "(FP" << task.fpIndex + 1 << "v" << task.versionIndex << ")";
-        }
+    // Depois da imagem gravada: cada registro de versão corresponde a um arquivo
+    if (m_manifest) {
+        appendVersionRecord(fpIndex, versionIndex, transform);
     }
     
-    // Worker terminando
-    qDebug() << "Worker" << m_workerId << "finished. Total tasks processed:" << tasksProcessed;
-    m_generator->m_activeWorkers.fetchAndAddRelaxed(-1);
+    // Em shards a entrada só vai para o diário quando o shard é selado; um fluxo não tem diário
+    if (m_journal && !m_shards) {
+        Raster::JournalEntry entry;
+        entry.identity = static_cast<quint32>(identity(fpIndex));
+        entry.version = static_cast<quint16>(versionIndex);
+        entry.crc = crc;
+        m_journal->record(entry);  // Uma falha trava o diário e aparece em closeJournal()
+    }
+    
+    return true;
+}
+
+Raster::MemoryModel BatchGenerator::memoryModel() const {
+    const quint64 crop = static_cast<quint64>(kCropWidth) * kCropHeight;
+    Raster::MemoryModel model;
+    model.baseline = Raster::privateRss() + kSharedBytes;
+    model.perIdentity = kIdentityBytesPerPixel * kMaxBasePixels;
+    model.perWorker = kVersionBytesPerPixel * kMaxBasePixels + crop;  // O recorte pronto sendo codificado
+    if (m_config.writeQueueDepth > 0) {
+        model.baseline += static_cast<quint64>(m_config.writeQueueDepth) * crop;
+    } else {
+        model.perWorker += 2 * crop;  // A parte dele na fila de gravação
+    }
+    return model;
+}
+
+Raster::WriteQueueStats BatchGenerator::writerStats() const {
+    return m_writer ? m_writer->stats() : m_writerStats;
 }
 
 FingerprintInstance BatchGenerator::createBaseFingerprint(int index) {
@@ -380,14 +648,16 @@ FingerprintInstance BatchGenerator::createBaseFingerprint(int index) {
     // Parâmetros base - GERAR IMPRESSÃO 1000x1200px @ 500 DPI
     instance.baseParams.reset();
     
-    auto* rng = QRandomGenerator::global();
+    // Semente pelo índice absoluto: um intervalo iniciado em outro lugar (startIndex) sai igual
+    instance.seed = Raster::identitySeed(m_masterSeed, static_cast<quint64>(identity(index)));
+    QRandomGenerator rng = seededGenerator(Raster::streamSeed(instance.seed, Raster::SeedStream::Parameters));
     // Para width=1000: left ~500, right ~500
-    instance.baseParams.shape.left = 500 + rng->bounded(-30, 31);
-    instance.baseParams.shape.right = 500 + rng->bounded(-30, 31);
+    instance.baseParams.shape.left = 500 + rng.bounded(-30, 31);
+    instance.baseParams.shape.right = 500 + rng.bounded(-30, 31);
     // Para height=1200: top ~480, middle ~240, bottom ~480
-    instance.baseParams.shape.top = 480 + rng->bounded(-30, 31);
-    instance.baseParams.shape.middle = 240 + rng->bounded(-20, 21);
-    instance.baseParams.shape.bottom = 480 + rng->bounded(-30, 31);
+    instance.baseParams.shape.top = 480 + rng.bounded(-30, 31);
+    instance.baseParams.shape.middle = 240 + rng.bounded(-20, 21);
+    instance.baseParams.shape.bottom = 480 + rng.bounded(-30, 31);
     
     // Gerar pontos singulares baseados no tipo de impressão
     int width = instance.baseParams.shape.left + instance.baseParams.shape.right;
@@ -395,9 +665,10 @@ FingerprintInstance BatchGenerator::createBaseFingerprint(int index) {
                  instance.baseParams.shape.bottom;
     
     // Selecionar tipo por distribuição populacional
-    FingerprintClass selectedClass = selectClassByPopulation();
+    FingerprintClass selectedClass = selectClassByPopulation(rng);
     
-    instance.basePoints.generateRandomPoints(selectedClass, width, height);
+    instance.basePoints.generateRandomPoints(selectedClass, width, height,
+                                             Raster::streamSeed(instance.seed, Raster::SeedStream::SingularPoints));
     instance.baseParams.classification.fingerprintClass = selectedClass;
     
     // Zerar edge blend na geração em massa
@@ -409,72 +680,90 @@ FingerprintInstance BatchGenerator::createBaseFingerprint(int index) {
     
     // Randomizar parâmetros de orientação para presilhas
     if (selectedClass == FingerprintClass::RightLoop || selectedClass == FingerprintClass::LeftLoop) {
-        instance.baseParams.orientation.coreConvergenceStrength = rng->generateDouble() * 0.25;
-        instance.baseParams.orientation.coreConvergenceRadius = rng->bounded(41);
-        instance.baseParams.orientation.verticalBiasStrength = rng->generateDouble() * 0.35;
-        instance.baseParams.orientation.verticalBiasRadius = rng->bounded(41);
+        instance.baseParams.orientation.coreConvergenceStrength = rng.generateDouble() * 0.25;
+        instance.baseParams.orientation.coreConvergenceRadius = rng.bounded(41);
+        instance.baseParams.orientation.verticalBiasStrength = rng.generateDouble() * 0.35;
+        instance.baseParams.orientation.verticalBiasRadius = rng.bounded(41);
     }
     
     return instance;
 }
 
-VersionTransform BatchGenerator::generateVersionTransform(int versionIndex) const {
+VersionTransform BatchGenerator::generateVersionTransform(quint64 identitySeed, int versionIndex) const {
     VersionTransform transform;
     
-    auto* rng = QRandomGenerator::global();
+    // Cada versão tem sua própria semente: (identidade, versão) define a imagem
+    QRandomGenerator rng = seededGenerator(Raster::versionSeed(identitySeed, versionIndex));
     
     // Versões 2+: Transformações PERCEPTÍVEIS
     
     // Rotação angular (-15 a +15 graus) - PERCEPTÍVEL
-    transform.rotation = (rng->generateDouble() - 0.5) * 30.0;
+    transform.rotation = (rng.generateDouble() - 0.5) * 30.0;
     
     // Nível de ruído (0.03 a 0.08) - PERCEPTÍVEL
-    transform.noiseLevel = 0.03 + rng->generateDouble() * 0.05;
+    transform.noiseLevel = 0.03 + rng.generateDouble() * 0.05;
     
     // Distorção de lente: PINCUSHION (sempre true)
     // Range dobrado: -0.16 a +0.16
     transform.usePincushion = true;
-    double magnitude = 0.08 + rng->generateDouble() * 0.08;  // 0.08 a 0.16
-    transform.lensDistortion = (rng->generateDouble() < 0.5) ? -magnitude : magnitude;
+    double magnitude = 0.08 + rng.generateDouble() * 0.08;  // 0.08 a 0.16
+    transform.lensDistortion = (rng.generateDouble() < 0.5) ? -magnitude : magnitude;
     
     // Deslocamento homográfico (-20 a +20 pixels em X e Y)
     transform.homographyShift = QPointF(
-        (rng->generateDouble() - 0.5) * 40.0,
-        (rng->generateDouble() - 0.5) * 40.0
+        (rng.generateDouble() - 0.5) * 40.0,
+        (rng.generateDouble() - 0.5) * 40.0
     );
     
     // Ângulo de perspectiva homográfica (-10 a +10 graus)
-    transform.homographyAngle = (rng->generateDouble() - 0.5) * 20.0;
+    transform.homographyAngle = (rng.generateDouble() - 0.5) * 20.0;
     
     // Recorte final será 500x600 (largura x altura)
-    transform.cropRegion = QRect(0, 0, 500, 600);
+    transform.cropRegion = QRect(0, 0, kCropWidth, kCropHeight);
     
     // Blur circular aleatório - centro DENTRO do cropRegion
     transform.applyBlur = true;
-    transform.blurRadius = 25 + rng->bounded(126);  // 25 a 150
+    transform.blurRadius = 25 + rng.bounded(126);  // 25 a 150
     
     // Centro do blur dentro do cropRegion (margem de 50px das bordas)
     int cropW = transform.cropRegion.width();
     int cropH = transform.cropRegion.height();
     transform.blurCenter = QPointF(
-        50.0 + rng->generateDouble() * (cropW - 100.0),  // 50 a 450
-        50.0 + rng->generateDouble() * (cropH - 100.0)   // 50 a 550
+        50.0 + rng.generateDouble() * (cropW - 100.0),  // 50 a 450
+        50.0 + rng.generateDouble() * (cropH - 100.0)   // 50 a 550
     );
     
+    // Semente do ruído (o kernel gera o ruído por linha a partir dela)
+    transform.noiseSeed = rng.generate64();
+    
+    // Intensidade do desfoque: sigma entre 1 e maxBlurSigma
+    transform.blurSigma = 1.0 + rng.generateDouble() * std::max(0.0, m_config.maxBlurSigma - 1.0);
+    
+    // Recorte em torno do centro: coordenadas polares, distância [0, 150px] e ângulo [0, 2π]
+    transform.cropRadius = rng.generateDouble() * 150.0;
+    transform.cropAngle = rng.generateDouble() * 2.0 * M_PI;
+    
     return transform;
 }
 
 QImage BatchGenerator::applyVersionTransforms(const QImage& baseImage, const VersionTransform& transform) const {
-    QImage result = baseImage.copy();
+    // Caminho fundido (a base menor que o recorte fica com o padding do caminho encadeado)
+    if (m_config.fusedWarp &&
+        baseImage.width() >= transform.cropRegion.width() &&
+        baseImage.height() >= transform.cropRegion.height()) {
+        return applyFusedVersionTransforms(baseImage, transform);
+    }
+    
+    QImage result = toGrayscale8(baseImage);
     
     // 1. Aplicar ruído
     if (transform.noiseLevel > 0.001) {
-        result = applyNoise(result, transform.noiseLevel);
+        result = applyNoise(result, transform.noiseLevel, transform.noiseSeed);
     }
     
     // 2. Aplicar BLUR circular (APÓS ruído, ANTES de lens/perspectiva)
     if (transform.applyBlur && transform.blurRadius > 0) {
-        result = applyBlur(result, transform.blurRadius, transform.blurCenter);
+        result = applyBlur(result, transform.blurRadius, transform.blurCenter, transform.blurSigma);
     }
     
     // 3. Aplicar distorção de lente (Barrel ou Pincushion)
@@ -493,7 +782,7 @@ QImage BatchGenerator::applyVersionTransforms(const QImage& baseImage, const Ver
     }
     
     // 6. Aplicar recorte final 500x600px (largura x altura) sem bordas vazias
-    result = applyCrop(result, 500, 600);
+    result = applyCrop(result, transform);
     
     // 6. Garantir DPI 500
     result.setDotsPerMeterX(500 * 39.3701);
@@ -502,201 +791,104 @@ QImage BatchGenerator::applyVersionTransforms(const QImage& baseImage, const Ver
     return result;
 }
 
-// Funções auxiliares de transformação
-QImage BatchGenerator::applyNoise(const QImage& image, double noiseLevel) const {
-    QImage noisy = image.copy();
-    auto* rng = QRandomGenerator::global();
-    
-    for (int y = 0; y < noisy.height(); ++y) {
-        for (int x = 0; x < noisy.width(); ++x) {
-            QRgb pixel = noisy.pixel(x, y);
-            int gray = qGray(pixel);
-            
-            // Adicionar ruído gaussiano
-            double noise = (rng->generateDouble() - 0.5) * 255.0 * noiseLevel;
-            int newGray = qBound(0, static_cast<int>(gray + noise), 255);
-            
-            noisy.setPixel(x, y, qRgb(newGray, newGray, newGray));
+QImage BatchGenerator::applyFusedVersionTransforms(const QImage& baseImage, const VersionTransform& transform) const {
+    // Mesma cadeia de applyVersionTransforms, mas o recorte é sorteado primeiro e
+    // lente, homografia, rotação e recorte viram um único mapeamento inverso:
+    // só os 500x600 pixels de saída são reamostrados, uma única vez
+    const int targetWidth = transform.cropRegion.width();
+    const int targetHeight = transform.cropRegion.height();
+    QImage source = toGrayscale8(baseImage);
+    
+    Raster::VersionWarp warp;
+    warp.sourceWidth = source.width();
+    warp.sourceHeight = source.height();
+    
+    QPoint cropOrigin = chooseCropOrigin(source.width(), source.height(), transform);
+    warp.cropX = cropOrigin.x();
+    warp.cropY = cropOrigin.y();
+    
+    warp.rotation = std::abs(transform.rotation) > 0.1;
+    warp.rotationDegrees = transform.rotation;
+    warp.homography = std::abs(transform.homographyAngle) > 0.1 || !transform.homographyShift.isNull();
+    warp.homographyDegrees = transform.homographyAngle;
+    warp.homographyShiftX = transform.homographyShift.x();
+    warp.homographyShiftY = transform.homographyShift.y();
+    warp.lens = std::abs(transform.lensDistortion) > 0.001;
+    warp.lensK = transform.lensDistortion;
+    
+    // Ruído e blur só na região da base que a saída realmente lê
+    Raster::WarpFootprint footprint = Raster::versionWarpFootprint(warp, targetWidth, targetHeight);
+    QImage region;
+    if (!footprint.isEmpty()) {
+        region = source.copy(footprint.x0, footprint.y0, footprint.width(), footprint.height());
+        
+        if (transform.noiseLevel > 0.001) {
+            region = applyNoise(region, transform.noiseLevel, transform.noiseSeed);
+        }
+        if (transform.applyBlur && transform.blurRadius > 0) {
+            region = applyBlur(region, transform.blurRadius,
+                               transform.blurCenter - QPointF(footprint.x0, footprint.y0),
+                               transform.blurSigma);
         }
     }
     
+    QImage result(targetWidth, targetHeight, QImage::Format_Grayscale8);
+    Raster::applyVersionWarp(region.isNull() ? nullptr : region.constBits(),
+                             region.isNull() ? 0 : static_cast<int>(region.bytesPerLine()),
+                             footprint, result.bits(), static_cast<int>(result.bytesPerLine()),
+                             targetWidth, targetHeight, warp, m_config.warpInterpolation);
+    
+    result.setDotsPerMeterX(500 * 39.3701);
+    result.setDotsPerMeterY(500 * 39.3701);
+    
+    return result;
+}
+
+// Funções auxiliares de transformação
+QImage BatchGenerator::applyNoise(const QImage& image, double noiseLevel, quint64 seed) const {
+    QImage noisy = toGrayscale8(image).copy();
+    Raster::addUniformNoise(grayView(noisy), noiseLevel,
+                            Raster::RandomStream(seed, 0, Raster::NoiseStage::VersionNoise));
     return noisy;
 }
 
-QImage BatchGenerator::applyBlur(const QImage& image, int radius, const QPointF& center) const {
-    // Blur circular gaussiano
-    QImage blurred = image.copy();
-    
-    // Kernel gaussiano simples (3x3 para performance)
-    const int kernelSize = 3;
-    const double kernel[3][3] = {
-        {1.0/16, 2.0/16, 1.0/16},
-        {2.0/16, 4.0/16, 2.0/16},
-        {1.0/16, 2.0/16, 1.0/16}
-    };
-    
-    // Aplicar blur apenas em região circular
-    for (int y = 0; y < image.height(); ++y) {
-        for (int x = 0; x < image.width(); ++x) {
-            // Calcular distância do pixel ao centro do blur
-            double dx = x - center.x();
-            double dy = y - center.y();
-            double dist = std::sqrt(dx*dx + dy*dy);
-            
-            // Se dentro do raio, aplicar blur
-            if (dist <= radius) {
-                // Intensidade do blur (mais forte no centro, decay linear)
-                double blurIntensity = 1.0 - (dist / radius);
-                
-                // Aplicar convolução gaussiana
-                double sumR = 0, sumG = 0, sumB = 0;
-                for (int ky = -1; ky <= 1; ++ky) {
-                    for (int kx = -1; kx <= 1; ++kx) {
-                        int px = qBound(0, x + kx, image.width() - 1);
-                        int py = qBound(0, y + ky, image.height() - 1);
-                        QRgb pixel = image.pixel(px, py);
-                        double weight = kernel[ky + 1][kx + 1];
-                        sumR += qRed(pixel) * weight;
-                        sumG += qGreen(pixel) * weight;
-                        sumB += qBlue(pixel) * weight;
-                    }
-                }
-                
-                // Interpolar entre original e blur
-                QRgb original = image.pixel(x, y);
-                int finalR = qBound(0, static_cast<int>(qRed(original) * (1-blurIntensity) + sumR * blurIntensity), 255);
-                int finalG = qBound(0, static_cast<int>(qGreen(original) * (1-blurIntensity) + sumG * blurIntensity), 255);
-                int finalB = qBound(0, static_cast<int>(qBlue(original) * (1-blurIntensity) + sumB * blurIntensity), 255);
-                
-                blurred.setPixel(x, y, qRgb(finalR, finalG, finalB));
-            }
-        }
-    }
-    
+QImage BatchGenerator::applyBlur(const QImage& image, int radius, const QPointF& center, double sigma) const {
+    // Desfoque circular: sigma decai linearmente do centro até a borda do disco
+    // (pirâmide gaussiana; custo por pixel independente do sigma)
+    QImage source = toGrayscale8(image);
+    QImage blurred = source.copy();
+    Raster::radialDefocus(constGrayView(source), grayView(blurred), radius, center.x(), center.y(), sigma);
     return blurred;
 }
 
-QImage BatchGenerator::applyLensDistortion(const QImage& image, double k) const {
-    QImage distorted(image.size(), image.format());
-    distorted.fill(Qt::white);
-    
-    int width = image.width();
-    int height = image.height();
-    double cx = width / 2.0;
-    double cy = height / 2.0;
-    double maxRadius = std::sqrt(cx * cx + cy * cy);
-    
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            // Normalizar coordenadas (-1 a +1)
-            double nx = (x - cx) / cx;
-            double ny = (y - cy) / cy;
-            double r = std::sqrt(nx * nx + ny * ny);
-            
-            // Aplicar distorção barrel: r' = r * (1 + k * r^2)
-            double rDistorted = r * (1.0 + k * r * r);
-            
-            // Converter de volta para coordenadas de imagem
-            double srcX = cx + (nx / r) * rDistorted * cx;
-            double srcY = cy + (ny / r) * rDistorted * cy;
-            
-            // Interpolação bilinear
-            if (srcX >= 0 && srcX < width - 1 && srcY >= 0 && srcY < height - 1) {
-                int x0 = static_cast<int>(srcX);
-                int y0 = static_cast<int>(srcY);
-                double fx = srcX - x0;
-                double fy = srcY - y0;
-                
-                QRgb p00 = image.pixel(x0, y0);
-                QRgb p10 = image.pixel(x0 + 1, y0);
-                QRgb p01 = image.pixel(x0, y0 + 1);
-                QRgb p11 = image.pixel(x0 + 1, y0 + 1);
-                
-                int gray = static_cast<int>(
-                    qGray(p00) * (1 - fx) * (1 - fy) +
-                    qGray(p10) * fx * (1 - fy) +
-                    qGray(p01) * (1 - fx) * fy +
-                    qGray(p11) * fx * fy
-                );
-                
-                distorted.setPixel(x, y, qRgb(gray, gray, gray));
-            }
-        }
-    }
-    
+QImage BatchGenerator::applyLensDistortion(const QImage& input, double k) const {
+    QImage image = toGrayscale8(input);
+    QImage distorted(image.size(), QImage::Format_Grayscale8);
+    Raster::lensDistortion(constGrayView(image), grayView(distorted), k);
     return distorted;
 }
 
-QImage BatchGenerator::applyHomography(const QImage& image, const QPointF& shift, double angle) const {
-    QImage result(image.size(), image.format());
-    result.fill(Qt::white);
-    
-    double rad = angle * M_PI / 180.0;
-    double cosA = std::cos(rad);
-    double sinA = std::sin(rad);
-    
-    int width = image.width();
-    int height = image.height();
-    double cx = width / 2.0;
-    double cy = height / 2.0;
-    
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            // Aplicar perspectiva simples (shear + deslocamento)
-            double nx = x - cx;
-            double ny = y - cy;
-            
-            // Transformação de perspectiva simples
-            double srcX = nx * cosA - ny * sinA * 0.3 + shift.x() + cx;
-            double srcY = nx * sinA * 0.3 + ny * cosA + shift.y() + cy;
-            
-            if (srcX >= 0 && srcX < width - 1 && srcY >= 0 && srcY < height - 1) {
-                int x0 = static_cast<int>(srcX);
-                int y0 = static_cast<int>(srcY);
-                double fx = srcX - x0;
-                double fy = srcY - y0;
-                
-                QRgb p00 = image.pixel(x0, y0);
-                QRgb p10 = image.pixel(x0 + 1, y0);
-                QRgb p01 = image.pixel(x0, y0 + 1);
-                QRgb p11 = image.pixel(x0 + 1, y0 + 1);
-                
-                int gray = static_cast<int>(
-                    qGray(p00) * (1 - fx) * (1 - fy) +
-                    qGray(p10) * fx * (1 - fy) +
-                    qGray(p01) * (1 - fx) * fy +
-                    qGray(p11) * fx * fy
-                );
-                
-                result.setPixel(x, y, qRgb(gray, gray, gray));
-            }
-        }
-    }
-    
+QImage BatchGenerator::applyHomography(const QImage& input, const QPointF& shift, double angle) const {
+    QImage image = toGrayscale8(input);
+    QImage result(image.size(), QImage::Format_Grayscale8);
+    Raster::homography(constGrayView(image), grayView(result), shift.x(), shift.y(), angle);
     return result;
 }
 
-QImage BatchGenerator::applyRotation(const QImage& image, double angle) const {
-    QTransform transform;
-    transform.rotate(angle);
-    
-    QImage rotated = image.transformed(transform, Qt::SmoothTransformation);
-    
-    // Retornar ao tamanho original (crop central)
-    int dx = (rotated.width() - image.width()) / 2;
-    int dy = (rotated.height() - image.height()) / 2;
-    
-    if (dx >= 0 && dy >= 0) {
-        return rotated.copy(dx, dy, image.width(), image.height());
-    }
-    
+QImage BatchGenerator::applyRotation(const QImage& input, double angle) const {
+    // Rotação em torno do centro mantendo o tamanho (cantos descobertos ficam brancos)
+    QImage image = toGrayscale8(input);
+    QImage rotated(image.size(), QImage::Format_Grayscale8);
+    Raster::rotation(constGrayView(image), grayView(rotated), angle);
     return rotated;
 }
 
-QImage BatchGenerator::applyCrop(const QImage& image, int targetWidth, int targetHeight) const {
+QImage BatchGenerator::applyCrop(const QImage& image, const VersionTransform& transform) const {
     // Recorte EM TORNO do centro usando coordenadas polares
     // Centro do retângulo de recorte varia em distância [0, 150px] e ângulo [0, 360°]
     // Imagem base é ~1000x1200, recorte é 500x600 (largura x altura)
+    const int targetWidth = transform.cropRegion.width();
+    const int targetHeight = transform.cropRegion.height();
     
     if (image.width() < targetWidth || image.height() < targetHeight) {
         // Se imagem menor que alvo (não deveria acontecer), retornar com padding
@@ -711,16 +903,24 @@ QImage BatchGenerator::applyCrop(const QImage& image, int targetWidth, int targe
         return result;
     }
     
-    auto* rng = QRandomGenerator::global();
+    QPoint origin = chooseCropOrigin(image.width(), image.height(), transform);
+    QImage source = toGrayscale8(image);
+    QImage result(targetWidth, targetHeight, QImage::Format_Grayscale8);
+    Raster::copyRegion(constGrayView(source), origin.x(), origin.y(), grayView(result));
+    return result;
+}
+
+QPoint BatchGenerator::chooseCropOrigin(int imageWidth, int imageHeight, const VersionTransform& transform) const {
+    const int targetWidth = transform.cropRegion.width();
+    const int targetHeight = transform.cropRegion.height();
     
     // Centro da imagem base
-    int imageCenterX = image.width() / 2;
-    int imageCenterY = image.height() / 2;
+    int imageCenterX = imageWidth / 2;
+    int imageCenterY = imageHeight / 2;
     
-    // Coordenadas polares: distância radial [0, 150] e ângulo [0, 2π]
-    double maxRadius = 150.0;
-    double radius = rng->generateDouble() * maxRadius;
-    double angle = rng->generateDouble() * 2.0 * M_PI;
+    // Coordenadas polares sorteadas com a versão
+    double radius = transform.cropRadius;
+    double angle = transform.cropAngle;
     
     // Calcular centro do retângulo de recorte em coordenadas cartesianas
     int cropCenterX = imageCenterX + static_cast<int>(radius * std::cos(angle));
@@ -733,61 +933,30 @@ QImage BatchGenerator::applyCrop(const QImage& image, int targetWidth, int targe
     // Garantir que recorte fica dentro dos limites da imagem (com margem de segurança)
     // Margem de 50px das bordas para garantir que não pega áreas sem cristas/vales
     int margin = 50;
-    cropX = qBound(margin, cropX, image.width() - targetWidth - margin);
-    cropY = qBound(margin, cropY, image.height() - targetHeight - margin);
+    cropX = qBound(margin, cropX, imageWidth - targetWidth - margin);
+    cropY = qBound(margin, cropY, imageHeight - targetHeight - margin);
     
-    return image.copy(cropX, cropY, targetWidth, targetHeight);
+    return QPoint(cropX, cropY);
 }
 
 QImage BatchGenerator::applyEllipticalMask(const QImage& image) const {
-    // Criar resultado com mesmo formato da imagem original
-    QImage result = image.copy();
-    int width = result.width();
-    int height = result.height();
-    
-    // Centro da elipse
-    double cx = width / 2.0;
-    double cy = height / 2.0;
+    QImage result = toGrayscale8(image).copy();
     
     // Raios da elipse (94% do tamanho para deixar margem)
-    double rx = width * 0.47;
-    double ry = height * 0.47;
-    
-    // Largura do fade out (10% do menor eixo)
-    double fadeWidth = std::min(rx, ry) * 0.10;
-    
-    // Aplicar máscara com fade out suave usando métodos seguros do Qt
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            // Calcular distância normalizada do centro da elipse
-            double dx_norm = (x - cx) / rx;
-            double dy_norm = (y - cy) / ry;
-            double dist = std::sqrt(dx_norm * dx_norm + dy_norm * dy_norm);
-            
-            // Calcular alpha (transparência)
-            double alpha = 1.0;
-            if (dist > 1.0) {
-                // Fora da elipse: fade out completo para branco
-                alpha = 0.0;
-            } else if (dist > (1.0 - fadeWidth / rx)) {
-                // Na região de fade out: transição suave
-                double fadePos = (dist - (1.0 - fadeWidth / rx)) / (fadeWidth / rx);
-                // Usar função suave (smoothstep)
-                alpha = 1.0 - (fadePos * fadePos * (3.0 - 2.0 * fadePos));
-            }
-            
-            // Aplicar alpha blending com branco usando métodos seguros
-            QRgb pixel = result.pixel(x, y);
-            int gray = qGray(pixel);
-            int newGray = static_cast<int>(gray * alpha + 255 * (1.0 - alpha));
-            result.setPixel(x, y, qRgb(newGray, newGray, newGray));
-        }
-    }
+    Raster::EllipticalMask mask;
+    mask.radiusX = result.width() * 0.47;
+    mask.radiusY = result.height() * 0.47;
+    
+    // Largura do fade out (10% do menor eixo), com transição smoothstep
+    double fadeWidth = std::min(mask.radiusX, mask.radiusY) * 0.10;
+    mask.fadeStart = 1.0 - fadeWidth / mask.radiusX;
+    mask.smoothstep = true;
     
+    Raster::applyEllipticalMask(grayView(result), mask);
     return result;
 }
 
-FingerprintClass BatchGenerator::selectClassByPopulation() const {
+FingerprintClass BatchGenerator::selectClassByPopulation(QRandomGenerator& rng) const {
     // Distribuição populacional baseada em estatísticas forenses reais:
     // Fontes: Crime Scene Investigator Network, PIT-4, estudos populacionais
     // 
@@ -802,8 +971,7 @@ FingerprintClass BatchGenerator::selectClassByPopulation() const {
     // Arch (Plain): 3%
     // TentedArch: 2%
     
-    auto* rng = QRandomGenerator::global();
-    double random = rng->generateDouble(); // 0.0 a 1.0
+    double random = rng.generateDouble(); // 0.0 a 1.0
     
     // Probabilidades acumuladas CORRIGIDAS com distribuição estatística real
     if (random < 0.325) return FingerprintClass::LeftLoop;     // 0.000 - 0.325 (32.5%)
@@ -814,33 +982,472 @@ FingerprintClass BatchGenerator::selectClassByPopulation() const {
     return FingerprintClass::TentedArch;                        // 0.980 - 1.000 (2.0%)
 }
 
+// Saídas em contêiner levam o nome da primeira identidade do intervalo, como as imagens
+QString BatchGenerator::outputStem() const {
+    return QString("%1/%2_%3")
+        .arg(m_config.outputDirectory)
+        .arg(m_config.filenamePrefix)
+        .arg(m_config.startIndex, 4, 10, QChar('0'));
+}
+
+bool BatchGenerator::openTensorOutput() {
+    // A v0 é a imagem base sem recorte, de tamanho variável: não cabe num slot
+    if (!m_config.skipOriginal) {
+        emit error(tr("NPY output holds the cropped versions only; use --skip-original"));
+        return false;
+    }
+    
+    const QString path = outputStem() + ".npy";
+    const std::vector<uint64_t> shape = {static_cast<uint64_t>(m_config.numFingerprints),
+                                         static_cast<uint64_t>(m_config.versionsPerFingerprint),
+                                         kCropHeight, kCropWidth};
+    const bool existing = m_resumed && QFile::exists(path);
+    m_tensor = std::make_unique<Raster::NpyFile>();
+    if (!(existing ? m_tensor->reopen(path.toStdString(), shape) : m_tensor->create(path.toStdString(), shape))) {
+        emit error(tr("NPY output failed: %1").arg(QString::fromStdString(m_tensor->error())));
+        m_tensor.reset();
+        return false;
+    }
+    m_labels.assign(m_config.numFingerprints, IdentityLabel());
+    
+    if (!m_config.quietMode) {
+        qDebug() << "Tensor:" << path << "[" << m_config.numFingerprints << m_config.versionsPerFingerprint
+                 << kCropHeight << kCropWidth << "] uint8";
+    }
+    return true;
+}
+
+// Os quadros vão direto para o stdout; enquanto isso a main manda as mensagens para o stderr
+bool BatchGenerator::openStreamOutput() {
+    m_stream = std::make_unique<Raster::FrameStreamWriter>();
+    if (!m_stream->open(1, m_config.filenamePrefix.toStdString())) {
+        emit error(tr("Stream output failed: %1").arg(QString::fromStdString(m_stream->error())));
+        m_stream.reset();
+        return false;
+    }
+    if (!m_config.quietMode) {
+        const bool raw = m_config.outputFormat == OutputFormat::Npy;
+        qDebug() << "Stream: stdout," << (raw ? "raw uint8" : m_config.imageCodec == ImageCodec::Wsq ? "WSQ" : "PNG")
+                 << "frames";
+    }
+    return true;
+}
+
+// Slots de tamanho fixo: como o tensor, o anel leva só as versões recortadas
+bool BatchGenerator::openRingOutput(int numWorkers) {
+    if (!m_config.skipOriginal) {
+        emit error(tr("A shared-memory ring holds the cropped versions only; use --skip-original"));
+        return false;
+    }
+    const int slotCount = m_config.ringSlots > 0 ? m_config.ringSlots : 4 * numWorkers;
+    const quint64 frames = static_cast<quint64>(m_config.numFingerprints) * m_config.versionsPerFingerprint;
+    m_ring = std::make_unique<Raster::ShmRingWriter>();
+    if (!m_ring->create(m_config.ringName.toStdString(), slotCount, kCropWidth, kCropHeight, frames,
+                        m_config.filenamePrefix.toStdString())) {
+        emit error(tr("Ring output failed: %1").arg(QString::fromStdString(m_ring->error())));
+        m_ring.reset();
+        return false;
+    }
+    if (!m_config.quietMode) {
+        qDebug() << "Ring:" << QString::fromStdString(m_ring->name()) << "with" << slotCount << "slots of"
+                 << kCropWidth << "x" << kCropHeight << "uint8";
+    }
+    return true;
+}
+
+// Espera o consumidor ler todos os quadros antes de o nome do segmento sumir
+bool BatchGenerator::closeRingOutput() {
+    if (m_cancelled) {
+        m_ring->abort("the batch was cancelled");
+    }
+    bool ok = m_ring->close();
+    if (!ok) {
+        emit error(tr("Ring output failed: %1").arg(QString::fromStdString(m_ring->error())));
+    } else if (!m_config.quietMode) {
+        qDebug() << "Ring:" << m_ring->frameCount() << "frames, workers waited" << m_ring->blockedSeconds()
+                 << "s for free slots";
+    }
+    m_ring.reset();
+    return ok;
+}
+
+bool BatchGenerator::closeStreamOutput() {
+    bool ok = m_stream->close();
+    if (!ok) {
+        emit error(tr("Stream output failed: %1").arg(QString::fromStdString(m_stream->error())));
+    } else if (!m_config.quietMode) {
+        qDebug() << "Stream:" << m_stream->frameCount() << "frames," << (m_stream->bytesWritten() >> 20) << "MiB,"
+                 << m_stream->blockedSeconds() << "s writing to the reader";
+    }
+    m_stream.reset();
+    return ok;
+}
+
+bool BatchGenerator::closeTensorOutput() {
+    bool ok = m_tensor->close();
+    if (!ok) {
+        emit error(tr("NPY output failed: %1").arg(QString::fromStdString(m_tensor->error())));
+    }
+    m_tensor.reset();
+    
+    // Linha n descreve tensor[n]; identidades que não rodaram (lote cancelado) ficam de fora
+    static const char* const kClassNames[] = {"none", "arch", "tented_arch", "left_loop", "right_loop",
+                                              "whorl", "twin_loop", "central_pocket", "accidental"};
+    QFile file(outputStem() + "_labels.csv");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        emit error(tr("Cannot write %1").arg(file.fileName()));
+        return false;
+    }
+    QByteArray csv = "index,identity,class,class_name,seed\n";
+    for (int n = 0; n < static_cast<int>(m_labels.size()); ++n) {
+        const IdentityLabel& label = m_labels[n];
+        if (!label.valid) {
+            continue;
+        }
+        int cls = static_cast<int>(label.fingerprintClass);
+        csv += QByteArray::number(n) + ',' + QByteArray::number(identity(n)) + ',' +
+               QByteArray::number(cls) + ',' + ((cls >= 0 && cls <= 8) ? kClassNames[cls] : "unknown") + ',' +
+               QByteArray::number(label.seed) + '\n';
+    }
+    ok = file.write(csv) == csv.size() && ok;
+    m_labels.clear();
+    return ok;
+}
+
 bool BatchGenerator::saveFingerprint(const QImage& image, const FingerprintInstance& instance,
-                                    int fpIndex, int versionIndex) {
+                                    int fpIndex, int versionIndex, quint32& crc) {
     // Usar startIndex para calcular o índice real da impressão
-    int actualIndex = m_config.startIndex + fpIndex;
-    QString filename = QString("%1/%2_%3_v%4.png")
-        .arg(m_config.outputDirectory)
+    int actualIndex = identity(fpIndex);
+    const bool wsq = m_config.imageCodec == ImageCodec::Wsq;
+    QString name = QString("%1_%2_v%3.%4")
         .arg(m_config.filenamePrefix)
         .arg(actualIndex, 4, 10, QChar('0'))
-        .arg(versionIndex, 2, 10, QChar('0'));
+        .arg(versionIndex, 2, 10, QChar('0'))
+        .arg(wsq ? "wsq" : "png");
+    
+    const QImage gray = toGrayscale8(image);
+    
+    // Slots em ordem de identidade: [fpIndex][versionIndex - 1]
+    if (m_tensor) {
+        quint64 slot = static_cast<quint64>(fpIndex) * m_config.versionsPerFingerprint + (versionIndex - 1);
+        crc = 0;
+        for (int y = 0; y < gray.height(); ++y) {
+            crc = Raster::crc32(crc, gray.constScanLine(y), static_cast<size_t>(gray.width()));
+        }
+        return m_tensor->writeSlot(slot, constGrayView(gray));
+    }
+    const bool streaming = m_config.streamOutput;
+    if (streaming && m_config.outputFormat == OutputFormat::Npy) {
+        // O quadro leva as linhas contíguas, sem o alinhamento do QImage
+        std::vector<uint8_t> pixels(static_cast<size_t>(gray.width()) * gray.height());
+        for (int y = 0; y < gray.height(); ++y) {
+            std::memcpy(pixels.data() + static_cast<size_t>(y) * gray.width(), gray.constScanLine(y),
+                        static_cast<size_t>(gray.width()));
+        }
+        crc = Raster::crc32(0, pixels.data(), pixels.size());
+        return streamFrame(gray, fpIndex, versionIndex, Raster::FrameFormat::Gray8, pixels.data(), pixels.size(), crc);
+    }
+    
+    // Codificadores próprios (buffers por thread de gravação) no lugar do QImage::save
+    const int dpi = static_cast<int>(std::lround(gray.dotsPerMeterX() * 0.0254));
+    const std::vector<uint8_t>* encoded = nullptr;
+    if (wsq) {
+        encoded = &Raster::WsqWriter::forThread().encode(constGrayView(gray), m_config.wsqBitrate, dpi);
+    } else {
+        Raster::PngWriter& writer = Raster::PngWriter::forThread();
+        writer.setProfile(m_config.pngProfile);
+        encoded = &writer.encode(constGrayView(gray), dpi);
+    }
+    if (encoded->empty()) {
+        return false;
+    }
+    crc = Raster::crc32(0, encoded->data(), encoded->size());
     
-    return image.save(filename);
+    if (streaming) {
+        return streamFrame(gray, fpIndex, versionIndex, wsq ? Raster::FrameFormat::Wsq : Raster::FrameFormat::Png,
+                           encoded->data(), encoded->size(), crc);
+    }
+    if (m_shards) {
+        // A tag traz o item de volta no callback de selagem, que o registra no diário
+        const quint64 tag = (static_cast<quint64>(fpIndex) << 16) | static_cast<quint64>(versionIndex);
+        return m_shards->append(name.toStdString(), encoded->data(), encoded->size(), tag);
+    }
+    
+    QFile file(m_config.outputDirectory + "/" + name);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    const qint64 size = static_cast<qint64>(encoded->size());
+    if (file.write(reinterpret_cast<const char*>(encoded->data()), size) != size) {
+        return false;
+    }
+    file.close();
+    if (m_written) {
+        m_written->add(name.toStdString());
+    }
+    return true;
+}
+
+// Um leitor que foi embora faz todos os quadros seguintes falharem: o lote para em vez de renderizar para ninguém
+bool BatchGenerator::streamFrame(const QImage& gray, int fpIndex, int versionIndex, Raster::FrameFormat format,
+                                 const void* data, size_t size, quint32 crc) {
+    Raster::FrameHeader header;
+    header.identity = static_cast<quint32>(identity(fpIndex));
+    header.version = static_cast<quint16>(versionIndex);
+    header.format = format;
+    header.width = static_cast<quint32>(gray.width());
+    header.height = static_cast<quint32>(gray.height());
+    header.length = size;
+    header.crc = crc;
+    if (!(m_frameCallback ? m_frameCallback(header, data) : m_stream->write(header, data))) {
+        m_cancelled = true;
+        return false;
+    }
+    return true;
 }
 
-bool BatchGenerator::saveParameters(const FingerprintParameters& params, const SingularPoints& points,
-                                   const QString& filename) {
-    QJsonObject json;
-    json["parameters"] = params.toJson();
-    json["singular_points"] = points.toJson();
+// Roda no worker que renderizou a imagem: o recorte vai direto para um slot livre, sem
+// codificador, fila de gravação nem pipe no caminho
+bool BatchGenerator::writeRingFrame(const QImage& image, int fpIndex, int versionIndex) {
+    if (m_cancelled) {
+        return false;  // Outro worker já viu o anel falhar
+    }
+    const QImage gray = toGrayscale8(image);
+    const size_t size = static_cast<size_t>(gray.width()) * gray.height();
+    if (size > m_ring->frameBytes()) {
+        m_ring->abort("an image is larger than a ring slot");
+        m_cancelled = true;
+        return false;
+    }
+    quint64 sequence = 0;
+    uint8_t* slot = m_ring->acquire(sequence);
+    if (!slot) {
+        m_cancelled = true;  // O consumidor foi embora: parar de renderizar para ninguém
+        return false;
+    }
+    // Linhas contíguas no slot, sem o alinhamento do QImage
+    for (int y = 0; y < gray.height(); ++y) {
+        std::memcpy(slot + static_cast<size_t>(y) * gray.width(), gray.constScanLine(y),
+                    static_cast<size_t>(gray.width()));
+    }
     
-    QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly)) {
+    Raster::FrameHeader header;
+    header.identity = static_cast<quint32>(identity(fpIndex));
+    header.version = static_cast<quint16>(versionIndex);
+    header.format = Raster::FrameFormat::Gray8;
+    header.width = static_cast<quint32>(gray.width());
+    header.height = static_cast<quint32>(gray.height());
+    header.length = size;
+    header.crc = Raster::crc32(0, slot, size);
+    m_ring->publish(sequence, header);
+    return true;
+}
+
+bool BatchGenerator::openManifest() {
+    const QString path = outputStem() + ".manifest";
+    const bool existing = m_resumed && QFile::exists(path);
+    m_manifest = std::make_unique<Raster::ManifestWriter>();
+    if (!(existing ? m_manifest->reopen(path.toStdString()) : m_manifest->create(path.toStdString()))) {
+        emit error(tr("Manifest output failed: %1").arg(QString::fromStdString(m_manifest->error())));
+        m_manifest.reset();
         return false;
     }
+    if (existing) {
+        // Lote retomado: o manifesto já começa pelo registro do lote e só recebe acréscimos
+        if (!m_config.quietMode) {
+            qDebug() << "Manifest:" << path << "(appending)";
+        }
+        return true;
+    }
+    
+    // Primeiro registro: como todas as identidades e versões seguintes foram produzidas
+    Raster::ManifestRecord record;
+    record.addUInt("seed", m_masterSeed);
+    record.addInt("startIndex", m_config.startIndex);
+    record.addInt("fingerprints", m_config.numFingerprints);
+    record.addInt("identityStride", m_config.identityStride);
+    record.addInt("shard", m_config.shardIndex);
+    record.addInt("shards", m_config.shardCount);
+    record.addInt("rangeStart", m_config.rangeStart);
+    record.addInt("rangeCount", m_config.rangeCount);
+    record.addInt("versionsPerFingerprint", m_config.versionsPerFingerprint);
+    record.addBool("skipOriginal", m_config.skipOriginal);
+    record.addBool("ellipticalMask", m_config.applyEllipticalMask);
+    record.addBool("fusedWarp", m_config.fusedWarp);
+    record.addInt("warpInterpolation", static_cast<int>(m_config.warpInterpolation));
+    record.addReal("maxBlurSigma", m_config.maxBlurSigma);
+    record.addInt("cropWidth", kCropWidth);
+    record.addInt("cropHeight", kCropHeight);
+    record.addText("prefix", m_config.filenamePrefix.toStdString());
+    record.addText("codec", m_config.imageCodec == ImageCodec::Wsq ? "wsq" : "png");
+    record.addReal("wsqBitrate", m_config.wsqBitrate);
+    record.addText("format", m_config.outputFormat == OutputFormat::Npy    ? "npy"
+                             : m_config.outputFormat == OutputFormat::Shards ? "shards"
+                                                                             : "files");
+    m_manifest->append("batch", record);
     
-    QJsonDocument doc(json);
-    file.write(doc.toJson(QJsonDocument::Indented));
+    if (!m_config.quietMode) {
+        qDebug() << "Manifest:" << path;
+    }
     return true;
 }
 
+// Tudo o que decide quais imagens o lote grava, e onde: um diário só retoma o lote que o escreveu
+quint32 BatchGenerator::configHash() const {
+    const QString text = QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10 %11 %12 %13 |%14")
+        .arg(m_config.startIndex).arg(m_config.identityStride).arg(m_config.numFingerprints)
+        .arg(m_config.versionsPerFingerprint)
+        .arg(int(m_config.skipOriginal)).arg(int(m_config.applyEllipticalMask)).arg(int(m_config.fusedWarp))
+        .arg(static_cast<int>(m_config.warpInterpolation)).arg(m_config.maxBlurSigma, 0, 'g', 17)
+        .arg(static_cast<int>(m_config.outputFormat)).arg(static_cast<int>(m_config.imageCodec))
+        .arg(m_config.wsqBitrate, 0, 'g', 17).arg(int(m_config.saveParameters))
+        .arg(m_config.filenamePrefix);
+    const QByteArray bytes = text.toUtf8();
+    return Raster::crc32(0, bytes.constData(), static_cast<size_t>(bytes.size()));
+}
+
+// Sempre gravado, para que qualquer lote possa ser retomado; com resume é lido antes
+bool BatchGenerator::openJournal() {
+    const QString path = outputStem() + ".journal";
+    m_journal = std::make_unique<Raster::CompletionJournal>();
+    m_done.assign(static_cast<size_t>(m_config.numFingerprints) * (m_config.versionsPerFingerprint + 1), 0);
+    m_resumed = false;
+    m_firstShard = 0;
+    
+    if (!m_config.resume || !QFile::exists(path)) {
+        if (!m_journal->create(path.toStdString(), m_masterSeed, configHash())) {
+            emit error(tr("Journal failed: %1").arg(QString::fromStdString(m_journal->error())));
+            m_journal.reset();
+            return false;
+        }
+        return true;
+    }
+    
+    if (!m_journal->resume(path.toStdString())) {
+        emit error(tr("Journal failed: %1").arg(QString::fromStdString(m_journal->error())));
+        m_journal.reset();
+        return false;
+    }
+    if (m_journal->configHash() != configHash()) {
+        emit error(tr("%1 belongs to a batch with other options; rerun with the same options").arg(path));
+        m_journal.reset();
+        return false;
+    }
+    if (m_config.fixedSeed && m_masterSeed != m_journal->seed()) {
+        emit error(tr("%1 belongs to a batch with seed %2").arg(path).arg(m_journal->seed()));
+        m_journal.reset();
+        return false;
+    }
+    m_masterSeed = m_journal->seed();
+    m_resumed = true;
+    
+    int done = 0;
+    for (const Raster::JournalEntry& entry : m_journal->completed()) {
+        const int offset = static_cast<int>(entry.identity) - m_config.startIndex;
+        const int fpIndex = offset / m_config.identityStride;
+        if (offset < 0 || offset % m_config.identityStride != 0 || fpIndex >= m_config.numFingerprints ||
+            entry.version > m_config.versionsPerFingerprint) {
+            continue;
+        }
+        uint8_t& slot = m_done[static_cast<size_t>(fpIndex) * (m_config.versionsPerFingerprint + 1) + entry.version];
+        done += slot ? 0 : 1;
+        slot = 1;
+        m_firstShard = std::max(m_firstShard, static_cast<int>(entry.shard));
+    }
+    if (!m_config.quietMode) {
+        qDebug() << "Resuming:" << done << "images already written, master seed" << m_masterSeed;
+    }
+    return true;
+}
+
+bool BatchGenerator::closeJournal() {
+    bool ok = m_journal->close();
+    if (!ok) {
+        emit error(tr("Journal failed: %1").arg(QString::fromStdString(m_journal->error())));
+    }
+    m_journal.reset();
+    m_written.reset();
+    m_done.clear();
+    return ok;
+}
+
+// Roda antes de cada commit do diário: as entradas gravadas devem descrever dados já no disco.
+// Shards não precisam de nada aqui, suas entradas só entram no diário com o shard selado.
+bool BatchGenerator::syncOutput() {
+    bool ok = true;
+    if (m_config.outputFormat == OutputFormat::Npy) {
+        ok = m_tensor->sync();
+    } else if (m_written) {
+        ok = m_written->sync();
+    }
+    if (m_manifest) {
+        ok = m_manifest->sync() && ok;
+    }
+    return ok;
+}
+
+bool BatchGenerator::isDone(int fpIndex, int versionIndex) const {
+    return !m_done.empty() && m_done[static_cast<size_t>(fpIndex) * (m_config.versionsPerFingerprint + 1) + versionIndex] != 0;
+}
+
+bool BatchGenerator::closeManifest() {
+    bool ok = m_manifest->close();
+    if (!ok) {
+        emit error(tr("Manifest output failed: %1").arg(QString::fromStdString(m_manifest->error())));
+    } else if (!m_config.quietMode) {
+        qDebug() << "Manifest:" << m_manifest->recordCount() << "records";
+    }
+    m_manifest.reset();
+    return ok;
+}
+
+// Na tarefa da identidade, depois da imagem base (as minúcias saem da geração dela)
+void BatchGenerator::appendIdentityRecord(const FingerprintInstance& instance, int fpIndex,
+                                          const std::vector<Minutia>& minutiae) {
+    Raster::ManifestRecord record;
+    record.addInt("identity", identity(fpIndex));
+    record.addUInt("seed", instance.seed);
+    record.addInt("class", static_cast<int>(instance.baseParams.classification.fingerprintClass));
+    addParameters(record, instance.baseParams);
+    record.addTuples("cores", {"x", "y"}, pointCoordinates(instance.basePoints.getCores()));
+    record.addTuples("deltas", {"x", "y"}, pointCoordinates(instance.basePoints.getDeltas()));
+    
+    std::vector<double> values;
+    values.reserve(5 * minutiae.size());
+    for (const Minutia& minutia : minutiae) {
+        values.insert(values.end(), {minutia.x, minutia.y, minutia.angle,
+                                     static_cast<double>(minutia.type), minutia.quality});
+    }
+    record.addTuples("minutiae", {"x", "y", "angle", "type", "quality"}, values);
+    m_manifest->append("identity", record);
+}
+
+// A v0 é a imagem base sem transformação, já descrita pelo registro da identidade
+void BatchGenerator::appendVersionRecord(int fpIndex, int versionIndex, const VersionTransform& transform) {
+    if (versionIndex == 0) {
+        return;
+    }
+    Raster::ManifestRecord record;
+    record.addInt("identity", identity(fpIndex));
+    record.addInt("version", versionIndex);
+    record.addReal("rotation", transform.rotation);
+    record.addReal("noiseLevel", transform.noiseLevel);
+    record.addUInt("noiseSeed", transform.noiseSeed);
+    record.addReal("lensDistortion", transform.lensDistortion);
+    record.addBool("usePincushion", transform.usePincushion);
+    record.addReal("homographyShiftX", transform.homographyShift.x());
+    record.addReal("homographyShiftY", transform.homographyShift.y());
+    record.addReal("homographyAngle", transform.homographyAngle);
+    record.addInt("cropWidth", transform.cropRegion.width());
+    record.addInt("cropHeight", transform.cropRegion.height());
+    record.addReal("cropRadius", transform.cropRadius);
+    record.addReal("cropAngle", transform.cropAngle);
+    record.addBool("applyBlur", transform.applyBlur);
+    record.addInt("blurRadius", transform.blurRadius);
+    record.addReal("blurCenterX", transform.blurCenter.x());
+    record.addReal("blurCenterY", transform.blurCenter.y());
+    record.addReal("blurSigma", transform.blurSigma);
+    m_manifest->append("version", record);
+}
+
 }
@@ -5,16 +5,28 @@
 #include <QString>
 #include <QImage>
 #include <QElapsedTimer>
-#include <QThreadPool>
-#include <QRunnable>
 #include <QAtomicInt>
 #include <QMutex>
-#include <QWaitCondition>
-#include <QQueue>
-#include <QSemaphore>
+#include <QRandomGenerator>
 #include "fingerprint_generator.h"
 #include "../models/fingerprint_parameters.h"
 #include "../models/singular_points.h"
+#include "raster/warp.h"
+#include "raster/write_queue.h"
+#include "raster/png_writer.h"
+#include "raster/shard.h"
+#include "raster/npy_file.h"
+#include "raster/wsq.h"
+#include "raster/manifest.h"
+#include "raster/journal.h"
+#include "raster/partition.h"
+#include "raster/frame_stream.h"
+#include "raster/shm_ring.h"
+#include "raster/task_pool.h"
+#include "raster/memory_budget.h"
+#include <atomic>
+#include <functional>
+#include <memory>
 
 namespace SFinGe {
 
@@ -30,26 +42,64 @@ struct VersionTransform {
     bool applyBlur = false;          // Aplicar blur circular
     int blurRadius = 0;              // Raio do blur (100-300 pixels)
     QPointF blurCenter;              // Centro do blur na imagem
+    double blurSigma = 1.0;          // Sigma do desfoque no centro do disco (pixels)
+    quint64 noiseSeed = 0;           // Semente do ruído
+    double cropRadius = 0.0;         // Deslocamento do centro do recorte (0 a 150 px)
+    double cropAngle = 0.0;          // Direção do deslocamento (radianos)
+};
+
+enum class OutputFormat {
+    Files,   // Um arquivo de imagem por versão
+    Shards,  // Tudo empacotado em arquivos de shard grandes e indexados (raster/shard.h)
+    Npy      // Tensor uint8 [N, versões, H, W] gravado no lugar (raster/npy_file.h)
+};
+
+enum class ImageCodec {
+    Png,  // Sem perdas (raster/png_writer.h)
+    Wsq   // Quantização escalar de wavelets do FBI, com perdas (raster/wsq.h)
 };
 
 struct BatchConfig {
     int numFingerprints = 10;        // Número de impressões diferentes
     int versionsPerFingerprint = 3;  // Versões de cada impressão
     int startIndex = 0;              // Índice inicial para numeração das impressões
+    int identityStride = 1;          // A impressão n tem o índice startIndex + n * identityStride
+    int shardIndex = 0;              // Parte do nó (--shard K/N) neste lote
+    int shardCount = 1;
+    int rangeStart = 0;              // Intervalo do lote inteiro, gravado para o merge dos nós
+    int rangeCount = 0;
+    quint64 seed = 0;                // Semente mestre: identidade N e suas versões derivam de (seed, N)
+    bool fixedSeed = false;          // false = sorteia uma semente mestre no início do lote (ou usa a do diário, em resume)
     bool usePopulationDistribution = true;  // Sempre usar distribuição populacional
     bool skipOriginal = true;        // Excluir v0 (marcado por padrão)
     bool applyEllipticalMask = true; // Aplicar máscara elíptica com fade out (padrão: sim)
     bool quietMode = false;          // Modo silencioso (sem debug)
+    bool fusedWarp = false;          // Lente+homografia+rotação+recorte em uma única reamostragem
+    Raster::Interpolation warpInterpolation = Raster::Interpolation::Bilinear;
+    double maxBlurSigma = 1.0;       // Sigma máximo sorteado para o desfoque (1 = blur leve)
+    int writerThreads = 0;           // Threads de codificação/gravação (0 = uma a cada quatro workers)
+    int writeQueueDepth = 0;         // Imagens prontas aguardando gravação (0 = duas por worker)
+    Raster::PngProfile pngProfile = Raster::PngProfile::Balanced;  // Tempo de codificação x tamanho
+    OutputFormat outputFormat = OutputFormat::Files;
+    ImageCodec imageCodec = ImageCodec::Png;  // Codificação dos arquivos e das entradas de shard
+    double wsqBitrate = Raster::WsqWriter::kDefaultBitrate;  // Bits por pixel
+    quint64 shardBytes = 1ull << 30;  // Tamanho a partir do qual um novo shard é aberto
     
     QString outputDirectory = ".";
+    bool streamOutput = false;       // Quadros no stdout em vez de arquivos (raster/frame_stream.h); Npy manda pixels crus
+    QString ringName;                // Recortes crus neste anel em memória compartilhada em vez de arquivos (raster/shm_ring.h)
+    int ringSlots = 0;               // Imagens que o anel comporta (0 = quatro por worker)
     QString filenamePrefix = "fingerprint";
-    bool saveParameters = false;     // Salvar JSON (padrão: não)
+    bool saveParameters = false;     // Manifesto de verdade de campo junto das imagens (raster/manifest.h)
+    bool resume = false;             // Pula as imagens listadas no diário de conclusão (raster/journal.h)
+    quint64 memoryBudget = 0;        // Memória privada que o lote pode usar, em bytes (0 = sem limite; raster/memory_budget.h)
 };
 
 struct FingerprintInstance {
     FingerprintParameters baseParams;
     SingularPoints basePoints;
     QString identifier;
+    quint64 seed = 0;                // Semente da identidade (todas as etapas derivam dela)
 };
 
 class BatchGenerator : public QObject {
@@ -62,73 +112,118 @@ public:
     void setBatchConfig(const BatchConfig& config);
     BatchConfig getBatchConfig() const { return m_config; }
     void setNumWorkers(int workers) { m_numWorkers = workers; }
+    // Lote no pool de quem chama, que sobrevive a ele (o servidor mantém os workers aquecidos); nulo = pool próprio
+    void setTaskPool(Raster::TaskPool* pool) { m_pool = pool; }
+    
+    // Com streamOutput, os quadros vêm para cá em vez do stdout (chamado das threads de gravação)
+    using FrameCallback = std::function<bool(const Raster::FrameHeader& header, const void* data)>;
+    void setFrameCallback(FrameCallback callback) { m_frameCallback = std::move(callback); }
     
     bool generateBatch();
     bool generateBatchParallel();
     void cancel();
     
+    // Semente mestre do último lote (a sorteada, se a configuração não fixou uma)
+    quint64 masterSeed() const { return m_masterSeed; }
+    
+    // Contadores do estágio de gravação: ao vivo durante generateBatchParallel()
+    // (por exemplo no progressUpdated), finais depois dele
+    Raster::WriteQueueStats writerStats() const;
+    
+    // Com memoryBudget: o paralelismo com que o lote rodou e a maior memória
+    // privada que ele usou (amostrada; Raster::peakRss() tem o pico do processo)
+    const Raster::MemoryPlan& memoryPlan() const { return m_memoryPlan; }
+    quint64 memoryPeak() const { return m_memoryPeak; }
+    
 signals:
     void progressUpdated(int current, int total, const QString& status);
     void batchCompleted(int generated);
     void error(const QString& message);
     
 private:
+    // Tamanho do recorte de todas as versões (e a forma do slot no NPY)
+    static constexpr int kCropWidth = 500;
+    static constexpr int kCropHeight = 600;
+    
+    struct IdentityLabel {
+        bool valid = false;
+        FingerprintClass fingerprintClass = FingerprintClass::None;
+        quint64 seed = 0;
+    };
+    
+    int identity(int fpIndex) const { return m_config.startIndex + fpIndex * m_config.identityStride; }
+    QString outputStem() const;
+    bool openTensorOutput();
+    bool closeTensorOutput();
+    bool openStreamOutput();
+    bool closeStreamOutput();
+    Raster::MemoryModel memoryModel() const;  // Pico de um lote por workers e identidades em voo
+    bool openRingOutput(int numWorkers);
+    bool closeRingOutput();
+    bool openManifest();
+    bool closeManifest();
+    void appendIdentityRecord(const FingerprintInstance& instance, int fpIndex, const std::vector<Minutia>& minutiae);
+    void appendVersionRecord(int fpIndex, int versionIndex, const VersionTransform& transform);
+    quint32 configHash() const;
+    bool openJournal();
+    bool closeJournal();
+    bool syncOutput();
+    bool isDone(int fpIndex, int versionIndex) const;
+    void resolveMasterSeed();
     FingerprintInstance createBaseFingerprint(int index);
-    VersionTransform generateVersionTransform(int versionIndex) const;
+    VersionTransform generateVersionTransform(quint64 identitySeed, int versionIndex) const;
     QImage applyVersionTransforms(const QImage& baseImage, const VersionTransform& transform) const;
-    FingerprintClass selectClassByPopulation() const;  // Seleção por distribuição populacional
+    QImage applyFusedVersionTransforms(const QImage& baseImage, const VersionTransform& transform) const;
+    FingerprintClass selectClassByPopulation(QRandomGenerator& rng) const;  // Seleção por distribuição populacional
     
     // Funções de transformação de imagem
-    QImage applyNoise(const QImage& image, double noiseLevel) const;
-    QImage applyBlur(const QImage& image, int radius, const QPointF& center) const;
+    QImage applyNoise(const QImage& image, double noiseLevel, quint64 seed) const;
+    QImage applyBlur(const QImage& image, int radius, const QPointF& center, double sigma) const;
     QImage applyLensDistortion(const QImage& image, double k) const;  // Barrel ou Pincushion
     QImage applyHomography(const QImage& image, const QPointF& shift, double angle) const;
     QImage applyRotation(const QImage& image, double angle) const;
-    QImage applyCrop(const QImage& image, int targetWidth, int targetHeight) const;
+    QImage applyCrop(const QImage& image, const VersionTransform& transform) const;
+    QPoint chooseCropOrigin(int imageWidth, int imageHeight, const VersionTransform& transform) const;
     QImage applyEllipticalMask(const QImage& image) const;  // Máscara elíptica com fade out
     
+    QImage renderVersion(const QImage& baseFingerprint, const VersionTransform& transform,
+                         int versionIndex) const;  // Transforma e mascara uma versão
+    bool writeVersion(const QImage& image, const FingerprintInstance& instance, const VersionTransform& transform,
+                      int fpIndex, int versionIndex);  // Salva a imagem (e o registro da versão, se pedido)
     bool saveFingerprint(const QImage& image, const FingerprintInstance& instance, 
-                        int fpIndex, int versionIndex);
-    bool saveParameters(const FingerprintParameters& params, const SingularPoints& points,
-                       const QString& filename);
-    
-    // Estrutura de tarefa para fila
-    struct FingerprintTask {
-        FingerprintInstance instance;
-        int fpIndex;
-        int versionIndex;
-        int totalImages;
-        QImage baseFingerprint;  // Imagem base pré-gerada
-    };
-    
-    // Classe worker para processamento contínuo
-    class WorkerThread : public QThread {
-    public:
-        WorkerThread(BatchGenerator* generator, int workerId);
-        void run() override;
-        void stop();
-        
-    private:
-        BatchGenerator* m_generator;
-        int m_workerId;
-        bool m_running;
-    };
+                        int fpIndex, int versionIndex, quint32& crc);
+    bool streamFrame(const QImage& gray, int fpIndex, int versionIndex, Raster::FrameFormat format,
+                     const void* data, size_t size, quint32 crc);
+    bool writeRingFrame(const QImage& image, int fpIndex, int versionIndex);
     
     BatchConfig m_config;
     FingerprintGenerator* m_generator;
-    bool m_cancelled;
+    std::atomic<bool> m_cancelled{false};  // Lido pelas tarefas do pool; o fluxo e o anel de saída também cancelam
     QElapsedTimer m_timer;
     qint64 m_firstImageTime;
     int m_numWorkers = 0;
+    Raster::TaskPool* m_pool = nullptr;  // Pool externo (setTaskPool), ou nulo
+    FrameCallback m_frameCallback;
+    quint64 m_masterSeed = 0;
     
-    // Variáveis para processamento com fila
+    // Estado do lote paralelo (compartilhado pelas tarefas do pool)
     QAtomicInt m_generated;
-    QAtomicInt m_activeWorkers;
-    QMutex m_queueMutex;
-    QMutex m_progressMutex;
-    QQueue<FingerprintTask> m_taskQueue;
-    QSemaphore m_queueSemaphore;  // Sinaliza tarefas disponíveis
-    QList<WorkerThread*> m_workers;
+    QMutex m_progressMutex;  // Serializa os sinais de progresso emitidos pelos workers
+    std::unique_ptr<Raster::WriteQueue> m_writer;
+    Raster::WriteQueueStats m_writerStats;
+    Raster::MemoryPlan m_memoryPlan;
+    quint64 m_memoryPeak = 0;
+    std::unique_ptr<Raster::ShardWriter> m_shards;  // Só durante um lote com saída em shards
+    std::unique_ptr<Raster::NpyFile> m_tensor;      // Só durante um lote com saída NPY
+    std::unique_ptr<Raster::FrameStreamWriter> m_stream;  // Só durante um lote enviado ao stdout
+    std::unique_ptr<Raster::ShmRingWriter> m_ring;        // Só durante um lote entregue num anel em memória compartilhada
+    std::vector<IdentityLabel> m_labels;            // Por identidade, para o CSV de rótulos do NPY
+    std::unique_ptr<Raster::ManifestWriter> m_manifest;  // Só durante um lote que salva os parâmetros
+    std::unique_ptr<Raster::CompletionJournal> m_journal;  // Só durante o lote paralelo
+    std::unique_ptr<Raster::FileSyncList> m_written;       // Arquivos à espera do próximo commit do diário
+    std::vector<uint8_t> m_done;    // [fpIndex * (versões + 1) + versão], do diário de um lote retomado
+    bool m_resumed = false;
+    int m_firstShard = 0;           // Shards abaixo dele estão selados e no diário
 };
 
 }
@@ -1,4 +1,5 @@
 #include "density_generator.h"
+#include "raster/quantize.h"
 #include "math_utils.h"
 
 namespace SFinGe {
@@ -105,16 +106,18 @@ QImage DensityGenerator::generate() {
     
     QImage image(m_width, m_height, QImage::Format_Grayscale8);
     
+    // Normalizar para [0, 255] direto nas linhas da imagem; fora da forma = branco
+    Raster::QuantizeOptions options;
+    options.offset = minDensity;
+    options.gain = 1.0f / range;
+    
     for (int j = 0; j < m_height; ++j) {
+        uchar* line = image.scanLine(j);
+        const float* shapeRow = &m_shapeMap[j * m_width];
+        Raster::quantizeRow(&m_densityMap[j * m_width], line, m_width, options);
         for (int i = 0; i < m_width; ++i) {
-            int idx = j * m_width + i;
-            if (m_shapeMap[idx] > 0.5) {
-                float normalized = (m_densityMap[idx] - minDensity) / range;
-                int gray = static_cast<int>(normalized * 255.0f);
-                gray = std::min(255, std::max(0, gray));
-                image.setPixel(i, j, qRgb(gray, gray, gray));
-            } else {
-                image.setPixel(i, j, qRgb(255, 255, 255));
+            if (!(shapeRow[i] > 0.5)) {
+                line[i] = 255;
             }
         }
     }
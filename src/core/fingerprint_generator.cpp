@@ -1,6 +1,8 @@
 #include "fingerprint_generator.h"
 #include "rendering/texture_renderer.h"
 #include "variation/variation_effects.h"
+#include "utils/image_converter.h"
+#include "raster/random.h"
 #include <QDebug>
 #include <random>
 
@@ -26,6 +28,11 @@ void FingerprintGenerator::setSingularPoints(const SingularPoints& points) {
     m_points = points;
 }
 
+void FingerprintGenerator::setSeed(quint64 seed) {
+    m_orientationGenerator.reseed(Raster::streamSeed(seed, Raster::SeedStream::Orientation));
+    m_ridgeGenerator.reseed(Raster::streamSeed(seed, Raster::SeedStream::Ridge));
+}
+
 QImage FingerprintGenerator::generateShape() {
     emit progressChanged(10, "Generating shape...");
     
@@ -156,8 +163,8 @@ QImage FingerprintGenerator::generateMasterprint() {
     m_ridgeGenerator.setDensityMap(m_densityGenerator.getDensityMap());
     m_ridgeGenerator.setShapeMap(m_shapeGenerator.getShapeMap());
     
-    // Obter mapa de cristas binário
-    QImage ridgeImage = m_ridgeGenerator.generate();
+    // Obter mapa de cristas já em ponto flutuante (sem passar por QImage)
+    Plane<float> ridgePlane = m_ridgeGenerator.generatePlane();
     
     emit progressChanged(85, "Applying advanced rendering...");
     
@@ -165,29 +172,11 @@ QImage FingerprintGenerator::generateMasterprint() {
     int width = m_shapeGenerator.getWidth();
     int height = m_shapeGenerator.getHeight();
     
-    // Converter ridgeImage para vetor de floats
-    std::vector<float> ridgeMap(width * height);
-    QImage grayscale = ridgeImage.convertToFormat(QImage::Format_Grayscale8);
-    for (int j = 0; j < height; ++j) {
-        const uchar* line = grayscale.constScanLine(j);
-        for (int i = 0; i < width; ++i) {
-            ridgeMap[j * width + i] = line[i] / 255.0f;
-        }
-    }
-    
-    // Criar TextureRenderer e aplicar
     TextureRenderer renderer(m_params.rendering, width, height, m_currentSeed);
-    auto renderedData = renderer.render(ridgeMap, m_shapeGenerator.getShapeMap());
-    
-    // Converter de volta para QImage
-    m_masterprintImage = QImage(width, height, QImage::Format_Grayscale8);
-    for (int j = 0; j < height; ++j) {
-        uchar* line = m_masterprintImage.scanLine(j);
-        for (int i = 0; i < width; ++i) {
-            float val = std::clamp(renderedData[j * width + i], 0.0f, 1.0f);
-            line[i] = static_cast<uchar>(val * 255.0f);
-        }
-    }
+    m_masterprintPlane = renderer.render(ridgePlane, m_shapeGenerator.getShapeMap());
+    
+    // Quantização única ao final do pipeline
+    m_masterprintImage = ImageConverter::planeToGrayscale(m_masterprintPlane);
     
     if (!m_masterprintImage.isNull()) {
         m_masterprintImage.setDotsPerMeterX(500 * 39.3701);
@@ -225,4 +214,28 @@ QImage FingerprintGenerator::generateVariation(const QImage& masterImage, unsign
     return variationImage;
 }
 
+QImage FingerprintGenerator::generateVariation(unsigned int seed) {
+    if (m_masterprintPlane.isEmpty()) {
+        qWarning() << "[FingerprintGenerator] Nenhuma impressão mestre gerada. Não é possível gerar variação.";
+        emit generationError("No masterprint available. Cannot generate variation.");
+        return QImage();
+    }
+    
+    emit progressChanged(10, "Applying variations...");
+    
+    // Variações aplicadas sobre o plano float da mestre (sem re-quantizar a entrada)
+    VariationEffects variationEffects(m_params.variation, seed);
+    QImage variationImage = ImageConverter::planeToGrayscale(variationEffects.apply(m_masterprintPlane));
+    
+    if (!variationImage.isNull()) {
+        variationImage.setDotsPerMeterX(500 * 39.3701);
+        variationImage.setDotsPerMeterY(500 * 39.3701);
+    }
+    
+    emit progressChanged(100, "Variation generation complete!");
+    
+    qDebug() << "[FingerprintGenerator] Variação gerada com seed:" << seed;
+    return variationImage;
+}
+
 }
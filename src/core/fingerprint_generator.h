@@ -26,6 +26,9 @@ public:
     void setParameters(const FingerprintParameters& params);
     void setSingularPoints(const SingularPoints& points);
     
+    // Semente da identidade (lote): orientação e cristas derivam as suas dela
+    void setSeed(quint64 seed);
+    
     QImage generateShape();
     QImage generateDensity();
     QImage generateOrientation();
@@ -35,12 +38,17 @@ public:
     // Módulo 3: Métodos para geração de impressão mestre e variações
     QImage generateMasterprint();
     QImage generateVariation(const QImage& masterImage, unsigned int seed);
+    QImage generateVariation(unsigned int seed);  // A partir da última mestre, em float
     
     QImage getShapeImage() const { return m_shapeImage; }
     QImage getDensityImage() const { return m_densityImage; }
     QImage getOrientationImage() const { return m_orientationImage; }
     QImage getFingerprintImage() const { return m_fingerprintImage; }
     QImage getMasterprintImage() const { return m_masterprintImage; }
+    const Plane<float>& getMasterprintPlane() const { return m_masterprintPlane; }
+    
+    // Minúcias da última generateFingerprint(), em coordenadas da imagem base
+    const std::vector<Minutia>& getMinutiae() const { return m_ridgeGenerator.getMinutiae(); }
     
 signals:
     void progressChanged(int percentage, const QString& message);
@@ -61,6 +69,7 @@ private:
     QImage m_orientationImage;
     QImage m_fingerprintImage;
     QImage m_masterprintImage;
+    Plane<float> m_masterprintPlane;  // Mestre antes da quantização
     
     // Seed para reprodutibilidade
     unsigned int m_currentSeed;
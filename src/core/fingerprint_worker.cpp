@@ -1,4 +1,5 @@
 #include "fingerprint_worker.h"
+#include "raster/gray8.h"
 #include <QDebug>
 
 namespace SFinGe {
@@ -92,50 +93,22 @@ void FingerprintWorker::run() {
 }
 
 QImage FingerprintWorker::applyEllipticalMask(const QImage& image) const {
-    // Criar resultado com mesmo formato da imagem original
-    QImage result = image.copy();
-    int width = result.width();
-    int height = result.height();
-    
-    // Centro da elipse
-    double cx = width / 2.0;
-    double cy = height / 2.0;
+    QImage result = image.convertToFormat(QImage::Format_Grayscale8);
     
     // Raios da elipse (94% do tamanho para deixar margem)
-    double rx = width * 0.47;
-    double ry = height * 0.47;
-    
-    // Largura do fade out (10% do menor eixo)
-    double fadeWidth = std::min(rx, ry) * 0.10;
+    Raster::EllipticalMask mask;
+    mask.radiusX = result.width() * 0.47;
+    mask.radiusY = result.height() * 0.47;
     
-    // Aplicar máscara com fade out suave usando métodos seguros do Qt
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            // Calcular distância normalizada do centro da elipse
-            double dx_norm = (x - cx) / rx;
-            double dy_norm = (y - cy) / ry;
-            double dist = std::sqrt(dx_norm * dx_norm + dy_norm * dy_norm);
-            
-            // Calcular alpha (transparência)
-            double alpha = 1.0;
-            if (dist > 1.0) {
-                // Fora da elipse: fade out completo para branco
-                alpha = 0.0;
-            } else if (dist > (1.0 - fadeWidth / rx)) {
-                // Na região de fade out: transição suave
-                double fadePos = (dist - (1.0 - fadeWidth / rx)) / (fadeWidth / rx);
-                // Usar função suave (smoothstep)
-                alpha = 1.0 - (fadePos * fadePos * (3.0 - 2.0 * fadePos));
-            }
-            
-            // Aplicar alpha blending com branco usando métodos seguros
-            QRgb pixel = result.pixel(x, y);
-            int gray = qGray(pixel);
-            int newGray = static_cast<int>(gray * alpha + 255 * (1.0 - alpha));
-            result.setPixel(x, y, qRgb(newGray, newGray, newGray));
-        }
-    }
+    // Largura do fade out (10% do menor eixo), com transição smoothstep
+    double fadeWidth = std::min(mask.radiusX, mask.radiusY) * 0.10;
+    mask.fadeStart = 1.0 - fadeWidth / mask.radiusX;
+    mask.smoothstep = true;
     
+    // Pesos vêm do cache de geometria (mesmo tamanho = mesmo plano)
+    Raster::applyEllipticalMask(
+        Raster::Gray8View{result.bits(), static_cast<int>(result.bytesPerLine()), result.width(), result.height()},
+        mask);
     return result;
 }
 
@@ -1,5 +1,8 @@
 #include "gabor_filter.h"
 #include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 namespace SFinGe {
 
@@ -66,6 +69,27 @@ GaborFilterCache::GaborFilterCache(int cacheDegrees, int cacheFrequencies,
     }
 }
 
+std::shared_ptr<const GaborFilterCache> GaborFilterCache::shared(int cacheDegrees, int cacheFrequencies,
+                                                                double minFreq, double maxFreq, int filterSize) {
+    using Key = std::tuple<int, int, double, double, int>;
+    static std::mutex mutex;
+    static std::map<Key, std::shared_ptr<const GaborFilterCache>> banks;
+    
+    const Key key(cacheDegrees, cacheFrequencies, minFreq, maxFreq, filterSize);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = banks.find(key);
+    if (it != banks.end()) {
+        return it->second;
+    }
+    // Parâmetros variam pouco; se variarem muito (densidades sorteadas), recomeça em vez de crescer
+    if (banks.size() >= 16) {
+        banks.clear();
+    }
+    auto bank = std::make_shared<const GaborFilterCache>(cacheDegrees, cacheFrequencies, minFreq, maxFreq, filterSize);
+    banks.emplace(key, bank);
+    return bank;
+}
+
 const GaborFilter& GaborFilterCache::getFilter(int degreeIndex, int freqIndex) const {
     int index = degreeIndex * m_cacheFrequencies + freqIndex;
     return m_filters[index];
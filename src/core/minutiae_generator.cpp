@@ -1,4 +1,5 @@
 #include "minutiae_generator.h"
+#include "raster/random.h"
 #include <cmath>
 #include <algorithm>
 
@@ -12,6 +13,10 @@ MinutiaeGenerator::MinutiaeGenerator()
     : m_width(0), m_height(0), m_coreX(0), m_coreY(0), m_rng(std::random_device{}()) {
 }
 
+void MinutiaeGenerator::reseed(uint64_t seed) {
+    Raster::seedEngine(m_rng, seed);
+}
+
 void MinutiaeGenerator::setParameters(const MinutiaeParameters& params) {
     m_params = params;
 }
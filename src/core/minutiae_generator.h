@@ -1,6 +1,7 @@
 #ifndef MINUTIAE_GENERATOR_H
 #define MINUTIAE_GENERATOR_H
 
+#include <cstdint>
 #include <vector>
 #include <random>
 #include "models/fingerprint_parameters.h"
@@ -26,6 +27,7 @@ class MinutiaeGenerator {
 public:
     MinutiaeGenerator();
     
+    void reseed(uint64_t seed);
     void setParameters(const MinutiaeParameters& params);
     void setOrientationMap(const std::vector<double>& orientationMap, int width, int height);
     void setShapeMap(const std::vector<float>& shapeMap);
@@ -1,6 +1,7 @@
 #include "orientation_generator.h"
 #include "fomfe_orientation_generator.h"
 #include "orientation_smoother.h"
+#include "raster/random.h"
 #include <QDebug>
 #include <QPainter>
 #include <cmath>
@@ -12,7 +13,11 @@
 namespace SFinGe {
 
 OrientationGenerator::OrientationGenerator() 
-    : m_width(0), m_height(0), m_fpClass(FingerprintClass::RightLoop) {
+    : m_width(0), m_height(0), m_fpClass(FingerprintClass::RightLoop), m_rng(std::random_device{}()) {
+}
+
+void OrientationGenerator::reseed(uint64_t seed) {
+    Raster::seedEngine(m_rng, seed);
 }
 
 void OrientationGenerator::setSingularPoints(const SingularPoints& points) {
@@ -65,7 +70,6 @@ void OrientationGenerator::generateVariedAlphas() {
     // Gerar alphas variados para Sherlock-Monro
     // Cores: média +1, desvio padrão 0.025
     // Deltas: média -1, desvio padrão 0.025
-    static std::mt19937 gen(std::random_device{}());
     std::normal_distribution<double> coreAlphaDist(1.0, 0.025);
     std::normal_distribution<double> deltaAlphaDist(-1.0, 0.025);
     
@@ -76,11 +80,11 @@ void OrientationGenerator::generateVariedAlphas() {
     m_deltaAlphas.resize(deltas.size());
     
     for (size_t i = 0; i < cores.size(); ++i) {
-        m_coreAlphas[i] = coreAlphaDist(gen);
+        m_coreAlphas[i] = coreAlphaDist(m_rng);
     }
     
     for (size_t i = 0; i < deltas.size(); ++i) {
-        m_deltaAlphas[i] = deltaAlphaDist(gen);
+        m_deltaAlphas[i] = deltaAlphaDist(m_rng);
     }
 }
 
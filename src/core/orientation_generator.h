@@ -2,6 +2,8 @@
 #define ORIENTATION_GENERATOR_H
 
 #include <QImage>
+#include <cstdint>
+#include <random>
 #include <vector>
 #include "models/singular_points.h"
 #include "models/fingerprint_parameters.h"
@@ -12,6 +14,9 @@ class OrientationGenerator {
 public:
     OrientationGenerator();
     
+    // Semente dos sorteios da orientação (alphas de Poincaré)
+    void reseed(uint64_t seed);
+    
     void setSingularPoints(const SingularPoints& points);
     void setShapeMap(const std::vector<float>& shapeMap, int width, int height);
     void setParameters(const OrientationParameters& params);
@@ -59,6 +64,7 @@ private:
     // Alphas variados para cada singularidade (Poincaré)
     std::vector<double> m_coreAlphas;   // média +1, dp 0.025
     std::vector<double> m_deltaAlphas;  // média -1, dp 0.025
+    std::mt19937 m_rng;
 };
 
 }
@@ -6,7 +6,8 @@ namespace SFinGe {
 
 PhaseFieldGenerator::PhaseFieldGenerator() {
     std::random_device rd;
-    m_rng.seed(rd());
+    uint64_t seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+    m_noiseStream = Raster::RandomStream(seed, 0, Raster::NoiseStage::PhaseNoise);
 }
 
 PhaseFieldGenerator::~PhaseFieldGenerator() {
@@ -52,11 +53,13 @@ std::vector<std::vector<double>> PhaseFieldGenerator::generate(
     
     // PASSO 3: Adiciona variação controlada (muito menor que aleatória!)
     if (m_noiseLevel > 0.0) {
-        std::normal_distribution<> dist(0.0, m_noiseLevel);
+        std::vector<float> noise(width);
         
         for (int y = 0; y < height; y++) {
+            Raster::fillNormal(m_noiseStream, static_cast<uint64_t>(y) * width, noise.data(),
+                               noise.size(), 0.0f, static_cast<float>(m_noiseLevel));
             for (int x = 0; x < width; x++) {
-                phaseField[y][x] += dist(m_rng);
+                phaseField[y][x] += noise[x];
             }
         }
     }
@@ -68,6 +71,10 @@ void PhaseFieldGenerator::setNoiseLevel(double noiseLevel) {
     m_noiseLevel = noiseLevel;
 }
 
+void PhaseFieldGenerator::setNoiseStream(const Raster::RandomStream& stream) {
+    m_noiseStream = stream;
+}
+
 void PhaseFieldGenerator::integrateLine(
     std::vector<double>& phaseLine,
     const std::vector<double>& orientationLine,
@@ -2,7 +2,7 @@
 #define PHASEFIELDGENERATOR_H
 
 #include <vector>
-#include <random>
+#include "raster/random.h"
 
 namespace SFinGe {
 
@@ -30,9 +30,14 @@ public:
      */
     void setNoiseLevel(double noiseLevel);
     
+    /**
+     * @brief Define a sequência do ruído por pixel (etapa PhaseNoise)
+     */
+    void setNoiseStream(const Raster::RandomStream& stream);
+    
 private:
     double m_noiseLevel = 0.1;  // 10% de variação padrão
-    std::mt19937 m_rng;
+    Raster::RandomStream m_noiseStream;
     
     /**
      * @brief Integra fase ao longo de uma linha (horizontal)
@@ -0,0 +1,54 @@
+#ifndef PLANE_H
+#define PLANE_H
+
+#include <vector>
+#include <utility>
+
+namespace SFinGe {
+
+/**
+ * @brief Plano de imagem de um canal armazenado em linha (row-major)
+ *
+ * Usado para trafegar imagens em ponto flutuante entre as etapas do pipeline
+ * (cristas -> renderização -> variações) sem passar por QImage. A quantização
+ * para 8 bits acontece uma única vez, ao final.
+ */
+template<typename T>
+class Plane {
+public:
+    Plane() = default;
+
+    Plane(int width, int height, T fill = T())
+        : m_width(width), m_height(height)
+        , m_data(static_cast<size_t>(width) * height, fill) {}
+
+    Plane(int width, int height, std::vector<T> data)
+        : m_width(width), m_height(height), m_data(std::move(data)) {}
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    size_t size() const { return m_data.size(); }
+    bool isEmpty() const { return m_data.empty(); }
+
+    T* data() { return m_data.data(); }
+    const T* data() const { return m_data.data(); }
+
+    T* row(int y) { return m_data.data() + static_cast<size_t>(y) * m_width; }
+    const T* row(int y) const { return m_data.data() + static_cast<size_t>(y) * m_width; }
+
+    T& at(int x, int y) { return m_data[static_cast<size_t>(y) * m_width + x]; }
+    const T& at(int x, int y) const { return m_data[static_cast<size_t>(y) * m_width + x]; }
+
+    // Acesso ao vetor subjacente (para as etapas que ainda operam em std::vector)
+    std::vector<T>& values() { return m_data; }
+    const std::vector<T>& values() const { return m_data; }
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<T> m_data;
+};
+
+} // namespace SFinGe
+
+#endif // PLANE_H
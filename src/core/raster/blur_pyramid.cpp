@@ -0,0 +1,207 @@
+#include "blur_pyramid.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+// Níveis além deste não trazem ganho visível nas resoluções do projeto
+constexpr int kMaxLevels = 6;
+
+// Resolução do nível l: os níveis 0 e 1 ficam na resolução original
+// (o desfoque fraco, o mais comum, não passa por interpolação) e cada nível
+// seguinte reduz por 2
+inline int levelShift(int level) {
+    return std::max(0, level - 1);
+}
+
+// Binomial 5-tap [1 4 6 4 1] / 16 (sigma 1) com índices limitados à borda,
+// avaliado a cada `step` amostras (step 2 = redução por 2)
+Plane<float> binomial(const Plane<float>& src, int step) {
+    const int w = src.width();
+    const int h = src.height();
+    const int rw = (w + step - 1) / step;
+    const int rh = (h + step - 1) / step;
+    static const float taps[5] = {1.0f / 16, 4.0f / 16, 6.0f / 16, 4.0f / 16, 1.0f / 16};
+
+    // Passe horizontal só nas colunas mantidas
+    Plane<float> horizontal(rw, h);
+    for (int y = 0; y < h; ++y) {
+        const float* in = src.row(y);
+        float* out = horizontal.row(y);
+        for (int i = 0; i < rw; ++i) {
+            int x = step * i;
+            float sum = 0.0f;
+            for (int k = 0; k < 5; ++k) {
+                sum += taps[k] * in[std::clamp(x + k - 2, 0, w - 1)];
+            }
+            out[i] = sum;
+        }
+    }
+
+    // Passe vertical só nas linhas mantidas, linhas inteiras de cada vez
+    Plane<float> result(rw, rh);
+    for (int j = 0; j < rh; ++j) {
+        float* out = result.row(j);
+        const float* rows[5];
+        for (int k = 0; k < 5; ++k) {
+            rows[k] = horizontal.row(std::clamp(step * j + k - 2, 0, h - 1));
+        }
+        for (int i = 0; i < rw; ++i) {
+            out[i] = taps[0] * rows[0][i] + taps[1] * rows[1][i] + taps[2] * rows[2][i]
+                   + taps[3] * rows[3][i] + taps[4] * rows[4][i];
+        }
+    }
+    return result;
+}
+
+// Leitura bilinear de um nível com redução 2^shift na posição (x, y) da resolução original
+inline float sampleLevel(const Plane<float>& level, int shift, float x, float y) {
+    if (shift == 0) {
+        return level.row(static_cast<int>(y))[static_cast<int>(x)];
+    }
+    float scale = 1.0f / static_cast<float>(1 << shift);
+    float u = std::max(0.0f, (x + 0.5f) * scale - 0.5f);
+    float v = std::max(0.0f, (y + 0.5f) * scale - 0.5f);
+    int u0 = std::min(static_cast<int>(u), level.width() - 1);
+    int v0 = std::min(static_cast<int>(v), level.height() - 1);
+    int u1 = std::min(u0 + 1, level.width() - 1);
+    int v1 = std::min(v0 + 1, level.height() - 1);
+    float fu = u - u0;
+    float fv = v - v0;
+    const float* r0 = level.row(v0);
+    const float* r1 = level.row(v1);
+    float top = r0[u0] + (r0[u1] - r0[u0]) * fu;
+    float bottom = r1[u0] + (r1[u1] - r1[u0]) * fu;
+    return top + (bottom - top) * fv;
+}
+
+} // namespace
+
+double pyramidLevelSigma(int level) {
+    if (level <= 0) {
+        return 0.0;
+    }
+    // sigma^2 = 1 (nível 1) + soma das variâncias de cada redução seguinte
+    return std::sqrt(1.0 + (std::pow(4.0, level - 1) - 1.0) / 3.0);
+}
+
+void variableBlur(ConstGray8View src, Gray8View dst, int x0, int y0,
+                  const Plane<float>& sigma, int threads) {
+    // Retângulo afetado, limitado à imagem
+    const int bx0 = std::max(0, x0);
+    const int by0 = std::max(0, y0);
+    const int bx1 = std::min(src.width, x0 + sigma.width());
+    const int by1 = std::min(src.height, y0 + sigma.height());
+    if (bx0 >= bx1 || by0 >= by1) {
+        return;
+    }
+
+    float maxSigma = 0.0f;
+    for (int y = by0; y < by1; ++y) {
+        const float* s = sigma.row(y - y0);
+        for (int x = bx0; x < bx1; ++x) {
+            maxSigma = std::max(maxSigma, s[x - x0]);
+        }
+    }
+    if (maxSigma <= 0.0f) {
+        return;
+    }
+
+    int levels = 1;
+    while (levels < kMaxLevels && pyramidLevelSigma(levels) < maxSigma) {
+        ++levels;
+    }
+    float levelSigma[kMaxLevels + 1];
+    for (int l = 0; l <= levels; ++l) {
+        levelSigma[l] = static_cast<float>(pyramidLevelSigma(l));
+    }
+
+    // Pirâmide sobre o retângulo + suporte do último nível
+    const int margin = 2 * (1 << levelShift(levels)) + 4;
+    const int rx0 = std::max(0, bx0 - margin);
+    const int ry0 = std::max(0, by0 - margin);
+    const int rx1 = std::min(src.width, bx1 + margin);
+    const int ry1 = std::min(src.height, by1 + margin);
+
+    std::vector<Plane<float>> pyramid;
+    pyramid.reserve(levels + 1);
+    pyramid.emplace_back(rx1 - rx0, ry1 - ry0);
+    for (int y = ry0; y < ry1; ++y) {
+        const uint8_t* in = src.row(y);
+        float* out = pyramid[0].row(y - ry0);
+        for (int x = rx0; x < rx1; ++x) {
+            out[x - rx0] = in[x];
+        }
+    }
+    for (int l = 1; l <= levels; ++l) {
+        pyramid.push_back(binomial(pyramid[l - 1], l == 1 ? 1 : 2));
+    }
+
+    parallelRanges(by0, by1, threads, [&](int ya, int yb) {
+        for (int y = ya; y < yb; ++y) {
+            const float* s = sigma.row(y - y0);
+            const uint8_t* in = src.row(y);
+            uint8_t* out = dst.row(y);
+            const float ly = static_cast<float>(y - ry0);
+
+            for (int x = bx0; x < bx1; ++x) {
+                float sx = s[x - x0];
+                if (sx <= 0.0f) {
+                    continue;
+                }
+
+                // Dois níveis vizinhos ao sigma pedido
+                int l = 0;
+                while (l + 1 < levels && levelSigma[l + 1] <= sx) {
+                    ++l;
+                }
+                float t = std::min(1.0f, (sx - levelSigma[l]) / (levelSigma[l + 1] - levelSigma[l]));
+
+                const float lx = static_cast<float>(x - rx0);
+                float lower = (l == 0) ? static_cast<float>(in[x])
+                                       : sampleLevel(pyramid[l], levelShift(l), lx, ly);
+                float upper = sampleLevel(pyramid[l + 1], levelShift(l + 1), lx, ly);
+                float value = lower + (upper - lower) * t;
+                out[x] = static_cast<uint8_t>(std::clamp(value, 0.0f, 255.0f));
+            }
+        }
+    });
+}
+
+void radialDefocus(ConstGray8View src, Gray8View dst, double radius,
+                   double centerX, double centerY, double maxSigma, int threads) {
+    if (radius <= 0.0 || maxSigma <= 0.0) {
+        return;
+    }
+
+    // Só o retângulo envolvente do disco
+    const int x0 = std::max(0, static_cast<int>(std::ceil(centerX - radius)));
+    const int y0 = std::max(0, static_cast<int>(std::ceil(centerY - radius)));
+    const int x1 = std::min(src.width, static_cast<int>(std::floor(centerX + radius)) + 1);
+    const int y1 = std::min(src.height, static_cast<int>(std::floor(centerY + radius)) + 1);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    Plane<float> sigma(x1 - x0, y1 - y0);
+    const double invRadius = 1.0 / radius;
+    for (int y = y0; y < y1; ++y) {
+        float* row = sigma.row(y - y0);
+        double dy = y - centerY;
+        for (int x = x0; x < x1; ++x) {
+            double dx = x - centerX;
+            double strength = 1.0 - std::sqrt(dx * dx + dy * dy) * invRadius;
+            row[x - x0] = strength > 0.0 ? static_cast<float>(maxSigma * strength) : 0.0f;
+        }
+    }
+
+    variableBlur(src, dst, x0, y0, sigma, threads);
+}
+
+} // namespace Raster
+} // namespace SFinGe
@@ -0,0 +1,44 @@
+#ifndef RASTER_BLUR_PYRAMID_H
+#define RASTER_BLUR_PYRAMID_H
+
+#include "gray8.h"
+#include "../plane.h"
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Desvio padrão (em pixels da imagem original) do nível de pirâmide
+ *
+ * O nível 1 é o binomial 5-tap (sigma 1) na resolução original; cada nível
+ * seguinte aplica o mesmo binomial e reduz por 2: sigma_l^2 = 1 + (4^(l-1) - 1) / 3,
+ * ou seja 0, 1, 1.41, 2.45, 4.69, 9.27, ...
+ */
+double pyramidLevelSigma(int level);
+
+/**
+ * @brief Blur espacialmente variável por mistura entre níveis de uma pirâmide gaussiana
+ *
+ * A pirâmide é construída uma vez sobre a região afetada (mais a margem do
+ * suporte do último nível). Cada pixel lê apenas os dois níveis vizinhos ao seu
+ * sigma (interpolação bilinear na resolução de cada nível), então o custo por
+ * pixel não depende da intensidade do blur.
+ *
+ * @param sigma Sigma por pixel (pixels) do retângulo com canto (x0, y0) em src;
+ *              valores <= 0 deixam o pixel intacto
+ * @param dst Mesmo tamanho de src; deve conter uma cópia de src (só o
+ *            retângulo é escrito). src e dst não podem se sobrepor.
+ */
+void variableBlur(ConstGray8View src, Gray8View dst, int x0, int y0,
+                  const Plane<float>& sigma, int threads = 1);
+
+/**
+ * @brief Desfoque circular: sigma = maxSigma * (1 - d / radius) dentro do disco
+ */
+void radialDefocus(ConstGray8View src, Gray8View dst, double radius,
+                   double centerX, double centerY, double maxSigma, int threads = 1);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_BLUR_PYRAMID_H
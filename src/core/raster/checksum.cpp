@@ -0,0 +1,54 @@
+#include "checksum.h"
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+// Slicing-by-4: quatro tabelas consomem uma palavra de 32 bits por passo
+struct CrcTables {
+    uint32_t table[4][256];
+
+    CrcTables() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[0][n] = c;
+        }
+        for (uint32_t n = 0; n < 256; ++n) {
+            for (int t = 1; t < 4; ++t) {
+                table[t][n] = table[0][table[t - 1][n] & 0xFF] ^ (table[t - 1][n] >> 8);
+            }
+        }
+    }
+};
+
+const CrcTables& crcTables() {
+    static const CrcTables instance;
+    return instance;
+}
+
+} // namespace
+
+uint32_t crc32(uint32_t crc, const void* data, size_t size) {
+    const CrcTables& t = crcTables();
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    while (size >= 4) {
+        crc ^= static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        crc = t.table[3][crc & 0xFF] ^ t.table[2][(crc >> 8) & 0xFF] ^
+              t.table[1][(crc >> 16) & 0xFF] ^ t.table[0][crc >> 24];
+        p += 4;
+        size -= 4;
+    }
+    while (size-- > 0) {
+        crc = t.table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+} // namespace Raster
+} // namespace SFinGe
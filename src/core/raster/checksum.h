@@ -0,0 +1,20 @@
+#ifndef RASTER_CHECKSUM_H
+#define RASTER_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief CRC-32 (polinômio 0xEDB88320, o mesmo de PNG, zip e zlib)
+ *
+ * Incremental: crc32(crc32(0, a, n), b, m) == crc32 de a seguido de b.
+ */
+uint32_t crc32(uint32_t crc, const void* data, size_t size);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_CHECKSUM_H
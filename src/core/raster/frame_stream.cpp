@@ -0,0 +1,344 @@
+#include "frame_stream.h"
+#include "checksum.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#include <unistd.h>
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+const char kStreamMagic[8] = {'S', 'F', 'S', 'T', 'R', 'E', 'A', 'M'};
+const char kFrameMagic[4] = {'S', 'F', 'F', 'R'};
+const uint32_t kVersion = 1;
+const size_t kFrameHeaderSize = 32;
+const uint64_t kEncodedSlack = 64 * 1024;  // Cabeçalhos, tabelas e blocos do PNG/WSQ
+const size_t kReadChunk = 1 << 20;
+const uint64_t kMaxPrefixBytes = 4096;
+
+void putLE(uint8_t* p, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint64_t getLE(const uint8_t* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+void encodeHeader(const FrameHeader& header, uint8_t* p) {
+    std::memcpy(p, kFrameMagic, 4);
+    putLE(p + 4, header.identity, 4);
+    putLE(p + 8, header.version, 2);
+    p[10] = static_cast<uint8_t>(header.format);
+    p[11] = 0;
+    putLE(p + 12, header.width, 4);
+    putLE(p + 16, header.height, 4);
+    putLE(p + 20, header.length, 8);
+    putLE(p + 28, header.crc, 4);
+}
+
+const char* formatName(FrameFormat format) {
+    switch (format) {
+        case FrameFormat::Gray8:
+            return "gray8";
+        case FrameFormat::Png:
+            return "png";
+        case FrameFormat::Wsq:
+            return "wsq";
+        default:
+            return "end";
+    }
+}
+
+// Maior payload plausível para as dimensões do quadro: Gray8 é exato; PNG e
+// WSQ nunca passam de 4 bytes por pixel (símbolo de Huffman e coeficiente de
+// 16 bits) mais os cabeçalhos
+uint64_t maxFrameBytes(const FrameHeader& header) {
+    const uint64_t pixels = static_cast<uint64_t>(header.width) * header.height;
+    return header.format == FrameFormat::Gray8 ? pixels : 4 * std::min<uint64_t>(pixels, 1ull << 60) + kEncodedSlack;
+}
+
+} // namespace
+
+bool FrameStreamWriter::open(int fd, const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_fd = fd;
+    m_frames = 0;
+    m_bytes = 0;
+    m_blocked = 0.0;
+    m_failed = false;
+    m_error.clear();
+#ifdef _WIN32
+    _setmode(fd, _O_BINARY);
+#else
+    // Leitor que some vira EPIPE em write(), tratado como erro, em vez de derrubar o processo
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    if (prefix.size() > kMaxPrefixBytes) {
+        return fail("file name prefix longer than " + std::to_string(kMaxPrefixBytes) + " bytes");
+    }
+    std::vector<uint8_t> start(16 + prefix.size());
+    std::memcpy(start.data(), kStreamMagic, 8);
+    putLE(start.data() + 8, kVersion, 4);
+    putLE(start.data() + 12, prefix.size(), 4);
+    std::memcpy(start.data() + 16, prefix.data(), prefix.size());
+    return writeAll(start.data(), start.size());
+}
+
+bool FrameStreamWriter::write(const FrameHeader& header, const void* data) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd < 0 || m_failed) {
+        return false;
+    }
+    uint8_t encoded[kFrameHeaderSize];
+    encodeHeader(header, encoded);
+    if (!writeAll(encoded, sizeof(encoded)) ||
+        !writeAll(static_cast<const uint8_t*>(data), static_cast<size_t>(header.length))) {
+        return false;
+    }
+    ++m_frames;
+    return true;
+}
+
+bool FrameStreamWriter::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd < 0) {
+        return !m_failed;
+    }
+    if (!m_failed) {
+        FrameHeader end;
+        end.identity = static_cast<uint32_t>(m_frames);
+        uint8_t encoded[kFrameHeaderSize];
+        encodeHeader(end, encoded);
+        writeAll(encoded, sizeof(encoded));
+    }
+    m_fd = -1;
+    return !m_failed;
+}
+
+uint64_t FrameStreamWriter::frameCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_frames;
+}
+
+uint64_t FrameStreamWriter::bytesWritten() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+double FrameStreamWriter::blockedSeconds() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_blocked;
+}
+
+bool FrameStreamWriter::writeAll(const uint8_t* data, size_t size) {
+    const auto start = std::chrono::steady_clock::now();
+    while (size > 0) {
+#ifdef _WIN32
+        const int chunk = static_cast<int>(std::min<size_t>(size, 1u << 30));
+        const int written = _write(m_fd, data, static_cast<unsigned>(chunk));
+#else
+        const ssize_t written = ::write(m_fd, data, size);
+#endif
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return fail(errno == EPIPE ? "the reader closed the stream" : std::string("write failed: ") +
+                                                                           std::strerror(errno));
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        m_bytes += static_cast<uint64_t>(written);
+    }
+    m_blocked += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool FrameStreamWriter::fail(const std::string& message) {
+    m_failed = true;
+    m_error = message;
+    return false;
+}
+
+FrameStreamReader::~FrameStreamReader() {
+    if (m_file && m_ownsFile) {
+        std::fclose(m_file);
+    }
+}
+
+bool FrameStreamReader::open(const std::string& path) {
+    if (path == "-") {
+        m_file = stdin;
+        m_ownsFile = false;
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    } else {
+        m_file = std::fopen(path.c_str(), "rb");
+        m_ownsFile = true;
+        if (!m_file) {
+            return fail("cannot open " + path);
+        }
+    }
+
+    uint8_t start[16];
+    if (std::fread(start, 1, sizeof(start), m_file) != sizeof(start) ||
+        std::memcmp(start, kStreamMagic, 8) != 0 || getLE(start + 8, 4) != kVersion) {
+        return fail(path + ": not a frame stream");
+    }
+    // O tamanho vem do arquivo: conferido antes de alocar
+    const uint64_t prefixSize = getLE(start + 12, 4);
+    if (prefixSize > kMaxPrefixBytes) {
+        return fail(path + ": not a frame stream");
+    }
+    m_prefix.resize(static_cast<size_t>(prefixSize));
+    if (std::fread(&m_prefix[0], 1, m_prefix.size(), m_file) != m_prefix.size()) {
+        return fail(path + ": not a frame stream");
+    }
+    return true;
+}
+
+bool FrameStreamReader::next(FrameHeader& header, std::vector<uint8_t>& data) {
+    if (!m_file || m_finished || !m_error.empty()) {
+        return false;
+    }
+    uint8_t encoded[kFrameHeaderSize];
+    if (std::fread(encoded, 1, sizeof(encoded), m_file) != sizeof(encoded)) {
+        return fail("stream ends after " + std::to_string(m_frames) + " frames without an end frame");
+    }
+    if (std::memcmp(encoded, kFrameMagic, 4) != 0) {
+        return fail("frame " + std::to_string(m_frames) + ": bad header");
+    }
+    header.identity = static_cast<uint32_t>(getLE(encoded + 4, 4));
+    header.version = static_cast<uint16_t>(getLE(encoded + 8, 2));
+    header.format = static_cast<FrameFormat>(encoded[10]);
+    header.width = static_cast<uint32_t>(getLE(encoded + 12, 4));
+    header.height = static_cast<uint32_t>(getLE(encoded + 16, 4));
+    header.length = getLE(encoded + 20, 8);
+    header.crc = static_cast<uint32_t>(getLE(encoded + 28, 4));
+
+    if (header.format == FrameFormat::End) {
+        if (header.identity != m_frames) {
+            return fail("end frame counts " + std::to_string(header.identity) + " frames, read " +
+                        std::to_string(m_frames));
+        }
+        m_finished = true;
+        return false;
+    }
+    if (header.format != FrameFormat::Gray8 && header.format != FrameFormat::Png &&
+        header.format != FrameFormat::Wsq) {
+        return fail("frame " + std::to_string(m_frames) + ": unknown format");
+    }
+    if (header.length > maxFrameBytes(header) ||
+        (header.format == FrameFormat::Gray8 && header.length != maxFrameBytes(header))) {
+        return fail("frame " + std::to_string(m_frames) + ": bad length");
+    }
+    // Em pedaços: um cabeçalho corrompido que passe pelos limites só faz a
+    // memória crescer com os bytes que de fato chegam
+    data.clear();
+    while (data.size() < header.length) {
+        const size_t offset = data.size();
+        const size_t chunk = static_cast<size_t>(std::min<uint64_t>(header.length - offset, kReadChunk));
+        data.resize(offset + chunk);
+        if (std::fread(data.data() + offset, 1, chunk, m_file) != chunk) {
+            return fail("frame " + std::to_string(m_frames) + " truncated");
+        }
+    }
+    if (crc32(0, data.data(), data.size()) != header.crc) {
+        return fail("frame " + std::to_string(m_frames) + ": CRC mismatch");
+    }
+    ++m_frames;
+    return true;
+}
+
+bool FrameStreamReader::fail(const std::string& message) {
+    m_error = message;
+    return false;
+}
+
+int runStreamTool(const std::vector<std::string>& args) {
+    const std::string command = args.empty() ? std::string() : args[0];
+    const bool list = command == "list" && args.size() == 2;
+    const bool extract = command == "extract" && args.size() == 3;
+    if (!list && !extract) {
+        std::cerr << "Usage:\n"
+                  << "  stream list <file|->               Identity, version, format, size and length of each frame\n"
+                  << "  stream extract <file|-> <dir>      Write each frame to dir under its batch file name\n";
+        return 2;
+    }
+
+    FrameStreamReader reader;
+    if (!reader.open(args[1])) {
+        std::cerr << reader.error() << "\n";
+        return 1;
+    }
+    std::error_code ec;
+    if (extract) {
+        if (reader.prefix().find_first_of("/\\:") != std::string::npos) {
+            std::cerr << args[1] << ": unsafe prefix " << reader.prefix() << "\n";
+            return 1;
+        }
+        std::filesystem::create_directories(args[2], ec);
+    }
+
+    FrameHeader header;
+    std::vector<uint8_t> data;
+    uint64_t frames = 0;
+    uint64_t total = 0;
+    while (reader.next(header, data)) {
+        ++frames;
+        total += data.size();
+        if (list) {
+            std::cout << header.identity << "\t" << header.version << "\t" << formatName(header.format) << "\t"
+                      << header.width << "x" << header.height << "\t" << header.length << "\n";
+            continue;
+        }
+
+        // Mesmo nome que o lote dá ao arquivo; pixels crus ganham um cabeçalho PGM
+        const bool gray = header.format == FrameFormat::Gray8;
+        char name[64];
+        std::snprintf(name, sizeof(name), "_%04u_v%02u.%s", static_cast<unsigned>(header.identity),
+                      static_cast<unsigned>(header.version), gray ? "pgm" : formatName(header.format));
+        const std::string path = (std::filesystem::path(args[2]) / (reader.prefix() + name)).string();
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        bool ok = file != nullptr;
+        if (ok && gray) {
+            ok = std::fprintf(file, "P5\n%u %u\n255\n", static_cast<unsigned>(header.width),
+                              static_cast<unsigned>(header.height)) > 0;
+        }
+        ok = ok && std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        ok = file && (std::fclose(file) == 0) && ok;
+        if (!ok) {
+            std::cerr << "cannot write " << path << "\n";
+            return 1;
+        }
+    }
+    if (!reader.finished()) {
+        std::cerr << reader.error() << "\n";
+        return 1;
+    }
+    std::cerr << args[1] << ": " << frames << " frames, " << total << " bytes\n";
+    return 0;
+}
+
+} // namespace Raster
+} // namespace SFinGe
@@ -0,0 +1,145 @@
+#ifndef RASTER_FRAME_STREAM_H
+#define RASTER_FRAME_STREAM_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Conteúdo de um quadro do fluxo
+ */
+enum class FrameFormat : uint8_t {
+    End = 0,    // Último quadro: sem dados, identity = número de quadros de imagem
+    Gray8 = 1,  // Pixels crus, width * height bytes, linha a linha
+    Png = 2,
+    Wsq = 3
+};
+
+struct FrameHeader {
+    uint32_t identity = 0;
+    uint16_t version = 0;
+    FrameFormat format = FrameFormat::End;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t length = 0;  // Bytes de dados depois do cabeçalho
+    uint32_t crc = 0;     // CRC-32 dos dados
+};
+
+/**
+ * @brief Imagens prontas como um fluxo binário em quadros (stdout, pipe, ssh)
+ *
+ * Formato (inteiros little-endian):
+ *   início     "SFSTREAM", versão u32, tamanho do prefixo u32, prefixo
+ *   quadros    "SFFR", identity u32, version u16, formato u8, reservado u8,
+ *              width u32, height u32, length u64, CRC dos dados u32, dados
+ *   fim        um quadro End; sem ele o fluxo foi interrompido
+ *
+ * Os quadros saem na ordem em que as imagens ficam prontas, não na ordem das
+ * identidades; o cabeçalho diz de qual imagem cada um é. write() é
+ * thread-safe e grava o quadro inteiro de uma vez. Um leitor lento segura a
+ * escrita no pipe, e com ela as threads de gravação e, pela fila limitada,
+ * os workers: a memória não cresce. Um leitor que fecha o pipe faz write()
+ * falhar (EPIPE, sem SIGPIPE).
+ */
+class FrameStreamWriter {
+public:
+    FrameStreamWriter() = default;
+
+    FrameStreamWriter(const FrameStreamWriter&) = delete;
+    FrameStreamWriter& operator=(const FrameStreamWriter&) = delete;
+
+    /**
+     * @brief Começa o fluxo no descritor fd (não é fechado aqui)
+     *
+     * @param prefix Prefixo dos nomes, para "stream extract" recriar os arquivos
+     */
+    bool open(int fd, const std::string& prefix);
+
+    bool write(const FrameHeader& header, const void* data);
+
+    /**
+     * @brief Grava o quadro End; o descritor continua aberto
+     *
+     * Só aqui: um writer destruído sem close() deixa o fluxo sem fim, como uma queda.
+     */
+    bool close();
+
+    uint64_t frameCount() const;
+    uint64_t bytesWritten() const;
+    double blockedSeconds() const;  // Tempo dentro de write() no descritor: espera pelo leitor
+    const std::string& error() const { return m_error; }
+
+private:
+    bool writeAll(const uint8_t* data, size_t size);
+    bool fail(const std::string& message);
+
+    mutable std::mutex m_mutex;
+    int m_fd = -1;
+    uint64_t m_frames = 0;
+    uint64_t m_bytes = 0;
+    double m_blocked = 0.0;
+    bool m_failed = false;
+    std::string m_error;
+};
+
+/**
+ * @brief Leitura sequencial de um fluxo de quadros (arquivo ou stdin)
+ */
+class FrameStreamReader {
+public:
+    FrameStreamReader() = default;
+    ~FrameStreamReader();
+
+    FrameStreamReader(const FrameStreamReader&) = delete;
+    FrameStreamReader& operator=(const FrameStreamReader&) = delete;
+
+    /**
+     * @param path Arquivo, ou "-" para stdin
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Próximo quadro de imagem, com os dados conferidos pelo CRC
+     *
+     * @return false no quadro End (finished() == true) ou em erro
+     */
+    bool next(FrameHeader& header, std::vector<uint8_t>& data);
+
+    bool finished() const { return m_finished; }
+    const std::string& prefix() const { return m_prefix; }
+    const std::string& error() const { return m_error; }
+
+private:
+    bool fail(const std::string& message);
+
+    std::FILE* m_file = nullptr;
+    bool m_ownsFile = false;
+    bool m_finished = false;
+    uint64_t m_frames = 0;
+    std::string m_prefix;
+    std::string m_error;
+};
+
+/**
+ * @brief Subcomando "stream" das linhas de comando
+ *
+ *   stream list <arquivo|->
+ *   stream extract <arquivo|-> <diretório>
+ *
+ * extract grava cada quadro com o nome que o lote daria ao arquivo (PGM para
+ * os quadros Gray8).
+ *
+ * @param args Argumentos após "stream"
+ * @return Código de saída do processo
+ */
+int runStreamTool(const std::vector<std::string>& args);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_FRAME_STREAM_H
@@ -0,0 +1,37 @@
+#include "geometry_cache.h"
+
+namespace SFinGe {
+namespace Raster {
+
+GeometryCache& GeometryCache::global() {
+    static GeometryCache cache;
+    return cache;
+}
+
+std::shared_ptr<const Plane<uint8_t>> GeometryCache::ellipticalAlpha(int width, int height,
+                                                                     const EllipticalMask& mask) {
+    MaskKey key(width, height, mask.radiusX, mask.radiusY, mask.fadeStart, mask.smoothstep);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_alpha.find(key);
+    if (it != m_alpha.end()) {
+        return it->second;
+    }
+
+    auto plane = std::make_shared<Plane<uint8_t>>(width, height);
+    fillEllipticalAlpha(Gray8View{plane->data(), width, width, height}, mask);
+
+    if (m_alpha.size() >= kMaxEntries) {
+        m_alpha.clear();
+    }
+    m_alpha.emplace(key, plane);
+    return plane;
+}
+
+void GeometryCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_alpha.clear();
+}
+
+} // namespace Raster
+} // namespace SFinGe
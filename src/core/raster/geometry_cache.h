@@ -0,0 +1,46 @@
+#ifndef RASTER_GEOMETRY_CACHE_H
+#define RASTER_GEOMETRY_CACHE_H
+
+#include "gray8.h"
+#include "../plane.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Cache de planos geométricos que dependem apenas do tamanho da imagem
+ *
+ * Em lote todas as saídas têm o mesmo tamanho (500x600 ou o da base), então
+ * a máscara elíptica é calculada uma vez e reaproveitada por todas as
+ * imagens e threads. Os planos são imutáveis e compartilhados via shared_ptr.
+ */
+class GeometryCache {
+public:
+    static GeometryCache& global();
+
+    /**
+     * @brief Peso da imagem na máscara elíptica, em 8 bits (255 = imagem, 0 = branco)
+     */
+    std::shared_ptr<const Plane<uint8_t>> ellipticalAlpha(int width, int height,
+                                                          const EllipticalMask& mask);
+
+    void clear();
+
+private:
+    // Tamanhos distintos são poucos; o limite só protege usos interativos
+    static constexpr size_t kMaxEntries = 32;
+
+    using MaskKey = std::tuple<int, int, double, double, double, bool>;
+
+    std::mutex m_mutex;
+    std::map<MaskKey, std::shared_ptr<const Plane<uint8_t>>> m_alpha;
+};
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_GEOMETRY_CACHE_H
@@ -0,0 +1,192 @@
+#include "gray8.h"
+#include "geometry_cache.h"
+#include "parallel.h"
+#include "warp.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTER_GRAY8_SSE2 1
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+inline uint8_t clampToByte(int value) {
+    return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+void singleStageWarp(ConstGray8View src, Gray8View dst, const VersionWarp& warp, int threads) {
+    WarpFootprint whole;
+    whole.x1 = src.width;
+    whole.y1 = src.height;
+    applyVersionWarp(src.data, src.stride, whole, dst.data, dst.stride, dst.width, dst.height,
+                     warp, Interpolation::Bilinear, threads);
+}
+
+VersionWarp stageFor(ConstGray8View src) {
+    VersionWarp warp;
+    warp.sourceWidth = src.width;
+    warp.sourceHeight = src.height;
+    return warp;
+}
+
+} // namespace
+
+void addUniformNoise(Gray8View image, double level, const RandomStream& stream, int threads) {
+    if (image.width <= 0 || image.height <= 0) {
+        return;
+    }
+    const float scale = static_cast<float>(255.0 * level);
+
+    parallelRanges(0, image.height, threads, [=, &stream](int y0, int y1) {
+        std::vector<float> uniform(image.width);
+        for (int y = y0; y < y1; ++y) {
+            // Amostra do pixel (x, y) = índice y * largura + x da sequência
+            fillUniform(stream, static_cast<uint64_t>(y) * image.width, uniform.data(), uniform.size());
+
+            uint8_t* line = image.row(y);
+            const float* u = uniform.data();
+            int x = 0;
+#ifdef RASTER_GRAY8_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 amplitude = _mm_set1_ps(scale);
+            for (; x + 16 <= image.width; x += 16) {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x));
+                __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+                __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+                __m128i q[4] = {
+                    _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                    _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+                };
+                for (int k = 0; k < 4; ++k) {
+                    __m128 noise = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(u + x + 4 * k), half), amplitude);
+                    // Truncamento em direção a zero, como static_cast<int>
+                    q[k] = _mm_cvttps_epi32(_mm_add_ps(_mm_cvtepi32_ps(q[k]), noise));
+                }
+                // Empacotamento com saturação = clamp [0, 255]
+                __m128i packed = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]),
+                                                  _mm_packs_epi32(q[2], q[3]));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(line + x), packed);
+            }
+#endif
+            for (; x < image.width; ++x) {
+                float noise = (u[x] - 0.5f) * scale;
+                line[x] = clampToByte(static_cast<int>(line[x] + noise));
+            }
+        }
+    });
+}
+
+void lensDistortion(ConstGray8View src, Gray8View dst, double k, int threads) {
+    VersionWarp warp = stageFor(src);
+    warp.lens = true;
+    warp.lensK = k;
+    singleStageWarp(src, dst, warp, threads);
+}
+
+void homography(ConstGray8View src, Gray8View dst, double shiftX, double shiftY,
+                double angleDegrees, int threads) {
+    VersionWarp warp = stageFor(src);
+    warp.homography = true;
+    warp.homographyDegrees = angleDegrees;
+    warp.homographyShiftX = shiftX;
+    warp.homographyShiftY = shiftY;
+    singleStageWarp(src, dst, warp, threads);
+}
+
+void rotation(ConstGray8View src, Gray8View dst, double angleDegrees, int threads) {
+    VersionWarp warp = stageFor(src);
+    warp.rotation = true;
+    warp.rotationDegrees = angleDegrees;
+    singleStageWarp(src, dst, warp, threads);
+}
+
+void copyRegion(ConstGray8View src, int x, int y, Gray8View dst) {
+    int xb = std::clamp(x, 0, src.width);
+    int xe = std::clamp(x + dst.width, 0, src.width);
+
+    for (int row = 0; row < dst.height; ++row) {
+        uint8_t* out = dst.row(row);
+        int sy = y + row;
+        if (sy < 0 || sy >= src.height || xb >= xe) {
+            std::memset(out, 255, dst.width);
+            continue;
+        }
+        std::memset(out, 255, xb - x);
+        std::memcpy(out + (xb - x), src.row(sy) + xb, xe - xb);
+        std::memset(out + (xe - x), 255, dst.width - (xe - x));
+    }
+}
+
+void applyEllipticalMask(Gray8View image, const EllipticalMask& mask, int threads) {
+    if (image.width <= 0 || image.height <= 0 || mask.radiusX <= 0.0 || mask.radiusY <= 0.0) {
+        return;
+    }
+    auto alpha = GeometryCache::global().ellipticalAlpha(image.width, image.height, mask);
+    blendToWhite(image, ConstGray8View(alpha->data(), alpha->width(), alpha->width(), alpha->height()),
+                 threads);
+}
+
+void fillEllipticalAlpha(Gray8View alpha, const EllipticalMask& mask) {
+    const double cx = alpha.width / 2.0;
+    const double cy = alpha.height / 2.0;
+    const double fadeWidth = std::max(1e-6, 1.0 - mask.fadeStart);
+
+    for (int y = 0; y < alpha.height; ++y) {
+        uint8_t* line = alpha.row(y);
+        double dy = (y - cy) / mask.radiusY;
+        for (int x = 0; x < alpha.width; ++x) {
+            double dx = (x - cx) / mask.radiusX;
+            double dist = std::sqrt(dx * dx + dy * dy);
+            double t = std::clamp((dist - mask.fadeStart) / fadeWidth, 0.0, 1.0);
+            double weight = mask.smoothstep ? 1.0 - t * t * (3.0 - 2.0 * t) : 1.0 - t;
+            line[x] = static_cast<uint8_t>(std::lround(weight * 255.0));
+        }
+    }
+}
+
+void blendToWhite(Gray8View image, ConstGray8View alpha, int threads) {
+    const int width = std::min(image.width, alpha.width);
+    const int height = std::min(image.height, alpha.height);
+
+    parallelRanges(0, height, threads, [=](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            uint8_t* line = image.row(y);
+            const uint8_t* weight = alpha.row(y);
+            int x = 0;
+#ifdef RASTER_GRAY8_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i white = _mm_set1_epi16(255);
+            const __m128i bias = _mm_set1_epi16(254);
+            const __m128i one = _mm_set1_epi16(1);
+            // floor(t / 255) = (t + 1 + (t >> 8)) >> 8, exato para t < 65535
+            auto blend8 = [&](__m128i pixels, __m128i a) {
+                __m128i t = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(white, pixels), a), bias);
+                __m128i q = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, one), _mm_srli_epi16(t, 8)), 8);
+                return _mm_sub_epi16(white, q);
+            };
+            for (; x + 16 <= width; x += 16) {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + x));
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weight + x));
+                __m128i lo = blend8(_mm_unpacklo_epi8(pixels, zero), _mm_unpacklo_epi8(a, zero));
+                __m128i hi = blend8(_mm_unpackhi_epi8(pixels, zero), _mm_unpackhi_epi8(a, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(line + x), _mm_packus_epi16(lo, hi));
+            }
+#endif
+            for (; x < width; ++x) {
+                int t = (255 - line[x]) * weight[x] + 254;
+                line[x] = static_cast<uint8_t>(255 - t / 255);
+            }
+        }
+    });
+}
+
+} // namespace Raster
+} // namespace SFinGe
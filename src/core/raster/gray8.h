@@ -0,0 +1,107 @@
+#ifndef RASTER_GRAY8_H
+#define RASTER_GRAY8_H
+
+#include "random.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Vista mutável de uma imagem Grayscale8 (sem posse dos dados)
+ *
+ * Construída a partir de QImage (bits(), bytesPerLine()) ou de Image
+ * (data(), width()). Todos os kernels abaixo trabalham sobre vistas.
+ */
+struct Gray8View {
+    uint8_t* data = nullptr;
+    int stride = 0;
+    int width = 0;
+    int height = 0;
+
+    uint8_t* row(int y) const { return data + static_cast<size_t>(y) * stride; }
+};
+
+/**
+ * @brief Vista somente leitura de uma imagem Grayscale8
+ */
+struct ConstGray8View {
+    const uint8_t* data = nullptr;
+    int stride = 0;
+    int width = 0;
+    int height = 0;
+
+    ConstGray8View() = default;
+    ConstGray8View(const uint8_t* d, int s, int w, int h) : data(d), stride(s), width(w), height(h) {}
+    ConstGray8View(const Gray8View& v) : data(v.data), stride(v.stride), width(v.width), height(v.height) {}
+
+    const uint8_t* row(int y) const { return data + static_cast<size_t>(y) * stride; }
+};
+
+/**
+ * @brief Ruído uniforme: p = clamp(int(p + (u - 0.5) * 255 * level)), u em [0, 1)
+ *
+ * u do pixel (x, y) é a amostra y * largura + x da sequência Philox, então o
+ * resultado não depende do número de threads.
+ */
+void addUniformNoise(Gray8View image, double level, const RandomStream& stream, int threads = 1);
+
+/**
+ * @brief Distorção de lente r' = r * (1 + k * r^2), normalizada pelo centro
+ *
+ * Transformações geométricas: mapeamento inverso com bilinear; amostras
+ * fora da origem resultam em branco. dst tem o tamanho de src.
+ */
+void lensDistortion(ConstGray8View src, Gray8View dst, double k, int threads = 1);
+
+/**
+ * @brief Perspectiva simplificada (rotação com cisalhamento 0.3 + deslocamento)
+ */
+void homography(ConstGray8View src, Gray8View dst, double shiftX, double shiftY,
+                double angleDegrees, int threads = 1);
+
+/**
+ * @brief Rotação em torno do centro, mantendo o tamanho da imagem
+ */
+void rotation(ConstGray8View src, Gray8View dst, double angleDegrees, int threads = 1);
+
+/**
+ * @brief Copia a janela de src com canto (x, y) e tamanho de dst (fora de src = branco)
+ */
+void copyRegion(ConstGray8View src, int x, int y, Gray8View dst);
+
+/**
+ * @brief Máscara elíptica com fade para branco
+ *
+ * Com d = distância normalizada pelos raios, o peso da imagem é 1 até
+ * fadeStart, cai até 0 em d = 1 (linear ou smoothstep) e é 0 fora da elipse.
+ */
+struct EllipticalMask {
+    double radiusX = 0.0;
+    double radiusY = 0.0;
+    double fadeStart = 0.9;
+    bool smoothstep = true;
+};
+
+/**
+ * @brief Aplica a máscara usando o plano de pesos do GeometryCache (calculado uma vez por tamanho)
+ */
+void applyEllipticalMask(Gray8View image, const EllipticalMask& mask, int threads = 1);
+
+/**
+ * @brief Preenche o plano de pesos da máscara (255 = imagem, 0 = branco)
+ */
+void fillEllipticalAlpha(Gray8View alpha, const EllipticalMask& mask);
+
+/**
+ * @brief Mistura com branco: p = 255 - ceil((255 - p) * a / 255), em inteiros
+ *
+ * Equivale a trunc(p * a + 255 * (1 - a)) com a em [0, 1]; 16 pixels por passo com SSE2.
+ */
+void blendToWhite(Gray8View image, ConstGray8View alpha, int threads = 1);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_GRAY8_H
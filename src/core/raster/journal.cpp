@@ -0,0 +1,284 @@
+#include "journal.h"
+#include "checksum.h"
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+const char kMagic[8] = {'S', 'F', 'J', 'O', 'U', 'R', 'N', 'L'};
+const uint32_t kVersion = 1;
+const size_t kHeaderSize = 32;
+const size_t kEntrySize = 16;
+
+void putLE(uint8_t* p, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint64_t getLE(const uint8_t* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+} // namespace
+
+CompletionJournal::~CompletionJournal() {
+    close();
+}
+
+bool CompletionJournal::create(const std::string& path, uint64_t seed, uint32_t configHash) {
+    close();
+    std::lock_guard<std::mutex> commitLock(m_commitMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+    m_seed = seed;
+    m_configHash = configHash;
+    m_completed.clear();
+    m_pending.clear();
+    m_failed = false;
+    m_error.clear();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        return fail("cannot create " + path);
+    }
+    uint8_t header[kHeaderSize] = {};
+    std::memcpy(header, kMagic, 8);
+    putLE(header + 8, kVersion, 4);
+    putLE(header + 16, seed, 8);
+    putLE(header + 24, configHash, 4);
+    if (std::fwrite(header, 1, kHeaderSize, m_file) != kHeaderSize || !syncFile(m_file)) {
+        return fail("write failed: " + path);
+    }
+    m_lastCommit = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool CompletionJournal::resume(const std::string& path) {
+    close();
+    std::lock_guard<std::mutex> commitLock(m_commitMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+    m_completed.clear();
+    m_pending.clear();
+    m_failed = false;
+    m_error.clear();
+
+    m_file = std::fopen(path.c_str(), "r+b");
+    if (!m_file) {
+        return fail("cannot open " + path);
+    }
+    uint8_t header[kHeaderSize];
+    if (std::fread(header, 1, kHeaderSize, m_file) != kHeaderSize ||
+        std::memcmp(header, kMagic, 8) != 0 || getLE(header + 8, 4) != kVersion) {
+        return fail(path + ": not a completion journal");
+    }
+    m_seed = getLE(header + 16, 8);
+    m_configHash = static_cast<uint32_t>(getLE(header + 24, 4));
+
+    uint8_t entry[kEntrySize];
+    while (std::fread(entry, 1, kEntrySize, m_file) == kEntrySize) {
+        if (crc32(0, entry, 12) != getLE(entry + 12, 4)) {
+            break;
+        }
+        JournalEntry done;
+        done.identity = static_cast<uint32_t>(getLE(entry, 4));
+        done.version = static_cast<uint16_t>(getLE(entry + 4, 2));
+        done.shard = static_cast<uint16_t>(getLE(entry + 6, 2));
+        done.crc = static_cast<uint32_t>(getLE(entry + 8, 4));
+        m_completed.push_back(done);
+    }
+    std::fclose(m_file);
+    m_file = nullptr;
+
+    // Corta o grupo que a queda deixou pela metade e acrescenta depois do último válido
+    std::error_code ec;
+    std::filesystem::resize_file(path, kHeaderSize + m_completed.size() * kEntrySize, ec);
+    if (ec) {
+        return fail("cannot truncate " + path);
+    }
+    m_file = std::fopen(path.c_str(), "r+b");
+    if (!m_file || std::fseek(m_file, 0, SEEK_END) != 0) {
+        return fail("cannot open " + path);
+    }
+    m_lastCommit = std::chrono::steady_clock::now();
+    return true;
+}
+
+void CompletionJournal::setSyncCallback(std::function<bool()> sync) {
+    std::lock_guard<std::mutex> commitLock(m_commitMutex);
+    m_sync = std::move(sync);
+}
+
+bool CompletionJournal::record(const JournalEntry& entry) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_file || m_failed) {
+            return false;
+        }
+        m_pending.push_back(entry);
+        if (m_pending.size() < kCommitEntries &&
+            std::chrono::steady_clock::now() - m_lastCommit < kCommitInterval) {
+            return true;
+        }
+    }
+    // Com um commit em andamento, as entradas esperam o próximo em vez de parar o worker
+    std::unique_lock<std::mutex> commitLock(m_commitMutex, std::try_to_lock);
+    return !commitLock.owns_lock() || commitPending({});
+}
+
+bool CompletionJournal::commit() {
+    std::lock_guard<std::mutex> commitLock(m_commitMutex);
+    return commitPending({});
+}
+
+bool CompletionJournal::commit(const std::vector<JournalEntry>& entries) {
+    std::lock_guard<std::mutex> commitLock(m_commitMutex);
+    return commitPending(entries);
+}
+
+bool CompletionJournal::close() {
+    std::lock_guard<std::mutex> commitLock(m_commitMutex);
+    bool open;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        open = m_file && !m_failed;
+    }
+    if (open) {
+        commitPending({});
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file) {
+        if (std::fclose(m_file) != 0 && !m_failed) {
+            m_failed = true;
+            m_error = "cannot finish " + m_path;
+        }
+        m_file = nullptr;
+    }
+    return !m_failed;
+}
+
+bool CompletionJournal::commitPending(const std::vector<JournalEntry>& entries) {
+    // Só a troca da lista é feita sob m_mutex: a sincronização e a gravação
+    // (o trecho lento) correm fora dele, e record() segue acumulando entradas
+    std::vector<JournalEntry> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_file || m_failed) {
+            return false;
+        }
+        m_pending.insert(m_pending.end(), entries.begin(), entries.end());
+        batch.swap(m_pending);
+        m_lastCommit = std::chrono::steady_clock::now();
+    }
+    if (batch.empty()) {
+        return true;
+    }
+    // Primeiro os dados, depois as entradas que os dão como gravados
+    if (m_sync && !m_sync()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return fail("cannot sync the batch output");
+    }
+
+    std::vector<uint8_t> block(batch.size() * kEntrySize);
+    uint8_t* p = block.data();
+    for (const JournalEntry& entry : batch) {
+        putLE(p, entry.identity, 4);
+        putLE(p + 4, entry.version, 2);
+        putLE(p + 6, entry.shard, 2);
+        putLE(p + 8, entry.crc, 4);
+        putLE(p + 12, crc32(0, p, 12), 4);
+        p += kEntrySize;
+    }
+    // m_file só muda com as duas travas, e esta thread tem m_commitMutex
+    if (std::fwrite(block.data(), 1, block.size(), m_file) != block.size() || !syncFile(m_file)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return fail("write failed: " + m_path);
+    }
+    return true;
+}
+
+bool CompletionJournal::fail(const std::string& message) {
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_failed = true;
+    m_error = message;
+    return false;
+}
+
+FileSyncList::FileSyncList(std::string directory)
+    : m_directory(std::move(directory)) {
+}
+
+void FileSyncList::add(const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_names.push_back(name);
+}
+
+bool FileSyncList::sync() {
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        names.swap(m_names);
+    }
+    if (names.empty()) {
+        return true;
+    }
+    bool ok = true;
+    for (const std::string& name : names) {
+        const std::string path = m_directory + "/" + name;
+#ifdef _WIN32
+        const int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+        ok = fd >= 0 && _commit(fd) == 0 && ok;
+        if (fd >= 0) {
+            _close(fd);
+        }
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        ok = fd >= 0 && fsync(fd) == 0 && ok;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+#endif
+    }
+#ifndef _WIN32
+    // Os nomes novos moram no diretório
+    const int fd = ::open(m_directory.c_str(), O_RDONLY);
+    ok = fd >= 0 && fsync(fd) == 0 && ok;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+#endif
+    return ok;
+}
+
+} // namespace Raster
+} // namespace SFinGe
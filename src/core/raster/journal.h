@@ -0,0 +1,148 @@
+#ifndef RASTER_JOURNAL_H
+#define RASTER_JOURNAL_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Uma imagem do lote que já está no disco
+ */
+struct JournalEntry {
+    uint32_t identity = 0;  // Índice absoluto da identidade
+    uint16_t version = 0;
+    uint16_t shard = 0;     // 1 + índice do shard que guarda a imagem; 0 fora de shards
+    uint32_t crc = 0;       // CRC-32 dos bytes gravados (PNG, WSQ ou slot do NPY)
+};
+
+/**
+ * @brief Diário de conclusão de um lote, para retomá-lo depois de uma queda
+ *
+ * Formato (inteiros little-endian):
+ *   cabeçalho  "SFJOURNL", versão u32, reservado u32, semente mestre u64,
+ *              hash da configuração u32, reservado u32
+ *   entradas   identidade u32, versão u16, shard u16, CRC dos dados u32,
+ *              CRC-32 dos 12 bytes anteriores u32
+ *
+ * record() só acumula a entrada; a cada kCommitEntries entradas ou
+ * kCommitInterval, o commit chama o callback de sincronização (que leva ao
+ * disco as imagens e o manifesto gravados até ali), grava as entradas
+ * pendentes e faz um único fsync do diário. Uma entrada no arquivo implica
+ * dados duráveis; uma queda perde no máximo o último grupo, que é refeito.
+ *
+ * record() e commit() são thread-safe. O commit tira as entradas pendentes
+ * da fila e sincroniza fora da trava de record(): os workers não esperam o
+ * disco. Se um commit já está em andamento, record() não espera por ele.
+ */
+class CompletionJournal {
+public:
+    static constexpr size_t kCommitEntries = 256;
+    static constexpr std::chrono::milliseconds kCommitInterval{1000};
+
+    CompletionJournal() = default;
+    ~CompletionJournal();
+
+    CompletionJournal(const CompletionJournal&) = delete;
+    CompletionJournal& operator=(const CompletionJournal&) = delete;
+
+    /**
+     * @brief Cria (ou trunca) o diário de um lote novo
+     */
+    bool create(const std::string& path, uint64_t seed, uint32_t configHash);
+
+    /**
+     * @brief Lê um diário existente e o reabre para acréscimo
+     *
+     * Uma entrada final incompleta ou corrompida (queda no meio da gravação)
+     * é descartada junto com o que vier depois dela.
+     */
+    bool resume(const std::string& path);
+
+    uint64_t seed() const { return m_seed; }
+    uint32_t configHash() const { return m_configHash; }
+
+    /**
+     * @brief Entradas lidas por resume()
+     */
+    const std::vector<JournalEntry>& completed() const { return m_completed; }
+
+    /**
+     * @brief Chamado antes de cada commit; false falha o diário
+     */
+    void setSyncCallback(std::function<bool()> sync);
+
+    bool record(const JournalEntry& entry);
+
+    /**
+     * @brief Grava as entradas pendentes agora
+     */
+    bool commit();
+
+    /**
+     * @brief Acrescenta um grupo de entradas e as grava no mesmo commit
+     *
+     * Para dados que ficam duráveis juntos (um shard selado): o grupo entra
+     * inteiro no diário, sem ser partido por um commit por tempo.
+     */
+    bool commit(const std::vector<JournalEntry>& entries);
+
+    /**
+     * @brief commit() final e fechamento (idempotente)
+     */
+    bool close();
+
+    const std::string& error() const { return m_error; }
+
+private:
+    bool commitPending(const std::vector<JournalEntry>& entries);  // Com m_commitMutex
+    bool fail(const std::string& message);                         // Com m_mutex
+
+    std::mutex m_commitMutex;  // Um commit por vez, na ordem das entradas; antes de m_mutex
+    std::mutex m_mutex;        // Entradas pendentes e estado
+    std::FILE* m_file = nullptr;
+    std::string m_path;
+    uint64_t m_seed = 0;
+    uint32_t m_configHash = 0;
+    std::vector<JournalEntry> m_completed;
+    std::vector<JournalEntry> m_pending;
+    std::chrono::steady_clock::time_point m_lastCommit;
+    std::function<bool()> m_sync;
+    bool m_failed = false;
+    std::string m_error;
+};
+
+/**
+ * @brief Arquivos de um diretório gravados desde o último commit do diário
+ *
+ * As threads de gravação chamam add() depois de fechar cada arquivo; sync(),
+ * no callback do diário, faz fsync só desses arquivos e depois do diretório
+ * (os nomes novos), em vez de sincronizar o sistema de arquivos inteiro.
+ * Thread-safe; no Windows o diretório fica de fora.
+ */
+class FileSyncList {
+public:
+    explicit FileSyncList(std::string directory);
+
+    FileSyncList(const FileSyncList&) = delete;
+    FileSyncList& operator=(const FileSyncList&) = delete;
+
+    void add(const std::string& name);  // Nome relativo ao diretório
+    bool sync();
+
+private:
+    std::string m_directory;
+    std::mutex m_mutex;
+    std::vector<std::string> m_names;
+};
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_JOURNAL_H
@@ -0,0 +1,712 @@
+#include "manifest.h"
+#include "checksum.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+const char kMagic[8] = {'S', 'F', 'M', 'A', 'N', 'I', 'F', '\0'};
+const uint32_t kVersion = 1;
+const size_t kHeaderSize = 16;
+const uint8_t kSchemaKind = 0;
+const size_t kWriteBuffer = 1 << 20;
+const uint64_t kMaxRecordBytes = 64ull << 20;  // Bem acima de qualquer registro; barra um tamanho corrompido
+
+void putU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void putU64(std::vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void putReal(std::vector<uint8_t>& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU64(out, bits);
+}
+
+// Nomes do esquema têm tamanho u8
+void putName(std::vector<uint8_t>& out, const std::string& name) {
+    const size_t length = std::min<size_t>(name.size(), 255);
+    out.push_back(static_cast<uint8_t>(length));
+    out.insert(out.end(), name.begin(), name.begin() + length);
+}
+
+uint64_t getLE(const uint8_t* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+double getReal(const uint8_t* p) {
+    const uint64_t bits = getLE(p, 8);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+void appendJsonString(std::string& out, const std::string& text) {
+    out += '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+// Menor representação que volta ao mesmo double; JSON não tem NaN nem infinito
+void appendJsonReal(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+    char text[32];
+    const std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+    out.append(text, result.ptr);
+}
+
+// Lê um nome u8 do esquema; false se passar do fim
+bool readName(const std::vector<uint8_t>& payload, size_t& pos, std::string& name) {
+    if (pos >= payload.size() || pos + 1 + payload[pos] > payload.size()) {
+        return false;
+    }
+    const size_t length = payload[pos];
+    name.assign(reinterpret_cast<const char*>(&payload[pos + 1]), length);
+    pos += 1 + length;
+    return true;
+}
+
+} // namespace
+
+void ManifestRecord::clear() {
+    m_fields.clear();
+    m_values.clear();
+}
+
+void ManifestRecord::addUInt(const char* name, uint64_t value) {
+    m_fields.push_back({name, ManifestType::UInt, {}});
+    putU64(m_values, value);
+}
+
+void ManifestRecord::addInt(const char* name, int64_t value) {
+    m_fields.push_back({name, ManifestType::Int, {}});
+    putU64(m_values, static_cast<uint64_t>(value));
+}
+
+void ManifestRecord::addReal(const char* name, double value) {
+    m_fields.push_back({name, ManifestType::Real, {}});
+    putReal(m_values, value);
+}
+
+void ManifestRecord::addBool(const char* name, bool value) {
+    m_fields.push_back({name, ManifestType::Bool, {}});
+    m_values.push_back(value ? 1 : 0);
+}
+
+void ManifestRecord::addText(const char* name, const std::string& value) {
+    m_fields.push_back({name, ManifestType::Text, {}});
+    putU32(m_values, static_cast<uint32_t>(value.size()));
+    m_values.insert(m_values.end(), value.begin(), value.end());
+}
+
+void ManifestRecord::addTuples(const char* name, std::initializer_list<const char*> members,
+                               const std::vector<double>& values) {
+    m_fields.push_back({name, ManifestType::Tuples, std::vector<const char*>(members)});
+    const size_t arity = members.size() > 0 ? members.size() : 1;
+    const size_t count = values.size() / arity;
+    putU32(m_values, static_cast<uint32_t>(count));
+    for (size_t i = 0; i < count * arity; ++i) {
+        putReal(m_values, values[i]);
+    }
+}
+
+ManifestWriter::~ManifestWriter() {
+    close();
+}
+
+bool ManifestWriter::create(const std::string& path) {
+    close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+    m_schemas.clear();
+    m_records = 0;
+    m_failed = false;
+    m_error.clear();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        return fail("cannot create " + path);
+    }
+    m_buffer.resize(kWriteBuffer);
+    std::setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size());
+
+    std::vector<uint8_t> header(kMagic, kMagic + 8);
+    putU32(header, kVersion);
+    putU32(header, 0);
+    if (std::fwrite(header.data(), 1, header.size(), m_file) != header.size()) {
+        return fail("write failed: " + path);
+    }
+    return true;
+}
+
+bool ManifestWriter::reopen(const std::string& path) {
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return create(path);
+    }
+
+    uint64_t validBytes = 0;
+    {
+        ManifestReader reader;
+        if (!reader.open(path)) {
+            // Queda antes de o cabeçalho chegar ao disco: recomeça o arquivo
+            if (std::filesystem::file_size(path, ec) < kHeaderSize && !ec) {
+                return create(path);
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return fail(reader.error());
+        }
+        while (reader.next()) {
+        }
+        validBytes = reader.validBytes();
+    }
+
+    close();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+    m_schemas.clear();
+    m_records = 0;
+    m_failed = false;
+    m_error.clear();
+
+    std::filesystem::resize_file(path, validBytes, ec);
+    if (ec) {
+        return fail("cannot truncate " + path);
+    }
+    m_file = std::fopen(path.c_str(), "r+b");
+    if (!m_file || std::fseek(m_file, 0, SEEK_END) != 0) {
+        return fail("cannot open " + path);
+    }
+    m_buffer.resize(kWriteBuffer);
+    std::setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size());
+    return true;
+}
+
+bool ManifestWriter::append(const std::string& recordName, const ManifestRecord& record) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file || m_failed) {
+        return false;
+    }
+
+    auto it = m_schemas.find(recordName);
+    if (it == m_schemas.end()) {
+        // Tipo novo: o esquema sai do próprio registro e é gravado antes dele
+        if (m_schemas.size() >= 255 || record.m_fields.size() > 0xFFFF) {
+            return fail("too many record types or fields");
+        }
+        Schema schema;
+        schema.kind = static_cast<uint8_t>(m_schemas.size() + 1);
+        std::vector<uint8_t> payload;
+        payload.push_back(schema.kind);
+        putName(payload, recordName);
+        putU16(payload, static_cast<uint16_t>(record.m_fields.size()));
+        for (const ManifestRecord::Field& field : record.m_fields) {
+            if (field.type == ManifestType::Tuples && (field.members.empty() || field.members.size() > 255)) {
+                return fail("record \"" + recordName + "\": tuples need 1 to 255 members");
+            }
+            payload.push_back(static_cast<uint8_t>(field.type));
+            putName(payload, field.name);
+            if (field.type == ManifestType::Tuples) {
+                payload.push_back(static_cast<uint8_t>(field.members.size()));
+                for (const char* member : field.members) {
+                    putName(payload, member);
+                }
+            }
+            schema.types.push_back(field.type);
+            schema.arities.push_back(field.members.size());
+        }
+        if (!writeRecord(kSchemaKind, payload)) {
+            return false;
+        }
+        it = m_schemas.emplace(recordName, std::move(schema)).first;
+    }
+
+    const Schema& schema = it->second;
+    bool matches = schema.types.size() == record.m_fields.size();
+    for (size_t i = 0; matches && i < schema.types.size(); ++i) {
+        matches = schema.types[i] == record.m_fields[i].type &&
+                  schema.arities[i] == record.m_fields[i].members.size();
+    }
+    if (!matches) {
+        return fail("record \"" + recordName + "\" does not match its schema");
+    }
+
+    if (!writeRecord(schema.kind, record.m_values)) {
+        return false;
+    }
+    ++m_records;
+    return true;
+}
+
+bool ManifestWriter::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file) {
+        bool ok = syncFile(m_file);
+        ok = (std::fclose(m_file) == 0) && ok;
+        m_file = nullptr;
+        if (!ok && !m_failed) {
+            m_failed = true;
+            m_error = "cannot finish " + m_path;
+        }
+    }
+    return !m_failed;
+}
+
+bool ManifestWriter::sync() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file || m_failed) {
+        return false;
+    }
+    return syncFile(m_file) ? true : fail("cannot sync " + m_path);
+}
+
+uint64_t ManifestWriter::recordCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_records;
+}
+
+bool ManifestWriter::writeRecord(uint8_t kind, const std::vector<uint8_t>& payload) {
+    if (payload.size() > kMaxRecordBytes) {
+        return fail("record larger than " + std::to_string(kMaxRecordBytes >> 20) + " MiB");
+    }
+    std::vector<uint8_t> frame;
+    frame.push_back(kind);
+    putU32(frame, static_cast<uint32_t>(payload.size()));
+    std::vector<uint8_t> trailer;
+    putU32(trailer, crc32(0, payload.data(), payload.size()));
+
+    const bool ok = std::fwrite(frame.data(), 1, frame.size(), m_file) == frame.size() &&
+                    (payload.empty() || std::fwrite(payload.data(), 1, payload.size(), m_file) == payload.size()) &&
+                    std::fwrite(trailer.data(), 1, trailer.size(), m_file) == trailer.size();
+    return ok ? true : fail("write failed: " + m_path);
+}
+
+bool ManifestWriter::fail(const std::string& message) {
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_failed = true;
+    m_error = message;
+    return false;
+}
+
+ManifestReader::~ManifestReader() {
+    close();
+}
+
+void ManifestReader::close() {
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_schemas.clear();
+    m_current = nullptr;
+}
+
+bool ManifestReader::open(const std::string& path) {
+    close();
+    m_error.clear();
+    m_path = path;
+    m_records = 0;
+    m_validBytes = 0;
+
+    m_file = std::fopen(path.c_str(), "rb");
+    if (!m_file) {
+        return fail("cannot open " + path);
+    }
+    uint8_t header[kHeaderSize];
+    if (std::fread(header, 1, kHeaderSize, m_file) != kHeaderSize ||
+        std::memcmp(header, kMagic, 8) != 0 || getLE(header + 8, 4) != kVersion) {
+        return fail(path + ": not a manifest");
+    }
+    m_validBytes = kHeaderSize;
+    std::error_code ec;
+    m_fileSize = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return fail("cannot open " + path);
+    }
+    return true;
+}
+
+bool ManifestReader::next() {
+    m_current = nullptr;
+    while (m_file) {
+        uint8_t frame[5];
+        const size_t got = std::fread(frame, 1, sizeof(frame), m_file);
+        if (got == 0 && std::feof(m_file)) {
+            return false;
+        }
+        const std::string where = m_path + ": record " + std::to_string(m_records + 1);
+        if (got != sizeof(frame)) {
+            return fail(where + " truncated (interrupted batch?)");
+        }
+
+        // O tamanho vem do arquivo e ainda não passou pelo CRC: uma cauda rasgada ou lixo
+        // é tratada como fim truncado em m_validBytes, sem alocar o que ela pede
+        const uint64_t length = getLE(frame + 1, 4);
+        const uint64_t left = m_fileSize - std::min<uint64_t>(m_fileSize, m_validBytes + sizeof(frame));
+        if (length > kMaxRecordBytes || length + 4 > left) {
+            return fail(where + " truncated (interrupted batch?)");
+        }
+        m_payload.resize(static_cast<size_t>(length));
+        uint8_t trailer[4];
+        if ((!m_payload.empty() && std::fread(m_payload.data(), 1, m_payload.size(), m_file) != m_payload.size()) ||
+            std::fread(trailer, 1, sizeof(trailer), m_file) != sizeof(trailer)) {
+            return fail(where + " truncated (interrupted batch?)");
+        }
+        if (crc32(0, m_payload.data(), m_payload.size()) != getLE(trailer, 4)) {
+            return fail(where + ": CRC mismatch");
+        }
+
+        if (frame[0] == kSchemaKind) {
+            if (!readSchema(m_payload)) {
+                return fail(where + ": invalid schema");
+            }
+            m_validBytes += sizeof(frame) + m_payload.size() + sizeof(trailer);
+            continue;
+        }
+        auto it = m_schemas.find(frame[0]);
+        if (it == m_schemas.end() || !validate(it->second, m_payload)) {
+            return fail(where + ": does not match its schema");
+        }
+        m_validBytes += sizeof(frame) + m_payload.size() + sizeof(trailer);
+        ++m_records;
+        m_current = &it->second;
+        return true;
+    }
+    return false;
+}
+
+const std::string& ManifestReader::recordName() const {
+    static const std::string kNone;
+    return m_current ? m_current->name : kNone;
+}
+
+bool ManifestReader::readSchema(const std::vector<uint8_t>& payload) {
+    Schema schema;
+    size_t pos = 1;
+    if (payload.empty() || payload[0] == kSchemaKind || !readName(payload, pos, schema.name) ||
+        pos + 2 > payload.size()) {
+        return false;
+    }
+    const size_t count = static_cast<size_t>(getLE(&payload[pos], 2));
+    pos += 2;
+    for (size_t i = 0; i < count; ++i) {
+        if (pos >= payload.size()) {
+            return false;
+        }
+        const uint8_t type = payload[pos++];
+        std::string name;
+        if (type < static_cast<uint8_t>(ManifestType::UInt) || type > static_cast<uint8_t>(ManifestType::Tuples) ||
+            !readName(payload, pos, name)) {
+            return false;
+        }
+        std::vector<std::string> members;
+        if (type == static_cast<uint8_t>(ManifestType::Tuples)) {
+            if (pos >= payload.size() || payload[pos] == 0) {
+                return false;
+            }
+            const size_t arity = payload[pos++];
+            members.resize(arity);
+            for (std::string& member : members) {
+                if (!readName(payload, pos, member)) {
+                    return false;
+                }
+            }
+        }
+        schema.types.push_back(static_cast<ManifestType>(type));
+        schema.names.push_back(std::move(name));
+        schema.members.push_back(std::move(members));
+    }
+    if (pos != payload.size()) {
+        return false;
+    }
+    m_schemas[payload[0]] = std::move(schema);
+    return true;
+}
+
+// Confere que os valores ocupam exatamente o registro: toJson() lê sem checar limites
+bool ManifestReader::validate(const Schema& schema, const std::vector<uint8_t>& payload) const {
+    size_t pos = 0;
+    for (size_t i = 0; i < schema.types.size(); ++i) {
+        uint64_t size = 0;
+        switch (schema.types[i]) {
+            case ManifestType::UInt:
+            case ManifestType::Int:
+            case ManifestType::Real:
+                size = 8;
+                break;
+            case ManifestType::Bool:
+                size = 1;
+                break;
+            case ManifestType::Text:
+            case ManifestType::Tuples:
+                if (pos + 4 > payload.size()) {
+                    return false;
+                }
+                size = getLE(&payload[pos], 4);
+                if (schema.types[i] == ManifestType::Tuples) {
+                    size *= 8 * schema.members[i].size();
+                }
+                size += 4;
+                break;
+        }
+        if (size > payload.size() - pos) {
+            return false;
+        }
+        pos += static_cast<size_t>(size);
+    }
+    return pos == payload.size();
+}
+
+std::string ManifestReader::toJson() const {
+    if (!m_current) {
+        return std::string();
+    }
+    const Schema& schema = *m_current;
+    const uint8_t* p = m_payload.data();
+
+    std::string json = "{\"record\":";
+    appendJsonString(json, schema.name);
+    for (size_t i = 0; i < schema.types.size(); ++i) {
+        json += ',';
+        appendJsonString(json, schema.names[i]);
+        json += ':';
+        switch (schema.types[i]) {
+            case ManifestType::UInt:
+                json += std::to_string(getLE(p, 8));
+                p += 8;
+                break;
+            case ManifestType::Int:
+                json += std::to_string(static_cast<int64_t>(getLE(p, 8)));
+                p += 8;
+                break;
+            case ManifestType::Real:
+                appendJsonReal(json, getReal(p));
+                p += 8;
+                break;
+            case ManifestType::Bool:
+                json += *p ? "true" : "false";
+                p += 1;
+                break;
+            case ManifestType::Text: {
+                const size_t length = static_cast<size_t>(getLE(p, 4));
+                appendJsonString(json, std::string(reinterpret_cast<const char*>(p + 4), length));
+                p += 4 + length;
+                break;
+            }
+            case ManifestType::Tuples: {
+                const std::vector<std::string>& members = schema.members[i];
+                const size_t count = static_cast<size_t>(getLE(p, 4));
+                p += 4;
+                json += '[';
+                for (size_t t = 0; t < count; ++t) {
+                    json += t ? ",{" : "{";
+                    for (size_t m = 0; m < members.size(); ++m) {
+                        if (m) {
+                            json += ',';
+                        }
+                        appendJsonString(json, members[m]);
+                        json += ':';
+                        appendJsonReal(json, getReal(p));
+                        p += 8;
+                    }
+                    json += '}';
+                }
+                json += ']';
+                break;
+            }
+        }
+    }
+    json += '}';
+    return json;
+}
+
+// Valores do campo chamado name no registro atual, ou nullptr
+const uint8_t* ManifestReader::field(const std::string& name, ManifestType& type) const {
+    if (!m_current) {
+        return nullptr;
+    }
+    const Schema& schema = *m_current;
+    const uint8_t* p = m_payload.data();
+    for (size_t i = 0; i < schema.types.size(); ++i) {
+        if (schema.names[i] == name) {
+            type = schema.types[i];
+            return p;
+        }
+        switch (schema.types[i]) {
+            case ManifestType::UInt:
+            case ManifestType::Int:
+            case ManifestType::Real:
+                p += 8;
+                break;
+            case ManifestType::Bool:
+                p += 1;
+                break;
+            case ManifestType::Text:
+                p += 4 + static_cast<size_t>(getLE(p, 4));
+                break;
+            case ManifestType::Tuples:
+                p += 4 + static_cast<size_t>(getLE(p, 4)) * schema.members[i].size() * 8;
+                break;
+        }
+    }
+    return nullptr;
+}
+
+bool ManifestReader::integer(const std::string& name, int64_t& value) const {
+    ManifestType type;
+    const uint8_t* p = field(name, type);
+    if (!p || (type != ManifestType::Int && type != ManifestType::UInt && type != ManifestType::Bool)) {
+        return false;
+    }
+    value = type == ManifestType::Bool ? static_cast<int64_t>(*p) : static_cast<int64_t>(getLE(p, 8));
+    return true;
+}
+
+bool ManifestReader::real(const std::string& name, double& value) const {
+    ManifestType type;
+    const uint8_t* p = field(name, type);
+    if (!p || type != ManifestType::Real) {
+        return false;
+    }
+    value = getReal(p);
+    return true;
+}
+
+bool ManifestReader::text(const std::string& name, std::string& value) const {
+    ManifestType type;
+    const uint8_t* p = field(name, type);
+    if (!p || type != ManifestType::Text) {
+        return false;
+    }
+    value.assign(reinterpret_cast<const char*>(p + 4), static_cast<size_t>(getLE(p, 4)));
+    return true;
+}
+
+void ManifestReader::copyTo(ManifestRecord& record) const {
+    record.clear();
+    if (!m_current) {
+        return;
+    }
+    const Schema& schema = *m_current;
+    for (size_t i = 0; i < schema.types.size(); ++i) {
+        ManifestRecord::Field field{schema.names[i].c_str(), schema.types[i], {}};
+        for (const std::string& member : schema.members[i]) {
+            field.members.push_back(member.c_str());
+        }
+        record.m_fields.push_back(std::move(field));
+    }
+    record.m_values = m_payload;
+}
+
+bool ManifestReader::fail(const std::string& message) {
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_current = nullptr;
+    m_error = message;
+    return false;
+}
+
+int runManifestTool(const std::vector<std::string>& args) {
+    const std::string command = args.empty() ? std::string() : args[0];
+
+    if (command == "jsonl" && (args.size() == 2 || args.size() == 3)) {
+        ManifestReader reader;
+        if (!reader.open(args[1])) {
+            std::cerr << reader.error() << "\n";
+            return 1;
+        }
+        std::ofstream file;
+        if (args.size() == 3) {
+            file.open(args[2], std::ios::binary);
+            if (!file) {
+                std::cerr << "cannot create " << args[2] << "\n";
+                return 1;
+            }
+        }
+        std::ostream& out = args.size() == 3 ? static_cast<std::ostream&>(file) : std::cout;
+
+        uint64_t count = 0;
+        while (reader.next()) {
+            out << reader.toJson() << '\n';
+            ++count;
+        }
+        out.flush();
+        // Os registros completos já saíram; o erro (cauda truncada) vai no código de saída
+        if (!reader.error().empty()) {
+            std::cerr << reader.error() << "\n";
+        }
+        if (!out) {
+            std::cerr << "write failed\n";
+            return 1;
+        }
+        std::cerr << args[1] << ": " << count << " records\n";
+        return reader.error().empty() ? 0 : 1;
+    }
+
+    std::cerr << "Usage:\n"
+              << "  manifest jsonl <file.manifest> [out.jsonl]   One JSON object per record (stdout by default)\n";
+    return 2;
+}
+
+} // namespace Raster
+} // namespace SFinGe
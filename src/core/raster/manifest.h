@@ -0,0 +1,230 @@
+#ifndef RASTER_MANIFEST_H
+#define RASTER_MANIFEST_H
+
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Tipos dos campos de um registro do manifesto
+ */
+enum class ManifestType : uint8_t {
+    UInt = 1,    // u64
+    Int = 2,     // i64
+    Real = 3,    // f64
+    Bool = 4,    // u8
+    Text = 5,    // tamanho u32 e bytes UTF-8
+    Tuples = 6   // contagem u32 e contagem x aridade f64 (pontos, minúcias)
+};
+
+/**
+ * @brief Valores de um registro, montados fora da trava do writer
+ *
+ * Os nomes (de campos e de componentes) são guardados como ponteiros e
+ * devem ser literais. O primeiro registro de cada tipo define o esquema;
+ * os seguintes precisam trazer os mesmos campos na mesma ordem.
+ */
+class ManifestRecord {
+public:
+    void clear();
+
+    void addUInt(const char* name, uint64_t value);
+    void addInt(const char* name, int64_t value);
+    void addReal(const char* name, double value);
+    void addBool(const char* name, bool value);
+    void addText(const char* name, const std::string& value);
+
+    /**
+     * @brief Lista de tuplas de reais com componentes nomeados
+     *
+     * @param values values.size() / members.size() tuplas, componentes contíguos
+     */
+    void addTuples(const char* name, std::initializer_list<const char*> members, const std::vector<double>& values);
+
+private:
+    friend class ManifestWriter;
+    friend class ManifestReader;
+
+    struct Field {
+        const char* name;
+        ManifestType type;
+        std::vector<const char*> members;  // Só em Tuples
+    };
+
+    std::vector<Field> m_fields;
+    std::vector<uint8_t> m_values;
+};
+
+/**
+ * @brief Fluxo binário de registros, só de acréscimo (verdade de campo do lote)
+ *
+ * Formato (inteiros little-endian):
+ *   cabeçalho  "SFMANIF\0", versão u32, reservado u32
+ *   registros  tipo u8, tamanho u32, conteúdo, CRC-32 do conteúdo u32
+ *
+ * O tipo 0 é um esquema: tipo descrito u8, nome, número de campos u16 e, por
+ * campo, ManifestType u8, nome e (em Tuples) os nomes dos componentes; nomes
+ * com tamanho u8. Os demais registros trazem só os valores, na ordem do
+ * esquema, e o esquema é gravado antes do primeiro registro do seu tipo.
+ *
+ * Não há índice nem rodapé: um lote interrompido deixa um manifesto válido
+ * até o último registro completo. append() é thread-safe e passa por um
+ * buffer grande, então cada registro custa uma cópia e não uma gravação.
+ */
+class ManifestWriter {
+public:
+    ManifestWriter() = default;
+    ~ManifestWriter();
+
+    ManifestWriter(const ManifestWriter&) = delete;
+    ManifestWriter& operator=(const ManifestWriter&) = delete;
+
+    bool create(const std::string& path);
+
+    /**
+     * @brief Continua um manifesto existente (lote retomado)
+     *
+     * Descarta um último registro incompleto e acrescenta depois do último
+     * válido; os esquemas são gravados de novo antes do primeiro registro de
+     * cada tipo. Sem arquivo, equivale a create().
+     */
+    bool reopen(const std::string& path);
+
+    /**
+     * @brief Acrescenta um registro do tipo chamado recordName ("identity", "version"...)
+     */
+    bool append(const std::string& recordName, const ManifestRecord& record);
+
+    /**
+     * @brief Leva ao disco os registros acrescentados até aqui
+     */
+    bool sync();
+
+    /**
+     * @brief Descarrega o buffer, sincroniza e fecha (idempotente)
+     */
+    bool close();
+
+    uint64_t recordCount() const;
+    const std::string& error() const { return m_error; }
+
+private:
+    struct Schema {
+        uint8_t kind;
+        std::vector<ManifestType> types;
+        std::vector<size_t> arities;
+    };
+
+    bool writeRecord(uint8_t kind, const std::vector<uint8_t>& payload);
+    bool fail(const std::string& message);
+
+    mutable std::mutex m_mutex;
+    std::FILE* m_file = nullptr;
+    std::string m_path;
+    std::vector<char> m_buffer;
+    std::unordered_map<std::string, Schema> m_schemas;
+    uint64_t m_records = 0;
+    bool m_failed = false;
+    std::string m_error;
+};
+
+/**
+ * @brief Leitura sequencial de um manifesto
+ */
+class ManifestReader {
+public:
+    ManifestReader() = default;
+    ~ManifestReader();
+
+    ManifestReader(const ManifestReader&) = delete;
+    ManifestReader& operator=(const ManifestReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    /**
+     * @brief Avança para o próximo registro de dados (esquemas são consumidos aqui)
+     *
+     * @return false no fim do arquivo ou em erro; error() só é preenchido no erro,
+     *         inclusive num último registro incompleto (lote interrompido)
+     */
+    bool next();
+
+    const std::string& recordName() const;
+
+    /**
+     * @brief Registro atual como um objeto JSON de uma linha, sem o '\n'
+     *
+     * A primeira chave é "record" (o nome do tipo); reais saem na menor forma
+     * que volta ao mesmo double, e os componentes de Tuples viram objetos.
+     */
+    std::string toJson() const;
+
+    /**
+     * @brief Campo inteiro do registro atual (Int, UInt ou Bool; UInt volta com os mesmos bits)
+     *
+     * @return false se o registro não tem um campo inteiro com esse nome
+     */
+    bool integer(const std::string& name, int64_t& value) const;
+    bool real(const std::string& name, double& value) const;
+    bool text(const std::string& name, std::string& value) const;
+
+    /**
+     * @brief Copia o registro atual para regravá-lo com outro ManifestWriter
+     *
+     * Os nomes apontam para os esquemas deste leitor: valem até o próximo open() ou close().
+     */
+    void copyTo(ManifestRecord& record) const;
+
+    /**
+     * @brief Bytes do cabeçalho e dos registros completos lidos até aqui
+     */
+    uint64_t validBytes() const { return m_validBytes; }
+
+    const std::string& error() const { return m_error; }
+
+private:
+    struct Schema {
+        std::string name;
+        std::vector<ManifestType> types;
+        std::vector<std::string> names;
+        std::vector<std::vector<std::string>> members;
+    };
+
+    const uint8_t* field(const std::string& name, ManifestType& type) const;
+    bool readSchema(const std::vector<uint8_t>& payload);
+    bool validate(const Schema& schema, const std::vector<uint8_t>& payload) const;
+    bool fail(const std::string& message);
+
+    std::FILE* m_file = nullptr;
+    std::string m_path;
+    std::unordered_map<uint8_t, Schema> m_schemas;
+    const Schema* m_current = nullptr;
+    std::vector<uint8_t> m_payload;
+    uint64_t m_records = 0;
+    uint64_t m_validBytes = 0;
+    uint64_t m_fileSize = 0;  // Em open(): limita o tamanho que um registro pode declarar
+    std::string m_error;
+};
+
+/**
+ * @brief Subcomando "manifest" das linhas de comando
+ *
+ *   manifest jsonl <arquivo.manifest> [saída.jsonl]
+ *
+ * @param args Argumentos após "manifest"
+ * @return Código de saída do processo
+ */
+int runManifestTool(const std::vector<std::string>& args);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_MANIFEST_H
@@ -0,0 +1,121 @@
+#include "memory_budget.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+uint64_t privateRss() {
+#ifdef __linux__
+    // statm: tamanho, residente, residente compartilhado (arquivos e shm), ... em páginas
+    std::FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    unsigned long long size = 0, resident = 0, shared = 0;
+    const int fields = std::fscanf(file, "%llu %llu %llu", &size, &resident, &shared);
+    std::fclose(file);
+    if (fields != 3 || shared > resident) {
+        return 0;
+    }
+    return static_cast<uint64_t>(resident - shared) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+uint64_t peakRss() {
+#if defined(__linux__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);  // Bytes
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // KiB
+#endif
+#else
+    return 0;
+#endif
+}
+
+void returnLargeBlocks() {
+#ifdef __GLIBC__
+    mallopt(M_MMAP_THRESHOLD, 1 << 20);  // Fixo: também desliga o ajuste dinâmico
+#endif
+}
+
+MemoryPlan planMemory(const MemoryModel& model, uint64_t budget, int workers, bool fixedWorkers) {
+    MemoryPlan plan;
+    plan.workers = std::max(1, workers);
+    const uint64_t perIdentity = std::max<uint64_t>(1, model.perIdentity);
+    for (;;) {
+        const uint64_t fixed = model.estimate(plan.workers, 0);
+        if (budget >= fixed + perIdentity) {
+            plan.identities = static_cast<int>(std::min<uint64_t>((budget - fixed) / perIdentity, plan.workers));
+            break;
+        }
+        if (fixedWorkers || plan.workers == 1) {
+            plan.identities = 1;
+            plan.fits = false;
+            break;
+        }
+        --plan.workers;
+    }
+    plan.estimate = model.estimate(plan.workers, plan.identities);
+    return plan;
+}
+
+MemoryMonitor::MemoryMonitor(uint64_t budget, int identities)
+    : m_budget(budget), m_limit(std::max(1, identities)) {
+    m_peak = privateRss();
+    m_thread = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_wake.wait_for(lock, std::chrono::milliseconds(20), [this]() { return m_stopping; })) {
+            sample();
+        }
+    });
+}
+
+MemoryMonitor::~MemoryMonitor() {
+    stop();
+}
+
+void MemoryMonitor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            return;
+        }
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+    sample();
+}
+
+void MemoryMonitor::sample() {
+    const uint64_t rss = privateRss();
+    if (rss > m_peak.load()) {
+        m_peak = rss;
+    }
+    // Um corte por identidade concluída: a memória das que já estão em voo só sai quando elas terminam
+    if (rss > m_budget && m_limit.load() > 1 && m_finished.exchange(false)) {
+        --m_limit;
+        ++m_cuts;
+    }
+}
+
+} // namespace Raster
+} // namespace SFinGe
@@ -0,0 +1,111 @@
+#ifndef RASTER_MEMORY_BUDGET_H
+#define RASTER_MEMORY_BUDGET_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Memória residente privada do processo agora, em bytes
+ *
+ * Só as páginas anônimas (heap e pilhas dos workers). Os mapeamentos de
+ * arquivo e de memória compartilhada ficam de fora: o tensor NPY e o anel shm
+ * são a saída do lote, não o trabalho do gerador. 0 se o sistema não informa.
+ */
+uint64_t privateRss();
+
+/**
+ * @brief Pico de memória residente do processo inteiro até agora, em bytes (0 se o sistema não informa)
+ */
+uint64_t peakRss();
+
+/**
+ * @brief Faz o alocador devolver ao sistema os blocos grandes assim que são liberados
+ *
+ * A glibc sobe o limiar de mmap a cada bloco grande liberado, e daí em diante
+ * os mapas de uma identidade saem da arena da thread, que os guarda depois do
+ * free: a memória residente iria para workers vezes o pico de uma identidade,
+ * qualquer que fosse o limite de identidades em voo. Com um limiar fixo, cada
+ * mapa é um mmap próprio. Sem efeito fora da glibc.
+ */
+void returnLargeBlocks();
+
+/**
+ * @brief Quanto um lote ocupa em função do que está em voo
+ */
+struct MemoryModel {
+    uint64_t baseline = 0;     // Já ocupado antes do lote (código, tabelas, caches)
+    uint64_t perIdentity = 0;  // Uma identidade gerando a imagem base: mapas, buffers do estágio de cristas, a base
+    uint64_t perWorker = 0;    // Uma versão sendo renderizada e as imagens dela na fila de gravação
+
+    uint64_t estimate(int workers, int identities) const {
+        return baseline + static_cast<uint64_t>(workers) * perWorker + static_cast<uint64_t>(identities) * perIdentity;
+    }
+};
+
+/**
+ * @brief Paralelismo escolhido para um orçamento
+ */
+struct MemoryPlan {
+    int workers = 1;
+    int identities = 1;  // Identidades em voo ao mesmo tempo (admitidas e com versões por terminar)
+    uint64_t estimate = 0;
+    bool fits = true;    // false: nem um worker com uma identidade cabe; o lote segue assim mesmo
+};
+
+/**
+ * @brief Maior paralelismo cujo pico estimado cabe em budget
+ *
+ * Mantém os workers e limita as identidades em voo, que são o grosso da
+ * memória; os workers só diminuem (se fixedWorkers não os prende) quando nem
+ * uma identidade cabe com todos eles. Mais identidades que workers não
+ * aceleram nada e não são planejadas.
+ */
+MemoryPlan planMemory(const MemoryModel& model, uint64_t budget, int workers, bool fixedWorkers);
+
+/**
+ * @brief Acompanha a memória privada durante o lote e aperta o limite de identidades em voo
+ *
+ * Uma thread lê privateRss() a cada 20 ms e guarda o pico. Acima do
+ * orçamento, baixa o limite em um (nunca abaixo de 1) e só volta a cortar
+ * depois que uma identidade terminar, para o corte anterior ter efeito. Serve
+ * de rede de segurança para o que a estimativa não previu; o limite nunca sobe.
+ */
+class MemoryMonitor {
+public:
+    MemoryMonitor(uint64_t budget, int identities);
+    ~MemoryMonitor();
+
+    MemoryMonitor(const MemoryMonitor&) = delete;
+    MemoryMonitor& operator=(const MemoryMonitor&) = delete;
+
+    int limit() const { return m_limit.load(); }
+    void identityFinished() { m_finished.store(true); }
+    void stop();
+
+    uint64_t peak() const { return m_peak.load(); }  // Maior privateRss() lido
+    int cuts() const { return m_cuts.load(); }
+
+private:
+    void sample();
+
+    uint64_t m_budget;
+    std::atomic<int> m_limit;
+    std::atomic<bool> m_finished{true};
+    std::atomic<uint64_t> m_peak{0};
+    std::atomic<int> m_cuts{0};
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_MEMORY_BUDGET_H
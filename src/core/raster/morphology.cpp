@@ -0,0 +1,243 @@
+#include "morphology.h"
+#include "parallel.h"
+#include "task_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+// Largura (em colunas) das faixas do passe vertical
+constexpr int kVerticalStripWidth = 64;
+
+// Sem threads pedidas, dentro de um worker as faixas vão para o pool dele: cada
+// worker abrindo núcleos std::threads por passe multiplicaria as threads
+template<typename Fn>
+void forRanges(int begin, int end, int threads, Fn fn) {
+    TaskPool* pool = TaskPool::current();
+    if (pool && threads <= 0) {
+        const int parts = std::max(1, std::min(pool->size(), end - begin));
+        pool->parallelFor(begin, end, (end - begin + parts - 1) / parts, fn);
+    } else {
+        parallelRanges(begin, end, threads, fn);
+    }
+}
+
+struct MinOp {
+    static float identity() { return std::numeric_limits<float>::infinity(); }
+    static float apply(float a, float b) { return b < a ? b : a; }
+};
+
+struct MaxOp {
+    static float identity() { return -std::numeric_limits<float>::infinity(); }
+    static float apply(float a, float b) { return b > a ? b : a; }
+};
+
+// Passe horizontal van Herk/Gil-Werman sobre uma linha de n amostras.
+// A linha é estendida com r elementos neutros em cada lado (janela recortada).
+template<typename Op>
+void vhgwLine(const float* in, float* out, int n, int r,
+              std::vector<float>& a, std::vector<float>& g, std::vector<float>& h) {
+    const int k = 2 * r + 1;
+    const int padded = n + 2 * r;
+    a.assign(padded, Op::identity());
+    g.resize(padded);
+    h.resize(padded);
+    std::copy(in, in + n, a.begin() + r);
+
+    // Prefixos e sufixos por bloco de k amostras
+    for (int start = 0; start < padded; start += k) {
+        int end = std::min(start + k, padded);
+        g[start] = a[start];
+        for (int p = start + 1; p < end; ++p) {
+            g[p] = Op::apply(g[p - 1], a[p]);
+        }
+        h[end - 1] = a[end - 1];
+        for (int p = end - 2; p >= start; --p) {
+            h[p] = Op::apply(h[p + 1], a[p]);
+        }
+    }
+
+    const float* gShift = g.data() + 2 * r;
+    for (int i = 0; i < n; ++i) {
+        out[i] = Op::apply(h[i], gShift[i]);
+    }
+}
+
+template<typename Op>
+void horizontalPass(const float* src, float* dst, int width, int height, int r, int threads) {
+    forRanges(0, height, threads, [=](int y0, int y1) {
+        std::vector<float> a;
+        std::vector<float> g;
+        std::vector<float> h;
+        for (int y = y0; y < y1; ++y) {
+            const float* in = src + static_cast<size_t>(y) * width;
+            float* out = dst + static_cast<size_t>(y) * width;
+            if (r == 0) {
+                std::memmove(out, in, sizeof(float) * width);
+            } else {
+                vhgwLine<Op>(in, out, width, r, a, g, h);
+            }
+        }
+    });
+}
+
+// Passe vertical: o mesmo algoritmo, com linhas inteiras como elementos,
+// em faixas de colunas (acesso sequencial à memória e laços vetorizáveis)
+template<typename Op>
+void verticalPass(const float* src, float* dst, int width, int height, int r, int threads) {
+    if (r == 0) {
+        if (src != dst) {
+            std::memcpy(dst, src, sizeof(float) * width * height);
+        }
+        return;
+    }
+
+    const int k = 2 * r + 1;
+    const int padded = height + 2 * r;
+
+    // Faixas estreitas mantêm os buffers de prefixo/sufixo na cache
+    const int strips = (width + kVerticalStripWidth - 1) / kVerticalStripWidth;
+
+    forRanges(0, strips, threads, [=](int s0, int s1) {
+        std::vector<float> g(static_cast<size_t>(padded) * kVerticalStripWidth);
+        std::vector<float> h(static_cast<size_t>(padded) * kVerticalStripWidth);
+        const std::vector<float> neutral(kVerticalStripWidth, Op::identity());
+
+        for (int strip = s0; strip < s1; ++strip) {
+            const int x0 = strip * kVerticalStripWidth;
+            const int sw = std::min(kVerticalStripWidth, width - x0);
+
+            auto rowAt = [&](int p) {
+                return (p < r || p >= height + r)
+                    ? neutral.data()
+                    : src + static_cast<size_t>(p - r) * width + x0;
+            };
+
+            for (int p = 0; p < padded; ++p) {
+                const float* a = rowAt(p);
+                float* gRow = &g[static_cast<size_t>(p) * sw];
+                if (p % k == 0) {
+                    std::memcpy(gRow, a, sizeof(float) * sw);
+                } else {
+                    const float* gPrev = gRow - sw;
+                    for (int x = 0; x < sw; ++x) {
+                        gRow[x] = Op::apply(gPrev[x], a[x]);
+                    }
+                }
+            }
+            for (int p = padded - 1; p >= 0; --p) {
+                const float* a = rowAt(p);
+                float* hRow = &h[static_cast<size_t>(p) * sw];
+                if (p == padded - 1 || (p + 1) % k == 0) {
+                    std::memcpy(hRow, a, sizeof(float) * sw);
+                } else {
+                    const float* hNext = hRow + sw;
+                    for (int x = 0; x < sw; ++x) {
+                        hRow[x] = Op::apply(hNext[x], a[x]);
+                    }
+                }
+            }
+            for (int y = 0; y < height; ++y) {
+                const float* hRow = &h[static_cast<size_t>(y) * sw];
+                const float* gRow = &g[static_cast<size_t>(y + 2 * r) * sw];
+                float* out = dst + static_cast<size_t>(y) * width + x0;
+                for (int x = 0; x < sw; ++x) {
+                    out[x] = Op::apply(hRow[x], gRow[x]);
+                }
+            }
+        }
+    });
+}
+
+template<typename Op>
+void rectangleFilter(const float* src, float* dst, int width, int height,
+                     int rx, int ry, int threads, std::vector<float>& scratch) {
+    scratch.resize(static_cast<size_t>(width) * height);
+    horizontalPass<Op>(src, scratch.data(), width, height, rx, threads);
+    verticalPass<Op>(scratch.data(), dst, width, height, ry, threads);
+}
+
+// Decompõe o disco digital de raio r em retângulos (meia-largura, meia-altura).
+// Cada nível distinto de largura das linhas gera um retângulo; se houver mais
+// que maxRects níveis, escolhe-se um subconjunto uniforme (sempre contido no disco).
+std::vector<std::pair<int, int>> discRectangles(int r, int maxRects) {
+    std::vector<std::pair<int, int>> levels;
+    for (int dy = 0; dy <= r; ++dy) {
+        int halfWidth = static_cast<int>(std::floor(std::sqrt(static_cast<double>(r * r - dy * dy)) + 1e-9));
+        if (!levels.empty() && levels.back().first == halfWidth) {
+            levels.back().second = dy;
+        } else {
+            levels.emplace_back(halfWidth, dy);
+        }
+    }
+
+    maxRects = std::max(1, maxRects);
+    if (static_cast<int>(levels.size()) <= maxRects) {
+        return levels;
+    }
+
+    std::vector<std::pair<int, int>> selected;
+    for (int i = 0; i < maxRects; ++i) {
+        size_t idx = static_cast<size_t>(std::lround(
+            static_cast<double>(i) * (levels.size() - 1) / (maxRects - 1)));
+        if (selected.empty() || selected.back() != levels[idx]) {
+            selected.push_back(levels[idx]);
+        }
+    }
+    return selected;
+}
+
+template<typename Op>
+void morphologyFilter(const float* src, float* dst, int width, int height,
+                      const MorphologyOptions& options) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    const int r = std::max(0, options.radius);
+    std::vector<float> scratch;
+
+    if (options.shape == StructuringElement::Rectangle || r <= 0) {
+        rectangleFilter<Op>(src, dst, width, height, r, r, options.threads, scratch);
+        return;
+    }
+
+    // Disco = união de retângulos: o filtro é a combinação dos filtros retangulares
+    auto rects = discRectangles(r, options.maxDiscRectangles);
+    std::vector<float> accum(static_cast<size_t>(width) * height);
+    std::vector<float> partial(static_cast<size_t>(width) * height);
+
+    rectangleFilter<Op>(src, accum.data(), width, height,
+                        rects[0].first, rects[0].second, options.threads, scratch);
+    for (size_t i = 1; i < rects.size(); ++i) {
+        rectangleFilter<Op>(src, partial.data(), width, height,
+                            rects[i].first, rects[i].second, options.threads, scratch);
+        for (size_t p = 0; p < accum.size(); ++p) {
+            accum[p] = Op::apply(accum[p], partial[p]);
+        }
+    }
+
+    std::memcpy(dst, accum.data(), sizeof(float) * accum.size());
+}
+
+} // namespace
+
+void minFilter(const float* src, float* dst, int width, int height,
+               const MorphologyOptions& options) {
+    morphologyFilter<MinOp>(src, dst, width, height, options);
+}
+
+void maxFilter(const float* src, float* dst, int width, int height,
+               const MorphologyOptions& options) {
+    morphologyFilter<MaxOp>(src, dst, width, height, options);
+}
+
+} // namespace Raster
+} // namespace SFinGe
@@ -0,0 +1,49 @@
+#ifndef RASTER_MORPHOLOGY_H
+#define RASTER_MORPHOLOGY_H
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Elemento estruturante das operações morfológicas
+ */
+enum class StructuringElement {
+    Rectangle,  // Quadrado (2r+1)x(2r+1), separável
+    Disc        // Disco aproximado por união de retângulos
+};
+
+/**
+ * @brief Opções dos filtros de mínimo/máximo (erosão/dilatação em tons de cinza)
+ */
+struct MorphologyOptions {
+    int radius = 1;                                          // Raio da janela (pixels)
+    StructuringElement shape = StructuringElement::Rectangle;
+    int maxDiscRectangles = 4;                               // Retângulos usados no disco
+    int threads = 0;                                         // 0 = núcleos disponíveis (num worker, o pool dele)
+};
+
+/**
+ * @brief Filtro de mínimo (erosão da região clara) com custo O(1) por pixel
+ *
+ * Implementação van Herk/Gil-Werman: cada passe 1D usa um prefixo e um
+ * sufixo por bloco de tamanho 2r+1, com ~3 comparações por pixel
+ * independentemente do raio. A janela é recortada nas bordas da imagem.
+ * As linhas (e faixas de colunas) são processadas em paralelo, no TaskPool
+ * quando chamado de um worker dele.
+ *
+ * @param src Plano de origem (row-major)
+ * @param dst Plano de destino (pode ser igual a src)
+ */
+void minFilter(const float* src, float* dst, int width, int height,
+               const MorphologyOptions& options);
+
+/**
+ * @brief Filtro de máximo (dilatação da região clara) com custo O(1) por pixel
+ */
+void maxFilter(const float* src, float* dst, int width, int height,
+               const MorphologyOptions& options);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_MORPHOLOGY_H
@@ -0,0 +1,206 @@
+#include "npy_file.h"
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+// Cabeçalho NPY 1.0: magic, versão, tamanho u16 e o dicionário em texto,
+// completado com espaços até um múltiplo de 64 bytes (alinha os dados)
+std::vector<uint8_t> npyHeader(const std::vector<uint64_t>& shape) {
+    std::string dict = "{'descr': '|u1', 'fortran_order': False, 'shape': (";
+    for (size_t i = 0; i < shape.size(); ++i) {
+        dict += std::to_string(shape[i]) + (shape.size() == 1 || i + 1 < shape.size() ? ", " : "");
+    }
+    dict += "), }";
+
+    const size_t prefix = 10;
+    size_t total = prefix + dict.size() + 1;
+    total = (total + 63) / 64 * 64;
+    dict.append(total - prefix - dict.size() - 1, ' ');
+    dict += '\n';
+
+    std::vector<uint8_t> header = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0};
+    header.push_back(static_cast<uint8_t>(dict.size()));
+    header.push_back(static_cast<uint8_t>(dict.size() >> 8));
+    header.insert(header.end(), dict.begin(), dict.end());
+    return header;
+}
+
+} // namespace
+
+NpyFile::~NpyFile() {
+    close();
+}
+
+bool NpyFile::create(const std::string& path, const std::vector<uint64_t>& shape) {
+    return open(path, shape, false);
+}
+
+bool NpyFile::reopen(const std::string& path, const std::vector<uint64_t>& shape) {
+    return open(path, shape, true);
+}
+
+bool NpyFile::open(const std::string& path, const std::vector<uint64_t>& shape, bool existing) {
+    close();
+    m_error.clear();
+
+    if (shape.size() < 2 || shape[shape.size() - 1] == 0 || shape[shape.size() - 2] == 0) {
+        return fail("invalid tensor shape");
+    }
+    m_width = static_cast<int>(shape[shape.size() - 1]);
+    m_height = static_cast<int>(shape[shape.size() - 2]);
+    m_slotCount = 1;
+    for (size_t i = 0; i + 2 < shape.size(); ++i) {
+        m_slotCount *= shape[i];
+    }
+
+    const std::vector<uint8_t> header = npyHeader(shape);
+    if (header.size() > 0xFFFF + 10) {
+        return fail("tensor header too large");
+    }
+    m_dataOffset = header.size();
+    m_mapSize = m_dataOffset + m_slotCount * static_cast<uint64_t>(m_width) * m_height;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              existing ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return fail((existing ? "cannot open " : "cannot create ") + path);
+    }
+    m_fileHandle = file;
+    LARGE_INTEGER size;
+    if (existing) {
+        if (!GetFileSizeEx(file, &size) || static_cast<uint64_t>(size.QuadPart) != m_mapSize) {
+            return fail(path + ": size does not match the tensor shape");
+        }
+    } else {
+        size.QuadPart = static_cast<LONGLONG>(m_mapSize);
+        if (!SetFilePointerEx(file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+            return fail("cannot allocate " + path);
+        }
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(m_mapSize >> 32),
+                                        static_cast<DWORD>(m_mapSize), nullptr);
+    if (!mapping) {
+        return fail("cannot map " + path);
+    }
+    m_mappingHandle = mapping;
+    m_map = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+#else
+    m_fd = existing ? ::open(path.c_str(), O_RDWR) : ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        return fail((existing ? "cannot open " : "cannot create ") + path);
+    }
+    if (existing) {
+        struct stat info;
+        if (fstat(m_fd, &info) != 0 || static_cast<uint64_t>(info.st_size) != m_mapSize) {
+            return fail(path + ": size does not match the tensor shape");
+        }
+    } else {
+        // Reserva os blocos já na criação: disco cheio falha aqui, e não como
+        // SIGBUS num worker no meio do lote
+#ifdef __linux__
+        if (posix_fallocate(m_fd, 0, static_cast<off_t>(m_mapSize)) != 0) {
+            return fail("cannot allocate " + path);
+        }
+#else
+        if (ftruncate(m_fd, static_cast<off_t>(m_mapSize)) != 0) {
+            return fail("cannot allocate " + path);
+        }
+#endif
+    }
+    void* map = mmap(nullptr, static_cast<size_t>(m_mapSize), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    m_map = (map == MAP_FAILED) ? nullptr : static_cast<uint8_t*>(map);
+#endif
+    if (!m_map) {
+        return fail("cannot map " + path);
+    }
+
+    if (existing) {
+        if (std::memcmp(m_map, header.data(), header.size()) != 0) {
+            return fail(path + ": header does not match the tensor shape");
+        }
+        return true;
+    }
+    std::memcpy(m_map, header.data(), header.size());
+    return true;
+}
+
+bool NpyFile::writeSlot(uint64_t slot, ConstGray8View image) {
+    if (!m_map || slot >= m_slotCount || image.width != m_width || image.height != m_height) {
+        return false;
+    }
+    uint8_t* dst = m_map + m_dataOffset + slot * static_cast<uint64_t>(m_width) * m_height;
+    for (int y = 0; y < m_height; ++y) {
+        std::memcpy(dst + static_cast<size_t>(y) * m_width, image.row(y), m_width);
+    }
+    return true;
+}
+
+bool NpyFile::sync() {
+    if (!m_map) {
+        return false;
+    }
+#ifdef _WIN32
+    return FlushViewOfFile(m_map, 0) != 0 && FlushFileBuffers(static_cast<HANDLE>(m_fileHandle)) != 0;
+#else
+    return msync(m_map, static_cast<size_t>(m_mapSize), MS_SYNC) == 0;
+#endif
+}
+
+bool NpyFile::close() {
+    bool ok = true;
+#ifdef _WIN32
+    if (m_map) {
+        ok = FlushViewOfFile(m_map, 0) != 0 && ok;
+        ok = UnmapViewOfFile(m_map) != 0 && ok;
+    }
+    if (m_mappingHandle) {
+        CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+        m_mappingHandle = nullptr;
+    }
+    if (m_fileHandle) {
+        ok = FlushFileBuffers(static_cast<HANDLE>(m_fileHandle)) != 0 && ok;
+        CloseHandle(static_cast<HANDLE>(m_fileHandle));
+        m_fileHandle = nullptr;
+    }
+#else
+    if (m_map) {
+        ok = msync(m_map, static_cast<size_t>(m_mapSize), MS_SYNC) == 0 && ok;
+        ok = munmap(m_map, static_cast<size_t>(m_mapSize)) == 0 && ok;
+    }
+    if (m_fd >= 0) {
+        ok = ::close(m_fd) == 0 && ok;
+        m_fd = -1;
+    }
+#endif
+    m_map = nullptr;
+    if (!ok && m_error.empty()) {
+        m_error = "failed to flush tensor file";
+    }
+    return ok;
+}
+
+bool NpyFile::fail(const std::string& message) {
+    close();
+    m_error = message;
+    return false;
+}
+
+} // namespace Raster
+} // namespace SFinGe
@@ -0,0 +1,86 @@
+#ifndef RASTER_NPY_FILE_H
+#define RASTER_NPY_FILE_H
+
+#include "gray8.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Tensor uint8 num arquivo .npy pré-alocado e mapeado em memória
+ *
+ * O arquivo (NPY 1.0, dtype '|u1', ordem C) é criado com o tamanho final e
+ * mapeado inteiro; cada "slot" são as duas últimas dimensões (altura x
+ * largura) e fica no offset fixo cabeçalho + slot * altura * largura. Os
+ * writers copiam as imagens direto no mapeamento, sem codificação e sem
+ * trava: slots diferentes nunca se sobrepõem. Slots não escritos ficam zerados.
+ *
+ * Leitura em Python: numpy.load(path, mmap_mode="r").
+ */
+class NpyFile {
+public:
+    NpyFile() = default;
+    ~NpyFile();
+
+    NpyFile(const NpyFile&) = delete;
+    NpyFile& operator=(const NpyFile&) = delete;
+
+    /**
+     * @brief Cria (ou trunca) o arquivo com a forma dada (ao menos 2 dimensões)
+     */
+    bool create(const std::string& path, const std::vector<uint64_t>& shape);
+
+    /**
+     * @brief Mapeia um arquivo já criado com a mesma forma, mantendo os slots gravados
+     *
+     * Usado ao retomar um lote: falha se o cabeçalho ou o tamanho não baterem.
+     */
+    bool reopen(const std::string& path, const std::vector<uint64_t>& shape);
+
+    /**
+     * @brief Grava no disco os slots escritos até aqui, sem desfazer o mapeamento
+     */
+    bool sync();
+
+    /**
+     * @brief Grava as páginas alteradas e desfaz o mapeamento (idempotente)
+     */
+    bool close();
+
+    uint64_t slotCount() const { return m_slotCount; }
+    int slotWidth() const { return m_width; }
+    int slotHeight() const { return m_height; }
+
+    /**
+     * @brief Copia a imagem para o slot; as dimensões devem ser as do slot
+     */
+    bool writeSlot(uint64_t slot, ConstGray8View image);
+
+    const std::string& error() const { return m_error; }
+
+private:
+    bool open(const std::string& path, const std::vector<uint64_t>& shape, bool existing);
+    bool fail(const std::string& message);
+
+    uint8_t* m_map = nullptr;
+    uint64_t m_mapSize = 0;
+    uint64_t m_dataOffset = 0;
+    uint64_t m_slotCount = 0;
+    int m_width = 0;
+    int m_height = 0;
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+    std::string m_error;
+};
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_NPY_FILE_H
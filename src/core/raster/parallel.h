@@ -0,0 +1,59 @@
+#ifndef RASTER_PARALLEL_H
+#define RASTER_PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Número de threads a usar para um kernel (0 = núcleos disponíveis)
+ */
+inline int resolveThreadCount(int requested, int workItems) {
+    int threads = requested > 0 ? requested
+                                : static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(1, std::min(threads, workItems));
+}
+
+/**
+ * @brief Executa fn(begin, end) sobre [begin, end) dividido em faixas contíguas
+ *
+ * Cada faixa roda em uma std::thread; com uma thread (ou pouco trabalho) a
+ * função é chamada diretamente, sem criar threads.
+ */
+template<typename Fn>
+void parallelRanges(int begin, int end, int threads, Fn fn) {
+    int count = end - begin;
+    if (count <= 0) {
+        return;
+    }
+
+    threads = resolveThreadCount(threads, count);
+    if (threads == 1) {
+        fn(begin, end);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    int chunk = (count + threads - 1) / threads;
+    for (int t = 1; t < threads; ++t) {
+        int b = begin + t * chunk;
+        int e = std::min(end, b + chunk);
+        if (b < e) {
+            workers.emplace_back(fn, b, e);
+        }
+    }
+    fn(begin, std::min(end, begin + chunk));
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_PARALLEL_H
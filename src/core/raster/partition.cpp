@@ -0,0 +1,530 @@
+#include "partition.h"
+#include "manifest.h"
+#include "shard.h"
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <unordered_map>
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// Campos do registro "batch" que todos os nós de um lote têm iguais; os
+// enums dão nome às posições lidas depois, na mesma ordem dos arrays
+const char* const kSharedIntegers[] = {"seed", "rangeStart", "rangeCount", "shards", "identityStride",
+                                       "versionsPerFingerprint", "skipOriginal", "ellipticalMask", "fusedWarp",
+                                       "warpInterpolation", "cropWidth", "cropHeight"};
+enum SharedInteger {
+    kSeed,
+    kRangeStart,
+    kRangeCount,
+    kShards,
+    kIdentityStride,
+    kVersionsPerFingerprint,
+    kSkipOriginal,
+    kEllipticalMask,
+    kFusedWarp,
+    kWarpInterpolation,
+    kCropWidth,
+    kCropHeight,
+    kSharedIntegerCount
+};
+static_assert(sizeof(kSharedIntegers) / sizeof(kSharedIntegers[0]) == kSharedIntegerCount, "one name per field");
+
+const char* const kSharedReals[] = {"maxBlurSigma", "wsqBitrate"};
+
+const char* const kSharedTexts[] = {"prefix", "codec", "format"};
+enum SharedText { kPrefix, kCodec, kFormat, kSharedTextCount };
+static_assert(sizeof(kSharedTexts) / sizeof(kSharedTexts[0]) == kSharedTextCount, "one name per field");
+
+struct Part {
+    std::string manifest;
+    fs::path directory;  // Onde o nó gravou as imagens (a pasta do manifesto)
+    int shard = 0;
+    IdentityRange range;
+};
+
+struct Location {
+    std::string key;
+    std::string path;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    uint32_t crc = 0;  // 0 quando o contêiner não guarda um
+};
+
+// Mesmos nomes que os batch generators dão às imagens e aos contêineres
+std::string imageName(const std::string& prefix, int identity, int version, const std::string& codec) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "_%04d_v%02d.%s", identity, version, codec == "wsq" ? "wsq" : "png");
+    return prefix + name;
+}
+
+std::string stemName(const std::string& prefix, int start) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_%04d", start);
+    return prefix + suffix;
+}
+
+std::string relativeTo(const fs::path& base, const fs::path& path) {
+    std::error_code ec;
+    const fs::path absolute = fs::absolute(path, ec);
+    const fs::path relative = absolute.lexically_relative(base);
+    return (relative.empty() ? absolute : relative).generic_string();
+}
+
+// Início dos dados de um .npy (cabeçalho 1.0: magic, versão, tamanho u16)
+bool npyDataOffset(const fs::path& path, uint64_t& offset) {
+    std::FILE* file = std::fopen(path.string().c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    uint8_t header[10];
+    const bool ok = std::fread(header, 1, sizeof(header), file) == sizeof(header) &&
+                    std::memcmp(header, "\x93NUMPY\x01", 7) == 0;
+    std::fclose(file);
+    if (!ok) {
+        return false;
+    }
+    offset = sizeof(header) + (header[8] | (header[9] << 8));
+    return true;
+}
+
+class Merger {
+public:
+    int run(const std::string& output, const std::vector<std::string>& inputs);
+
+private:
+    bool readPart(const std::string& manifest);
+    bool checkCoverage();
+    bool copyRecords(size_t index);
+    bool checkComplete();
+    bool locateImages(const Part& part, std::vector<Location>& locations);
+    bool fail(const std::string& message);
+
+    std::vector<Part> m_parts;
+    int64_t m_sharedIntegers[kSharedIntegerCount] = {};
+    double m_sharedReals[sizeof(kSharedReals) / sizeof(kSharedReals[0])] = {};
+    std::string m_sharedTexts[kSharedTextCount];
+
+    int m_rangeStart = 0;
+    int m_rangeCount = 0;
+    int m_versions = 0;
+    int m_firstVersion = 1;  // 0 quando o lote grava a v0
+    std::string m_prefix;
+    std::string m_codec;
+    std::string m_format;
+
+    std::vector<int> m_owner;              // Parte de cada identidade do intervalo
+    std::vector<uint8_t> m_identitySeen;   // Registro "identity" já copiado
+    std::vector<uint8_t> m_versionSeen;    // [identidade * (versões + 1) + versão]
+    fs::path m_outputDirectory;
+    ManifestWriter m_writer;
+};
+
+bool Merger::fail(const std::string& message) {
+    std::cerr << message << "\n";
+    return false;
+}
+
+bool Merger::readPart(const std::string& manifest) {
+    ManifestReader reader;
+    if (!reader.open(manifest)) {
+        return fail(reader.error());
+    }
+    if (!reader.next() || reader.recordName() != "batch") {
+        return fail(manifest + ": does not start with a batch record");
+    }
+
+    const bool first = m_parts.empty();
+    const std::string& reference = first ? manifest : m_parts.front().manifest;
+    for (size_t i = 0; i < kSharedIntegerCount; ++i) {
+        int64_t value;
+        if (!reader.integer(kSharedIntegers[i], value)) {
+            return fail(manifest + ": batch record has no " + kSharedIntegers[i] + " (written before --shard?)");
+        }
+        if (first) {
+            m_sharedIntegers[i] = value;
+        } else if (value != m_sharedIntegers[i]) {
+            return fail(manifest + ": " + kSharedIntegers[i] + " differs from " + reference);
+        }
+    }
+    for (size_t i = 0; i < sizeof(kSharedReals) / sizeof(kSharedReals[0]); ++i) {
+        double value;
+        if (!reader.real(kSharedReals[i], value)) {
+            return fail(manifest + ": batch record has no " + kSharedReals[i]);
+        }
+        if (first) {
+            m_sharedReals[i] = value;
+        } else if (value != m_sharedReals[i]) {
+            return fail(manifest + ": " + kSharedReals[i] + " differs from " + reference);
+        }
+    }
+    for (size_t i = 0; i < kSharedTextCount; ++i) {
+        std::string value;
+        if (!reader.text(kSharedTexts[i], value)) {
+            return fail(manifest + ": batch record has no " + kSharedTexts[i]);
+        }
+        if (first) {
+            m_sharedTexts[i] = value;
+        } else if (value != m_sharedTexts[i]) {
+            return fail(manifest + ": " + kSharedTexts[i] + " differs from " + reference);
+        }
+    }
+
+    int64_t shard = 0;
+    int64_t start = 0;
+    int64_t count = 0;
+    int64_t stride = 1;
+    if (!reader.integer("shard", shard) || !reader.integer("startIndex", start) ||
+        !reader.integer("fingerprints", count) || !reader.integer("identityStride", stride)) {
+        return fail(manifest + ": batch record has no identity range");
+    }
+    for (const Part& other : m_parts) {
+        if (other.shard == shard) {
+            return fail(manifest + ": shard " + std::to_string(shard) + " is also " + other.manifest);
+        }
+    }
+
+    Part part;
+    part.manifest = manifest;
+    part.directory = fs::path(manifest).parent_path();
+    part.shard = static_cast<int>(shard);
+    part.range.start = static_cast<int>(start);
+    part.range.count = static_cast<int>(count);
+    part.range.stride = static_cast<int>(stride);
+    m_parts.push_back(part);
+    return true;
+}
+
+bool Merger::checkCoverage() {
+    m_owner.assign(m_rangeCount, -1);
+    for (size_t i = 0; i < m_parts.size(); ++i) {
+        const IdentityRange& range = m_parts[i].range;
+        for (int n = 0; n < range.count; ++n) {
+            const int identity = range.start + n * range.stride;
+            const int64_t slot = static_cast<int64_t>(identity) - m_rangeStart;
+            if (slot < 0 || slot >= m_rangeCount) {
+                return fail(m_parts[i].manifest + ": identity " + std::to_string(identity) + " is outside the batch");
+            }
+            if (m_owner[slot] >= 0) {
+                return fail("identity " + std::to_string(identity) + " is in both " +
+                            m_parts[m_owner[slot]].manifest + " and " + m_parts[i].manifest);
+            }
+            m_owner[slot] = static_cast<int>(i);
+        }
+    }
+
+    int missing = 0;
+    int firstMissing = -1;
+    for (int slot = 0; slot < m_rangeCount; ++slot) {
+        if (m_owner[slot] < 0) {
+            firstMissing = firstMissing < 0 ? m_rangeStart + slot : firstMissing;
+            ++missing;
+        }
+    }
+    if (missing > 0) {
+        return fail(std::to_string(missing) + " identities are in no part, starting at " +
+                    std::to_string(firstMissing) + " (missing shard?)");
+    }
+    return true;
+}
+
+// Registros de identidade e de versão de um nó, sem as repetições de um lote retomado
+bool Merger::copyRecords(size_t index) {
+    const Part& part = m_parts[index];
+    ManifestReader reader;
+    if (!reader.open(part.manifest)) {
+        return fail(reader.error());
+    }
+    ManifestRecord record;
+    while (reader.next()) {
+        const std::string& name = reader.recordName();
+        if (name == "batch") {
+            continue;
+        }
+        int64_t identity;
+        if (!reader.integer("identity", identity)) {
+            reader.copyTo(record);
+            m_writer.append(name, record);
+            continue;
+        }
+        const int64_t slot = identity - m_rangeStart;
+        if (slot < 0 || slot >= m_rangeCount || m_owner[slot] != static_cast<int>(index)) {
+            return fail(part.manifest + ": identity " + std::to_string(identity) + " does not belong to this part");
+        }
+
+        uint8_t* seen = nullptr;
+        if (name == "identity") {
+            seen = &m_identitySeen[slot];
+        } else if (name == "version") {
+            int64_t version;
+            if (!reader.integer("version", version) || version < 0 || version > m_versions) {
+                return fail(part.manifest + ": version record out of range");
+            }
+            seen = &m_versionSeen[slot * (m_versions + 1) + version];
+        }
+        if (seen && *seen) {
+            continue;
+        }
+        if (seen) {
+            *seen = 1;
+        }
+        reader.copyTo(record);
+        if (!m_writer.append(name, record)) {
+            return fail(m_writer.error());
+        }
+    }
+    if (!reader.error().empty()) {
+        return fail(reader.error() + "; finish that node with --resume first");
+    }
+    return true;
+}
+
+bool Merger::checkComplete() {
+    for (int slot = 0; slot < m_rangeCount; ++slot) {
+        const std::string& manifest = m_parts[m_owner[slot]].manifest;
+        const std::string identity = std::to_string(m_rangeStart + slot);
+        if (!m_identitySeen[slot]) {
+            return fail(manifest + ": no record of identity " + identity + " (unfinished node?)");
+        }
+        for (int version = 1; version <= m_versions; ++version) {
+            if (!m_versionSeen[static_cast<size_t>(slot) * (m_versions + 1) + version]) {
+                return fail(manifest + ": no record of identity " + identity + " version " +
+                            std::to_string(version) + " (unfinished node?)");
+            }
+        }
+    }
+    return true;
+}
+
+// Onde cada imagem do nó está, na ordem identidade, versão
+bool Merger::locateImages(const Part& part, std::vector<Location>& locations) {
+    const IdentityRange& range = part.range;
+    const fs::path stem = part.directory / stemName(m_prefix, range.start);
+    std::error_code ec;
+
+    if (m_format == "npy") {
+        const fs::path path = fs::path(stem.string() + ".npy");
+        const uint64_t slotBytes = static_cast<uint64_t>(m_sharedIntegers[kCropWidth]) * m_sharedIntegers[kCropHeight];
+        uint64_t offset = 0;
+        if (range.count > 0 && (!npyDataOffset(path, offset) ||
+                                fs::file_size(path, ec) != offset + slotBytes * range.count * m_versions)) {
+            return fail(path.string() + ": missing or not the tensor of this part");
+        }
+        const std::string relative = relativeTo(m_outputDirectory, path);
+        for (int n = 0; n < range.count; ++n) {
+            for (int version = 1; version <= m_versions; ++version) {
+                Location location;
+                location.path = relative;
+                location.offset = offset + slotBytes * (static_cast<uint64_t>(n) * m_versions + version - 1);
+                location.length = slotBytes;
+                locations.push_back(location);
+            }
+        }
+        return true;
+    }
+
+    // Índices de todos os shards do nó; numa chave repetida (lote retomado) vale a primeira
+    std::unordered_map<std::string, Location> stored;
+    if (m_format == "shards") {
+        for (int index = 0; fs::exists(ShardWriter::shardPath(stem.string(), index), ec); ++index) {
+            const std::string path = ShardWriter::shardPath(stem.string(), index);
+            ShardReader reader;
+            if (!reader.open(path)) {
+                return fail(reader.error());
+            }
+            const std::string relative = relativeTo(m_outputDirectory, path);
+            for (const ShardEntry& entry : reader.entries()) {
+                Location location;
+                location.key = entry.key;
+                location.path = relative;
+                location.offset = entry.offset;
+                location.length = entry.length;
+                location.crc = entry.crc;
+                stored.emplace(entry.key, location);
+            }
+        }
+    }
+
+    for (int n = 0; n < range.count; ++n) {
+        const int identity = range.start + n * range.stride;
+        for (int version = m_firstVersion; version <= m_versions; ++version) {
+            const std::string key = imageName(m_prefix, identity, version, m_codec);
+            if (m_format == "shards") {
+                auto it = stored.find(key);
+                if (it == stored.end()) {
+                    return fail(part.manifest + ": " + key + " is in none of its shards");
+                }
+                locations.push_back(it->second);
+                continue;
+            }
+            const fs::path path = part.directory / key;
+            Location location;
+            location.key = key;
+            location.path = relativeTo(m_outputDirectory, path);
+            location.length = fs::file_size(path, ec);
+            if (ec) {
+                return fail(path.string() + ": missing");
+            }
+            locations.push_back(location);
+        }
+    }
+    return true;
+}
+
+int Merger::run(const std::string& output, const std::vector<std::string>& inputs) {
+    for (const std::string& input : inputs) {
+        if (!readPart(input)) {
+            return 1;
+        }
+    }
+    m_rangeStart = static_cast<int>(m_sharedIntegers[kRangeStart]);
+    m_rangeCount = static_cast<int>(m_sharedIntegers[kRangeCount]);
+    m_versions = static_cast<int>(m_sharedIntegers[kVersionsPerFingerprint]);
+    m_firstVersion = m_sharedIntegers[kSkipOriginal] ? 1 : 0;
+    m_prefix = m_sharedTexts[kPrefix];
+    m_codec = m_sharedTexts[kCodec];
+    m_format = m_sharedTexts[kFormat];
+    if (m_rangeCount < 0 || m_versions < 0 || !checkCoverage()) {
+        return 1;
+    }
+
+    std::error_code ec;
+    m_outputDirectory = fs::absolute(output, ec).parent_path();
+    if (!m_writer.create(output)) {
+        fail(m_writer.error());
+        return 1;
+    }
+    auto abandon = [this, &output]() {
+        m_writer.close();
+        std::error_code removeError;
+        fs::remove(output, removeError);
+        return 1;
+    };
+
+    ManifestRecord dataset;
+    dataset.addUInt("seed", static_cast<uint64_t>(m_sharedIntegers[kSeed]));
+    dataset.addInt("rangeStart", m_rangeStart);
+    dataset.addInt("rangeCount", m_rangeCount);
+    dataset.addInt("shards", m_sharedIntegers[kShards]);
+    dataset.addInt("parts", static_cast<int64_t>(m_parts.size()));
+    dataset.addInt("versionsPerFingerprint", m_versions);
+    dataset.addBool("skipOriginal", m_firstVersion == 1);
+    dataset.addText("prefix", m_prefix);
+    dataset.addText("codec", m_codec);
+    dataset.addText("format", m_format);
+    m_writer.append("dataset", dataset);
+
+    // O registro "batch" de cada nó, com o caminho do manifesto dele
+    for (const Part& part : m_parts) {
+        ManifestReader reader;
+        if (!reader.open(part.manifest) || !reader.next()) {
+            fail(reader.error());
+            return abandon();
+        }
+        ManifestRecord record;
+        reader.copyTo(record);
+        record.addText("manifest", relativeTo(m_outputDirectory, part.manifest));
+        m_writer.append("part", record);
+    }
+
+    m_identitySeen.assign(m_rangeCount, 0);
+    m_versionSeen.assign(static_cast<size_t>(m_rangeCount) * (m_versions + 1), 0);
+    for (size_t i = 0; i < m_parts.size(); ++i) {
+        if (!copyRecords(i)) {
+            return abandon();
+        }
+    }
+    if (!checkComplete()) {
+        return abandon();
+    }
+
+    uint64_t images = 0;
+    for (const Part& part : m_parts) {
+        std::vector<Location> locations;
+        if (!locateImages(part, locations)) {
+            return abandon();
+        }
+        size_t next = 0;
+        for (int n = 0; n < part.range.count; ++n) {
+            for (int version = (m_format == "npy" ? 1 : m_firstVersion); version <= m_versions; ++version) {
+                const Location& location = locations[next++];
+                ManifestRecord record;
+                record.addInt("identity", part.range.start + n * part.range.stride);
+                record.addInt("version", version);
+                record.addText("key", location.key);
+                record.addText("path", location.path);
+                record.addUInt("offset", location.offset);
+                record.addUInt("length", location.length);
+                record.addUInt("crc", location.crc);
+                m_writer.append("file", record);
+                ++images;
+            }
+        }
+    }
+
+    if (!m_writer.close()) {
+        fail(m_writer.error());
+        return abandon();
+    }
+    std::cerr << output << ": " << m_parts.size() << " parts, " << m_rangeCount << " identities, "
+              << images << " images\n";
+    return 0;
+}
+
+} // namespace
+
+IdentityRange partitionRange(int start, int count, int shard, int shards, PartitionMode mode) {
+    IdentityRange range;
+    if (shards < 1 || shard < 0 || shard >= shards || count <= 0) {
+        range.start = start;
+        return range;
+    }
+    if (mode == PartitionMode::Strided) {
+        range.start = start + shard;
+        range.count = shard < count ? (count - shard + shards - 1) / shards : 0;
+        range.stride = shards;
+        return range;
+    }
+    const int base = count / shards;
+    const int extra = count % shards;
+    range.start = start + shard * base + std::min(shard, extra);
+    range.count = base + (shard < extra ? 1 : 0);
+    return range;
+}
+
+bool parseShardSpec(const std::string& text, int& shard, int& shards) {
+    const size_t slash = text.find('/');
+    if (slash == std::string::npos || slash == 0 || slash + 1 == text.size() ||
+        text.find_first_not_of("0123456789/") != std::string::npos || text.find('/', slash + 1) != std::string::npos) {
+        return false;
+    }
+    try {
+        shard = std::stoi(text.substr(0, slash));
+        shards = std::stoi(text.substr(slash + 1));
+    } catch (const std::exception&) {
+        return false;
+    }
+    return shards >= 1 && shard >= 0 && shard < shards;
+}
+
+int runMergeTool(const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        std::cerr << "Usage:\n"
+                  << "  merge <out.manifest> <node.manifest>...   Check that the nodes of a --shard batch cover it\n"
+                  << "                                            and write one manifest describing the dataset\n";
+        return 2;
+    }
+    Merger merger;
+    return merger.run(args[0], std::vector<std::string>(args.begin() + 1, args.end()));
+}
+
+} // namespace Raster
+} // namespace SFinGe
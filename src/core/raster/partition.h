@@ -0,0 +1,62 @@
+#ifndef RASTER_PARTITION_H
+#define RASTER_PARTITION_H
+
+#include <string>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Como o intervalo global de identidades é dividido entre os nós
+ */
+enum class PartitionMode {
+    Contiguous,  // Blocos consecutivos
+    Strided      // Intercalado: o nó K fica com start + K, start + K + N, ...
+};
+
+/**
+ * @brief Identidades de um nó: start + n * stride, para 0 <= n < count
+ */
+struct IdentityRange {
+    int start = 0;
+    int count = 0;
+    int stride = 1;
+};
+
+/**
+ * @brief Parte K de N do intervalo global [start, start + count)
+ *
+ * Determinística: todos os nós calculam a mesma divisão a partir dos mesmos
+ * argumentos. Na contígua os primeiros count % N nós recebem uma identidade a
+ * mais; um nó sem identidades (N > count) tem count == 0.
+ */
+IdentityRange partitionRange(int start, int count, int shard, int shards, PartitionMode mode);
+
+/**
+ * @brief Lê "K/N", com 0 <= K < N
+ */
+bool parseShardSpec(const std::string& text, int& shard, int& shards);
+
+/**
+ * @brief Subcomando "merge" das linhas de comando
+ *
+ *   merge <saída.manifest> <nó.manifest>...
+ *
+ * Confere que os manifestos são do mesmo lote (semente, intervalo global e
+ * opções) e que as partes cobrem o intervalo sem buracos nem sobreposições,
+ * com todas as identidades e versões gravadas. A saída é um manifesto único:
+ * um registro "dataset", um "part" por nó (o registro "batch" dele e o
+ * caminho), os registros "identity" e "version" sem repetições e um "file"
+ * por imagem, com o caminho (relativo à saída), offset e tamanho dentro do
+ * arquivo, shard ou tensor que a guarda.
+ *
+ * @param args Argumentos após "merge"
+ * @return Código de saída do processo
+ */
+int runMergeTool(const std::vector<std::string>& args);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_PARTITION_H
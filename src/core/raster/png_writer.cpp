@@ -0,0 +1,770 @@
+#include "png_writer.h"
+#include "checksum.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+constexpr int kWindowSize = 32768;
+constexpr int kWindowMask = kWindowSize - 1;
+constexpr int kHashBits = 15;
+constexpr int kMaxMatch = 258;
+constexpr size_t kBlockSymbols = 1 << 16;
+constexpr size_t kMaxStored = 65535;
+
+constexpr int kLitLenCodes = 286;
+constexpr int kDistCodes = 30;
+constexpr int kCodeLengthCodes = 19;
+constexpr int kEndOfBlock = 256;
+
+// Busca de repetições por perfil
+struct MatchParams {
+    int maxChain;     // Candidatos visitados por posição
+    int niceLength;   // Comprimento que encerra a busca
+    bool lazy;        // Adia a repetição se a próxima posição tiver uma maior
+    int maxInsert;    // Repetições maiores não indexam as posições internas
+    int hashBytes;    // 4 = só repetições de 4+ bytes (menos candidatos falsos nos resíduos com ruído)
+};
+
+MatchParams matchParams(PngProfile profile) {
+    switch (profile) {
+    case PngProfile::Fast:
+        return {4, 16, false, 4, 4};
+    case PngProfile::Small:
+        return {256, kMaxMatch, true, kMaxMatch, 3};
+    case PngProfile::Balanced:
+    default:
+        return {16, 64, true, kMaxMatch, 3};
+    }
+}
+
+const uint16_t kLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+const uint8_t kLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+const uint16_t kDistBase[kDistCodes] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+const uint8_t kDistExtra[kDistCodes] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+const uint8_t kCodeLengthOrder[kCodeLengthCodes] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+uint16_t reverseBits(uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; ++i) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    return static_cast<uint16_t>(reversed);
+}
+
+// Códigos canônicos (RFC 1951, 3.2.2), já invertidos para a escrita LSB-first
+void assignCodes(const uint8_t* lengths, int count, uint16_t* codes) {
+    int lengthCount[16] = {0};
+    for (int i = 0; i < count; ++i) {
+        lengthCount[lengths[i]]++;
+    }
+    lengthCount[0] = 0;
+
+    uint32_t next[16] = {0};
+    uint32_t code = 0;
+    for (int bits = 1; bits < 16; ++bits) {
+        code = (code + lengthCount[bits - 1]) << 1;
+        next[bits] = code;
+    }
+    for (int i = 0; i < count; ++i) {
+        codes[i] = lengths[i] ? reverseBits(next[lengths[i]]++, lengths[i]) : 0;
+    }
+}
+
+/**
+ * Comprimentos de Huffman limitados a maxBits: árvore ótima pelo método das
+ * duas filas sobre as folhas ordenadas; se passar do limite, os níveis são
+ * reequilibrados mantendo a desigualdade de Kraft e os códigos mais longos
+ * vão para os símbolos menos frequentes.
+ */
+void buildLengths(const uint32_t* freq, int count, int maxBits, uint8_t* lengths) {
+    std::fill(lengths, lengths + count, 0);
+
+    int symbols[288];
+    int n = 0;
+    for (int i = 0; i < count; ++i) {
+        if (freq[i] > 0) {
+            symbols[n++] = i;
+        }
+    }
+    if (n == 0) {
+        return;
+    }
+    if (n == 1) {
+        // Um código sozinho ainda precisa de 1 bit; o par mantém a árvore completa
+        lengths[symbols[0]] = 1;
+        lengths[symbols[0] == 0 ? 1 : 0] = 1;
+        return;
+    }
+    std::stable_sort(symbols, symbols + n, [freq](int a, int b) { return freq[a] < freq[b]; });
+
+    uint32_t weight[2 * 288];
+    int parent[2 * 288];
+    for (int i = 0; i < n; ++i) {
+        weight[i] = freq[symbols[i]];
+    }
+    int leaf = 0;
+    int internalHead = n;
+    int next = n;
+    auto takeSmallest = [&]() {
+        if (leaf < n && (internalHead >= next || weight[leaf] <= weight[internalHead])) {
+            return leaf++;
+        }
+        return internalHead++;
+    };
+    for (int k = 0; k < n - 1; ++k) {
+        int a = takeSmallest();
+        int b = takeSmallest();
+        weight[next] = weight[a] + weight[b];
+        parent[a] = parent[b] = next;
+        ++next;
+    }
+
+    // Pais têm índice maior: a profundidade sai em uma passada decrescente
+    int depth[2 * 288];
+    int root = next - 1;
+    depth[root] = 0;
+    int lengthCount[33] = {0};
+    for (int i = root - 1; i >= 0; --i) {
+        depth[i] = depth[parent[i]] + 1;
+        if (i < n) {
+            lengthCount[std::min(depth[i], 32)]++;
+        }
+    }
+
+    for (int bits = maxBits + 1; bits <= 32; ++bits) {
+        lengthCount[maxBits] += lengthCount[bits];
+        lengthCount[bits] = 0;
+    }
+    uint32_t total = 0;
+    for (int bits = maxBits; bits > 0; --bits) {
+        total += static_cast<uint32_t>(lengthCount[bits]) << (maxBits - bits);
+    }
+    while (total != (1u << maxBits)) {
+        lengthCount[maxBits]--;
+        for (int bits = maxBits - 1; bits > 0; --bits) {
+            if (lengthCount[bits] > 0) {
+                lengthCount[bits]--;
+                lengthCount[bits + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    int index = 0;
+    for (int bits = maxBits; bits > 0; --bits) {
+        for (int k = 0; k < lengthCount[bits]; ++k) {
+            lengths[symbols[index++]] = static_cast<uint8_t>(bits);
+        }
+    }
+}
+
+struct Tables {
+    uint8_t lengthCode[kMaxMatch + 1];
+    uint8_t distCode[512];
+    uint8_t fixedLitLenLength[288];
+    uint16_t fixedLitLenCode[288];
+    uint8_t fixedDistLength[kDistCodes];
+    uint16_t fixedDistCode[kDistCodes];
+
+    Tables() {
+        for (int code = 0; code < 29; ++code) {
+            int last = (code == 28) ? kMaxMatch : kLengthBase[code] + (1 << kLengthExtra[code]) - 1;
+            for (int length = kLengthBase[code]; length <= last; ++length) {
+                lengthCode[length] = static_cast<uint8_t>(code);
+            }
+        }
+        // Distâncias até 256 indexadas direto; acima, em passos de 128 (como no zlib)
+        for (int code = 0; code < kDistCodes; ++code) {
+            for (int d = kDistBase[code]; d < kDistBase[code] + (1 << kDistExtra[code]); ++d) {
+                int v = d - 1;
+                distCode[v < 256 ? v : 256 + (v >> 7)] = static_cast<uint8_t>(code);
+            }
+        }
+        for (int i = 0; i < 288; ++i) {
+            fixedLitLenLength[i] = i < 144 ? 8 : (i < 256 ? 9 : (i < 280 ? 7 : 8));
+        }
+        assignCodes(fixedLitLenLength, 288, fixedLitLenCode);
+        std::fill(fixedDistLength, fixedDistLength + kDistCodes, 5);
+        assignCodes(fixedDistLength, kDistCodes, fixedDistCode);
+    }
+
+    int distanceCode(int distance) const {
+        int v = distance - 1;
+        return distCode[v < 256 ? v : 256 + (v >> 7)];
+    }
+};
+
+const Tables& tables() {
+    static const Tables instance;
+    return instance;
+}
+
+uint32_t adler32(const uint8_t* data, size_t size) {
+    uint32_t a = 1, b = 0;
+    while (size > 0) {
+        // 5552 = maior bloco sem estouro de 32 bits antes do módulo
+        size_t block = std::min<size_t>(size, 5552);
+        size -= block;
+        for (size_t i = 0; i < block; ++i) {
+            a += data[i];
+            b += a;
+        }
+        data += block;
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+inline void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint64_t load64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline int matchLength(const uint8_t* a, const uint8_t* b, int limit) {
+    int length = 0;
+    while (length + 8 <= limit && load64(a + length) == load64(b + length)) {
+        length += 8;
+    }
+    while (length < limit && a[length] == b[length]) {
+        ++length;
+    }
+    return length;
+}
+
+inline uint8_t paethPredictor(int a, int b, int c) {
+    int pa = std::abs(b - c);
+    int pb = std::abs(a - c);
+    int pc = std::abs(a + b - 2 * c);
+    return static_cast<uint8_t>((pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c));
+}
+
+// Filtros do PNG (tipos 0 a 4) sobre os pixels originais de uma linha
+void filterRow(int type, const uint8_t* cur, const uint8_t* up, int width, uint8_t* out) {
+    switch (type) {
+    case 0:
+        std::memcpy(out, cur, width);
+        break;
+    case 1:
+        out[0] = cur[0];
+        for (int x = 1; x < width; ++x) {
+            out[x] = static_cast<uint8_t>(cur[x] - cur[x - 1]);
+        }
+        break;
+    case 2:
+        for (int x = 0; x < width; ++x) {
+            out[x] = static_cast<uint8_t>(cur[x] - up[x]);
+        }
+        break;
+    case 3:
+        out[0] = static_cast<uint8_t>(cur[0] - (up[0] >> 1));
+        for (int x = 1; x < width; ++x) {
+            out[x] = static_cast<uint8_t>(cur[x] - ((cur[x - 1] + up[x]) >> 1));
+        }
+        break;
+    default:
+        out[0] = static_cast<uint8_t>(cur[0] - up[0]);
+        for (int x = 1; x < width; ++x) {
+            out[x] = static_cast<uint8_t>(cur[x] - paethPredictor(cur[x - 1], up[x], up[x - 1]));
+        }
+        break;
+    }
+}
+
+// Heurística usual de escolha do filtro: menor soma dos resíduos com sinal
+uint32_t residualCost(const uint8_t* row, int width) {
+    uint32_t sum = 0;
+    for (int x = 0; x < width; ++x) {
+        sum += row[x] < 128 ? row[x] : 256 - row[x];
+    }
+    return sum;
+}
+
+} // namespace
+
+bool parsePngProfile(const std::string& name, PngProfile& profile) {
+    if (name == "fast") {
+        profile = PngProfile::Fast;
+    } else if (name == "balanced") {
+        profile = PngProfile::Balanced;
+    } else if (name == "small") {
+        profile = PngProfile::Small;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* pngProfileName(PngProfile profile) {
+    switch (profile) {
+    case PngProfile::Fast: return "fast";
+    case PngProfile::Small: return "small";
+    case PngProfile::Balanced:
+    default: return "balanced";
+    }
+}
+
+PngWriter::PngWriter(PngProfile profile)
+    : m_profile(profile) {
+}
+
+PngWriter& PngWriter::forThread() {
+    static thread_local PngWriter writer;
+    return writer;
+}
+
+const std::vector<uint8_t>& PngWriter::encode(ConstGray8View image, int dpi) {
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    m_out.assign(kSignature, kSignature + 8);
+
+    beginChunk("IHDR");
+    appendBigEndian(m_out, static_cast<uint32_t>(image.width));
+    appendBigEndian(m_out, static_cast<uint32_t>(image.height));
+    m_out.push_back(8);  // Bits por amostra
+    m_out.push_back(0);  // Tons de cinza
+    m_out.push_back(0);  // Deflate
+    m_out.push_back(0);  // Filtros adaptativos (tipo por linha)
+    m_out.push_back(0);  // Sem entrelaçamento
+    endChunk();
+
+    if (dpi > 0) {
+        uint32_t pixelsPerMeter = static_cast<uint32_t>(std::lround(dpi / 0.0254));
+        beginChunk("pHYs");
+        appendBigEndian(m_out, pixelsPerMeter);
+        appendBigEndian(m_out, pixelsPerMeter);
+        m_out.push_back(1);  // Unidade: metro
+        endChunk();
+    }
+
+    filterRows(image);
+
+    // Cabeçalho zlib: janela de 32 KiB, FLEVEL informativo (FCHECK fecha o múltiplo de 31)
+    beginChunk("IDAT");
+    m_out.push_back(0x78);
+    m_out.push_back(m_profile == PngProfile::Fast ? 0x01 : (m_profile == PngProfile::Small ? 0xDA : 0x9C));
+    deflate(m_filtered.data(), m_filtered.size());
+    appendBigEndian(m_out, adler32(m_filtered.data(), m_filtered.size()));
+    endChunk();
+
+    beginChunk("IEND");
+    endChunk();
+
+    return m_out;
+}
+
+bool PngWriter::write(ConstGray8View image, const std::string& path, int dpi) {
+    const std::vector<uint8_t>& data = encode(image, dpi);
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = (std::fclose(file) == 0) && ok;
+    return ok;
+}
+
+void PngWriter::filterRows(ConstGray8View image) {
+    const int width = image.width;
+    const size_t stride = static_cast<size_t>(width) + 1;
+    m_filtered.resize(stride * image.height);
+    m_zeroRow.assign(width, 0);
+    if (m_profile == PngProfile::Small) {
+        m_candidates.resize(5 * static_cast<size_t>(width));
+    }
+
+    for (int y = 0; y < image.height; ++y) {
+        const uint8_t* cur = image.row(y);
+        const uint8_t* up = y > 0 ? image.row(y - 1) : m_zeroRow.data();
+        uint8_t* out = m_filtered.data() + y * stride;
+
+        if (m_profile == PngProfile::Fast) {
+            out[0] = 1;
+            filterRow(1, cur, up, width, out + 1);
+        } else if (m_profile == PngProfile::Balanced) {
+            out[0] = 4;
+            filterRow(4, cur, up, width, out + 1);
+        } else {
+            int bestType = 0;
+            uint32_t bestCost = UINT32_MAX;
+            for (int type = 0; type < 5; ++type) {
+                uint8_t* candidate = m_candidates.data() + type * static_cast<size_t>(width);
+                filterRow(type, cur, up, width, candidate);
+                uint32_t cost = residualCost(candidate, width);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestType = type;
+                }
+            }
+            out[0] = static_cast<uint8_t>(bestType);
+            std::memcpy(out + 1, m_candidates.data() + bestType * static_cast<size_t>(width), width);
+        }
+    }
+}
+
+void PngWriter::deflate(const uint8_t* data, size_t size) {
+    // Cada bloco sai pelo menor entre dinâmico, fixo e armazenado: o tamanho
+    // armazenado mais os cabeçalhos limita a saída e ela é escrita direto no buffer
+    const size_t start = m_out.size();
+    m_out.resize(start + size + size / 1024 + 1024);
+    m_bitOut = m_out.data() + start;
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+    parse(data, size);
+    alignToByte();
+    m_out.resize(m_bitOut - m_out.data());
+}
+
+void PngWriter::parse(const uint8_t* data, size_t size) {
+    const MatchParams params = matchParams(m_profile);
+
+    m_head.assign(size_t(1) << kHashBits, -1);
+    m_prev.resize(kWindowSize);
+    m_symbols.clear();
+    m_symbols.reserve(kBlockSymbols);
+
+    const int minMatch = params.hashBytes;
+    const uint32_t hashMask = params.hashBytes == 4 ? 0xFFFFFFFFu : 0x00FFFFFFu;
+    auto hashAt = [data, hashMask](size_t p) {
+        uint32_t v;
+        std::memcpy(&v, data + p, sizeof(v));
+        return ((v & hashMask) * 2654435761u) >> (32 - kHashBits);
+    };
+    auto insert = [&](size_t p, uint32_t h) {
+        m_prev[p & kWindowMask] = m_head[h];
+        m_head[h] = static_cast<int32_t>(p);
+    };
+    // Hash lido em 4 bytes: as últimas posições (sem 4 bytes à frente) não buscam nem indexam
+    const size_t hashEnd = size >= 4 ? size - 3 : 0;
+    auto findMatch = [&](size_t p, uint32_t h, int& distance) {
+        const int limit = static_cast<int>(std::min<size_t>(kMaxMatch, size - p));
+        const uint8_t* cur = data + p;
+        int best = minMatch - 1;
+        int chain = params.maxChain;
+        int32_t candidate = m_head[h];
+
+        while (candidate >= 0 && p - candidate <= static_cast<size_t>(kWindowSize) && chain-- > 0) {
+            const uint8_t* match = data + candidate;
+            if (match[best] == cur[best] && match[0] == cur[0] && match[1] == cur[1]) {
+                int length = matchLength(match, cur, limit);
+                if (length > best) {
+                    best = length;
+                    distance = static_cast<int>(p - candidate);
+                    if (length >= params.niceLength || length == limit) {
+                        break;
+                    }
+                }
+            }
+            int32_t older = m_prev[candidate & kWindowMask];
+            if (older >= candidate) {
+                break;
+            }
+            candidate = older;
+        }
+        return best >= minMatch ? best : 0;
+    };
+
+    size_t blockStart = 0;
+    auto endSymbol = [&](size_t next) {
+        if (m_symbols.size() >= kBlockSymbols) {
+            flushBlock(data, blockStart, next, false);
+            m_symbols.clear();
+            blockStart = next;
+        }
+    };
+
+    size_t p = 0;
+    int length = 0;
+    int distance = 0;
+    bool pending = false;  // (length, distance) já buscados para p pela etapa preguiçosa
+    while (p < hashEnd) {
+        uint32_t h = hashAt(p);
+        if (!pending) {
+            length = findMatch(p, h, distance);
+        }
+        pending = false;
+        insert(p, h);
+
+        if (length == 0) {
+            m_symbols.push_back({data[p], 0});
+            ++p;
+            endSymbol(p);
+            continue;
+        }
+
+        if (params.lazy && length < params.niceLength && p + 1 < hashEnd) {
+            int nextDistance = 0;
+            int nextLength = findMatch(p + 1, hashAt(p + 1), nextDistance);
+            if (nextLength > length) {
+                // Literal agora, repetição maior a partir da próxima posição
+                m_symbols.push_back({data[p], 0});
+                ++p;
+                endSymbol(p);
+                length = nextLength;
+                distance = nextDistance;
+                pending = true;
+                continue;
+            }
+        }
+
+        m_symbols.push_back({static_cast<uint16_t>(length), static_cast<uint16_t>(distance)});
+        if (length <= params.maxInsert) {
+            size_t stop = std::min(p + length, hashEnd);
+            for (size_t k = p + 1; k < stop; ++k) {
+                insert(k, hashAt(k));
+            }
+        }
+        p += length;
+        endSymbol(p);
+    }
+    for (; p < size; ++p) {
+        m_symbols.push_back({data[p], 0});
+    }
+
+    flushBlock(data, blockStart, size, true);
+}
+
+void PngWriter::flushBlock(const uint8_t* data, size_t begin, size_t end, bool last) {
+    const Tables& t = tables();
+
+    uint32_t litFreq[kLitLenCodes] = {0};
+    uint32_t distFreq[kDistCodes] = {0};
+    uint64_t extraBits = 0;
+    for (const Symbol& s : m_symbols) {
+        if (s.distance == 0) {
+            litFreq[s.litLen]++;
+        } else {
+            int lc = t.lengthCode[s.litLen];
+            int dc = t.distanceCode(s.distance);
+            litFreq[257 + lc]++;
+            distFreq[dc]++;
+            extraBits += kLengthExtra[lc] + kDistExtra[dc];
+        }
+    }
+    litFreq[kEndOfBlock] = 1;
+
+    // Árvores dinâmicas
+    uint8_t litLen[kLitLenCodes];
+    uint8_t distLen[kDistCodes];
+    buildLengths(litFreq, kLitLenCodes, 15, litLen);
+    buildLengths(distFreq, kDistCodes, 15, distLen);
+    if (std::all_of(distLen, distLen + kDistCodes, [](uint8_t l) { return l == 0; })) {
+        distLen[0] = 1;  // Pelo menos um código de distância, mesmo sem uso
+    }
+
+    int hlit = kLitLenCodes;
+    while (hlit > 257 && litLen[hlit - 1] == 0) --hlit;
+    int hdist = kDistCodes;
+    while (hdist > 1 && distLen[hdist - 1] == 0) --hdist;
+
+    // Comprimentos concatenados em RLE (16 = repete o anterior, 17/18 = zeros)
+    uint8_t lengths[kLitLenCodes + kDistCodes];
+    std::memcpy(lengths, litLen, hlit);
+    std::memcpy(lengths + hlit, distLen, hdist);
+    const int total = hlit + hdist;
+
+    struct RunCode { uint8_t symbol; uint8_t extra; };
+    RunCode runs[kLitLenCodes + kDistCodes];
+    int runCount = 0;
+    uint32_t clFreq[kCodeLengthCodes] = {0};
+    for (int i = 0; i < total;) {
+        uint8_t value = lengths[i];
+        int run = 1;
+        while (i + run < total && lengths[i + run] == value) ++run;
+        int remaining = run;
+        if (value == 0) {
+            while (remaining >= 11) {
+                int n = std::min(remaining, 138);
+                runs[runCount++] = {18, static_cast<uint8_t>(n - 11)};
+                remaining -= n;
+            }
+            if (remaining >= 3) {
+                runs[runCount++] = {17, static_cast<uint8_t>(remaining - 3)};
+                remaining = 0;
+            }
+        } else {
+            runs[runCount++] = {value, 0};
+            remaining--;
+            while (remaining >= 3) {
+                int n = std::min(remaining, 6);
+                runs[runCount++] = {16, static_cast<uint8_t>(n - 3)};
+                remaining -= n;
+            }
+        }
+        while (remaining-- > 0) {
+            runs[runCount++] = {value, 0};
+        }
+        i += run;
+    }
+    for (int i = 0; i < runCount; ++i) {
+        clFreq[runs[i].symbol]++;
+    }
+
+    uint8_t clLen[kCodeLengthCodes];
+    buildLengths(clFreq, kCodeLengthCodes, 7, clLen);
+    int hclen = kCodeLengthCodes;
+    while (hclen > 4 && clLen[kCodeLengthOrder[hclen - 1]] == 0) --hclen;
+
+    // Custo em bits das três codificações possíveis
+    uint64_t dynamicBits = 3 + 14 + 3 * static_cast<uint64_t>(hclen) + extraBits;
+    uint64_t fixedBits = 3 + extraBits;
+    for (int i = 0; i < kCodeLengthCodes; ++i) {
+        static const int runExtra[3] = {2, 3, 7};
+        dynamicBits += clFreq[i] * static_cast<uint64_t>(clLen[i] + (i >= 16 ? runExtra[i - 16] : 0));
+    }
+    for (int i = 0; i < kLitLenCodes; ++i) {
+        dynamicBits += litFreq[i] * static_cast<uint64_t>(litLen[i]);
+        fixedBits += litFreq[i] * static_cast<uint64_t>(t.fixedLitLenLength[i]);
+    }
+    for (int i = 0; i < kDistCodes; ++i) {
+        dynamicBits += distFreq[i] * static_cast<uint64_t>(distLen[i]);
+        fixedBits += distFreq[i] * 5ull;
+    }
+    const size_t rawSize = end - begin;
+    const size_t storedChunks = std::max<size_t>(1, (rawSize + kMaxStored - 1) / kMaxStored);
+    const uint64_t storedBits = 8 * static_cast<uint64_t>(rawSize) + 48 * storedChunks;
+
+    if (storedBits < dynamicBits && storedBits < fixedBits) {
+        for (size_t c = 0; c < storedChunks; ++c) {
+            size_t chunkBegin = begin + c * kMaxStored;
+            size_t chunkSize = std::min(kMaxStored, end - chunkBegin);
+            putBits((last && c + 1 == storedChunks) ? 1 : 0, 1);
+            putBits(0, 2);
+            alignToByte();
+            *m_bitOut++ = static_cast<uint8_t>(chunkSize);
+            *m_bitOut++ = static_cast<uint8_t>(chunkSize >> 8);
+            *m_bitOut++ = static_cast<uint8_t>(~chunkSize);
+            *m_bitOut++ = static_cast<uint8_t>(~chunkSize >> 8);
+            std::memcpy(m_bitOut, data + chunkBegin, chunkSize);
+            m_bitOut += chunkSize;
+        }
+        return;
+    }
+
+    const uint8_t* litLengths;
+    const uint16_t* litCodes;
+    const uint8_t* distLengths;
+    const uint16_t* distCodes;
+    uint16_t litCode[kLitLenCodes];
+    uint16_t distCode[kDistCodes];
+
+    putBits(last ? 1 : 0, 1);
+    if (fixedBits <= dynamicBits) {
+        putBits(1, 2);
+        litLengths = t.fixedLitLenLength;
+        litCodes = t.fixedLitLenCode;
+        distLengths = t.fixedDistLength;
+        distCodes = t.fixedDistCode;
+    } else {
+        putBits(2, 2);
+        putBits(hlit - 257, 5);
+        putBits(hdist - 1, 5);
+        putBits(hclen - 4, 4);
+        for (int i = 0; i < hclen; ++i) {
+            putBits(clLen[kCodeLengthOrder[i]], 3);
+        }
+        uint16_t clCode[kCodeLengthCodes];
+        assignCodes(clLen, kCodeLengthCodes, clCode);
+        for (int i = 0; i < runCount; ++i) {
+            putBits(clCode[runs[i].symbol], clLen[runs[i].symbol]);
+            if (runs[i].symbol == 16) putBits(runs[i].extra, 2);
+            else if (runs[i].symbol == 17) putBits(runs[i].extra, 3);
+            else if (runs[i].symbol == 18) putBits(runs[i].extra, 7);
+        }
+        assignCodes(litLen, kLitLenCodes, litCode);
+        assignCodes(distLen, kDistCodes, distCode);
+        litLengths = litLen;
+        litCodes = litCode;
+        distLengths = distLen;
+        distCodes = distCode;
+    }
+
+    for (const Symbol& s : m_symbols) {
+        if (s.distance == 0) {
+            putBits(litCodes[s.litLen], litLengths[s.litLen]);
+        } else {
+            int lc = t.lengthCode[s.litLen];
+            putBits(litCodes[257 + lc], litLengths[257 + lc]);
+            putBits(s.litLen - kLengthBase[lc], kLengthExtra[lc]);
+            int dc = t.distanceCode(s.distance);
+            putBits(distCodes[dc], distLengths[dc]);
+            putBits(s.distance - kDistBase[dc], kDistExtra[dc]);
+        }
+    }
+    putBits(litCodes[kEndOfBlock], litLengths[kEndOfBlock]);
+}
+
+void PngWriter::putBits(uint32_t bits, int count) {
+    m_bitBuffer |= static_cast<uint64_t>(bits) << m_bitCount;
+    m_bitCount += count;
+    if (m_bitCount >= 32) {
+        uint32_t word = static_cast<uint32_t>(m_bitBuffer);
+        m_bitOut[0] = static_cast<uint8_t>(word);
+        m_bitOut[1] = static_cast<uint8_t>(word >> 8);
+        m_bitOut[2] = static_cast<uint8_t>(word >> 16);
+        m_bitOut[3] = static_cast<uint8_t>(word >> 24);
+        m_bitOut += 4;
+        m_bitBuffer >>= 32;
+        m_bitCount -= 32;
+    }
+}
+
+void PngWriter::alignToByte() {
+    while (m_bitCount > 0) {
+        *m_bitOut++ = static_cast<uint8_t>(m_bitBuffer);
+        m_bitBuffer >>= 8;
+        m_bitCount -= 8;
+    }
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+}
+
+void PngWriter::beginChunk(const char* type) {
+    m_chunkStart = m_out.size();
+    appendBigEndian(m_out, 0);  // Comprimento, preenchido em endChunk()
+    m_out.insert(m_out.end(), type, type + 4);
+}
+
+void PngWriter::endChunk() {
+    uint32_t length = static_cast<uint32_t>(m_out.size() - m_chunkStart - 8);
+    m_out[m_chunkStart] = static_cast<uint8_t>(length >> 24);
+    m_out[m_chunkStart + 1] = static_cast<uint8_t>(length >> 16);
+    m_out[m_chunkStart + 2] = static_cast<uint8_t>(length >> 8);
+    m_out[m_chunkStart + 3] = static_cast<uint8_t>(length);
+    uint32_t crc = crc32(0, m_out.data() + m_chunkStart + 4, m_out.size() - m_chunkStart - 4);
+    appendBigEndian(m_out, crc);
+}
+
+} // namespace Raster
+} // namespace SFinGe
@@ -0,0 +1,99 @@
+#ifndef RASTER_PNG_WRITER_H
+#define RASTER_PNG_WRITER_H
+
+#include "gray8.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Compromisso entre tempo de codificação e tamanho do PNG
+ *
+ * Fast: filtro Sub em todas as linhas e deflate guloso com cadeias curtas
+ * (equivalente ao nível 1 do zlib). Balanced: filtro Paeth e busca
+ * preguiçosa moderada. Small: filtro escolhido por linha (menor soma dos
+ * resíduos) e busca longa.
+ */
+enum class PngProfile {
+    Fast,
+    Balanced,
+    Small
+};
+
+/**
+ * @brief "fast", "balanced" ou "small"; false (profile intacto) para outro nome
+ */
+bool parsePngProfile(const std::string& name, PngProfile& profile);
+const char* pngProfileName(PngProfile profile);
+
+/**
+ * @brief Codificador PNG Grayscale8 com deflate próprio
+ *
+ * Os buffers (linhas filtradas, tabelas de hash, símbolos e saída) são
+ * mantidos entre chamadas: depois da primeira imagem de um tamanho não há
+ * mais alocações. Uma instância não é thread-safe; forThread() devolve uma
+ * por thread.
+ */
+class PngWriter {
+public:
+    explicit PngWriter(PngProfile profile = PngProfile::Balanced);
+
+    void setProfile(PngProfile profile) { m_profile = profile; }
+    PngProfile profile() const { return m_profile; }
+
+    /**
+     * @brief Codifica a imagem; o resultado vale até a próxima chamada
+     *
+     * @param dpi Resolução gravada no chunk pHYs (0 = sem pHYs)
+     */
+    const std::vector<uint8_t>& encode(ConstGray8View image, int dpi = 0);
+
+    /**
+     * @brief encode() e grava o arquivo
+     */
+    bool write(ConstGray8View image, const std::string& path, int dpi = 0);
+
+    /**
+     * @brief Instância da thread atual (buffers reaproveitados pelos writers do lote)
+     */
+    static PngWriter& forThread();
+
+private:
+    struct Symbol {
+        uint16_t litLen;    // Literal (distance == 0) ou comprimento 3..258
+        uint16_t distance;  // 1..32768
+    };
+
+    void filterRows(ConstGray8View image);
+    void deflate(const uint8_t* data, size_t size);
+    void parse(const uint8_t* data, size_t size);
+    void flushBlock(const uint8_t* data, size_t begin, size_t end, bool last);
+
+    void putBits(uint32_t bits, int count);
+    void alignToByte();
+    void beginChunk(const char* type);
+    void endChunk();
+
+    PngProfile m_profile;
+
+    std::vector<uint8_t> m_filtered;   // Linhas com o byte de filtro, entrada do deflate
+    std::vector<uint8_t> m_candidates; // Saída dos 5 filtros de uma linha (perfil Small)
+    std::vector<uint8_t> m_zeroRow;    // Linha "acima" da primeira
+    std::vector<int32_t> m_head;       // Última posição de cada hash (-1 = vazio)
+    std::vector<int32_t> m_prev;       // Posição anterior com o mesmo hash, por janela
+    std::vector<Symbol> m_symbols;     // Símbolos do bloco corrente
+
+    std::vector<uint8_t> m_out;
+    size_t m_chunkStart = 0;
+    uint8_t* m_bitOut = nullptr;       // Posição de escrita do deflate dentro de m_out
+    uint64_t m_bitBuffer = 0;
+    int m_bitCount = 0;
+};
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_PNG_WRITER_H
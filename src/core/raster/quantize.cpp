@@ -0,0 +1,105 @@
+#include "quantize.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTER_QUANTIZE_SSE2 1
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+template<typename T>
+inline uint8_t quantizeScalar(T value, T offset, T gain, bool invert) {
+    T v = (value - offset) * gain;
+    if (invert) {
+        v = T(1) - v;
+    }
+    // Comparação direta também mapeia NaN para 0
+    v = v > T(0) ? std::min(v, T(1)) : T(0);
+    return static_cast<uint8_t>(v * T(255));
+}
+
+} // namespace
+
+void quantizeRow(const float* src, uint8_t* dst, int count, const QuantizeOptions& options) {
+    int i = 0;
+#ifdef RASTER_QUANTIZE_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 offset = _mm_set1_ps(options.offset);
+    const __m128 gain = _mm_set1_ps(options.gain);
+    for (; i + 16 <= count; i += 16) {
+        __m128i q[4];
+        for (int k = 0; k < 4; ++k) {
+            __m128 v = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(src + i + 4 * k), offset), gain);
+            if (options.invert) {
+                v = _mm_sub_ps(one, v);
+            }
+            // max(v, 0) devolve 0 para NaN
+            v = _mm_min_ps(_mm_max_ps(v, zero), one);
+            q[k] = _mm_cvttps_epi32(_mm_mul_ps(v, scale));
+        }
+        __m128i lo = _mm_packs_epi32(q[0], q[1]);
+        __m128i hi = _mm_packs_epi32(q[2], q[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = quantizeScalar<float>(src[i], options.offset, options.gain, options.invert);
+    }
+}
+
+void quantizeRow(const double* src, uint8_t* dst, int count, const QuantizeOptions& options) {
+    int i = 0;
+#ifdef RASTER_QUANTIZE_SSE2
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d scale = _mm_set1_pd(255.0);
+    const __m128d offset = _mm_set1_pd(options.offset);
+    const __m128d gain = _mm_set1_pd(options.gain);
+    for (; i + 16 <= count; i += 16) {
+        __m128i q[4];
+        for (int k = 0; k < 4; ++k) {
+            __m128i halves[2];
+            for (int h = 0; h < 2; ++h) {
+                __m128d v = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(src + i + 4 * k + 2 * h), offset), gain);
+                if (options.invert) {
+                    v = _mm_sub_pd(one, v);
+                }
+                v = _mm_min_pd(_mm_max_pd(v, zero), one);
+                halves[h] = _mm_cvttpd_epi32(_mm_mul_pd(v, scale));
+            }
+            q[k] = _mm_unpacklo_epi64(halves[0], halves[1]);
+        }
+        __m128i lo = _mm_packs_epi32(q[0], q[1]);
+        __m128i hi = _mm_packs_epi32(q[2], q[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = quantizeScalar<double>(src[i], options.offset, options.gain, options.invert);
+    }
+}
+
+void quantizePlane(const float* src, int width, int height,
+                   uint8_t* dst, int dstStride, const QuantizeOptions& options) {
+    for (int y = 0; y < height; ++y) {
+        quantizeRow(src + static_cast<size_t>(y) * width, dst + static_cast<size_t>(y) * dstStride,
+                    width, options);
+    }
+}
+
+void quantizePlane(const double* src, int width, int height,
+                   uint8_t* dst, int dstStride, const QuantizeOptions& options) {
+    for (int y = 0; y < height; ++y) {
+        quantizeRow(src + static_cast<size_t>(y) * width, dst + static_cast<size_t>(y) * dstStride,
+                    width, options);
+    }
+}
+
+} // namespace Raster
+} // namespace SFinGe
@@ -0,0 +1,51 @@
+#ifndef RASTER_QUANTIZE_H
+#define RASTER_QUANTIZE_H
+
+#include <cstdint>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Opções de conversão de planos float/double para 8 bits
+ *
+ * Cada amostra é transformada em v = (src - offset) * gain, invertida
+ * opcionalmente (v = 1 - v), limitada a [0, 1] e escalada para [0, 255]
+ * com truncamento, como nas conversões escalares originais.
+ */
+struct QuantizeOptions {
+    float offset = 0.0f;
+    float gain = 1.0f;
+    bool invert = false;
+};
+
+/**
+ * @brief Quantiza uma linha de floats para 8 bits (SSE2 quando disponível)
+ */
+void quantizeRow(const float* src, uint8_t* dst, int count,
+                 const QuantizeOptions& options = QuantizeOptions());
+
+/**
+ * @brief Quantiza uma linha de doubles para 8 bits (SSE2 quando disponível)
+ */
+void quantizeRow(const double* src, uint8_t* dst, int count,
+                 const QuantizeOptions& options = QuantizeOptions());
+
+/**
+ * @brief Quantiza um plano inteiro direto no buffer de destino
+ * @param src Plano de origem (row-major, passo = width)
+ * @param dst Primeiro byte do destino (ex.: QImage::bits() ou Image::data())
+ * @param dstStride Bytes por linha no destino (ex.: QImage::bytesPerLine())
+ */
+void quantizePlane(const float* src, int width, int height,
+                   uint8_t* dst, int dstStride,
+                   const QuantizeOptions& options = QuantizeOptions());
+
+void quantizePlane(const double* src, int width, int height,
+                   uint8_t* dst, int dstStride,
+                   const QuantizeOptions& options = QuantizeOptions());
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_QUANTIZE_H
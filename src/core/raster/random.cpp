@@ -0,0 +1,259 @@
+#include "random.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTER_RANDOM_SSE2 1
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+// Constantes do Philox4x32 (multiplicadores e incrementos da chave)
+constexpr uint32_t kMul0 = 0xD2511F53u;
+constexpr uint32_t kMul1 = 0xCD9E8D57u;
+constexpr uint32_t kWeyl0 = 0x9E3779B9u;
+constexpr uint32_t kWeyl1 = 0xBB67AE85u;
+constexpr int kRounds = 10;
+
+// Cada grupo = 4 blocos Philox = 16 amostras
+constexpr size_t kGroupSize = 16;
+
+constexpr float kUnit = 1.0f / 16777216.0f;
+constexpr float kTwoPi = 6.28318530717958647692f;
+
+#ifdef RASTER_RANDOM_SSE2
+// Produto 32x32 -> 64 das quatro lanes, separado em metade baixa e alta
+inline void mulHiLo(__m128i a, __m128i b, __m128i& lo, __m128i& hi) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    lo = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    hi = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+}
+
+// Quatro blocos consecutivos a partir de firstBlock; x[w] = palavra w de cada bloco
+void philoxGroup(const RandomStream& stream, uint64_t firstBlock, __m128i x[4]) {
+    uint32_t lo[4];
+    uint32_t hi[4];
+    for (int lane = 0; lane < 4; ++lane) {
+        uint64_t block = firstBlock + lane;
+        lo[lane] = static_cast<uint32_t>(block);
+        hi[lane] = static_cast<uint32_t>(block >> 32);
+    }
+    __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo));
+    __m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi));
+    __m128i c2 = _mm_set1_epi32(static_cast<int>(stream.image));
+    __m128i c3 = _mm_set1_epi32(static_cast<int>(stream.stage));
+    __m128i k0 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream.seed)));
+    __m128i k1 = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream.seed >> 32)));
+    const __m128i m0 = _mm_set1_epi32(static_cast<int>(kMul0));
+    const __m128i m1 = _mm_set1_epi32(static_cast<int>(kMul1));
+    const __m128i w0 = _mm_set1_epi32(static_cast<int>(kWeyl0));
+    const __m128i w1 = _mm_set1_epi32(static_cast<int>(kWeyl1));
+
+    for (int round = 0; round < kRounds; ++round) {
+        if (round > 0) {
+            k0 = _mm_add_epi32(k0, w0);
+            k1 = _mm_add_epi32(k1, w1);
+        }
+        __m128i lo0, hi0, lo1, hi1;
+        mulHiLo(m0, c0, lo0, hi0);
+        mulHiLo(m1, c2, lo1, hi1);
+        c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), k0);
+        c1 = lo1;
+        c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), k1);
+        c3 = lo0;
+    }
+    x[0] = c0;
+    x[1] = c1;
+    x[2] = c2;
+    x[3] = c3;
+}
+
+// 24 bits altos -> [0, 1)
+inline __m128 unitPs(__m128i x) {
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)), _mm_set1_ps(kUnit));
+}
+
+// ln(u) para u normal e positivo: u = m * 2^e com m em [sqrt(1/2), sqrt(2)),
+// ln(m) = 2 atanh(s), s = (m - 1) / (m + 1), série até s^9 (erro < 1e-9)
+inline __m128 logPs(__m128 u) {
+    __m128i bits = _mm_castps_si128(u);
+    __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)),
+                                             _mm_set1_epi32(0x3F800000)));
+    __m128 large = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+    m = _mm_or_ps(_mm_and_ps(large, _mm_mul_ps(m, _mm_set1_ps(0.5f))), _mm_andnot_ps(large, m));
+    exponent = _mm_sub_epi32(exponent, _mm_castps_si128(large));
+
+    __m128 f = _mm_sub_ps(m, _mm_set1_ps(1.0f));
+    __m128 s = _mm_div_ps(f, _mm_add_ps(f, _mm_set1_ps(2.0f)));
+    __m128 z = _mm_mul_ps(s, s);
+    __m128 poly = _mm_add_ps(_mm_set1_ps(1.0f / 7.0f), _mm_mul_ps(z, _mm_set1_ps(1.0f / 9.0f)));
+    poly = _mm_add_ps(_mm_set1_ps(1.0f / 5.0f), _mm_mul_ps(z, poly));
+    poly = _mm_add_ps(_mm_set1_ps(1.0f / 3.0f), _mm_mul_ps(z, poly));
+    poly = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(z, poly));
+    __m128 lnM = _mm_mul_ps(_mm_add_ps(s, s), poly);
+    return _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(exponent), _mm_set1_ps(0.693147181f)), lnM);
+}
+
+// sin e cos de 2*pi*t para t em [0, 1): quadrante q = round(4t), resto em
+// [-pi/4, pi/4] por Taylor (erro < 4e-7) e troca/sinal conforme q
+inline void sinCosTurnsPs(__m128 t, __m128& sinOut, __m128& cosOut) {
+    __m128i q = _mm_cvtps_epi32(_mm_mul_ps(t, _mm_set1_ps(4.0f)));
+    __m128 a = _mm_mul_ps(_mm_sub_ps(t, _mm_mul_ps(_mm_cvtepi32_ps(q), _mm_set1_ps(0.25f))),
+                          _mm_set1_ps(kTwoPi));
+    __m128 a2 = _mm_mul_ps(a, a);
+
+    __m128 s = _mm_add_ps(_mm_set1_ps(1.0f / 120.0f), _mm_mul_ps(a2, _mm_set1_ps(-1.0f / 5040.0f)));
+    s = _mm_add_ps(_mm_set1_ps(-1.0f / 6.0f), _mm_mul_ps(a2, s));
+    s = _mm_add_ps(a, _mm_mul_ps(_mm_mul_ps(a, a2), s));
+
+    __m128 c = _mm_add_ps(_mm_set1_ps(-1.0f / 720.0f), _mm_mul_ps(a2, _mm_set1_ps(1.0f / 40320.0f)));
+    c = _mm_add_ps(_mm_set1_ps(1.0f / 24.0f), _mm_mul_ps(a2, c));
+    c = _mm_add_ps(_mm_set1_ps(-0.5f), _mm_mul_ps(a2, c));
+    c = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(a2, c));
+
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    __m128 sinBase = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+    __m128 cosBase = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+    // Bit 1 de q (ou de q + 1) vira o bit de sinal
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+    sinOut = _mm_xor_ps(sinBase, sinSign);
+    cosOut = _mm_xor_ps(cosBase, cosSign);
+}
+
+// Transpõe (palavra, bloco) -> ordem das amostras e grava 16 floats
+inline void storeGroup(float* dst, __m128 v0, __m128 v1, __m128 v2, __m128 v3) {
+    _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+    _mm_storeu_ps(dst, v0);
+    _mm_storeu_ps(dst + 4, v1);
+    _mm_storeu_ps(dst + 8, v2);
+    _mm_storeu_ps(dst + 12, v3);
+}
+
+void uniformGroup(const RandomStream& stream, uint64_t group, float* dst) {
+    __m128i x[4];
+    philoxGroup(stream, group * 4, x);
+    storeGroup(dst, unitPs(x[0]), unitPs(x[1]), unitPs(x[2]), unitPs(x[3]));
+}
+
+void normalGroup(const RandomStream& stream, uint64_t group, float* dst) {
+    __m128i x[4];
+    philoxGroup(stream, group * 4, x);
+    const __m128 unit = _mm_set1_ps(kUnit);
+    const __m128 minusTwo = _mm_set1_ps(-2.0f);
+    __m128 n[4];
+    for (int pair = 0; pair < 2; ++pair) {
+        // u1 em (0, 1] para o log; u2 em [0, 1) para o ângulo
+        __m128 u1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_srli_epi32(x[2 * pair], 8),
+                                                             _mm_set1_epi32(1))), unit);
+        __m128 radius = _mm_sqrt_ps(_mm_mul_ps(minusTwo, logPs(u1)));
+        __m128 sinT, cosT;
+        sinCosTurnsPs(unitPs(x[2 * pair + 1]), sinT, cosT);
+        n[2 * pair] = _mm_mul_ps(radius, cosT);
+        n[2 * pair + 1] = _mm_mul_ps(radius, sinT);
+    }
+    storeGroup(dst, n[0], n[1], n[2], n[3]);
+}
+#else
+std::array<uint32_t, 4> blockWords(const RandomStream& stream, uint64_t block) {
+    return philox4x32({static_cast<uint32_t>(block), static_cast<uint32_t>(block >> 32),
+                       stream.image, stream.stage},
+                      {static_cast<uint32_t>(stream.seed), static_cast<uint32_t>(stream.seed >> 32)});
+}
+
+void uniformGroup(const RandomStream& stream, uint64_t group, float* dst) {
+    for (int b = 0; b < 4; ++b) {
+        auto words = blockWords(stream, group * 4 + b);
+        for (int w = 0; w < 4; ++w) {
+            dst[4 * b + w] = static_cast<float>(words[w] >> 8) * kUnit;
+        }
+    }
+}
+
+void normalGroup(const RandomStream& stream, uint64_t group, float* dst) {
+    for (int b = 0; b < 4; ++b) {
+        auto words = blockWords(stream, group * 4 + b);
+        for (int pair = 0; pair < 2; ++pair) {
+            float u1 = static_cast<float>((words[2 * pair] >> 8) + 1) * kUnit;
+            float angle = kTwoPi * static_cast<float>(words[2 * pair + 1] >> 8) * kUnit;
+            float radius = std::sqrt(-2.0f * std::log(u1));
+            dst[4 * b + 2 * pair] = radius * std::cos(angle);
+            dst[4 * b + 2 * pair + 1] = radius * std::sin(angle);
+        }
+    }
+}
+#endif
+
+// Gera por grupos inteiros, então a amostra i não depende de offset/count
+template <typename GroupFn>
+void fillGroups(const RandomStream& stream, uint64_t offset, float* dst, size_t count, GroupFn groupFn) {
+    size_t done = 0;
+    while (done < count) {
+        uint64_t index = offset + done;
+        uint64_t group = index / kGroupSize;
+        size_t skip = static_cast<size_t>(index % kGroupSize);
+        size_t take = std::min(kGroupSize - skip, count - done);
+        if (take == kGroupSize) {
+            groupFn(stream, group, dst + done);
+        } else {
+            float tmp[kGroupSize];
+            groupFn(stream, group, tmp);
+            std::memcpy(dst + done, tmp + skip, take * sizeof(float));
+        }
+        done += take;
+    }
+}
+
+} // namespace
+
+std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key) {
+    for (int round = 0; round < kRounds; ++round) {
+        if (round > 0) {
+            key[0] += kWeyl0;
+            key[1] += kWeyl1;
+        }
+        uint64_t p0 = static_cast<uint64_t>(kMul0) * counter[0];
+        uint64_t p1 = static_cast<uint64_t>(kMul1) * counter[2];
+        counter = {static_cast<uint32_t>(p1 >> 32) ^ counter[1] ^ key[0], static_cast<uint32_t>(p1),
+                   static_cast<uint32_t>(p0 >> 32) ^ counter[3] ^ key[1], static_cast<uint32_t>(p0)};
+    }
+    return counter;
+}
+
+uint64_t deriveSeed(uint64_t parent, uint64_t index) {
+    // Duas rodadas do finalizador splitmix64: uma sobre o pai, outra com o índice
+    auto mix = [](uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    };
+    return mix(mix(parent + 0x9E3779B97F4A7C15ull) + (index + 1) * 0xD1B54A32D192ED03ull);
+}
+
+void fillUniform(const RandomStream& stream, uint64_t offset, float* dst, size_t count) {
+    fillGroups(stream, offset, dst, count, uniformGroup);
+}
+
+void fillNormal(const RandomStream& stream, uint64_t offset, float* dst, size_t count,
+                float mean, float stddev) {
+    fillGroups(stream, offset, dst, count, normalGroup);
+    if (mean != 0.0f || stddev != 1.0f) {
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = mean + stddev * dst[i];
+        }
+    }
+}
+
+} // namespace Raster
+} // namespace SFinGe
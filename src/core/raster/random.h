@@ -0,0 +1,106 @@
+#ifndef RASTER_RANDOM_H
+#define RASTER_RANDOM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Etapas que consomem ruído por pixel; cada uma tem sua própria sequência
+ */
+enum class NoiseStage : uint32_t {
+    VersionNoise = 1,   ///< Ruído uniforme das versões (BatchGenerator)
+    RidgeNoise = 2,     ///< Ruído gaussiano do render das cristas
+    PhaseNoise = 3      ///< Variação gaussiana do campo de fase
+};
+
+/**
+ * @brief Chave de uma sequência do gerador por contador: (seed, imagem, etapa)
+ *
+ * A amostra i de uma sequência é função pura de (chave, i): não há estado
+ * compartilhado, então linhas e blocos podem ser gerados em qualquer ordem
+ * e em qualquer número de threads com o mesmo resultado.
+ */
+struct RandomStream {
+    uint64_t seed = 0;
+    uint32_t image = 0;
+    uint32_t stage = 0;
+
+    RandomStream() = default;
+    RandomStream(uint64_t s, uint32_t img, NoiseStage st)
+        : seed(s), image(img), stage(static_cast<uint32_t>(st)) {}
+};
+
+/**
+ * @brief Philox4x32-10 (Salmon et al., 2011): 4 palavras de 32 bits por contador
+ */
+std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key);
+
+/**
+ * @brief Preenche dst com as amostras [offset, offset + count) uniformes em [0, 1)
+ *
+ * Cada bloco Philox (contador = índice do bloco, imagem, etapa; chave = seed)
+ * rende 4 amostras de 24 bits. Com SSE2 quatro blocos são gerados por passo.
+ */
+void fillUniform(const RandomStream& stream, uint64_t offset, float* dst, size_t count);
+
+/**
+ * @brief Preenche dst com as amostras [offset, offset + count) de N(mean, stddev^2)
+ *
+ * Box–Muller sobre os pares de palavras de cada bloco; com SSE2 log, seno e
+ * cosseno são avaliados por polinômios em quatro blocos de uma vez.
+ */
+void fillNormal(const RandomStream& stream, uint64_t offset, float* dst, size_t count,
+                float mean = 0.0f, float stddev = 1.0f);
+
+/**
+ * @brief Subsequências de uma identidade; cada etapa sorteia da sua própria semente
+ */
+enum class SeedStream : uint64_t {
+    Parameters = 1,     ///< Forma, classe e parâmetros sorteados no lote
+    SingularPoints = 2,
+    Orientation = 3,
+    Density = 4,
+    Ridge = 5,
+    Minutiae = 6,
+    PixelNoise = 7,     ///< Chave das sequências Philox (RidgeNoise, PhaseNoise)
+    Versions = 8        ///< Raiz das sementes de versão
+};
+
+/**
+ * @brief Semente filha (parent, index) por mistura splitmix64
+ *
+ * Árvore de sementes do lote: mestre -> identidade N -> etapas e versões.
+ * Cada nó depende só do caminho até ele, então a identidade N (e cada uma
+ * das suas versões) sai igual em qualquer worker, ordem ou máquina.
+ */
+uint64_t deriveSeed(uint64_t parent, uint64_t index);
+
+inline uint64_t identitySeed(uint64_t masterSeed, uint64_t identity) {
+    return deriveSeed(masterSeed, identity);
+}
+
+inline uint64_t streamSeed(uint64_t seed, SeedStream stream) {
+    return deriveSeed(seed, static_cast<uint64_t>(stream));
+}
+
+inline uint64_t versionSeed(uint64_t identity, uint64_t version) {
+    return deriveSeed(streamSeed(identity, SeedStream::Versions), version);
+}
+
+/**
+ * @brief Semeia um mt19937 com os 64 bits da semente
+ */
+inline void seedEngine(std::mt19937& engine, uint64_t seed) {
+    std::seed_seq sequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+    engine.seed(sequence);
+}
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_RANDOM_H
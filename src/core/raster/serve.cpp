@@ -0,0 +1,760 @@
+#include "serve.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+void appendUtf8(std::string& out, unsigned code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    return out + "\"";
+}
+
+std::string jsonNumber(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.3f", value);
+    return text;
+}
+
+const char* frameFormatName(FrameFormat format) {
+    switch (format) {
+        case FrameFormat::Gray8:
+            return "gray8";
+        case FrameFormat::Wsq:
+            return "wsq";
+        default:
+            return "png";
+    }
+}
+
+// Parser de um objeto plano; pos avança sobre o texto
+class Parser {
+public:
+    explicit Parser(const std::string& text) : m_text(text) {}
+
+    void skipSpace() {
+        while (m_pos < m_text.size() && std::strchr(" \t\r\n", m_text[m_pos]) && m_text[m_pos] != '\0') {
+            ++m_pos;
+        }
+    }
+    bool consume(char c) {
+        skipSpace();
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+    bool atEnd() {
+        skipSpace();
+        return m_pos == m_text.size();
+    }
+    char peek() {
+        skipSpace();
+        return m_pos < m_text.size() ? m_text[m_pos] : '\0';
+    }
+
+    bool string(std::string& out) {
+        if (!consume('"')) {
+            return false;
+        }
+        out.clear();
+        while (m_pos < m_text.size()) {
+            const char c = m_text[m_pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_pos >= m_text.size()) {
+                return false;
+            }
+            const char e = m_text[m_pos++];
+            switch (e) {
+                case '"':
+                case '\\':
+                case '/':
+                    out += e;
+                    break;
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'n':
+                    out += '\n';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'u': {
+                    if (m_pos + 4 > m_text.size()) {
+                        return false;
+                    }
+                    char* end = nullptr;
+                    const std::string hex = m_text.substr(m_pos, 4);
+                    const unsigned code = static_cast<unsigned>(std::strtoul(hex.c_str(), &end, 16));
+                    if (end != hex.c_str() + 4) {
+                        return false;
+                    }
+                    appendUtf8(out, code);
+                    m_pos += 4;
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+    // Gramática de número do JSON: o texto é ecoado como veio (o "id"), então
+    // "+5", ".5" e "05", que o strtod aceita, não podem passar
+    bool number(std::string& out) {
+        skipSpace();
+        const size_t start = m_pos;
+        consumeChar('-');
+        if (!consumeChar('0') && !digits()) {  // Um zero à esquerda é o número inteiro
+            return false;
+        }
+        if (consumeChar('.') && !digits()) {
+            return false;
+        }
+        if (consumeChar('e') || consumeChar('E')) {
+            if (!consumeChar('+')) {
+                consumeChar('-');
+            }
+            if (!digits()) {
+                return false;
+            }
+        }
+        out = m_text.substr(start, m_pos - start);
+        return true;
+    }
+
+    bool word(const char* expected) {
+        skipSpace();
+        const size_t length = std::strlen(expected);
+        if (m_text.compare(m_pos, length, expected) == 0) {
+            m_pos += length;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    bool consumeChar(char c) {
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+    bool digits() {
+        const size_t start = m_pos;
+        while (m_pos < m_text.size() && m_text[m_pos] >= '0' && m_text[m_pos] <= '9') {
+            ++m_pos;
+        }
+        return m_pos > start;
+    }
+
+    const std::string& m_text;
+    size_t m_pos = 0;
+};
+
+} // namespace
+
+bool ServeRequest::parse(const std::string& line, std::string& error) {
+    m_values.clear();
+    Parser parser(line);
+    if (!parser.consume('{')) {
+        error = "request is not a JSON object";
+        return false;
+    }
+    bool more = !parser.consume('}');
+    while (more) {
+        std::string name;
+        if (!parser.string(name) || !parser.consume(':')) {
+            error = "expected \"name\": value";
+            return false;
+        }
+        Value value;
+        const char next = parser.peek();
+        if (next == '"') {
+            value.kind = Kind::Text;
+            if (!parser.string(value.text)) {
+                error = "bad string for " + name;
+                return false;
+            }
+        } else if (next == '{' || next == '[') {
+            error = name + ": nested values are not supported";
+            return false;
+        } else if (parser.word("true") || parser.word("false")) {
+            value.kind = Kind::Bool;
+            value.flag = next == 't';
+        } else if (parser.word("null")) {
+            value.kind = Kind::Null;
+        } else {
+            value.kind = Kind::Number;
+            if (!parser.number(value.text)) {
+                error = "bad value for " + name;
+                return false;
+            }
+        }
+        m_values[name] = value;
+        more = parser.consume(',');
+        if (!more && !parser.consume('}')) {
+            error = "expected , or } after " + name;
+            return false;
+        }
+    }
+    if (!parser.atEnd()) {
+        error = "trailing text after the object";
+        return false;
+    }
+    return true;
+}
+
+std::string ServeRequest::text(const std::string& name, const std::string& fallback) const {
+    auto it = m_values.find(name);
+    return it != m_values.end() && it->second.kind == Kind::Text ? it->second.text : fallback;
+}
+
+bool ServeRequest::integer(const std::string& name, int64_t& value) const {
+    auto it = m_values.find(name);
+    if (it == m_values.end() || it->second.kind != Kind::Number) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    const long long parsed = std::strtoll(it->second.text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool ServeRequest::unsignedInteger(const std::string& name, uint64_t& value) const {
+    auto it = m_values.find(name);
+    if (it == m_values.end() || it->second.kind != Kind::Number || it->second.text[0] == '-') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long parsed = std::strtoull(it->second.text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE) {  // Fora da faixa o strtoull satura em vez de falhar
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool ServeRequest::real(const std::string& name, double& value) const {
+    auto it = m_values.find(name);
+    if (it == m_values.end() || it->second.kind != Kind::Number) {
+        return false;
+    }
+    value = std::strtod(it->second.text.c_str(), nullptr);
+    return true;
+}
+
+bool ServeRequest::flag(const std::string& name, bool& value) const {
+    auto it = m_values.find(name);
+    if (it == m_values.end() || it->second.kind != Kind::Bool) {
+        return false;
+    }
+    value = it->second.flag;
+    return true;
+}
+
+std::string ServeRequest::idJson() const {
+    auto it = m_values.find("id");
+    if (it == m_values.end()) {
+        return "null";
+    }
+    switch (it->second.kind) {
+        case Kind::Text:
+            return jsonString(it->second.text);
+        case Kind::Number:
+            return it->second.text;
+        case Kind::Bool:
+            return it->second.flag ? "true" : "false";
+        default:
+            return "null";
+    }
+}
+
+std::string base64Encode(const uint8_t* data, size_t size) {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((size + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < size; i += 3) {
+        const uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out += kAlphabet[v >> 18];
+        out += kAlphabet[(v >> 12) & 63];
+        out += kAlphabet[(v >> 6) & 63];
+        out += kAlphabet[v & 63];
+    }
+    if (i < size) {
+        const uint32_t v = (data[i] << 16) | (i + 1 < size ? data[i + 1] << 8 : 0);
+        out += kAlphabet[v >> 18];
+        out += kAlphabet[(v >> 12) & 63];
+        out += i + 1 < size ? kAlphabet[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+#ifdef _WIN32
+
+int runServer(const ServeOptions& options, ServeHandler handler) {
+    (void)options;
+    (void)handler;
+    std::cerr << "serve needs Unix domain sockets (not available in this build)\n";
+    return 1;
+}
+
+#else
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<bool> g_stop{false};
+
+void requestStop(int) {
+    g_stop = true;
+}
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Quanto uma resposta pode esperar um cliente que não lê; depois ele é desconectado
+constexpr int kSendTimeoutSeconds = 10;
+
+// Fechada quando a última referência sai: a thread de leitura ou um pedido ainda na fila
+struct Connection {
+    int fd = -1;
+    std::atomic<bool> finished{false};  // Thread de leitura terminou; pode ser unida
+    std::atomic<bool> dropped{false};   // Parou de ler; as respostas seguintes são descartadas
+    std::mutex writeMutex;
+
+    ~Connection() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    // Uma resposta por linha; um cliente que saiu só perde a resposta. O socket
+    // tem SO_SNDTIMEO: se o buffer não esvazia a tempo, a conexão cai (o
+    // shutdown também acorda a thread de leitura)
+    void send(const std::string& line) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        const char* data = line.data();
+        size_t size = line.size();
+        while (size > 0 && !dropped) {
+            const ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                std::cerr << "Dropping a client that stopped reading its responses\n";
+                dropped = true;
+                ::shutdown(fd, SHUT_RDWR);
+                return;
+            }
+            if (written <= 0) {
+                return;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+};
+
+struct Job {
+    std::shared_ptr<Connection> connection;
+    ServeRequest request;
+    Clock::time_point queued;
+};
+
+// Latências dos últimos kWindow pedidos
+class LatencyWindow {
+public:
+    void add(double milliseconds) {
+        if (m_samples.size() < kWindow) {
+            m_samples.push_back(milliseconds);
+        } else {
+            m_samples[m_next] = milliseconds;
+        }
+        m_next = (m_next + 1) % kWindow;
+    }
+
+    std::string json() const {
+        std::vector<double> sorted = m_samples;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double sample : sorted) {
+            sum += sample;
+        }
+        auto percentile = [&sorted](double p) {
+            if (sorted.empty()) {
+                return 0.0;
+            }
+            const size_t index = static_cast<size_t>(std::ceil(p * sorted.size())) - 1;
+            return sorted[std::min(index, sorted.size() - 1)];
+        };
+        return "{\"count\":" + std::to_string(sorted.size()) +
+               ",\"mean\":" + jsonNumber(sorted.empty() ? 0.0 : sum / sorted.size()) +
+               ",\"p50\":" + jsonNumber(percentile(0.50)) + ",\"p95\":" + jsonNumber(percentile(0.95)) +
+               ",\"p99\":" + jsonNumber(percentile(0.99)) +
+               ",\"max\":" + jsonNumber(sorted.empty() ? 0.0 : sorted.back()) + "}";
+    }
+
+private:
+    static constexpr size_t kWindow = 1024;
+    std::vector<double> m_samples;
+    size_t m_next = 0;
+};
+
+class Server {
+public:
+    Server(const ServeOptions& options, ServeHandler handler)
+        : m_options(options)
+        , m_handler(std::move(handler))
+        , m_start(Clock::now()) {}
+
+    int run();
+
+private:
+    bool listenOn();
+    void acceptLoop();
+    void connectionLoop(std::shared_ptr<Connection> connection);
+    void handleLine(const std::shared_ptr<Connection>& connection, const std::string& line);
+    void execute(Job& job);
+    std::string statsJson(const std::string& id);
+
+    ServeOptions m_options;
+    ServeHandler m_handler;
+    Clock::time_point m_start;
+    int m_listenFd = -1;
+
+    std::mutex m_mutex;  // Fila, conexões e estatísticas
+    std::condition_variable m_wake;
+    std::deque<Job> m_queue;
+    std::vector<std::pair<std::thread, std::shared_ptr<Connection>>> m_readers;
+    bool m_running = false;
+    uint64_t m_served = 0;
+    uint64_t m_failed = 0;
+    uint64_t m_rejected = 0;
+    uint64_t m_images = 0;
+    LatencyWindow m_queueLatency;
+    LatencyWindow m_runLatency;
+};
+
+bool Server::listenOn() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (m_options.socketPath.empty() || m_options.socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "socket path must have 1 to " << sizeof(address.sun_path) - 1 << " characters\n";
+        return false;
+    }
+    std::memcpy(address.sun_path, m_options.socketPath.c_str(), m_options.socketPath.size() + 1);
+
+    // Só um socket que sobrou de um servidor anterior é removido; outro arquivo no caminho é erro
+    struct stat info;
+    if (::lstat(m_options.socketPath.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        ::unlink(m_options.socketPath.c_str());
+    }
+
+    m_listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listenFd < 0 || ::bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(m_listenFd, 16) != 0) {
+        std::cerr << "cannot listen on " << m_options.socketPath << ": " << std::strerror(errno) << "\n";
+        if (m_listenFd >= 0) {
+            ::close(m_listenFd);
+        }
+        return false;
+    }
+    return true;
+}
+
+void Server::acceptLoop() {
+    while (!g_stop) {
+        pollfd watch{m_listenFd, POLLIN, 0};
+        if (::poll(&watch, 1, 200) <= 0) {
+            continue;
+        }
+        const int fd = ::accept(m_listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        const timeval timeout{kSendTimeoutSeconds, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        auto connection = std::make_shared<Connection>();
+        connection->fd = fd;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Clientes que já saíram liberam a thread aqui
+        for (auto it = m_readers.begin(); it != m_readers.end();) {
+            if (it->second->finished) {
+                it->first.join();
+                it = m_readers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        m_readers.emplace_back(std::thread(&Server::connectionLoop, this, connection), connection);
+    }
+}
+
+void Server::connectionLoop(std::shared_ptr<Connection> connection) {
+    static const size_t kMaxLine = 1 << 20;
+    std::string buffer;
+    char chunk[4096];
+    while (!g_stop) {
+        pollfd watch{connection->fd, POLLIN, 0};
+        if (::poll(&watch, 1, 200) <= 0) {
+            continue;
+        }
+        const ssize_t received = ::recv(connection->fd, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            break;
+        }
+        buffer.append(chunk, static_cast<size_t>(received));
+        size_t newline;
+        while ((newline = buffer.find('\n')) != std::string::npos) {
+            const std::string line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                handleLine(connection, line);
+            }
+        }
+        if (buffer.size() > kMaxLine) {
+            connection->send("{\"id\":null,\"ok\":false,\"error\":\"request line too long\"}\n");
+            break;
+        }
+    }
+    connection->finished = true;
+}
+
+void Server::handleLine(const std::shared_ptr<Connection>& connection, const std::string& line) {
+    Job job;
+    std::string error;
+    if (!job.request.parse(line, error)) {
+        connection->send("{\"id\":null,\"ok\":false,\"error\":" + jsonString(error) + "}\n");
+        return;
+    }
+    const std::string command = job.request.text("command", "generate");
+    if (command == "stats") {
+        connection->send(statsJson(job.request.idJson()));
+        return;
+    }
+    if (command != "generate") {
+        connection->send("{\"id\":" + job.request.idJson() + ",\"ok\":false,\"error\":" +
+                         jsonString("unknown command " + command) + "}\n");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_queue.size() >= m_options.maxQueue) {
+        ++m_rejected;
+        connection->send("{\"id\":" + job.request.idJson() + ",\"ok\":false,\"error\":\"busy: " +
+                         std::to_string(m_queue.size()) + " requests queued\"}\n");
+        return;
+    }
+    job.connection = connection;
+    job.queued = Clock::now();
+    m_queue.push_back(std::move(job));
+    m_wake.notify_one();
+}
+
+void Server::execute(Job& job) {
+    const double queueMs = millisecondsSince(job.queued);
+    const Clock::time_point start = Clock::now();
+    ServeResult result = m_handler(job.request);
+    const double runMs = millisecondsSince(start);
+
+    // Rede de segurança para o limite que o handler aplica pelo número de imagens
+    size_t inlineBytes = 0;
+    for (const ServeImage& image : result.images) {
+        inlineBytes += image.data.size();
+    }
+    if (result.ok && inlineBytes > kMaxInlineBytes) {
+        result.ok = false;
+        result.error = "inline images total " + std::to_string(inlineBytes >> 20) + " MiB, over the " +
+                       std::to_string(kMaxInlineBytes >> 20) + " MiB limit; use a directory output";
+        result.images.clear();
+    }
+
+    std::string response = "{\"id\":" + job.request.idJson();
+    if (!result.ok) {
+        response += ",\"ok\":false,\"error\":" + jsonString(result.error);
+    } else {
+        response += ",\"ok\":true,\"seed\":" + std::to_string(result.seed) + ",\"images\":[";
+        for (size_t i = 0; i < result.images.size(); ++i) {
+            const ServeImage& image = result.images[i];
+            response += i ? ",{" : "{";
+            response += "\"identity\":" + std::to_string(image.header.identity) +
+                        ",\"version\":" + std::to_string(image.header.version) +
+                        ",\"format\":\"" + frameFormatName(image.header.format) + "\"" +
+                        ",\"width\":" + std::to_string(image.header.width) +
+                        ",\"height\":" + std::to_string(image.header.height) +
+                        ",\"crc\":" + std::to_string(image.header.crc);
+            response += image.path.empty() ? ",\"data\":\"" + base64Encode(image.data.data(), image.data.size()) + "\"}"
+                                           : ",\"path\":" + jsonString(image.path) + "}";
+        }
+        response += "]";
+    }
+    response += ",\"queueMs\":" + jsonNumber(queueMs) + ",\"runMs\":" + jsonNumber(runMs) + "}\n";
+
+    // Antes da resposta: um "stats" logo depois dela já vê este pedido
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        ++(result.ok ? m_served : m_failed);
+        m_images += result.images.size();
+        m_queueLatency.add(queueMs);
+        m_runLatency.add(runMs);
+    }
+    job.connection->send(response);
+}
+
+std::string Server::statsJson(const std::string& id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const double uptime = std::chrono::duration<double>(Clock::now() - m_start).count();
+    return "{\"id\":" + id + ",\"ok\":true,\"queueDepth\":" + std::to_string(m_queue.size()) +
+           ",\"running\":" + (m_running ? "true" : "false") + ",\"served\":" + std::to_string(m_served) +
+           ",\"failed\":" + std::to_string(m_failed) + ",\"rejected\":" + std::to_string(m_rejected) +
+           ",\"images\":" + std::to_string(m_images) + ",\"uptimeSeconds\":" + jsonNumber(uptime) +
+           ",\"queueMs\":" + m_queueLatency.json() + ",\"runMs\":" + m_runLatency.json() + "}\n";
+}
+
+int Server::run() {
+    if (!listenOn()) {
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    std::cerr << "Listening on " << m_options.socketPath << "\n";
+
+    std::thread acceptor(&Server::acceptLoop, this);
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Acordar de tempos em tempos para ver o sinal de parada
+            m_wake.wait_for(lock, std::chrono::milliseconds(200), [this]() { return !m_queue.empty() || g_stop; });
+            if (g_stop) {
+                break;
+            }
+            if (m_queue.empty()) {
+                continue;
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_running = true;
+        }
+        execute(job);
+    }
+
+    acceptor.join();
+    for (auto& reader : m_readers) {
+        reader.first.join();
+    }
+    m_readers.clear();
+    m_queue.clear();
+    ::close(m_listenFd);
+    ::unlink(m_options.socketPath.c_str());
+    std::cerr << "Served " << m_served << " requests (" << m_failed << " failed, " << m_rejected << " rejected)\n";
+    return 0;
+}
+
+} // namespace
+
+int runServer(const ServeOptions& options, ServeHandler handler) {
+    g_stop = false;
+    Server server(options, std::move(handler));
+    return server.run();
+}
+
+#endif
+
+} // namespace Raster
+} // namespace SFinGe
@@ -0,0 +1,103 @@
+#ifndef RASTER_SERVE_H
+#define RASTER_SERVE_H
+
+#include "frame_stream.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Pedido JSON de uma linha: objeto plano de textos, números e booleanos
+ *
+ * Números ficam como o texto original, então sementes de 64 bits não passam
+ * por double.
+ */
+class ServeRequest {
+public:
+    bool parse(const std::string& line, std::string& error);
+
+    bool has(const std::string& name) const { return m_values.count(name) != 0; }
+    std::string text(const std::string& name, const std::string& fallback = std::string()) const;
+    bool integer(const std::string& name, int64_t& value) const;
+    bool unsignedInteger(const std::string& name, uint64_t& value) const;
+    bool real(const std::string& name, double& value) const;
+    bool flag(const std::string& name, bool& value) const;
+
+    /**
+     * @brief "id" do pedido como JSON, para ecoar na resposta ("null" sem id)
+     */
+    std::string idJson() const;
+
+private:
+    enum class Kind { Text, Number, Bool, Null };
+    struct Value {
+        Kind kind = Kind::Null;
+        std::string text;  // Texto decodificado, ou o número como veio
+        bool flag = false;
+    };
+    std::map<std::string, Value> m_values;
+};
+
+/**
+ * @brief Uma imagem da resposta: os dados (inline) ou o caminho do arquivo
+ */
+struct ServeImage {
+    FrameHeader header;
+    std::vector<uint8_t> data;
+    std::string path;
+};
+
+struct ServeResult {
+    bool ok = false;
+    std::string error;
+    uint64_t seed = 0;
+    std::vector<ServeImage> images;
+};
+
+/**
+ * @brief Executa um pedido de geração; roda numa thread só, um pedido por vez
+ */
+using ServeHandler = std::function<ServeResult(const ServeRequest& request)>;
+
+// Uma resposta inline fica inteira na memória e sai em base64 numa linha só:
+// pedidos maiores que isso precisam de um diretório em "output"
+constexpr int kMaxInlineImages = 100;
+constexpr size_t kMaxInlineBytes = 96u << 20;  // Dados das imagens de uma resposta, antes do base64
+
+struct ServeOptions {
+    std::string socketPath;
+    size_t maxQueue = 64;  // Pedidos à espera; além disso a resposta é um erro "busy"
+};
+
+/**
+ * @brief Servidor de geração num socket Unix (subcomando "serve")
+ *
+ * Protocolo: uma linha JSON por pedido, uma linha JSON por resposta, na
+ * mesma conexão e com o "id" do pedido. {"command": "stats"} responde na
+ * hora com a profundidade da fila e as latências (fila e execução, média e
+ * percentis dos últimos pedidos); os demais pedidos entram numa fila única e
+ * rodam em ordem, cada um usando todos os workers. O processo, o pool de
+ * workers e os caches (bancos de Gabor, planos geométricos, codificadores)
+ * sobrevivem entre pedidos: um pedido pequeno paga só a renderização.
+ *
+ * Resposta: {"id", "ok", "seed", "images": [{identity, version, format,
+ * width, height, crc, data (base64) | path}], "queueMs", "runMs"} ou
+ * {"id", "ok": false, "error"}. SIGINT/SIGTERM terminam o pedido em curso
+ * e removem o socket. Um cliente que para de ler as respostas é desconectado
+ * depois de um tempo, em vez de segurar a thread que executa os pedidos.
+ *
+ * @return Código de saída do processo
+ */
+int runServer(const ServeOptions& options, ServeHandler handler);
+
+std::string base64Encode(const uint8_t* data, size_t size);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_SERVE_H
@@ -0,0 +1,207 @@
+/*
+ * sfinge_ring.h - lado consumidor do anel de imagens em memória compartilhada
+ *
+ * Cabeçalho C99 autocontido (POSIX, atômicos __atomic do GCC/Clang) para um
+ * data loader no mesmo nó ler as imagens de "sfinge-cli -o shm:<nome>" sem
+ * cópia por pipe: os workers do gerador escrevem cada recorte direto num slot
+ * livre do segmento, e o consumidor lê o slot no lugar.
+ *
+ * Layout do segmento (little-endian, o da máquina):
+ *   sfinge_ring_header no início; slot k em data_offset + k * slot_bytes,
+ *   com um sfinge_ring_slot seguido dos pixels (uint8, width * height, linha
+ *   a linha).
+ *
+ * Protocolo (sequências de 64 bits, nunca reiniciam):
+ *   produtores  seq = claimed++; esperam seq < consumed + slot_count;
+ *               escrevem o slot seq % slot_count; publicam slot.sequence = seq + 1
+ *   consumidor  espera slot.sequence == next + 1; lê; consumed = ++next
+ *   fim         o produtor grava final (quadros publicados) e state = DONE;
+ *               state = FAILED se o lote foi interrompido
+ *
+ * Os quadros saem na ordem em que os workers terminam, não na das
+ * identidades; o cabeçalho do slot diz de qual imagem cada um é. Um consumidor
+ * por anel. O produtor remove o nome do segmento quando o consumidor esvazia
+ * o anel (ou morre).
+ *
+ * Vida do consumidor: open, next (e portanto wait) e release incrementam
+ * header.heartbeat. Um produtor à espera de slot que não vê o contador mudar
+ * por SFINGE_RING_HEARTBEAT_TIMEOUT segundos dá o consumidor como morto e
+ * falha o lote. Não depende de PID, então produtor e consumidor podem estar
+ * em contêineres diferentes; um consumidor que fica mais tempo que isso sem
+ * ler chama sfinge_ring_heartbeat().
+ *
+ * Uso:
+ *   sfinge_ring ring;
+ *   if (sfinge_ring_open(&ring, "/sfinge") == 0) {
+ *       const sfinge_ring_slot *slot;
+ *       const uint8_t *pixels;
+ *       while (sfinge_ring_wait(&ring, &slot, &pixels) == SFINGE_RING_FRAME) {
+ *           ... usa pixels (slot->width x slot->height) ...
+ *           sfinge_ring_release(&ring);
+ *       }
+ *       sfinge_ring_close(&ring);
+ *   }
+ */
+#ifndef SFINGE_RING_H
+#define SFINGE_RING_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SFINGE_RING_MAGIC 0x474e495245474653ULL /* "SFGERING" */
+#define SFINGE_RING_VERSION 2u
+#define SFINGE_RING_DATA_OFFSET 4096u /* Slots alinhados à página */
+#define SFINGE_RING_HEARTBEAT_TIMEOUT 30 /* Segundos sem sinal do consumidor até o produtor desistir */
+
+enum { SFINGE_RING_OPEN = 0, SFINGE_RING_DONE = 1, SFINGE_RING_FAILED = 2 };
+
+/* Resultados de sfinge_ring_next / sfinge_ring_wait */
+enum { SFINGE_RING_FRAME = 1, SFINGE_RING_EMPTY = 0, SFINGE_RING_END = -1, SFINGE_RING_ERROR = -2 };
+
+typedef struct sfinge_ring_header {
+    uint64_t magic; /* Gravado por último: o anel está pronto */
+    uint32_t version;
+    uint32_t slot_count;
+    uint64_t slot_bytes;  /* Distância entre slots, cabeçalho do slot incluído */
+    uint64_t data_offset; /* Início do slot 0 */
+    uint32_t width;       /* Maior quadro do lote */
+    uint32_t height;
+    uint64_t expected; /* Quadros do lote (0 = desconhecido) */
+    char prefix[64];   /* Prefixo dos nomes do lote, terminado em zero */
+    uint64_t heartbeat; /* Consumidor: muda enquanto ele está vivo; 0 = ainda não abriu */
+    uint8_t reserved0[8];
+
+    /* Cada contador na sua linha de cache */
+    uint64_t claimed; /* Produtores: próxima sequência a entregar */
+    uint8_t reserved1[56];
+    uint64_t consumed; /* Consumidor: quadros liberados */
+    uint8_t reserved2[56];
+    uint32_t state;        /* SFINGE_RING_OPEN / DONE / FAILED */
+    int32_t consumer_pid;  /* Gravado pelo consumidor, só informativo (o PID é do namespace dele) */
+    uint64_t final;        /* Quadros publicados, válido com state != OPEN */
+    uint8_t reserved3[48];
+} sfinge_ring_header;
+
+typedef struct sfinge_ring_slot {
+    uint64_t sequence; /* seq + 1 quando o quadro seq está publicado */
+    uint32_t identity;
+    uint16_t version;
+    uint8_t format; /* 1 = gray8 */
+    uint8_t reserved;
+    uint32_t width;
+    uint32_t height;
+    uint32_t crc; /* CRC-32 (zlib) dos pixels */
+    uint32_t reserved2;
+    uint64_t length; /* Bytes de pixels depois do cabeçalho do slot */
+    uint8_t reserved3[24];
+} sfinge_ring_slot;
+
+typedef struct sfinge_ring {
+    sfinge_ring_header *header;
+    uint8_t *base;
+    size_t size;
+    uint64_t next; /* Próxima sequência a ler */
+} sfinge_ring;
+
+/* 0 em sucesso; -1 com errno (EAGAIN: o produtor ainda está criando o anel) */
+static inline int sfinge_ring_open(sfinge_ring *ring, const char *name) {
+    struct stat info;
+    void *base;
+    int fd = shm_open(name, O_RDWR, 0);
+    memset(ring, 0, sizeof(*ring));
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < SFINGE_RING_DATA_OFFSET) {
+        close(fd);
+        errno = EAGAIN;
+        return -1;
+    }
+    base = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    ring->base = (uint8_t *)base;
+    ring->size = (size_t)info.st_size;
+    ring->header = (sfinge_ring_header *)base;
+    if (__atomic_load_n(&ring->header->magic, __ATOMIC_ACQUIRE) != SFINGE_RING_MAGIC ||
+        ring->header->version != SFINGE_RING_VERSION) {
+        munmap(base, ring->size);
+        memset(ring, 0, sizeof(*ring));
+        errno = EAGAIN;
+        return -1;
+    }
+    ring->next = __atomic_load_n(&ring->header->consumed, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&ring->header->consumer_pid, (int32_t)getpid(), __ATOMIC_RELEASE);
+    __atomic_add_fetch(&ring->header->heartbeat, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Sinal de vida para o produtor; next, wait e release já o dão */
+static inline void sfinge_ring_heartbeat(sfinge_ring *ring) {
+    __atomic_add_fetch(&ring->header->heartbeat, 1, __ATOMIC_RELEASE);
+}
+
+/* Sem bloquear: SFINGE_RING_FRAME com o próximo quadro, EMPTY, END ou ERROR */
+static inline int sfinge_ring_next(sfinge_ring *ring, const sfinge_ring_slot **slot, const uint8_t **pixels) {
+    sfinge_ring_header *header = ring->header;
+    uint8_t *at = ring->base + header->data_offset + (ring->next % header->slot_count) * header->slot_bytes;
+    const sfinge_ring_slot *current = (const sfinge_ring_slot *)at;
+    uint32_t state;
+    sfinge_ring_heartbeat(ring);
+    if (__atomic_load_n(&current->sequence, __ATOMIC_ACQUIRE) == ring->next + 1) {
+        *slot = current;
+        *pixels = at + sizeof(sfinge_ring_slot);
+        return SFINGE_RING_FRAME;
+    }
+    state = __atomic_load_n(&header->state, __ATOMIC_ACQUIRE);
+    if (state == SFINGE_RING_FAILED) {
+        return SFINGE_RING_ERROR;
+    }
+    if (state == SFINGE_RING_DONE && ring->next >= header->final) {
+        return SFINGE_RING_END;
+    }
+    return SFINGE_RING_EMPTY;
+}
+
+/* Como sfinge_ring_next, mas espera o próximo quadro (ou o fim) */
+static inline int sfinge_ring_wait(sfinge_ring *ring, const sfinge_ring_slot **slot, const uint8_t **pixels) {
+    struct timespec pause = {0, 50000};
+    int result;
+    while ((result = sfinge_ring_next(ring, slot, pixels)) == SFINGE_RING_EMPTY) {
+        nanosleep(&pause, NULL);
+    }
+    return result;
+}
+
+/* Devolve o slot lido ao produtor; os ponteiros dele deixam de valer */
+static inline void sfinge_ring_release(sfinge_ring *ring) {
+    ++ring->next;
+    __atomic_store_n(&ring->header->consumed, ring->next, __ATOMIC_RELEASE);
+    sfinge_ring_heartbeat(ring);
+}
+
+static inline void sfinge_ring_close(sfinge_ring *ring) {
+    if (ring->base) {
+        munmap(ring->base, ring->size);
+    }
+    memset(ring, 0, sizeof(*ring));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SFINGE_RING_H */
@@ -0,0 +1,403 @@
+#include "shard.h"
+#include "checksum.h"
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+const char kHeaderMagic[8] = {'S', 'F', 'S', 'H', 'A', 'R', 'D', '\0'};
+const char kFooterMagic[4] = {'S', 'I', 'D', 'X'};
+const uint32_t kVersion = 1;
+const size_t kHeaderSize = 16;
+const size_t kFooterSize = 24;
+const size_t kWriteBuffer = 4 << 20;  // Gravações de 4 MiB no disco
+
+void putU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void putU64(std::vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint64_t getLE(const uint8_t* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+bool seekTo(std::FILE* file, int64_t offset, int origin) {
+#ifdef _WIN32
+    return _fseeki64(file, offset, origin) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), origin) == 0;
+#endif
+}
+
+int64_t tellPosition(std::FILE* file) {
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return static_cast<int64_t>(ftello(file));
+#endif
+}
+
+// Dados no disco antes de o shard ser dado como completo
+bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Chaves extraídas viram nomes de arquivo: sem diretórios nem ".."
+bool safeKey(const std::string& key) {
+    return !key.empty() && key != "." && key != ".." &&
+           key.find_first_of("/\\:") == std::string::npos;
+}
+
+} // namespace
+
+ShardWriter::ShardWriter(const std::string& stem, uint64_t maxShardBytes, int firstIndex)
+    : m_stem(stem)
+    , m_maxShardBytes(maxShardBytes)
+    , m_buffer(kWriteBuffer)
+    , m_nextIndex(firstIndex) {
+}
+
+ShardWriter::~ShardWriter() {
+    close();
+}
+
+std::string ShardWriter::shardPath(const std::string& stem, int index) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "-%05d.shard", index);
+    return stem + suffix;
+}
+
+bool ShardWriter::append(const std::string& key, const void* data, size_t size, uint64_t tag) {
+    if (key.size() > 0xFFFF) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_failed) {
+        return false;
+    }
+
+    // Uma entrada maior que o limite fica sozinha num shard
+    if (m_file && !m_entries.empty() && m_offset + size > m_maxShardBytes) {
+        if (!seal()) {
+            return false;
+        }
+    }
+    if (!m_file && !openNext()) {
+        return false;
+    }
+
+    if (size > 0 && std::fwrite(data, 1, size, m_file) != size) {
+        return fail("write failed: " + shardPath(m_stem, m_nextIndex - 1));
+    }
+
+    ShardEntry entry;
+    entry.key = key;
+    entry.offset = m_offset;
+    entry.length = size;
+    entry.crc = crc32(0, data, size);
+    entry.tag = tag;
+    m_entries.push_back(std::move(entry));
+    m_offset += size;
+    ++m_totalEntries;
+    return true;
+}
+
+void ShardWriter::setSealCallback(SealCallback callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_onSeal = std::move(callback);
+}
+
+bool ShardWriter::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_file) {
+        seal();
+    }
+    return !m_failed;
+}
+
+int ShardWriter::shardCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nextIndex;
+}
+
+uint64_t ShardWriter::entryCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_totalEntries;
+}
+
+bool ShardWriter::openNext() {
+    const std::string path = shardPath(m_stem, m_nextIndex);
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        return fail("cannot create " + path);
+    }
+    ++m_nextIndex;
+    std::setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size());
+
+    std::vector<uint8_t> header(kHeaderMagic, kHeaderMagic + 8);
+    putU32(header, kVersion);
+    putU32(header, 0);
+    if (std::fwrite(header.data(), 1, header.size(), m_file) != header.size()) {
+        return fail("write failed: " + path);
+    }
+    m_offset = kHeaderSize;
+    m_entries.clear();
+    return true;
+}
+
+bool ShardWriter::seal() {
+    std::vector<uint8_t> index;
+    for (const ShardEntry& entry : m_entries) {
+        putU64(index, entry.offset);
+        putU64(index, entry.length);
+        putU32(index, entry.crc);
+        putU16(index, static_cast<uint16_t>(entry.key.size()));
+        index.insert(index.end(), entry.key.begin(), entry.key.end());
+    }
+
+    std::vector<uint8_t> footer;
+    putU64(footer, m_offset);
+    putU64(footer, m_entries.size());
+    putU32(footer, crc32(0, index.data(), index.size()));
+    footer.insert(footer.end(), kFooterMagic, kFooterMagic + 4);
+
+    const std::string path = shardPath(m_stem, m_nextIndex - 1);
+    bool ok = std::fwrite(index.data(), 1, index.size(), m_file) == index.size() &&
+              std::fwrite(footer.data(), 1, footer.size(), m_file) == footer.size() &&
+              syncFile(m_file);
+    ok = (std::fclose(m_file) == 0) && ok;
+    m_file = nullptr;
+    if (!ok) {
+        m_entries.clear();
+        return fail("cannot finish " + path);
+    }
+    if (m_onSeal) {
+        m_onSeal(m_nextIndex - 1, m_entries);
+    }
+    m_entries.clear();
+    return true;
+}
+
+bool ShardWriter::fail(const std::string& message) {
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_failed = true;
+    m_error = message;
+    return false;
+}
+
+ShardReader::~ShardReader() {
+    close();
+}
+
+void ShardReader::close() {
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_entries.clear();
+    m_byKey.clear();
+}
+
+bool ShardReader::open(const std::string& path) {
+    close();
+    m_error.clear();
+
+    m_file = std::fopen(path.c_str(), "rb");
+    if (!m_file) {
+        m_error = "cannot open " + path;
+        return false;
+    }
+
+    uint8_t header[kHeaderSize];
+    uint8_t footer[kFooterSize];
+    int64_t fileSize = -1;
+    bool ok = std::fread(header, 1, kHeaderSize, m_file) == kHeaderSize &&
+              std::memcmp(header, kHeaderMagic, 8) == 0 &&
+              getLE(header + 8, 4) == kVersion &&
+              seekTo(m_file, -static_cast<int64_t>(kFooterSize), SEEK_END) &&
+              (fileSize = tellPosition(m_file) + static_cast<int64_t>(kFooterSize)) > 0 &&
+              std::fread(footer, 1, kFooterSize, m_file) == kFooterSize &&
+              std::memcmp(footer + 20, kFooterMagic, 4) == 0;
+    if (!ok) {
+        m_error = path + ": not a shard, or not closed (interrupted batch?)";
+        close();
+        return false;
+    }
+
+    const uint64_t indexOffset = getLE(footer, 8);
+    const uint64_t count = getLE(footer + 8, 8);
+    const uint64_t indexEnd = static_cast<uint64_t>(fileSize) - kFooterSize;
+    std::vector<uint8_t> index;
+    if (indexOffset < kHeaderSize || indexOffset > indexEnd) {
+        ok = false;
+    } else {
+        index.resize(indexEnd - indexOffset);
+        ok = seekTo(m_file, static_cast<int64_t>(indexOffset), SEEK_SET) &&
+             std::fread(index.data(), 1, index.size(), m_file) == index.size() &&
+             crc32(0, index.data(), index.size()) == getLE(footer + 16, 4);
+    }
+
+    size_t pos = 0;
+    for (uint64_t i = 0; ok && i < count; ++i) {
+        if (pos + 22 > index.size()) {
+            ok = false;
+            break;
+        }
+        ShardEntry entry;
+        entry.offset = getLE(&index[pos], 8);
+        entry.length = getLE(&index[pos + 8], 8);
+        entry.crc = static_cast<uint32_t>(getLE(&index[pos + 16], 4));
+        size_t keyLength = static_cast<size_t>(getLE(&index[pos + 20], 2));
+        pos += 22;
+        if (pos + keyLength > index.size() || entry.offset + entry.length > indexOffset) {
+            ok = false;
+            break;
+        }
+        entry.key.assign(reinterpret_cast<const char*>(&index[pos]), keyLength);
+        pos += keyLength;
+        m_byKey[entry.key] = m_entries.size();
+        m_entries.push_back(std::move(entry));
+    }
+
+    if (!ok || pos != index.size()) {
+        m_error = path + ": corrupt index";
+        close();
+        return false;
+    }
+    return true;
+}
+
+const ShardEntry* ShardReader::find(const std::string& key) const {
+    auto it = m_byKey.find(key);
+    return it != m_byKey.end() ? &m_entries[it->second] : nullptr;
+}
+
+bool ShardReader::read(const ShardEntry& entry, std::vector<uint8_t>& data) {
+    if (!m_file) {
+        m_error = "shard not open";
+        return false;
+    }
+    data.resize(entry.length);
+    if (!seekTo(m_file, static_cast<int64_t>(entry.offset), SEEK_SET) ||
+        std::fread(data.data(), 1, data.size(), m_file) != data.size()) {
+        m_error = entry.key + ": read failed";
+        return false;
+    }
+    if (crc32(0, data.data(), data.size()) != entry.crc) {
+        m_error = entry.key + ": CRC mismatch";
+        return false;
+    }
+    return true;
+}
+
+int runShardTool(const std::vector<std::string>& args) {
+    const std::string command = args.empty() ? std::string() : args[0];
+
+    if (command == "list" && args.size() >= 2) {
+        for (size_t i = 1; i < args.size(); ++i) {
+            ShardReader reader;
+            if (!reader.open(args[i])) {
+                std::cerr << reader.error() << "\n";
+                return 1;
+            }
+            uint64_t total = 0;
+            for (const ShardEntry& entry : reader.entries()) {
+                std::cout << entry.key << "\t" << entry.offset << "\t" << entry.length << "\n";
+                total += entry.length;
+            }
+            std::cerr << args[i] << ": " << reader.entries().size() << " entries, " << total << " bytes\n";
+        }
+        return 0;
+    }
+
+    if (command == "extract" && args.size() >= 3) {
+        ShardReader reader;
+        if (!reader.open(args[1])) {
+            std::cerr << reader.error() << "\n";
+            return 1;
+        }
+        std::error_code ec;
+        std::filesystem::create_directories(args[2], ec);
+
+        std::vector<const ShardEntry*> selected;
+        for (size_t i = 3; i < args.size(); ++i) {
+            const ShardEntry* entry = reader.find(args[i]);
+            if (!entry) {
+                std::cerr << args[1] << ": no entry " << args[i] << "\n";
+                return 1;
+            }
+            selected.push_back(entry);
+        }
+        if (args.size() == 3) {
+            for (const ShardEntry& entry : reader.entries()) {
+                selected.push_back(&entry);
+            }
+        }
+
+        std::vector<uint8_t> data;
+        for (const ShardEntry* entry : selected) {
+            if (!safeKey(entry->key)) {
+                std::cerr << "skipping unsafe key " << entry->key << "\n";
+                continue;
+            }
+            if (!reader.read(*entry, data)) {
+                std::cerr << reader.error() << "\n";
+                return 1;
+            }
+            const std::string path = (std::filesystem::path(args[2]) / entry->key).string();
+            std::FILE* file = std::fopen(path.c_str(), "wb");
+            bool ok = file && std::fwrite(data.data(), 1, data.size(), file) == data.size();
+            ok = file && (std::fclose(file) == 0) && ok;
+            if (!ok) {
+                std::cerr << "cannot write " << path << "\n";
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    std::cerr << "Usage:\n"
+              << "  shard list <file.shard>...                   Key, offset and length of each entry\n"
+              << "  shard extract <file.shard> <dir> [key...]    Write entries (all by default) to dir\n";
+    return 2;
+}
+
+} // namespace Raster
+} // namespace SFinGe
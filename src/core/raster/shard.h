@@ -0,0 +1,144 @@
+#ifndef RASTER_SHARD_H
+#define RASTER_SHARD_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Uma entrada do índice de um shard
+ */
+struct ShardEntry {
+    std::string key;        // Nome lógico, por exemplo "fingerprint_0042_v01.png"
+    uint64_t offset = 0;    // Início dos dados no arquivo
+    uint64_t length = 0;
+    uint32_t crc = 0;       // CRC-32 dos dados
+    uint64_t tag = 0;       // Do chamador, só em memória (não vai para o índice)
+};
+
+/**
+ * @brief Empacota muitas entradas pequenas em poucos arquivos grandes
+ *
+ * Formato (inteiros little-endian):
+ *   cabeçalho  "SFSHARD\0", versão u32, reservado u32
+ *   dados      entradas concatenadas, na ordem de append()
+ *   índice     por entrada: offset u64, length u64, crc u32, tamanho da chave u16, chave
+ *   rodapé     offset do índice u64, número de entradas u64, CRC do índice u32, "SIDX"
+ *
+ * Os arquivos são stem-00000.shard, stem-00001.shard, ...; um novo é aberto
+ * quando o atual passaria de maxShardBytes. As gravações são sequenciais e
+ * passam por um buffer grande, e o índice só é escrito ao fechar o shard:
+ * um shard sem rodapé (lote interrompido) é rejeitado pelo ShardReader.
+ *
+ * append() é thread-safe: os writers codificam em paralelo e só a cópia
+ * para o arquivo é serializada.
+ */
+class ShardWriter {
+public:
+    /**
+     * @brief Chamado com as entradas de cada shard depois que ele está no disco
+     */
+    using SealCallback = std::function<void(int index, const std::vector<ShardEntry>& entries)>;
+
+    /**
+     * @param firstIndex Número do primeiro shard aberto (lote retomado mantém os anteriores)
+     */
+    ShardWriter(const std::string& stem, uint64_t maxShardBytes, int firstIndex = 0);
+    ~ShardWriter();
+
+    ShardWriter(const ShardWriter&) = delete;
+    ShardWriter& operator=(const ShardWriter&) = delete;
+
+    bool append(const std::string& key, const void* data, size_t size, uint64_t tag = 0);
+
+    /**
+     * @brief Chamado sob a trava do writer, que não pode ser usado dentro dele
+     */
+    void setSealCallback(SealCallback callback);
+
+    /**
+     * @brief Grava o índice do shard aberto e o fecha (idempotente)
+     */
+    bool close();
+
+    int shardCount() const;
+    uint64_t entryCount() const;
+    const std::string& error() const { return m_error; }
+
+    static std::string shardPath(const std::string& stem, int index);
+
+private:
+    bool openNext();
+    bool seal();
+    bool fail(const std::string& message);
+
+    const std::string m_stem;
+    const uint64_t m_maxShardBytes;
+    mutable std::mutex m_mutex;
+    std::FILE* m_file = nullptr;
+    std::vector<char> m_buffer;
+    std::vector<ShardEntry> m_entries;  // Do shard aberto
+    uint64_t m_offset = 0;
+    int m_nextIndex;
+    uint64_t m_totalEntries = 0;
+    SealCallback m_onSeal;
+    bool m_failed = false;
+    std::string m_error;
+};
+
+/**
+ * @brief Leitura de um shard fechado: índice em memória, dados sob demanda
+ */
+class ShardReader {
+public:
+    ShardReader() = default;
+    ~ShardReader();
+
+    ShardReader(const ShardReader&) = delete;
+    ShardReader& operator=(const ShardReader&) = delete;
+
+    /**
+     * @brief Abre o arquivo e carrega o índice (valida rodapé e CRC do índice)
+     */
+    bool open(const std::string& path);
+    void close();
+
+    const std::vector<ShardEntry>& entries() const { return m_entries; }
+    const ShardEntry* find(const std::string& key) const;
+
+    /**
+     * @brief Lê os dados de uma entrada e confere o CRC
+     */
+    bool read(const ShardEntry& entry, std::vector<uint8_t>& data);
+
+    const std::string& error() const { return m_error; }
+
+private:
+    std::FILE* m_file = nullptr;
+    std::vector<ShardEntry> m_entries;
+    std::unordered_map<std::string, size_t> m_byKey;  // Chave -> posição em m_entries
+    std::string m_error;
+};
+
+/**
+ * @brief Subcomando "shard" das linhas de comando
+ *
+ *   shard list <arquivo.shard>...
+ *   shard extract <arquivo.shard> <diretório> [chave...]
+ *
+ * @param args Argumentos após "shard"
+ * @return Código de saída do processo
+ */
+int runShardTool(const std::vector<std::string>& args);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_SHARD_H
@@ -0,0 +1,302 @@
+#include "shm_ring.h"
+#include "checksum.h"
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include "sfinge_ring.h"
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+std::string ringName(const std::string& name) {
+    return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+
+int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+#ifdef _WIN32
+
+ShmRingWriter::~ShmRingWriter() = default;
+
+bool ShmRingWriter::create(const std::string& name, int, uint32_t, uint32_t, uint64_t, const std::string&) {
+    m_name = name;
+    m_error = "shared-memory rings need POSIX shm (not available in this build)";
+    return false;
+}
+
+uint8_t* ShmRingWriter::acquire(uint64_t&) {
+    return nullptr;
+}
+
+void ShmRingWriter::publish(uint64_t, const FrameHeader&) {}
+
+bool ShmRingWriter::close() {
+    return false;
+}
+
+void ShmRingWriter::abort(const std::string& message) {
+    m_error = message;
+}
+
+bool ShmRingWriter::consumerGone() {
+    return true;
+}
+
+void ShmRingWriter::unmap() {}
+
+int runRingTool(const std::vector<std::string>&) {
+    std::cerr << "ring needs POSIX shared memory (not available in this build)\n";
+    return 1;
+}
+
+#else
+
+static_assert(sizeof(sfinge_ring_header) <= SFINGE_RING_DATA_OFFSET, "ring header overlaps slot 0");
+static_assert(sizeof(sfinge_ring_slot) == 64, "slot header is one cache line");
+static_assert(offsetof(sfinge_ring_header, claimed) == 128, "ring header layout changed");
+static_assert(ShmRingWriter::kConsumerTimeout.count() == SFINGE_RING_HEARTBEAT_TIMEOUT, "see sfinge_ring.h");
+
+ShmRingWriter::~ShmRingWriter() {
+    // Sem close(): o consumidor vê um lote interrompido, e o nome não fica para trás
+    if (m_header) {
+        abort("the generator exited");
+        unmap();
+        shm_unlink(m_name.c_str());
+    }
+}
+
+bool ShmRingWriter::create(const std::string& name, int slotTotal, uint32_t width, uint32_t height, uint64_t expected,
+                           const std::string& prefix) {
+    m_name = ringName(name);
+    if (m_name.size() < 2 || m_name.size() > 250 || m_name.find('/', 1) != std::string::npos) {
+        m_error = "invalid ring name " + name + " (use a plain name such as /sfinge)";
+        return false;
+    }
+    if (slotTotal < 1) {
+        m_error = "a ring needs at least one slot";
+        return false;
+    }
+    m_slots = slotTotal;
+    m_frameBytes = static_cast<uint64_t>(width) * height;
+    m_slotBytes = (sizeof(sfinge_ring_slot) + m_frameBytes + 63) / 64 * 64;  // Slots em linhas de cache próprias
+    m_size = SFINGE_RING_DATA_OFFSET + static_cast<size_t>(m_slotBytes * slotTotal);
+
+    // Um segmento com o mesmo nome sobrou de um lote anterior; o consumidor dele continua com o mapeamento
+    shm_unlink(m_name.c_str());
+    const int fd = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        m_error = "cannot create " + m_name + ": " + std::strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+        m_error = "cannot size " + m_name + ": " + std::strerror(errno);
+        ::close(fd);
+        shm_unlink(m_name.c_str());
+        return false;
+    }
+    void* base = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        m_error = "cannot map " + m_name + ": " + std::strerror(errno);
+        shm_unlink(m_name.c_str());
+        return false;
+    }
+    m_base = static_cast<uint8_t*>(base);
+    m_header = reinterpret_cast<sfinge_ring_header*>(m_base);
+
+    // O segmento novo vem zerado: contadores em 0 e nenhum slot publicado
+    m_header->version = SFINGE_RING_VERSION;
+    m_header->slot_count = static_cast<uint32_t>(slotTotal);
+    m_header->slot_bytes = m_slotBytes;
+    m_header->data_offset = SFINGE_RING_DATA_OFFSET;
+    m_header->width = width;
+    m_header->height = height;
+    m_header->expected = expected;
+    std::snprintf(m_header->prefix, sizeof(m_header->prefix), "%s", prefix.c_str());
+    m_lastBeat = 0;
+    m_lastBeatTime = steadyNs();
+    __atomic_store_n(&m_header->magic, SFINGE_RING_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint8_t* ShmRingWriter::acquire(uint64_t& sequence) {
+    if (!m_header || m_failed) {
+        return nullptr;
+    }
+    sequence = __atomic_fetch_add(&m_header->claimed, 1, __ATOMIC_ACQ_REL);
+
+    // O slot está livre quando o consumidor liberou a volta anterior dele
+    if (sequence - __atomic_load_n(&m_header->consumed, __ATOMIC_ACQUIRE) >= static_cast<uint64_t>(m_slots)) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int spins = 1;; ++spins) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            if (sequence - __atomic_load_n(&m_header->consumed, __ATOMIC_ACQUIRE) < static_cast<uint64_t>(m_slots)) {
+                break;
+            }
+            if (m_failed) {
+                return nullptr;
+            }
+            if (spins % 2000 == 0 && consumerGone()) {
+                abort("the consumer went away");
+                return nullptr;
+            }
+        }
+        m_blockedNs += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+    return m_base + SFINGE_RING_DATA_OFFSET + (sequence % m_slots) * m_slotBytes + sizeof(sfinge_ring_slot);
+}
+
+void ShmRingWriter::publish(uint64_t sequence, const FrameHeader& header) {
+    sfinge_ring_slot* slot = reinterpret_cast<sfinge_ring_slot*>(m_base + SFINGE_RING_DATA_OFFSET +
+                                                                 (sequence % m_slots) * m_slotBytes);
+    slot->identity = header.identity;
+    slot->version = header.version;
+    slot->format = static_cast<uint8_t>(header.format);
+    slot->width = header.width;
+    slot->height = header.height;
+    slot->crc = header.crc;
+    slot->length = header.length;
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELEASE);
+    ++m_published;
+}
+
+bool ShmRingWriter::close() {
+    if (!m_header) {
+        return !m_failed;
+    }
+    if (!m_failed) {
+        // Chamado depois que os workers pararam: toda sequência entregue foi publicada
+        const uint64_t final = __atomic_load_n(&m_header->claimed, __ATOMIC_ACQUIRE);
+        m_header->final = final;
+        __atomic_store_n(&m_header->state, static_cast<uint32_t>(SFINGE_RING_DONE), __ATOMIC_RELEASE);
+        for (int spins = 1; __atomic_load_n(&m_header->consumed, __ATOMIC_ACQUIRE) < final; ++spins) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (spins % 100 == 0 && consumerGone()) {
+                abort("the consumer went away before reading every frame");
+                break;
+            }
+        }
+    }
+    unmap();
+    shm_unlink(m_name.c_str());
+    return !m_failed;
+}
+
+void ShmRingWriter::abort(const std::string& message) {
+    bool expected = false;
+    if (m_failed.compare_exchange_strong(expected, true)) {
+        m_error = message;
+    }
+    if (m_header) {
+        __atomic_store_n(&m_header->state, static_cast<uint32_t>(SFINGE_RING_FAILED), __ATOMIC_RELEASE);
+    }
+}
+
+// Pelo heartbeat e não por kill(pid, 0): o PID do consumidor não vale fora do namespace dele
+bool ShmRingWriter::consumerGone() {
+    const uint64_t beat = __atomic_load_n(&m_header->heartbeat, __ATOMIC_ACQUIRE);
+    const int64_t now = steadyNs();
+    if (beat == 0) {
+        return false;  // Ainda não abriu o anel
+    }
+    if (m_lastBeat.exchange(beat) != beat) {
+        m_lastBeatTime = now;
+        return false;
+    }
+    return now - m_lastBeatTime.load() >
+           std::chrono::duration_cast<std::chrono::nanoseconds>(m_consumerTimeout).count();
+}
+
+void ShmRingWriter::unmap() {
+    munmap(m_base, m_size);
+    m_base = nullptr;
+    m_header = nullptr;
+}
+
+int runRingTool(const std::vector<std::string>& args) {
+    if (args.size() < 2 || args.size() > 3 || args[0] != "read") {
+        std::cerr << "Usage:\n"
+                  << "  ring read <name> [dir]      Consume a shared-memory ring (-o shm:<name>) to the end of the batch;\n"
+                  << "                              with dir, write each frame as PGM under its batch file name\n";
+        return 2;
+    }
+    const std::string name = ringName(args[1]);
+    const bool save = args.size() == 3;
+    if (save) {
+        std::error_code ec;
+        std::filesystem::create_directories(args[2], ec);
+    }
+
+    // O gerador pode ainda não ter criado o anel
+    sfinge_ring ring;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (sfinge_ring_open(&ring, name.c_str()) != 0) {
+        if ((errno != ENOENT && errno != EAGAIN) || std::chrono::steady_clock::now() > deadline) {
+            std::cerr << "cannot open ring " << name << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    const std::string prefix(ring.header->prefix);
+
+    const sfinge_ring_slot* slot = nullptr;
+    const uint8_t* pixels = nullptr;
+    uint64_t frames = 0;
+    uint64_t total = 0;
+    int result;
+    while ((result = sfinge_ring_wait(&ring, &slot, &pixels)) == SFINGE_RING_FRAME) {
+        if (crc32(0, pixels, static_cast<size_t>(slot->length)) != slot->crc) {
+            std::cerr << "frame " << frames << ": CRC mismatch\n";
+            sfinge_ring_close(&ring);
+            return 1;
+        }
+        std::cout << slot->identity << "\t" << slot->version << "\tgray8\t" << slot->width << "x" << slot->height
+                  << "\t" << slot->length << "\n";
+        if (save) {
+            char file[64];
+            std::snprintf(file, sizeof(file), "_%04u_v%02u.pgm", static_cast<unsigned>(slot->identity),
+                          static_cast<unsigned>(slot->version));
+            const std::string path = (std::filesystem::path(args[2]) / (prefix + file)).string();
+            std::FILE* out = std::fopen(path.c_str(), "wb");
+            bool ok = out && std::fprintf(out, "P5\n%u %u\n255\n", slot->width, slot->height) > 0 &&
+                      std::fwrite(pixels, 1, static_cast<size_t>(slot->length), out) == slot->length;
+            ok = out && (std::fclose(out) == 0) && ok;
+            if (!ok) {
+                std::cerr << "cannot write " << path << "\n";
+                sfinge_ring_close(&ring);
+                return 1;
+            }
+        }
+        ++frames;
+        total += slot->length;
+        sfinge_ring_release(&ring);
+    }
+    sfinge_ring_close(&ring);
+    if (result == SFINGE_RING_ERROR) {
+        std::cerr << name << ": the generator stopped before the end of the batch (" << frames << " frames read)\n";
+        return 1;
+    }
+    std::cerr << name << ": " << frames << " frames, " << total << " bytes\n";
+    return 0;
+}
+
+#endif
+
+} // namespace Raster
+} // namespace SFinGe
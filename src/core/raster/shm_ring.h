@@ -0,0 +1,123 @@
+#ifndef RASTER_SHM_RING_H
+#define RASTER_SHM_RING_H
+
+#include "frame_stream.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct sfinge_ring_header;
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Produtor do anel de imagens em memória compartilhada ("-o shm:<nome>")
+ *
+ * Cria o segmento POSIX descrito em sfinge_ring.h, o cabeçalho C que os
+ * consumidores incluem. Cada worker pede um slot com acquire(), escreve os
+ * pixels direto nele e o publica com publish(): entre o recorte e o data
+ * loader não há codificação, fila, pipe nem cópia do lado do consumidor.
+ *
+ * acquire() e publish() são lock-free e podem ser chamados de qualquer
+ * thread. Com o anel cheio, acquire() espera o consumidor liberar um slot (a
+ * contrapressão que o pipe daria); um consumidor cujo heartbeat para por
+ * consumerTimeout() faz acquire() falhar, como o EPIPE do fluxo. Antes de o
+ * consumidor abrir o anel, a espera não tem prazo.
+ */
+class ShmRingWriter {
+public:
+    static constexpr std::chrono::seconds kConsumerTimeout{30};  // SFINGE_RING_HEARTBEAT_TIMEOUT
+
+    ShmRingWriter() = default;
+    ~ShmRingWriter();
+
+    ShmRingWriter(const ShmRingWriter&) = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+    /**
+     * @brief Cria o segmento (substitui um que sobrou de uma execução anterior)
+     *
+     * @param name Nome POSIX ("/sfinge"; a barra é acrescentada se faltar)
+     * @param slotTotal Número de slots do anel
+     * @param width, height Maior quadro que o lote publica
+     * @param expected Quadros do lote, para o consumidor (0 = desconhecido)
+     */
+    bool create(const std::string& name, int slotTotal, uint32_t width, uint32_t height, uint64_t expected,
+                const std::string& prefix);
+
+    /**
+     * @brief Reserva o próximo slot, esperando o consumidor se o anel estiver cheio
+     *
+     * @param sequence Sequência do slot, para publish()
+     * @return Onde escrever os pixels (frameBytes() bytes), ou nullptr se o anel falhou
+     */
+    uint8_t* acquire(uint64_t& sequence);
+
+    /**
+     * @brief Entrega o slot ao consumidor; header.length bytes de pixels já escritos
+     */
+    void publish(uint64_t sequence, const FrameHeader& header);
+
+    /**
+     * @brief Marca o fim do lote, espera o consumidor esvaziar o anel e remove o nome
+     */
+    bool close();
+
+    /**
+     * @brief Lote interrompido: o consumidor recebe um erro em vez de esperar para sempre
+     */
+    void abort(const std::string& message);
+
+    /**
+     * @brief Prazo sem heartbeat até o consumidor ser dado como morto (padrão: kConsumerTimeout)
+     */
+    void setConsumerTimeout(std::chrono::milliseconds timeout) { m_consumerTimeout = timeout; }
+    std::chrono::milliseconds consumerTimeout() const { return m_consumerTimeout; }
+
+    uint64_t frameBytes() const { return m_frameBytes; }
+    int slotCount() const { return m_slots; }
+    uint64_t frameCount() const { return m_published.load(); }
+    double blockedSeconds() const { return m_blockedNs.load() * 1e-9; }  // Workers à espera de slot
+    const std::string& name() const { return m_name; }
+    const std::string& error() const { return m_error; }
+
+private:
+    bool consumerGone();
+    void unmap();
+
+    std::string m_name;
+    sfinge_ring_header* m_header = nullptr;
+    uint8_t* m_base = nullptr;
+    size_t m_size = 0;
+    int m_slots = 0;
+    uint64_t m_slotBytes = 0;
+    uint64_t m_frameBytes = 0;
+    std::atomic<uint64_t> m_published{0};
+    std::atomic<uint64_t> m_blockedNs{0};
+    std::atomic<bool> m_failed{false};
+    std::string m_error;  // Só escrito por quem marca m_failed primeiro
+    std::chrono::milliseconds m_consumerTimeout{kConsumerTimeout};
+    std::atomic<uint64_t> m_lastBeat{0};      // Último heartbeat visto
+    std::atomic<int64_t> m_lastBeatTime{0};   // Quando ele mudou (ns do steady_clock)
+};
+
+/**
+ * @brief Subcomando "ring" das linhas de comando: um consumidor de referência
+ *
+ *   ring read <nome> [diretório]
+ *
+ * Lê o anel até o fim do lote, lista cada quadro e, com um diretório, grava
+ * os quadros como PGM com os nomes do lote.
+ *
+ * @param args Argumentos após "ring"
+ * @return Código de saída do processo
+ */
+int runRingTool(const std::vector<std::string>& args);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_SHM_RING_H
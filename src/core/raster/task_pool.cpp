@@ -0,0 +1,127 @@
+#include "task_pool.h"
+#include "parallel.h"
+#include <limits>
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+thread_local TaskPool* t_pool = nullptr;
+thread_local int t_index = -1;
+
+} // namespace
+
+TaskPool::TaskPool(int threads) {
+    int count = resolveThreadCount(threads, std::numeric_limits<int>::max());
+    m_queues.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    m_threads.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        m_threads.emplace_back(&TaskPool::workerLoop, this, i);
+    }
+}
+
+TaskPool::~TaskPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+TaskPool* TaskPool::current() {
+    return t_pool;
+}
+
+void TaskPool::spawn(Task task) {
+    int target = (t_pool == this) ? t_index
+                                  : static_cast<int>(m_nextQueue.fetch_add(1) % m_queues.size());
+    m_pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(m_queues[target]->mutex);
+        m_queues[target]->tasks.push_back(std::move(task));
+    }
+    m_queued.fetch_add(1);
+
+    // O lock impede que um worker durma entre testar m_queued e esperar
+    { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+    m_wake.notify_one();
+}
+
+void TaskPool::wait() {
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_idle.wait(lock, [this] { return m_pending.load() == 0; });
+}
+
+bool TaskPool::takeTask(int self, Task& task) {
+    const int count = size();
+
+    // Própria deque pelo fim (LIFO)
+    if (self >= 0) {
+        Queue& own = *m_queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // Roubo pelo início das demais, a partir da vizinha
+    int start = self >= 0 ? self + 1 : static_cast<int>(m_nextQueue.load() % count);
+    for (int k = 0; k < count; ++k) {
+        int victim = (start + k) % count;
+        if (victim == self) {
+            continue;
+        }
+        Queue& queue = *m_queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskPool::runOne() {
+    Task task;
+    if (!takeTask(t_pool == this ? t_index : -1, task)) {
+        return false;
+    }
+    task();
+    if (m_pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_idle.notify_all();
+    }
+    return true;
+}
+
+void TaskPool::workerLoop(int index) {
+    t_pool = this;
+    t_index = index;
+
+    for (;;) {
+        if (runOne()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this] { return m_stopping || m_queued.load() > 0; });
+        if (m_stopping && m_queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace Raster
+} // namespace SFinGe
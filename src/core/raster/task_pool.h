@@ -0,0 +1,152 @@
+#ifndef RASTER_TASK_POOL_H
+#define RASTER_TASK_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Pool de threads com roubo de tarefas (work stealing)
+ *
+ * Cada worker tem sua própria deque: tarefas criadas dentro de um worker vão
+ * para o fim da deque dele e são consumidas em ordem LIFO (a versão recém
+ * criada roda enquanto a imagem base ainda está no cache), enquanto workers
+ * ociosos roubam do início das deques alheias (as tarefas mais antigas e
+ * normalmente maiores). Tarefas criadas fora do pool são distribuídas em
+ * rodízio entre as deques.
+ *
+ * O mesmo pool atende o paralelismo entre imagens (identidades e versões) e
+ * dentro de uma imagem (parallelFor): quem espera um parallelFor executa os
+ * blocos pendentes da própria chamada em vez de bloquear, então não há
+ * deadlock nem threads extras. Ele nunca pega outra tarefa do pool enquanto
+ * espera: uma identidade aninhada na pilha dele seguraria a imagem de fora
+ * (e os mapas dela) até terminar.
+ */
+class TaskPool {
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * @param threads Número de workers (0 = núcleos disponíveis)
+     */
+    explicit TaskPool(int threads = 0);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    int size() const { return static_cast<int>(m_queues.size()); }
+
+    /**
+     * @brief Agenda uma tarefa; pode ser chamada de qualquer thread, inclusive de dentro de tarefas
+     */
+    void spawn(Task task);
+
+    /**
+     * @brief Bloqueia até que todas as tarefas agendadas (e as que elas criarem) terminem
+     *
+     * Deve ser chamada de fora do pool.
+     */
+    void wait();
+
+    /**
+     * @brief fn(b, e) sobre [begin, end) em blocos de até grain elementos
+     *
+     * Ajudantes agendados no pool e a thread chamadora tiram blocos de um
+     * contador da chamada até acabarem; depois a chamadora só cede a vez até
+     * os blocos já tirados terminarem.
+     */
+    template<typename Fn>
+    void parallelFor(int begin, int end, int grain, Fn fn);
+
+    /**
+     * @brief Pool do worker que executa a thread atual (nullptr fora de um pool)
+     */
+    static TaskPool* current();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(int index);
+    bool runOne();
+    bool takeTask(int self, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;     // Há tarefas nas deques (ou o pool está parando)
+    std::condition_variable m_idle;     // m_pending chegou a zero
+    std::atomic<int> m_queued{0};       // Tarefas nas deques
+    std::atomic<int> m_pending{0};      // Tarefas agendadas e ainda não concluídas
+    std::atomic<unsigned> m_nextQueue{0};
+    bool m_stopping = false;
+};
+
+template<typename Fn>
+void TaskPool::parallelFor(int begin, int end, int grain, Fn fn) {
+    int count = end - begin;
+    if (count <= 0) {
+        return;
+    }
+    grain = std::max(1, grain);
+    int blocks = (count + grain - 1) / grain;
+    if (blocks == 1 || size() == 1) {
+        fn(begin, end);
+        return;
+    }
+
+    // Estado da chamada: um ajudante que só roda depois do retorno encontra o
+    // contador esgotado e não toca em fn, que vive na pilha do chamador
+    struct Blocks {
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+    };
+    auto state = std::make_shared<Blocks>();
+    Fn* body = &fn;
+    auto runBlocks = [state, body, begin, end, grain, blocks]() {
+        for (int b; (b = state->next.fetch_add(1, std::memory_order_relaxed)) < blocks;) {
+            const int b0 = begin + b * grain;
+            (*body)(b0, std::min(end, b0 + grain));
+            state->done.fetch_add(1, std::memory_order_release);
+        }
+    };
+    const int helpers = std::min(blocks, size()) - 1;
+    for (int h = 0; h < helpers; ++h) {
+        spawn(runBlocks);
+    }
+    runBlocks();
+
+    while (state->done.load(std::memory_order_acquire) < blocks) {
+        std::this_thread::yield();
+    }
+}
+
+/**
+ * @brief parallelFor no pool da thread atual; fora de um pool roda fn(begin, end) direto
+ */
+template<typename Fn>
+void parallelFor(int begin, int end, int grain, Fn fn) {
+    if (TaskPool* pool = TaskPool::current()) {
+        pool->parallelFor(begin, end, grain, fn);
+    } else if (begin < end) {
+        fn(begin, end);
+    }
+}
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_TASK_POOL_H
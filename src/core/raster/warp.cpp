@@ -0,0 +1,348 @@
+#include "warp.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTER_WARP_SSE2 1
+#endif
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+constexpr double kDegToRad = 3.14159265358979323846 / 180.0;
+
+// Fator de cisalhamento da homografia simplificada dos geradores em lote
+constexpr double kHomographyShear = 0.3;
+
+// Coeficientes trigonométricos calculados uma vez por versão
+struct PreparedWarp {
+    double cx, cy;
+    double maxX, maxY;             // Limite exclusivo dos testes (largura-1, altura-1)
+    double cropX, cropY;
+
+    bool rotation;
+    double rotCos, rotSin;
+
+    bool homography;
+    double homCos, homShear;
+    double shiftX, shiftY;
+
+    bool lens;
+    double lensK;
+
+    explicit PreparedWarp(const VersionWarp& w)
+        : cx(w.sourceWidth / 2.0), cy(w.sourceHeight / 2.0)
+        , maxX(w.sourceWidth - 1), maxY(w.sourceHeight - 1)
+        , cropX(w.cropX), cropY(w.cropY)
+        , rotation(w.rotation)
+        , rotCos(std::cos(w.rotationDegrees * kDegToRad))
+        , rotSin(std::sin(w.rotationDegrees * kDegToRad))
+        , homography(w.homography)
+        , homCos(std::cos(w.homographyDegrees * kDegToRad))
+        , homShear(std::sin(w.homographyDegrees * kDegToRad) * kHomographyShear)
+        , shiftX(w.homographyShiftX), shiftY(w.homographyShiftY)
+        , lens(w.lens), lensK(w.lensK) {}
+
+    bool inside(double x, double y) const {
+        return x >= 0 && x < maxX && y >= 0 && y < maxY;
+    }
+
+    // Mapeamento inverso saída → origem; com checkBounds=false serve para
+    // estimar a região lida (sem rejeitar estágios intermediários)
+    bool map(double u, double v, double& sx, double& sy, bool checkBounds) const {
+        double x = u + cropX;
+        double y = v + cropY;
+
+        if (rotation) {
+            double nx = x - cx;
+            double ny = y - cy;
+            x = nx * rotCos + ny * rotSin + cx;
+            y = -nx * rotSin + ny * rotCos + cy;
+            if (checkBounds && !inside(x, y)) return false;
+        }
+
+        if (homography) {
+            double nx = x - cx;
+            double ny = y - cy;
+            x = nx * homCos - ny * homShear + shiftX + cx;
+            y = nx * homShear + ny * homCos + shiftY + cy;
+            if (checkBounds && !inside(x, y)) return false;
+        }
+
+        if (lens) {
+            // (n / r) * r * (1 + k r^2) = n * (1 + k r^2): sem sqrt nem divisão por r
+            double nx = (x - cx) / cx;
+            double ny = (y - cy) / cy;
+            double factor = 1.0 + lensK * (nx * nx + ny * ny);
+            x = cx + (x - cx) * factor;
+            y = cy + (y - cy) * factor;
+            if (checkBounds && !inside(x, y)) return false;
+        }
+
+        sx = x;
+        sy = y;
+        return !checkBounds || inside(x, y);
+    }
+};
+
+inline uint8_t clampToByte(float value) {
+    return static_cast<uint8_t>(value > 0.0f ? std::min(value, 255.0f) : 0.0f);
+}
+
+inline void cubicWeights(float t, float w[4]) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    w[0] = -0.5f * t3 + t2 - 0.5f * t;
+    w[1] = 1.5f * t3 - 2.5f * t2 + 1.0f;
+    w[2] = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+    w[3] = 0.5f * t3 - 0.5f * t2;
+}
+
+// Amostradores sobre a região disponível (índices limitados à borda da região)
+struct RegionSampler {
+    const uint8_t* data;
+    int stride;
+    int originX, originY;
+    int width, height;
+
+    const uint8_t* row(int y) const {
+        return data + static_cast<size_t>(std::clamp(y, 0, height - 1)) * stride;
+    }
+
+    uint8_t bilinear(double sx, double sy) const {
+        double lx = sx - originX;
+        double ly = sy - originY;
+        int x0 = static_cast<int>(std::floor(lx));
+        int y0 = static_cast<int>(std::floor(ly));
+        float fx = static_cast<float>(lx - x0);
+        float fy = static_cast<float>(ly - y0);
+        int xa = std::clamp(x0, 0, width - 1);
+        int xb = std::clamp(x0 + 1, 0, width - 1);
+        const uint8_t* r0 = row(y0);
+        const uint8_t* r1 = row(y0 + 1);
+        float top = r0[xa] + (r0[xb] - r0[xa]) * fx;
+        float bottom = r1[xa] + (r1[xb] - r1[xa]) * fx;
+        return clampToByte(top + (bottom - top) * fy);
+    }
+
+    uint8_t bicubic(double sx, double sy) const {
+        double lx = sx - originX;
+        double ly = sy - originY;
+        int x0 = static_cast<int>(std::floor(lx));
+        int y0 = static_cast<int>(std::floor(ly));
+        float wx[4], wy[4];
+        cubicWeights(static_cast<float>(lx - x0), wx);
+        cubicWeights(static_cast<float>(ly - y0), wy);
+
+        int xs[4];
+        for (int i = 0; i < 4; ++i) {
+            xs[i] = std::clamp(x0 - 1 + i, 0, width - 1);
+        }
+        float sum = 0.0f;
+        for (int j = 0; j < 4; ++j) {
+            const uint8_t* r = row(y0 - 1 + j);
+            float rowSum = r[xs[0]] * wx[0] + r[xs[1]] * wx[1] + r[xs[2]] * wx[2] + r[xs[3]] * wx[3];
+            sum += rowSum * wy[j];
+        }
+        return clampToByte(sum);
+    }
+};
+
+#ifdef RASTER_WARP_SSE2
+// Linha de saída com bilinear, 4 pixels por passo: mapeamento e testes de
+// limites em float vetorial; só a leitura dos 4 vizinhos é escalar.
+// Devolve quantos pixels foram escritos (o restante fica para o laço escalar).
+int bilinearRowSse2(const PreparedWarp& p, const RegionSampler& s, int v, uint8_t* out, int width) {
+    const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 maxX = _mm_set1_ps(static_cast<float>(p.maxX));
+    const __m128 maxY = _mm_set1_ps(static_cast<float>(p.maxY));
+    const __m128 cx = _mm_set1_ps(static_cast<float>(p.cx));
+    const __m128 cy = _mm_set1_ps(static_cast<float>(p.cy));
+    const __m128 rotCos = _mm_set1_ps(static_cast<float>(p.rotCos));
+    const __m128 rotSin = _mm_set1_ps(static_cast<float>(p.rotSin));
+    const __m128 homCos = _mm_set1_ps(static_cast<float>(p.homCos));
+    const __m128 homShear = _mm_set1_ps(static_cast<float>(p.homShear));
+    const __m128 shiftX = _mm_set1_ps(static_cast<float>(p.shiftX));
+    const __m128 shiftY = _mm_set1_ps(static_cast<float>(p.shiftY));
+    const __m128 invCx = _mm_set1_ps(static_cast<float>(1.0 / p.cx));
+    const __m128 invCy = _mm_set1_ps(static_cast<float>(1.0 / p.cy));
+    const __m128 lensK = _mm_set1_ps(static_cast<float>(p.lensK));
+    const __m128 originX = _mm_set1_ps(static_cast<float>(s.originX));
+    const __m128 originY = _mm_set1_ps(static_cast<float>(s.originY));
+    const __m128 rowY = _mm_set1_ps(static_cast<float>(v + p.cropY));
+    const __m128 lastX = _mm_set1_ps(static_cast<float>(s.width - 1));
+    const __m128 lastY = _mm_set1_ps(static_cast<float>(s.height - 1));
+    const __m128 stride = _mm_set1_ps(static_cast<float>(s.stride));
+
+    auto inside = [&](__m128 x, __m128 y) {
+        return _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, zero), _mm_cmplt_ps(x, maxX)),
+                          _mm_and_ps(_mm_cmpge_ps(y, zero), _mm_cmplt_ps(y, maxY)));
+    };
+
+    int u = 0;
+    for (; u + 4 <= width; u += 4) {
+        __m128 x = _mm_add_ps(_mm_set1_ps(static_cast<float>(u + p.cropX)), lane);
+        __m128 y = rowY;
+        __m128 valid = _mm_cmpeq_ps(zero, zero);
+
+        if (p.rotation) {
+            __m128 nx = _mm_sub_ps(x, cx);
+            __m128 ny = _mm_sub_ps(y, cy);
+            x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, rotCos), _mm_mul_ps(ny, rotSin)), cx);
+            y = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(ny, rotCos), _mm_mul_ps(nx, rotSin)), cy);
+            valid = _mm_and_ps(valid, inside(x, y));
+        }
+        if (p.homography) {
+            __m128 nx = _mm_sub_ps(x, cx);
+            __m128 ny = _mm_sub_ps(y, cy);
+            x = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(nx, homCos), _mm_mul_ps(ny, homShear)), shiftX), cx);
+            y = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, homShear), _mm_mul_ps(ny, homCos)), shiftY), cy);
+            valid = _mm_and_ps(valid, inside(x, y));
+        }
+        if (p.lens) {
+            __m128 dx = _mm_sub_ps(x, cx);
+            __m128 dy = _mm_sub_ps(y, cy);
+            __m128 nx = _mm_mul_ps(dx, invCx);
+            __m128 ny = _mm_mul_ps(dy, invCy);
+            __m128 factor = _mm_add_ps(one, _mm_mul_ps(lensK, _mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny))));
+            x = _mm_add_ps(cx, _mm_mul_ps(dx, factor));
+            y = _mm_add_ps(cy, _mm_mul_ps(dy, factor));
+        }
+        valid = _mm_and_ps(valid, inside(x, y));
+
+        int laneMask = _mm_movemask_ps(valid);
+        if (laneMask == 0) {
+            std::memset(out + u, 255, 4);
+            continue;
+        }
+
+        // Coordenadas limitadas à região (lanes inválidas leem um pixel qualquer
+        // e são substituídas por branco no fim); válidas são >= 0: trunc = floor
+        __m128 lx = _mm_min_ps(_mm_max_ps(_mm_sub_ps(x, originX), zero), lastX);
+        __m128 ly = _mm_min_ps(_mm_max_ps(_mm_sub_ps(y, originY), zero), lastY);
+        __m128 x0 = _mm_cvtepi32_ps(_mm_cvttps_epi32(lx));
+        __m128 y0 = _mm_cvtepi32_ps(_mm_cvttps_epi32(ly));
+        __m128 fx = _mm_sub_ps(lx, x0);
+        __m128 fy = _mm_sub_ps(ly, y0);
+        __m128 x1 = _mm_min_ps(_mm_add_ps(x0, one), lastX);
+        __m128 y1 = _mm_min_ps(_mm_add_ps(y0, one), lastY);
+
+        // Deslocamentos exatos em float (região < 2^24 bytes)
+        __m128 row0 = _mm_mul_ps(y0, stride);
+        __m128 row1 = _mm_mul_ps(y1, stride);
+        alignas(16) int o00[4], o10[4], o01[4], o11[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(o00), _mm_cvttps_epi32(_mm_add_ps(row0, x0)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(o10), _mm_cvttps_epi32(_mm_add_ps(row0, x1)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(o01), _mm_cvttps_epi32(_mm_add_ps(row1, x0)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(o11), _mm_cvttps_epi32(_mm_add_ps(row1, x1)));
+
+        const uint8_t* base = s.data;
+        __m128 a = _mm_setr_ps(base[o00[0]], base[o00[1]], base[o00[2]], base[o00[3]]);
+        __m128 b = _mm_setr_ps(base[o10[0]], base[o10[1]], base[o10[2]], base[o10[3]]);
+        __m128 c = _mm_setr_ps(base[o01[0]], base[o01[1]], base[o01[2]], base[o01[3]]);
+        __m128 d = _mm_setr_ps(base[o11[0]], base[o11[1]], base[o11[2]], base[o11[3]]);
+        __m128 top = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fx));
+        __m128 bottom = _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(d, c), fx));
+        __m128 value = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fy));
+        // Pixels inválidos: branco
+        value = _mm_or_ps(_mm_and_ps(valid, value), _mm_andnot_ps(valid, _mm_set1_ps(255.0f)));
+
+        __m128i q = _mm_cvttps_epi32(value);
+        q = _mm_packs_epi32(q, q);
+        q = _mm_packus_epi16(q, q);
+        int packed = _mm_cvtsi128_si32(q);
+        std::memcpy(out + u, &packed, 4);
+    }
+    return u;
+}
+#endif
+
+} // namespace
+
+WarpFootprint versionWarpFootprint(const VersionWarp& warp, int outWidth, int outHeight, int margin) {
+    WarpFootprint footprint;
+    if (warp.sourceWidth <= 0 || warp.sourceHeight <= 0 || outWidth <= 0 || outHeight <= 0) {
+        return footprint;
+    }
+
+    PreparedWarp prepared(warp);
+    double minX = warp.sourceWidth, minY = warp.sourceHeight;
+    double maxX = -1.0, maxY = -1.0;
+
+    auto visit = [&](int u, int v) {
+        double sx, sy;
+        prepared.map(u, v, sx, sy, false);
+        minX = std::min(minX, sx);
+        minY = std::min(minY, sy);
+        maxX = std::max(maxX, sx);
+        maxY = std::max(maxY, sy);
+    };
+
+    for (int u = 0; u < outWidth; ++u) {
+        visit(u, 0);
+        visit(u, outHeight - 1);
+    }
+    for (int v = 1; v < outHeight - 1; ++v) {
+        visit(0, v);
+        visit(outWidth - 1, v);
+    }
+
+    footprint.x0 = std::max(0, static_cast<int>(std::floor(minX)) - margin);
+    footprint.y0 = std::max(0, static_cast<int>(std::floor(minY)) - margin);
+    footprint.x1 = std::min(warp.sourceWidth, static_cast<int>(std::floor(maxX)) + 1 + margin);
+    footprint.y1 = std::min(warp.sourceHeight, static_cast<int>(std::floor(maxY)) + 1 + margin);
+    return footprint;
+}
+
+void applyVersionWarp(const uint8_t* src, int srcStride, const WarpFootprint& region,
+                      uint8_t* dst, int dstStride, int outWidth, int outHeight,
+                      const VersionWarp& warp, Interpolation interpolation, int threads) {
+    if (outWidth <= 0 || outHeight <= 0) {
+        return;
+    }
+    if (region.isEmpty()) {
+        for (int y = 0; y < outHeight; ++y) {
+            std::memset(dst + static_cast<size_t>(y) * dstStride, 255, outWidth);
+        }
+        return;
+    }
+
+    const PreparedWarp prepared(warp);
+    const RegionSampler sampler{src, srcStride, region.x0, region.y0, region.width(), region.height()};
+    const bool bicubic = interpolation == Interpolation::Bicubic;
+#ifdef RASTER_WARP_SSE2
+    // O caminho vetorial calcula os deslocamentos em float (exatos até 2^24)
+    const bool vectorRows = !bicubic &&
+        static_cast<int64_t>(srcStride) * region.height() < (int64_t(1) << 24);
+#endif
+
+    parallelRanges(0, outHeight, threads, [&](int y0, int y1) {
+        for (int v = y0; v < y1; ++v) {
+            uint8_t* out = dst + static_cast<size_t>(v) * dstStride;
+            int u = 0;
+#ifdef RASTER_WARP_SSE2
+            if (vectorRows) {
+                u = bilinearRowSse2(prepared, sampler, v, out, outWidth);
+            }
+#endif
+            for (; u < outWidth; ++u) {
+                double sx, sy;
+                if (!prepared.map(u, v, sx, sy, true)) {
+                    out[u] = 255;
+                } else {
+                    out[u] = bicubic ? sampler.bicubic(sx, sy) : sampler.bilinear(sx, sy);
+                }
+            }
+        }
+    });
+}
+
+} // namespace Raster
+} // namespace SFinGe
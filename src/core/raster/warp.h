@@ -0,0 +1,87 @@
+#ifndef RASTER_WARP_H
+#define RASTER_WARP_H
+
+#include <cstdint>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Interpolação usada na reamostragem final
+ */
+enum class Interpolation {
+    Bilinear,  // 2x2, igual às transformações encadeadas
+    Bicubic    // 4x4 Catmull-Rom, preserva melhor as cristas finas
+};
+
+/**
+ * @brief Cadeia geométrica de uma versão em lote (lente → homografia → rotação → recorte)
+ *
+ * Todos os estágios intermediários têm o tamanho da imagem de origem e usam
+ * o seu centro como referência, como nas funções encadeadas dos geradores em
+ * lote. Cada estágio habilitado tem o próprio teste de limites: uma amostra
+ * que cai fora da imagem em qualquer estágio resulta em branco.
+ */
+struct VersionWarp {
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+
+    int cropX = 0;                    // Canto do recorte no quadro rotacionado
+    int cropY = 0;
+
+    bool rotation = false;
+    double rotationDegrees = 0.0;
+
+    bool homography = false;
+    double homographyDegrees = 0.0;
+    double homographyShiftX = 0.0;
+    double homographyShiftY = 0.0;
+
+    bool lens = false;
+    double lensK = 0.0;               // r' = r * (1 + k * r^2)
+};
+
+/**
+ * @brief Retângulo [x0, x1) x [y0, y1) em coordenadas da imagem de origem
+ */
+struct WarpFootprint {
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+    bool isEmpty() const { return x1 <= x0 || y1 <= y0; }
+};
+
+/**
+ * @brief Região da origem lida ao gerar uma saída outWidth x outHeight
+ *
+ * Percorre apenas a borda da saída (o mapeamento é contínuo e monótono) e
+ * expande o resultado por margin pixels, limitado à imagem de origem.
+ * Efeitos aplicados antes da geometria (ruído, blur) só precisam cobrir
+ * esta região.
+ */
+WarpFootprint versionWarpFootprint(const VersionWarp& warp, int outWidth, int outHeight,
+                                   int margin = 3);
+
+/**
+ * @brief Aplica a cadeia inteira com uma única reamostragem por pixel de saída
+ *
+ * @param src Primeiro byte da região de origem disponível (Grayscale8)
+ * @param srcStride Bytes por linha da origem
+ * @param region Posição da região na imagem de origem (ex.: versionWarpFootprint)
+ * @param dst Saída outWidth x outHeight (Grayscale8)
+ * @param threads 0 = núcleos disponíveis
+ */
+void applyVersionWarp(const uint8_t* src, int srcStride, const WarpFootprint& region,
+                      uint8_t* dst, int dstStride, int outWidth, int outHeight,
+                      const VersionWarp& warp,
+                      Interpolation interpolation = Interpolation::Bilinear,
+                      int threads = 1);
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_WARP_H
@@ -0,0 +1,94 @@
+#include "write_queue.h"
+#include <algorithm>
+
+namespace SFinGe {
+namespace Raster {
+
+WriteQueue::WriteQueue(int writers, size_t capacity)
+    : m_capacity(std::max<size_t>(1, capacity))
+    , m_start(Clock::now()) {
+    writers = std::max(1, writers);
+    m_threads.reserve(writers);
+    for (int i = 0; i < writers; ++i) {
+        m_threads.emplace_back(&WriteQueue::writerLoop, this);
+    }
+}
+
+WriteQueue::~WriteQueue() {
+    finish();
+}
+
+void WriteQueue::push(Job job) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_jobs.size() >= m_capacity) {
+        Clock::time_point waitStart = Clock::now();
+        m_notFull.wait(lock, [this] { return m_jobs.size() < m_capacity; });
+        m_producerWait += Clock::now() - waitStart;
+    }
+    m_jobs.push_back(std::move(job));
+    m_maxDepth = std::max(m_maxDepth, m_jobs.size());
+    lock.unlock();
+    m_notEmpty.notify_one();
+}
+
+void WriteQueue::finish() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closing) {
+            return;
+        }
+        m_closing = true;
+    }
+    m_notEmpty.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_end = Clock::now();
+    m_finished = true;
+}
+
+WriteQueueStats WriteQueue::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    WriteQueueStats s;
+    s.writers = static_cast<int>(m_threads.size());
+    s.capacity = m_capacity;
+    s.completed = m_completed;
+    s.failed = m_failed;
+    s.depth = m_jobs.size();
+    s.maxDepth = m_maxDepth;
+    s.busySeconds = std::chrono::duration<double>(m_busy).count();
+    s.elapsedSeconds = std::chrono::duration<double>((m_finished ? m_end : Clock::now()) - m_start).count();
+    s.producerWaitSeconds = std::chrono::duration<double>(m_producerWait).count();
+    return s;
+}
+
+void WriteQueue::writerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_notEmpty.wait(lock, [this] { return m_closing || !m_jobs.empty(); });
+        if (m_jobs.empty()) {
+            return;  // Fechando e sem trabalho pendente
+        }
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+
+        Clock::time_point jobStart = Clock::now();
+        bool ok = job();
+        Clock::duration spent = Clock::now() - jobStart;
+
+        lock.lock();
+        m_busy += spent;
+        ++m_completed;
+        if (!ok) {
+            ++m_failed;
+        }
+    }
+}
+
+} // namespace Raster
+} // namespace SFinGe
@@ -0,0 +1,100 @@
+#ifndef RASTER_WRITE_QUEUE_H
+#define RASTER_WRITE_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Contadores de uma WriteQueue (lidos com stats(), a qualquer momento)
+ */
+struct WriteQueueStats {
+    int writers = 0;
+    size_t capacity = 0;
+    size_t completed = 0;           // Trabalhos executados
+    size_t failed = 0;              // Trabalhos que retornaram false
+    size_t depth = 0;               // Trabalhos na fila agora
+    size_t maxDepth = 0;            // Maior ocupação observada
+    double busySeconds = 0.0;       // Soma do tempo dos writers executando trabalhos
+    double elapsedSeconds = 0.0;    // Desde a construção (ou até finish())
+    double producerWaitSeconds = 0.0;  // Tempo dos produtores bloqueados com a fila cheia
+
+    /**
+     * @brief Fração do tempo em que os writers estiveram ocupados (0 a 1)
+     */
+    double utilization() const {
+        double available = elapsedSeconds * writers;
+        return available > 0.0 ? busySeconds / available : 0.0;
+    }
+};
+
+/**
+ * @brief Estágio de codificação/gravação desacoplado dos workers de cálculo
+ *
+ * Fila limitada de trabalhos (cada um codifica e grava uma imagem pronta)
+ * consumida por um grupo próprio de threads. push() bloqueia enquanto a
+ * fila está cheia: a memória das imagens em espera fica limitada e, se o
+ * disco (ou o volume de rede) não acompanha, os workers desaceleram em vez
+ * de acumular imagens.
+ */
+class WriteQueue {
+public:
+    using Job = std::function<bool()>;
+
+    /**
+     * @param writers Threads de gravação (mínimo 1)
+     * @param capacity Trabalhos em espera antes de push() bloquear (mínimo 1)
+     */
+    WriteQueue(int writers, size_t capacity);
+    ~WriteQueue();
+
+    WriteQueue(const WriteQueue&) = delete;
+    WriteQueue& operator=(const WriteQueue&) = delete;
+
+    /**
+     * @brief Enfileira um trabalho; bloqueia enquanto a fila estiver cheia
+     */
+    void push(Job job);
+
+    /**
+     * @brief Espera a fila esvaziar e encerra os writers (idempotente)
+     */
+    void finish();
+
+    WriteQueueStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void writerLoop();
+
+    const size_t m_capacity;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::deque<Job> m_jobs;
+    std::vector<std::thread> m_threads;
+    bool m_closing = false;
+
+    Clock::time_point m_start;
+    Clock::time_point m_end;
+    bool m_finished = false;
+    size_t m_completed = 0;
+    size_t m_failed = 0;
+    size_t m_maxDepth = 0;
+    Clock::duration m_busy{};
+    Clock::duration m_producerWait{};
+};
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_WRITE_QUEUE_H
@@ -0,0 +1,1124 @@
+#include "wsq.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace SFinGe {
+namespace Raster {
+
+namespace {
+
+// Marcadores
+constexpr uint16_t kSOI = 0xFFA0;
+constexpr uint16_t kEOI = 0xFFA1;
+constexpr uint16_t kSOF = 0xFFA2;
+constexpr uint16_t kSOB = 0xFFA3;
+constexpr uint16_t kDTT = 0xFFA4;
+constexpr uint16_t kDQT = 0xFFA5;
+constexpr uint16_t kDHT = 0xFFA6;
+constexpr uint16_t kDRT = 0xFFA7;
+constexpr uint16_t kCOM = 0xFFA8;
+
+constexpr int kNodeCount = 20;
+constexpr int kSubbandCount = 64;
+constexpr int kCodedSubbands = 60;
+constexpr int kBlockCount = 3;
+constexpr int kBlockStart[kBlockCount + 1] = {0, 19, 52, kCodedSubbands};
+constexpr int kBlockTable[kBlockCount] = {0, 1, 1};
+constexpr int kMaxTables = 8;
+
+// Filtros de análise FBI, do centro para a borda (simétricos)
+constexpr int kLowpassTaps = 9;
+constexpr int kHighpassTaps = 7;
+constexpr double kLowpass[5] = {
+    0.85269867833021100, 0.37740285561283066, -0.11062440441843718, -0.02384946501955685, 0.03782845550726404
+};
+constexpr double kHighpass[4] = {
+    0.78848561640558290, -0.41809227322161724, -0.04068941760916406, 0.06453888262869706
+};
+
+// Os mesmos filtros fatorados em lifting CDF 9/7 (extensão simétrica nas
+// bordas); os ganhos finais reproduzem exatamente as respostas acima
+constexpr float kAlpha = -1.586134342059924f;
+constexpr float kBeta = -0.052980118572961f;
+constexpr float kGamma = 0.882911075530934f;
+constexpr float kDelta = 0.443506852043971f;
+constexpr float kLowGain = 1.149604398f;
+constexpr float kHighGain = 1.0f / kLowGain;
+
+// Símbolos Huffman: 1..100 corrida de zeros; 101..104 coeficiente com o
+// módulo em 8/16 bits a seguir; 105/106 corrida em 8/16 bits; 107..254
+// coeficiente -73..74 direto (símbolo - 180)
+constexpr int kMaxZeroRun = 100;
+constexpr int kPositive8 = 101;
+constexpr int kNegative8 = 102;
+constexpr int kPositive16 = 103;
+constexpr int kNegative16 = 104;
+constexpr int kZeroRun8 = 105;
+constexpr int kZeroRun16 = 106;
+constexpr int kCoefficientBias = 180;
+constexpr int kMaxDirect = 74;
+
+constexpr double kBinCenter = 0.44;       // Reconstrução dentro do intervalo de quantização
+constexpr double kZeroBinRatio = 1.2;     // Zona morta = 1.2 * passo
+constexpr double kVarianceThreshold = 1.01;
+
+struct Region {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Cada nó é uma divisão 2D de um quadrante do pai (0 = superior esquerdo,
+// 1 = superior direito, 2 = inferior esquerdo, 3 = inferior direito). Nas
+// faixas passa-altas a ordem das metades se inverte (passa-altas primeiro)
+struct Node {
+    int parent;
+    int quadrant;
+    bool invertRows;
+    bool invertColumns;
+};
+
+const Node kNodes[kNodeCount] = {
+    {-1, 0, false, false},
+    {0, 0, false, false}, {0, 1, true, false}, {0, 2, false, true},
+    {1, 1, true, false}, {1, 2, false, true},
+    {4, 0, false, false}, {4, 1, true, false}, {4, 2, false, true}, {4, 3, true, true},
+    {5, 0, false, false}, {5, 1, true, false}, {5, 2, false, true}, {5, 3, true, true},
+    {1, 0, false, false},
+    {14, 0, false, false}, {14, 1, true, false}, {14, 2, false, true}, {14, 3, true, true},
+    {15, 0, false, false}
+};
+
+// Sub-banda k = quadrante da divisão de um nó. O quadrante 3 da raiz (a
+// diagonal mais fina, sub-bandas 60-63) não é codificado
+struct SubbandSource {
+    uint8_t node;
+    uint8_t quadrant;
+};
+
+const SubbandSource kSubbands[kCodedSubbands] = {
+    {19, 0}, {19, 1}, {19, 2}, {19, 3},
+    {15, 1}, {15, 2}, {15, 3},
+    {16, 0}, {16, 1}, {16, 2}, {16, 3}, {17, 0}, {17, 1}, {17, 2}, {17, 3},
+    {18, 0}, {18, 1}, {18, 2}, {18, 3},
+    {6, 0}, {6, 1}, {6, 2}, {6, 3}, {7, 0}, {7, 1}, {7, 2}, {7, 3},
+    {8, 0}, {8, 1}, {8, 2}, {8, 3}, {9, 0}, {9, 1}, {9, 2}, {9, 3},
+    {10, 0}, {10, 1}, {10, 2}, {10, 3}, {11, 0}, {11, 1}, {11, 2}, {11, 3},
+    {12, 0}, {12, 1}, {12, 2}, {12, 3}, {13, 0}, {13, 1}, {13, 2}, {13, 3},
+    {1, 3},
+    {2, 0}, {2, 1}, {2, 2}, {2, 3}, {3, 0}, {3, 1}, {3, 2}, {3, 3}
+};
+
+struct Layout {
+    Region nodes[kNodeCount];
+    Region subbands[kCodedSubbands];
+};
+
+// Passa-baixas com ceil(n/2) amostras, passa-altas com floor(n/2)
+void splitRegion(const Region& r, bool invertRows, bool invertColumns, Region out[4]) {
+    const int left = invertRows ? r.width / 2 : (r.width + 1) / 2;
+    const int top = invertColumns ? r.height / 2 : (r.height + 1) / 2;
+    out[0] = {r.x, r.y, left, top};
+    out[1] = {r.x + left, r.y, r.width - left, top};
+    out[2] = {r.x, r.y + top, left, r.height - top};
+    out[3] = {r.x + left, r.y + top, r.width - left, r.height - top};
+}
+
+Layout buildLayout(int width, int height) {
+    Layout layout;
+    Region quadrants[kNodeCount][4];
+    for (int n = 0; n < kNodeCount; ++n) {
+        const Node& node = kNodes[n];
+        layout.nodes[n] = n == 0 ? Region{0, 0, width, height} : quadrants[node.parent][node.quadrant];
+        splitRegion(layout.nodes[n], node.invertRows, node.invertColumns, quadrants[n]);
+    }
+    for (int k = 0; k < kCodedSubbands; ++k) {
+        layout.subbands[k] = quadrants[kSubbands[k].node][kSubbands[k].quadrant];
+    }
+    return layout;
+}
+
+// Um passo de lifting nas amostras de paridade start, espelhando nas bordas
+inline void liftStep(float* s, int n, int start, float c) {
+    for (int i = start; i < n; i += 2) {
+        const float left = i > 0 ? s[i - 1] : s[i + 1];
+        const float right = i + 1 < n ? s[i + 1] : s[i - 1];
+        s[i] += c * (left + right);
+    }
+}
+
+// Transformada 1D de n >= 2 amostras (passo stride), no lugar
+void analyze(float* data, int n, size_t stride, bool inverted, float* line) {
+    for (int i = 0; i < n; ++i) {
+        line[i] = data[i * stride];
+    }
+    liftStep(line, n, 1, kAlpha);
+    liftStep(line, n, 0, kBeta);
+    liftStep(line, n, 1, kGamma);
+    liftStep(line, n, 0, kDelta);
+
+    const int lowCount = (n + 1) / 2;
+    const int highCount = n / 2;
+    float* low = data + (inverted ? highCount : 0) * stride;
+    float* high = data + (inverted ? 0 : lowCount) * stride;
+    for (int k = 0; k < lowCount; ++k) {
+        low[k * stride] = line[2 * k] * kLowGain;
+    }
+    for (int k = 0; k < highCount; ++k) {
+        high[k * stride] = line[2 * k + 1] * kHighGain;
+    }
+}
+
+void synthesize(float* data, int n, size_t stride, bool inverted, float* line) {
+    const int lowCount = (n + 1) / 2;
+    const int highCount = n / 2;
+    const float* low = data + (inverted ? highCount : 0) * stride;
+    const float* high = data + (inverted ? 0 : lowCount) * stride;
+    for (int k = 0; k < lowCount; ++k) {
+        line[2 * k] = low[k * stride] / kLowGain;
+    }
+    for (int k = 0; k < highCount; ++k) {
+        line[2 * k + 1] = high[k * stride] / kHighGain;
+    }
+    liftStep(line, n, 0, -kDelta);
+    liftStep(line, n, 1, -kGamma);
+    liftStep(line, n, 0, -kBeta);
+    liftStep(line, n, 1, -kAlpha);
+
+    for (int i = 0; i < n; ++i) {
+        data[i * stride] = line[i];
+    }
+}
+
+void forwardTransform(float* plane, size_t stride, const Layout& layout, float* line) {
+    for (int n = 0; n < kNodeCount; ++n) {
+        const Region& r = layout.nodes[n];
+        float* origin = plane + r.y * stride + r.x;
+        for (int y = 0; y < r.height; ++y) {
+            analyze(origin + y * stride, r.width, 1, kNodes[n].invertRows, line);
+        }
+        for (int x = 0; x < r.width; ++x) {
+            analyze(origin + x, r.height, stride, kNodes[n].invertColumns, line);
+        }
+    }
+}
+
+void inverseTransform(float* plane, size_t stride, const Layout& layout, float* line) {
+    for (int n = kNodeCount - 1; n >= 0; --n) {
+        const Region& r = layout.nodes[n];
+        float* origin = plane + r.y * stride + r.x;
+        for (int x = 0; x < r.width; ++x) {
+            synthesize(origin + x, r.height, stride, kNodes[n].invertColumns, line);
+        }
+        for (int y = 0; y < r.height; ++y) {
+            synthesize(origin + y * stride, r.width, 1, kNodes[n].invertRows, line);
+        }
+    }
+}
+
+double regionVariance(const float* plane, size_t stride, int x0, int y0, int width, int height) {
+    const double count = static_cast<double>(width) * height;
+    if (count < 2.0) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    double squares = 0.0;
+    for (int y = 0; y < height; ++y) {
+        const float* row = plane + (y0 + y) * stride + x0;
+        for (int x = 0; x < width; ++x) {
+            sum += row[x];
+            squares += static_cast<double>(row[x]) * row[x];
+        }
+    }
+    return (squares - sum * sum / count) / (count - 1.0);
+}
+
+// Variância na janela central de cada sub-banda (as bordas da impressão não
+// representam as cristas); se quase tudo for fundo, usa a sub-banda inteira
+void subbandVariances(const float* plane, size_t stride, const Layout& layout, double* variance) {
+    double total = 0.0;
+    for (int k = 0; k < kCodedSubbands; ++k) {
+        const Region& r = layout.subbands[k];
+        variance[k] = regionVariance(plane, stride, r.x + r.width / 8, r.y + 9 * r.height / 32,
+                                     3 * r.width / 4, 7 * r.height / 16);
+        total += variance[k];
+    }
+    if (total < 20000.0) {
+        for (int k = 0; k < kCodedSubbands; ++k) {
+            const Region& r = layout.subbands[k];
+            variance[k] = regionVariance(plane, stride, r.x, r.y, r.width, r.height);
+        }
+    }
+}
+
+/**
+ * Passos de quantização para a taxa alvo (alocação de bits em alta taxa).
+ * Passo relativo Q'_k = 1 nas quatro sub-bandas mais baixas e
+ * 10 / (A_k ln σ²_k) nas demais; o fator q faz Σ m_k log2(2.5 σ_k q / Q'_k)
+ * igual à taxa, com m_k a fração da imagem ocupada pela sub-banda.
+ * Sub-bandas cujo passo passaria de 5σ (tudo zero) saem e q é refeito.
+ */
+void quantizationSteps(const double* variance, double bitrate, double* step) {
+    static const double kWeight[8] = {1.32, 1.08, 1.42, 1.08, 1.32, 1.42, 1.08, 1.08};
+
+    double relative[kCodedSubbands];
+    double fraction[kCodedSubbands];
+    bool active[kCodedSubbands];
+    for (int k = 0; k < kCodedSubbands; ++k) {
+        fraction[k] = k < 4 ? 1.0 / 1024.0 : (k < 52 ? 1.0 / 256.0 : 1.0 / 16.0);
+        active[k] = variance[k] >= kVarianceThreshold;
+        if (active[k]) {
+            const double a = k >= 52 ? kWeight[k - 52] : 1.0;
+            relative[k] = k < 4 ? 1.0 : 10.0 / (a * std::log(variance[k]));
+        }
+    }
+
+    double q = 0.0;
+    for (bool changed = true; changed;) {
+        double s = 0.0;
+        double logP = 0.0;
+        for (int k = 0; k < kCodedSubbands; ++k) {
+            if (active[k]) {
+                s += fraction[k];
+                logP += fraction[k] * std::log(std::sqrt(variance[k]) / relative[k]);
+            }
+        }
+        if (s <= 0.0) {
+            break;
+        }
+        q = std::exp2(bitrate / s - 1.0) / (2.5 * std::exp(logP / s));
+
+        changed = false;
+        for (int k = 0; k < kCodedSubbands; ++k) {
+            if (active[k] && relative[k] / q >= 5.0 * std::sqrt(variance[k])) {
+                active[k] = false;
+                changed = true;
+            }
+        }
+    }
+    for (int k = 0; k < kCodedSubbands; ++k) {
+        step[k] = active[k] ? relative[k] / q : 0.0;
+    }
+}
+
+// Real positivo como inteiro sem sinal e potência de 10 (escala): a maior
+// escala que mantém o inteiro abaixo de limit
+struct Scaled {
+    uint8_t scale = 0;
+    uint32_t value = 0;
+};
+
+Scaled toScaled(double v, uint32_t limit) {
+    Scaled s;
+    if (!(v > 0.0)) {
+        return s;
+    }
+    while (v * 10.0 < limit && s.scale < 30) {
+        v *= 10.0;
+        ++s.scale;
+    }
+    s.value = static_cast<uint32_t>(std::min<double>(std::round(v), limit));
+    return s;
+}
+
+double fromScaled(uint8_t scale, uint32_t value) {
+    double v = value;
+    for (int i = 0; i < scale; ++i) {
+        v /= 10.0;
+    }
+    return v;
+}
+
+double fromScaled(const Scaled& s) {
+    return fromScaled(s.scale, s.value);
+}
+
+inline int16_t quantize(float c, float step, float halfZero) {
+    int q = 0;
+    if (c > halfZero) {
+        q = static_cast<int>(std::floor((c - halfZero) / step)) + 1;
+    } else if (c < -halfZero) {
+        q = -(static_cast<int>(std::floor((-c - halfZero) / step)) + 1);
+    }
+    return static_cast<int16_t>(std::max(-32767, std::min(32767, q)));
+}
+
+inline float dequantize(int q, float step, float halfZero, float binCenter) {
+    if (q > 0) {
+        return step * (q - binCenter) + halfZero;
+    }
+    if (q < 0) {
+        return step * (q + binCenter) - halfZero;
+    }
+    return 0.0f;
+}
+
+// Símbolos de um bloco: emit(símbolo, bits extras, quantidade de bits extras)
+template <typename Emit>
+void forEachSymbol(const int16_t* coefficients, size_t count, Emit emit) {
+    uint32_t run = 0;
+    auto flushRun = [&]() {
+        if (run == 0) {
+            return;
+        }
+        if (run <= kMaxZeroRun) {
+            emit(static_cast<int>(run), 0u, 0);
+        } else if (run <= 0xFF) {
+            emit(kZeroRun8, run, 8);
+        } else {
+            emit(kZeroRun16, run, 16);
+        }
+        run = 0;
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        const int v = coefficients[i];
+        if (v == 0) {
+            if (++run == 0xFFFF) {
+                flushRun();
+            }
+            continue;
+        }
+        flushRun();
+        if (v > kMaxDirect || v < 1 - kMaxDirect) {
+            const uint32_t magnitude = static_cast<uint32_t>(std::abs(v));
+            if (magnitude <= 0xFF) {
+                emit(v > 0 ? kPositive8 : kNegative8, magnitude, 8);
+            } else {
+                emit(v > 0 ? kPositive16 : kNegative16, magnitude, 16);
+            }
+        } else {
+            emit(kCoefficientBias + v, 0u, 0);
+        }
+    }
+    flushRun();
+}
+
+struct HuffmanTable {
+    uint8_t bits[17] = {0};          // bits[n] = quantidade de códigos com n bits
+    std::vector<uint8_t> values;     // Símbolos em ordem de código
+    uint16_t codes[256] = {0};
+    uint8_t sizes[256] = {0};
+};
+
+/**
+ * Tamanhos de código como no Anexo K do JPEG: árvore de Huffman com um
+ * símbolo reservado de frequência 1 (nenhum código fica só com uns),
+ * comprimentos limitados a 16 bits e o reservado removido no fim. Os
+ * códigos são canônicos, em ordem de tamanho e de símbolo.
+ */
+void buildHuffmanTable(const uint32_t* frequency, HuffmanTable& table) {
+    constexpr int kReserved = 256;
+    uint64_t freq[257];
+    int codeSize[257] = {0};
+    int others[257];
+    bool any = false;
+    for (int v = 0; v < 256; ++v) {
+        freq[v] = frequency[v];
+        any = any || freq[v] > 0;
+    }
+    freq[kReserved] = 1;
+    std::fill(others, others + 257, -1);
+    table = HuffmanTable();
+    if (!any) {
+        return;
+    }
+
+    for (;;) {
+        int v1 = -1;
+        int v2 = -1;
+        for (int v = 0; v <= kReserved; ++v) {
+            if (freq[v] > 0 && (v1 < 0 || freq[v] <= freq[v1])) {
+                v1 = v;
+            }
+        }
+        for (int v = 0; v <= kReserved; ++v) {
+            if (freq[v] > 0 && v != v1 && (v2 < 0 || freq[v] <= freq[v2])) {
+                v2 = v;
+            }
+        }
+        if (v2 < 0) {
+            break;
+        }
+        freq[v1] += freq[v2];
+        freq[v2] = 0;
+        for (++codeSize[v1]; others[v1] >= 0;) {
+            v1 = others[v1];
+            ++codeSize[v1];
+        }
+        others[v1] = v2;
+        for (++codeSize[v2]; others[v2] >= 0;) {
+            v2 = others[v2];
+            ++codeSize[v2];
+        }
+    }
+
+    int count[258] = {0};
+    for (int v = 0; v <= kReserved; ++v) {
+        count[codeSize[v]]++;
+    }
+    for (int i = 257; i > 16; --i) {
+        while (count[i] > 0) {
+            int j = i - 2;
+            while (count[j] == 0) {
+                --j;
+            }
+            count[i] -= 2;
+            count[i - 1]++;
+            count[j + 1] += 2;
+            count[j]--;
+        }
+    }
+    int longest = 16;
+    while (count[longest] == 0) {
+        --longest;
+    }
+    count[longest]--;
+
+    for (int n = 1; n <= 16; ++n) {
+        table.bits[n] = static_cast<uint8_t>(count[n]);
+    }
+    for (int n = 1; n <= 256; ++n) {
+        for (int v = 0; v < 256; ++v) {
+            if (codeSize[v] == n) {
+                table.values.push_back(static_cast<uint8_t>(v));
+            }
+        }
+    }
+
+    uint32_t code = 0;
+    size_t k = 0;
+    for (int n = 1; n <= 16; ++n) {
+        for (int i = 0; i < table.bits[n]; ++i, ++k) {
+            table.codes[table.values[k]] = static_cast<uint16_t>(code++);
+            table.sizes[table.values[k]] = static_cast<uint8_t>(n);
+        }
+        code <<= 1;
+    }
+}
+
+void putU8(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void putU16(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void putU32(std::vector<uint8_t>& out, uint32_t v) {
+    putU16(out, v >> 16);
+    putU16(out, v & 0xFFFF);
+}
+
+void putHuffmanTable(std::vector<uint8_t>& out, int id, const HuffmanTable& table) {
+    putU16(out, kDHT);
+    putU16(out, static_cast<uint32_t>(3 + 16 + table.values.size()));
+    putU8(out, static_cast<uint32_t>(id));
+    out.insert(out.end(), table.bits + 1, table.bits + 17);
+    out.insert(out.end(), table.values.begin(), table.values.end());
+}
+
+// Leitura do fluxo: big-endian, com limite
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    bool u8(uint32_t& v) {
+        if (m_pos >= m_size) {
+            return false;
+        }
+        v = m_data[m_pos++];
+        return true;
+    }
+    bool u16(uint32_t& v) {
+        uint32_t hi = 0;
+        uint32_t lo = 0;
+        if (!u8(hi) || !u8(lo)) {
+            return false;
+        }
+        v = (hi << 8) | lo;
+        return true;
+    }
+    bool u32(uint32_t& v) {
+        uint32_t hi = 0;
+        uint32_t lo = 0;
+        if (!u16(hi) || !u16(lo)) {
+            return false;
+        }
+        v = (hi << 16) | lo;
+        return true;
+    }
+
+    size_t position() const { return m_pos; }
+    void seek(size_t pos) { m_pos = pos; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+};
+
+// Bits do segmento entrópico, MSB primeiro; 0xFF vem seguido de 0x00
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size, size_t pos) : m_data(data), m_size(size), m_pos(pos) {}
+
+    bool bits(int count, uint32_t& value) {
+        value = 0;
+        for (int i = 0; i < count; ++i) {
+            if (m_available == 0) {
+                if (m_pos >= m_size) {
+                    return false;
+                }
+                m_byte = m_data[m_pos++];
+                if (m_byte == 0xFF) {
+                    if (m_pos >= m_size || m_data[m_pos] != 0x00) {
+                        return false;
+                    }
+                    ++m_pos;
+                }
+                m_available = 8;
+            }
+            value = (value << 1) | ((m_byte >> --m_available) & 1u);
+        }
+        return true;
+    }
+
+    size_t position() const { return m_pos; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos;
+    uint8_t m_byte = 0;
+    int m_available = 0;
+};
+
+struct DecodeTable {
+    bool defined = false;
+    int32_t maxCode[17];
+    int32_t minCode[17];
+    int valuePointer[17];
+    std::vector<uint8_t> values;
+
+    void build(const uint8_t* bits) {
+        int32_t code = 0;
+        int k = 0;
+        for (int n = 1; n <= 16; ++n) {
+            valuePointer[n] = k;
+            minCode[n] = code;
+            code += bits[n];
+            k += bits[n];
+            maxCode[n] = bits[n] ? code - 1 : -1;
+            code <<= 1;
+        }
+        defined = true;
+    }
+
+    bool decode(BitReader& reader, int& symbol) const {
+        int32_t code = 0;
+        for (int n = 1; n <= 16; ++n) {
+            uint32_t bit = 0;
+            if (!reader.bits(1, bit)) {
+                return false;
+            }
+            code = (code << 1) | static_cast<int32_t>(bit);
+            if (code <= maxCode[n]) {
+                symbol = values[valuePointer[n] + code - minCode[n]];
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+WsqWriter& WsqWriter::forThread() {
+    static thread_local WsqWriter writer;
+    return writer;
+}
+
+const std::vector<uint8_t>& WsqWriter::encode(ConstGray8View image, double bitrate, int ppi) {
+    m_out.clear();
+    const int width = image.width;
+    const int height = image.height;
+    if (width < kMinDimension || height < kMinDimension || width > kMaxDimension || height > kMaxDimension) {
+        return m_out;
+    }
+    const size_t stride = static_cast<size_t>(width);
+
+    // Normalização: média subtraída e escala que leva os extremos a ±128. Os
+    // valores gravados (arredondados) são os usados, como no decodificador
+    uint64_t sum = 0;
+    int lowest = 255;
+    int highest = 0;
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = image.row(y);
+        for (int x = 0; x < width; ++x) {
+            sum += row[x];
+            lowest = std::min<int>(lowest, row[x]);
+            highest = std::max<int>(highest, row[x]);
+        }
+    }
+    const double mean = static_cast<double>(sum) / (stride * height);
+    const Scaled shiftScaled = toScaled(mean, 0xFFFF);
+    const Scaled rangeScaled = toScaled(std::max(std::max(highest - mean, mean - lowest) / 128.0, 1.0 / 128.0), 0xFFFF);
+    const float shift = static_cast<float>(fromScaled(shiftScaled));
+    const float invRange = static_cast<float>(1.0 / fromScaled(rangeScaled));
+
+    m_plane.resize(stride * height);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = image.row(y);
+        float* out = m_plane.data() + y * stride;
+        for (int x = 0; x < width; ++x) {
+            out[x] = (row[x] - shift) * invRange;
+        }
+    }
+
+    const Layout layout = buildLayout(width, height);
+    m_line.resize(std::max(width, height));
+    forwardTransform(m_plane.data(), stride, layout, m_line.data());
+
+    double variance[kCodedSubbands];
+    double steps[kCodedSubbands];
+    subbandVariances(m_plane.data(), stride, layout, variance);
+    quantizationSteps(variance, bitrate, steps);
+
+    // Em taxas muito altas o passo não desce abaixo do que mantém o maior
+    // coeficiente da sub-banda dentro dos 16 bits dos índices
+    for (int k = 0; k < kCodedSubbands; ++k) {
+        if (steps[k] <= 0.0) {
+            continue;
+        }
+        const Region& r = layout.subbands[k];
+        float peak = 0.0f;
+        for (int y = 0; y < r.height; ++y) {
+            const float* row = m_plane.data() + (r.y + y) * stride + r.x;
+            for (int x = 0; x < r.width; ++x) {
+                peak = std::max(peak, std::fabs(row[x]));
+            }
+        }
+        steps[k] = std::max(steps[k], peak / 32000.0);
+    }
+
+    Scaled stepScaled[kCodedSubbands];
+    Scaled zeroScaled[kCodedSubbands];
+    size_t blockSize[kBlockCount] = {0};
+    m_quantized.clear();
+    for (int b = 0; b < kBlockCount; ++b) {
+        for (int k = kBlockStart[b]; k < kBlockStart[b + 1]; ++k) {
+            stepScaled[k] = toScaled(steps[k], 0xFFFF);
+            zeroScaled[k] = toScaled(steps[k] * kZeroBinRatio, 0xFFFF);
+            if (stepScaled[k].value == 0) {
+                continue;
+            }
+            const float step = static_cast<float>(fromScaled(stepScaled[k]));
+            const float halfZero = static_cast<float>(fromScaled(zeroScaled[k]) / 2.0);
+            const Region& r = layout.subbands[k];
+            for (int y = 0; y < r.height; ++y) {
+                const float* row = m_plane.data() + (r.y + y) * stride + r.x;
+                for (int x = 0; x < r.width; ++x) {
+                    m_quantized.push_back(quantize(row[x], step, halfZero));
+                }
+            }
+            blockSize[b] += static_cast<size_t>(r.width) * r.height;
+        }
+    }
+
+    // Tabela 0 para o primeiro bloco, tabela 1 para os outros dois
+    uint32_t frequency[2][256] = {{0}};
+    size_t offset = 0;
+    for (int b = 0; b < kBlockCount; ++b) {
+        uint32_t* freq = frequency[kBlockTable[b]];
+        forEachSymbol(m_quantized.data() + offset, blockSize[b],
+                      [freq](int symbol, uint32_t, int) { ++freq[symbol]; });
+        offset += blockSize[b];
+    }
+    HuffmanTable tables[2];
+    buildHuffmanTable(frequency[0], tables[0]);
+    buildHuffmanTable(frequency[1], tables[1]);
+
+    m_out.reserve(m_quantized.size() / 4 + 4096);
+    putU16(m_out, kSOI);
+
+    // Comentário NISTCOM (atributos lidos pelos sistemas AFIS)
+    char comment[256];
+    std::snprintf(comment, sizeof(comment),
+                  "NIST_COM 9\nPIX_WIDTH %d\nPIX_HEIGHT %d\nPIX_DEPTH 8\nPPI %d\nLOSSY 1\n"
+                  "COLORSPACE GRAY\nCOMPRESSION WSQ\nWSQ_BITRATE %f",
+                  width, height, ppi > 0 ? ppi : -1, bitrate);
+    const size_t commentLength = std::strlen(comment);
+    putU16(m_out, kCOM);
+    putU16(m_out, static_cast<uint32_t>(2 + commentLength));
+    m_out.insert(m_out.end(), comment, comment + commentLength);
+
+    // Filtros: metade de cada um, do centro para a borda (sinal, escala, valor)
+    putU16(m_out, kDTT);
+    putU16(m_out, 58);
+    putU8(m_out, kLowpassTaps);
+    putU8(m_out, kHighpassTaps);
+    auto putCoefficient = [this](double c) {
+        const Scaled s = toScaled(std::fabs(c), 0xFFFFFFFFu);
+        putU8(m_out, c < 0.0 ? 1 : 0);
+        putU8(m_out, s.scale);
+        putU32(m_out, s.value);
+    };
+    for (double c : kLowpass) {
+        putCoefficient(c);
+    }
+    for (double c : kHighpass) {
+        putCoefficient(c);
+    }
+
+    // Passo e zona morta das 64 sub-bandas (zero = não codificada)
+    const Scaled binCenter = toScaled(kBinCenter, 0xFFFF);
+    putU16(m_out, kDQT);
+    putU16(m_out, 2 + 3 + kSubbandCount * 6);
+    putU8(m_out, binCenter.scale);
+    putU16(m_out, binCenter.value);
+    for (int k = 0; k < kSubbandCount; ++k) {
+        const bool coded = k < kCodedSubbands && stepScaled[k].value != 0;
+        putU8(m_out, coded ? stepScaled[k].scale : 0);
+        putU16(m_out, coded ? stepScaled[k].value : 0);
+        putU8(m_out, coded ? zeroScaled[k].scale : 0);
+        putU16(m_out, coded ? zeroScaled[k].value : 0);
+    }
+
+    putU16(m_out, kSOF);
+    putU16(m_out, 17);
+    putU8(m_out, 0);    // Preto
+    putU8(m_out, 255);  // Branco
+    putU16(m_out, static_cast<uint32_t>(height));
+    putU16(m_out, static_cast<uint32_t>(width));
+    putU8(m_out, shiftScaled.scale);
+    putU16(m_out, shiftScaled.value);
+    putU8(m_out, rangeScaled.scale);
+    putU16(m_out, rangeScaled.value);
+    putU8(m_out, 2);    // Versão do codificador
+    putU16(m_out, 0);   // Implementação
+
+    offset = 0;
+    for (int b = 0; b < kBlockCount; ++b) {
+        const int id = kBlockTable[b];
+        if (b == 0 || id != kBlockTable[b - 1]) {
+            putHuffmanTable(m_out, id, tables[id]);
+        }
+        putU16(m_out, kSOB);
+        putU16(m_out, 3);
+        putU8(m_out, static_cast<uint32_t>(id));
+        encodeBlock(m_quantized.data() + offset, blockSize[b], tables[id].codes, tables[id].sizes);
+        offset += blockSize[b];
+    }
+    putU16(m_out, kEOI);
+    return m_out;
+}
+
+void WsqWriter::encodeBlock(const int16_t* coefficients, size_t count, const uint16_t* codes, const uint8_t* sizes) {
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+    forEachSymbol(coefficients, count, [&](int symbol, uint32_t extra, int extraBits) {
+        putBits(codes[symbol], sizes[symbol]);
+        if (extraBits > 0) {
+            putBits(extra, extraBits);
+        }
+    });
+    flushBits();
+}
+
+void WsqWriter::putBits(uint32_t bits, int count) {
+    m_bitBuffer = (m_bitBuffer << count) | (bits & ((1u << count) - 1));
+    m_bitCount += count;
+    while (m_bitCount >= 8) {
+        m_bitCount -= 8;
+        const uint8_t byte = static_cast<uint8_t>(m_bitBuffer >> m_bitCount);
+        m_out.push_back(byte);
+        if (byte == 0xFF) {
+            m_out.push_back(0x00);
+        }
+    }
+    m_bitBuffer &= (1u << m_bitCount) - 1;
+}
+
+// Completa o último byte com uns
+void WsqWriter::flushBits() {
+    if (m_bitCount > 0) {
+        const int pad = 8 - m_bitCount;
+        putBits((1u << pad) - 1, pad);
+    }
+}
+
+bool WsqWriter::write(ConstGray8View image, const std::string& path, double bitrate, int ppi) {
+    const std::vector<uint8_t>& data = encode(image, bitrate, ppi);
+    if (data.empty()) {
+        return false;
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = (std::fclose(file) == 0) && ok;
+    return ok;
+}
+
+bool WsqReader::read(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return fail("cannot open " + path);
+    }
+    std::vector<uint8_t> data;
+    uint8_t buffer[65536];
+    size_t n = 0;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    std::fclose(file);
+    return decode(data.data(), data.size());
+}
+
+bool WsqReader::decode(const uint8_t* data, size_t size) {
+    m_error.clear();
+    m_width = 0;
+    m_height = 0;
+    m_ppi = -1;
+    m_pixels.clear();
+
+    ByteReader in(data, size);
+    uint32_t marker = 0;
+    if (!in.u16(marker) || marker != kSOI) {
+        return fail("not a WSQ stream");
+    }
+
+    DecodeTable tables[kMaxTables];
+    float step[kSubbandCount] = {0};
+    float halfZero[kSubbandCount] = {0};
+    float binCenter = 0.0f;
+    bool haveQuantization = false;
+    bool haveFrame = false;
+    float shift = 0.0f;
+    float range = 1.0f;
+    Layout layout;
+    int block = 0;
+
+    for (;;) {
+        if (!in.u16(marker)) {
+            return fail("truncated stream");
+        }
+        if (marker == kEOI) {
+            break;
+        }
+        uint32_t length = 0;
+        if (!in.u16(length) || length < 2 || in.position() - 2 + length > size) {
+            return fail("truncated segment");
+        }
+        const size_t segmentEnd = in.position() - 2 + length;
+
+        switch (marker) {
+        case kCOM: {
+            const std::string text(reinterpret_cast<const char*>(data + in.position()), segmentEnd - in.position());
+            const size_t at = text.find("\nPPI ");
+            if (text.compare(0, 8, "NIST_COM") == 0 && at != std::string::npos) {
+                m_ppi = std::atoi(text.c_str() + at + 5);
+            }
+            break;
+        }
+        case kDTT: {
+            uint32_t lowTaps = 0;
+            uint32_t highTaps = 0;
+            if (!in.u8(lowTaps) || !in.u8(highTaps) ||
+                lowTaps != kLowpassTaps || highTaps != kHighpassTaps) {
+                return fail("unsupported wavelet filters");
+            }
+            for (int i = 0; i < 9; ++i) {
+                uint32_t sign = 0;
+                uint32_t scale = 0;
+                uint32_t value = 0;
+                if (!in.u8(sign) || !in.u8(scale) || !in.u32(value)) {
+                    return fail("truncated transform table");
+                }
+                const double c = (sign ? -1.0 : 1.0) * fromScaled(static_cast<uint8_t>(scale), value);
+                const double expected = i < 5 ? kLowpass[i] : kHighpass[i - 5];
+                if (std::fabs(c - expected) > 1e-6) {
+                    return fail("unsupported wavelet filters");
+                }
+            }
+            break;
+        }
+        case kDQT: {
+            uint32_t scale = 0;
+            uint32_t value = 0;
+            if (!in.u8(scale) || !in.u16(value)) {
+                return fail("truncated quantization table");
+            }
+            binCenter = static_cast<float>(fromScaled(static_cast<uint8_t>(scale), value));
+            for (int k = 0; k < kSubbandCount; ++k) {
+                uint32_t stepScale = 0;
+                uint32_t stepValue = 0;
+                uint32_t zeroScale = 0;
+                uint32_t zeroValue = 0;
+                if (!in.u8(stepScale) || !in.u16(stepValue) || !in.u8(zeroScale) || !in.u16(zeroValue)) {
+                    return fail("truncated quantization table");
+                }
+                step[k] = static_cast<float>(fromScaled(static_cast<uint8_t>(stepScale), stepValue));
+                halfZero[k] = static_cast<float>(fromScaled(static_cast<uint8_t>(zeroScale), zeroValue) / 2.0);
+            }
+            haveQuantization = true;
+            break;
+        }
+        case kDHT:
+            while (in.position() < segmentEnd) {
+                uint32_t id = 0;
+                uint8_t bits[17] = {0};
+                if (!in.u8(id) || id >= kMaxTables || in.position() + 16 > segmentEnd) {
+                    return fail("invalid Huffman table");
+                }
+                size_t total = 0;
+                for (int n = 1; n <= 16; ++n) {
+                    bits[n] = data[in.position()];
+                    in.seek(in.position() + 1);
+                    total += bits[n];
+                }
+                if (total > 256 || in.position() + total > segmentEnd) {
+                    return fail("invalid Huffman table");
+                }
+                tables[id].values.assign(data + in.position(), data + in.position() + total);
+                tables[id].build(bits);
+                in.seek(in.position() + total);
+            }
+            break;
+        case kDRT: {
+            uint32_t interval = 0;
+            if (!in.u16(interval) || interval != 0) {
+                return fail("restart intervals are not supported");
+            }
+            break;
+        }
+        case kSOF: {
+            uint32_t black = 0, white = 0, height = 0, width = 0;
+            uint32_t shiftScale = 0, shiftValue = 0, rangeScale = 0, rangeValue = 0;
+            if (!in.u8(black) || !in.u8(white) || !in.u16(height) || !in.u16(width) ||
+                !in.u8(shiftScale) || !in.u16(shiftValue) || !in.u8(rangeScale) || !in.u16(rangeValue)) {
+                return fail("truncated frame header");
+            }
+            if (static_cast<int>(width) < WsqWriter::kMinDimension ||
+                static_cast<int>(height) < WsqWriter::kMinDimension ||
+                static_cast<size_t>(width) * height > kMaxPixels) {
+                return fail("unsupported image size");
+            }
+            m_width = static_cast<int>(width);
+            m_height = static_cast<int>(height);
+            shift = static_cast<float>(fromScaled(static_cast<uint8_t>(shiftScale), shiftValue));
+            range = static_cast<float>(fromScaled(static_cast<uint8_t>(rangeScale), rangeValue));
+            layout = buildLayout(m_width, m_height);
+            m_plane.assign(static_cast<size_t>(m_width) * m_height, 0.0f);
+            haveFrame = true;
+            break;
+        }
+        case kSOB: {
+            uint32_t id = 0;
+            if (!in.u8(id) || id >= kMaxTables || !tables[id].defined) {
+                return fail("block without Huffman table");
+            }
+            if (!haveFrame || !haveQuantization || block >= kBlockCount) {
+                return fail("unexpected block");
+            }
+
+            size_t count = 0;
+            for (int k = kBlockStart[block]; k < kBlockStart[block + 1]; ++k) {
+                if (step[k] > 0.0f) {
+                    count += static_cast<size_t>(layout.subbands[k].width) * layout.subbands[k].height;
+                }
+            }
+            // Cada símbolo tem ao menos 17 bits por 65535 coeficientes (corrida longa de zeros):
+            // o bloco não pode pedir mais coeficientes do que os bytes restantes descrevem
+            if (count / 0xFFFF * 2 > size - in.position()) {
+                return fail("truncated block");
+            }
+            std::vector<int32_t> values(count, 0);
+            BitReader bits(data, size, segmentEnd);
+            for (size_t filled = 0; filled < count;) {
+                int symbol = 0;
+                uint32_t extra = 0;
+                if (!tables[id].decode(bits, symbol)) {
+                    return fail("truncated block");
+                }
+                size_t run = 0;
+                if (symbol >= 1 && symbol <= kMaxZeroRun) {
+                    run = static_cast<size_t>(symbol);
+                } else if (symbol == kZeroRun8 || symbol == kZeroRun16) {
+                    if (!bits.bits(symbol == kZeroRun8 ? 8 : 16, extra)) {
+                        return fail("truncated block");
+                    }
+                    run = extra;
+                } else if (symbol >= kPositive8 && symbol <= kNegative16) {
+                    if (!bits.bits(symbol <= kNegative8 ? 8 : 16, extra)) {
+                        return fail("truncated block");
+                    }
+                    values[filled++] = (symbol == kPositive8 || symbol == kPositive16) ? static_cast<int32_t>(extra)
+                                                                                         : -static_cast<int32_t>(extra);
+                    continue;
+                } else if (symbol > kZeroRun16 && symbol != kCoefficientBias) {
+                    values[filled++] = symbol - kCoefficientBias;
+                    continue;
+                } else {
+                    return fail("invalid Huffman symbol");
+                }
+                if (run == 0 || run > count - filled) {
+                    return fail("zero run past the end of the block");
+                }
+                filled += run;
+            }
+
+            size_t next = 0;
+            for (int k = kBlockStart[block]; k < kBlockStart[block + 1]; ++k) {
+                if (step[k] <= 0.0f) {
+                    continue;
+                }
+                const Region& r = layout.subbands[k];
+                for (int y = 0; y < r.height; ++y) {
+                    float* row = m_plane.data() + static_cast<size_t>(r.y + y) * m_width + r.x;
+                    for (int x = 0; x < r.width; ++x) {
+                        row[x] = dequantize(values[next++], step[k], halfZero[k], binCenter);
+                    }
+                }
+            }
+            ++block;
+            in.seek(bits.position());
+            continue;
+        }
+        default:
+            return fail("unknown marker");
+        }
+        in.seek(segmentEnd);
+    }
+
+    if (!haveFrame || block != kBlockCount) {
+        return fail("incomplete stream");
+    }
+
+    m_line.resize(std::max(m_width, m_height));
+    inverseTransform(m_plane.data(), static_cast<size_t>(m_width), layout, m_line.data());
+
+    m_pixels.resize(m_plane.size());
+    for (size_t i = 0; i < m_plane.size(); ++i) {
+        const long v = std::lround(m_plane[i] * range + shift);
+        m_pixels[i] = static_cast<uint8_t>(std::max(0L, std::min(255L, v)));
+    }
+    return true;
+}
+
+bool WsqReader::fail(const std::string& message) {
+    m_error = message;
+    m_pixels.clear();
+    return false;
+}
+
+} // namespace Raster
+} // namespace SFinGe
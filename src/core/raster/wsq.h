@@ -0,0 +1,110 @@
+#ifndef RASTER_WSQ_H
+#define RASTER_WSQ_H
+
+#include "gray8.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SFinGe {
+namespace Raster {
+
+/**
+ * @brief Codificador WSQ (FBI Wavelet Scalar Quantization) para Grayscale8
+ *
+ * Segue a estrutura da especificação do FBI: transformada wavelet 9/7 com
+ * os filtros do padrão (implementada por lifting), decomposição em 64
+ * sub-bandas (60 codificadas), quantização escalar com zona morta cujos
+ * passos saem da variância de cada sub-banda para a taxa pedida, e
+ * Huffman com corridas de zeros em três blocos (sub-bandas 0-18 na tabela
+ * 0, 19-51 e 52-59 na tabela 1). 0.75 bit/pixel é a taxa usual do FBI.
+ *
+ * Os buffers são mantidos entre chamadas; uma instância não é thread-safe
+ * e forThread() devolve uma por thread.
+ */
+class WsqWriter {
+public:
+    static constexpr double kDefaultBitrate = 0.75;
+
+    /**
+     * @brief Menor e maior dimensão aceitas (a decomposição tem 5 níveis)
+     */
+    static constexpr int kMinDimension = 64;
+    static constexpr int kMaxDimension = 65535;
+
+    /**
+     * @brief Codifica a imagem; o resultado vale até a próxima chamada
+     *
+     * @param bitrate Taxa alvo em bits por pixel
+     * @param ppi Resolução gravada no comentário NISTCOM
+     * @return Vazio se as dimensões estiverem fora dos limites
+     */
+    const std::vector<uint8_t>& encode(ConstGray8View image, double bitrate = kDefaultBitrate, int ppi = 500);
+
+    /**
+     * @brief encode() e grava o arquivo
+     */
+    bool write(ConstGray8View image, const std::string& path, double bitrate = kDefaultBitrate, int ppi = 500);
+
+    /**
+     * @brief Instância da thread atual (buffers reaproveitados pelos writers do lote)
+     */
+    static WsqWriter& forThread();
+
+private:
+    void putBits(uint32_t bits, int count);
+    void flushBits();
+    void encodeBlock(const int16_t* coefficients, size_t count, const uint16_t* codes, const uint8_t* sizes);
+
+    std::vector<float> m_plane;          // Imagem normalizada, depois os coeficientes
+    std::vector<float> m_line;           // Linha ou coluna sendo transformada
+    std::vector<int16_t> m_quantized;    // Coeficientes quantizados, na ordem dos blocos
+    std::vector<uint8_t> m_out;
+    uint32_t m_bitBuffer = 0;
+    int m_bitCount = 0;
+};
+
+/**
+ * @brief Decodificador WSQ, usado nos testes de ida e volta e pela ferramenta
+ *
+ * Aceita os arquivos do WsqWriter: filtros 9/7 do padrão, sem intervalos de
+ * reinício. Tabelas e blocos são validados; nenhum erro aborta o processo.
+ */
+class WsqReader {
+public:
+    /**
+     * @brief Maior imagem aceita, em pixels
+     *
+     * Bem acima do maior quadro de um lote (cerca de 1060 x 1275); um
+     * cabeçalho corrompido não chega a alocar o plano de 65535 x 65535.
+     */
+    static constexpr size_t kMaxPixels = 4096 * 4096;
+
+    bool decode(const uint8_t* data, size_t size);
+    bool read(const std::string& path);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int ppi() const { return m_ppi; }  // -1 sem NISTCOM
+    const std::vector<uint8_t>& pixels() const { return m_pixels; }
+    ConstGray8View view() const { return ConstGray8View(m_pixels.data(), m_width, m_width, m_height); }
+
+    const std::string& error() const { return m_error; }
+
+private:
+    bool fail(const std::string& message);
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_ppi = -1;
+    std::vector<uint8_t> m_pixels;
+    std::vector<float> m_plane;
+    std::vector<float> m_line;
+    std::string m_error;
+};
+
+} // namespace Raster
+} // namespace SFinGe
+
+#endif // RASTER_WSQ_H
@@ -0,0 +1,113 @@
+#include "pore_atlas.h"
+#include <algorithm>
+#include <cmath>
+
+namespace SFinGe {
+
+namespace {
+// Amostras por eixo usadas para estimar a cobertura de cada pixel
+constexpr int kSupersampling = 4;
+}
+
+PoreAtlas::PoreAtlas(double minRadius, double maxRadius,
+                     double minIntensity, double maxIntensity,
+                     int radiusLevels, int intensityLevels)
+    : m_minRadius(minRadius)
+    , m_maxRadius(std::max(minRadius, maxRadius))
+    , m_minIntensity(minIntensity)
+    , m_maxIntensity(std::max(minIntensity, maxIntensity))
+    , m_radiusLevels(std::max(1, radiusLevels))
+    , m_intensityLevels(std::max(1, intensityLevels))
+{
+    m_sprites.reserve(m_radiusLevels * m_intensityLevels);
+
+    for (int r = 0; r < m_radiusLevels; ++r) {
+        double radius = m_radiusLevels > 1
+            ? m_minRadius + (m_maxRadius - m_minRadius) * r / (m_radiusLevels - 1)
+            : m_minRadius;
+
+        for (int i = 0; i < m_intensityLevels; ++i) {
+            double intensity = m_intensityLevels > 1
+                ? m_minIntensity + (m_maxIntensity - m_minIntensity) * i / (m_intensityLevels - 1)
+                : m_minIntensity;
+            m_sprites.push_back(buildSprite(radius, intensity));
+        }
+    }
+}
+
+int PoreAtlas::levelOf(double value, double minValue, double maxValue, int levels) {
+    if (levels <= 1 || maxValue <= minValue) {
+        return 0;
+    }
+    double t = (value - minValue) / (maxValue - minValue);
+    int level = static_cast<int>(std::lround(t * (levels - 1)));
+    return std::clamp(level, 0, levels - 1);
+}
+
+PoreAtlas::Sprite PoreAtlas::buildSprite(double radius, double intensity) {
+    Sprite sprite;
+    sprite.halfSize = static_cast<int>(std::ceil(radius));
+    int size = 2 * sprite.halfSize + 1;
+    sprite.weights.assign(size * size, 0.0f);
+
+    double radiusSq = radius * radius;
+    double step = 1.0 / kSupersampling;
+
+    for (int dy = -sprite.halfSize; dy <= sprite.halfSize; ++dy) {
+        for (int dx = -sprite.halfSize; dx <= sprite.halfSize; ++dx) {
+            // Fração do pixel coberta pelo disco (anti-aliasing)
+            int inside = 0;
+            for (int sy = 0; sy < kSupersampling; ++sy) {
+                double py = dy - 0.5 + (sy + 0.5) * step;
+                for (int sx = 0; sx < kSupersampling; ++sx) {
+                    double px = dx - 0.5 + (sx + 0.5) * step;
+                    if (px * px + py * py <= radiusSq) {
+                        ++inside;
+                    }
+                }
+            }
+            double coverage = static_cast<double>(inside) / (kSupersampling * kSupersampling);
+
+            // O pixel central é sempre clareado por inteiro, mesmo para poros subpixel
+            if (dx == 0 && dy == 0) {
+                coverage = 1.0;
+            }
+
+            sprite.weights[(dy + sprite.halfSize) * size + (dx + sprite.halfSize)] =
+                static_cast<float>(coverage * intensity);
+        }
+    }
+
+    return sprite;
+}
+
+const PoreAtlas::Sprite& PoreAtlas::sprite(double radius, double intensity) const {
+    int r = levelOf(radius, m_minRadius, m_maxRadius, m_radiusLevels);
+    int i = levelOf(intensity, m_minIntensity, m_maxIntensity, m_intensityLevels);
+    return m_sprites[r * m_intensityLevels + i];
+}
+
+void PoreAtlas::stamp(std::vector<float>& image, int width, int height,
+                      int x, int y, double radius, double intensity) const {
+    const Sprite& s = sprite(radius, intensity);
+    int size = 2 * s.halfSize + 1;
+
+    // Recortar o sprite contra as bordas da imagem uma única vez
+    int x0 = std::max(x - s.halfSize, 0);
+    int x1 = std::min(x + s.halfSize, width - 1);
+    int y0 = std::max(y - s.halfSize, 0);
+    int y1 = std::min(y + s.halfSize, height - 1);
+
+    for (int py = y0; py <= y1; ++py) {
+        const float* weights = &s.weights[(py - y + s.halfSize) * size + (x0 - x + s.halfSize)];
+        float* row = &image[py * width];
+        for (int px = x0; px <= x1; ++px) {
+            float w = *weights++;
+            if (w > 0.0f) {
+                row[px] = std::min(row[px] + w, 1.0f);
+            }
+        }
+    }
+}
+
+} // namespace SFinGe
@@ -0,0 +1,70 @@
+#ifndef PORE_ATLAS_H
+#define PORE_ATLAS_H
+
+#include <vector>
+#include <cstdint>
+
+namespace SFinGe {
+
+/**
+ * @brief Atlas de sprites de poros pré-computados com anti-aliasing
+ *
+ * Os poros são discos claros de raio subpixel a poucos pixels. Em vez de
+ * calcular uma raiz quadrada por vizinho a cada poro, o atlas guarda uma
+ * pequena grade de sprites indexada por (raio, intensidade), com a
+ * cobertura de cada pixel obtida por superamostragem. Carimbar um poro
+ * passa a ser apenas somar um sprite já pronto à imagem.
+ */
+class PoreAtlas {
+public:
+    /**
+     * @brief Sprite de um poro centrado no pixel de destino
+     */
+    struct Sprite {
+        int halfSize = 0;              // Sprite ocupa (2*halfSize+1)^2 pixels
+        std::vector<float> weights;    // Incremento de brilho por pixel
+    };
+
+    /**
+     * @brief Construtor
+     * @param minRadius Raio mínimo dos poros (pixels)
+     * @param maxRadius Raio máximo dos poros (pixels)
+     * @param minIntensity Intensidade mínima (aumento de brilho)
+     * @param maxIntensity Intensidade máxima
+     * @param radiusLevels Número de níveis de raio no atlas
+     * @param intensityLevels Número de níveis de intensidade no atlas
+     */
+    PoreAtlas(double minRadius, double maxRadius,
+              double minIntensity, double maxIntensity,
+              int radiusLevels = 8, int intensityLevels = 4);
+
+    /**
+     * @brief Retorna o sprite mais próximo do raio e intensidade pedidos
+     */
+    const Sprite& sprite(double radius, double intensity) const;
+
+    /**
+     * @brief Soma o sprite à imagem na posição (x, y), saturando em [0, 1]
+     * @param image Imagem de destino
+     * @param width Largura da imagem
+     * @param height Altura da imagem
+     */
+    void stamp(std::vector<float>& image, int width, int height,
+               int x, int y, double radius, double intensity) const;
+
+private:
+    static Sprite buildSprite(double radius, double intensity);
+    static int levelOf(double value, double minValue, double maxValue, int levels);
+
+    double m_minRadius;
+    double m_maxRadius;
+    double m_minIntensity;
+    double m_maxIntensity;
+    int m_radiusLevels;
+    int m_intensityLevels;
+    std::vector<Sprite> m_sprites;  // [radiusLevel * intensityLevels + intensityLevel]
+};
+
+} // namespace SFinGe
+
+#endif // PORE_ATLAS_H
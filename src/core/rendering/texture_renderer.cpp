@@ -1,6 +1,8 @@
 #include "texture_renderer.h"
+#include "pore_atlas.h"
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <QDebug>
 
 namespace SFinGe {
@@ -27,10 +29,10 @@ std::vector<float> TextureRenderer::render(const std::vector<float>& ridgeMap,
     auto textured = applyTexture(ridgeMap);
     qDebug() << "[TextureRenderer] Textura aplicada";
     
-    // Passo 3: Criar máscara de cristas
-    std::vector<bool> ridgeMask(m_width * m_height);
+    // Passo 3: Criar máscara de cristas (um byte por pixel)
+    std::vector<uint8_t> ridgeMask(m_width * m_height);
     for (size_t i = 0; i < ridgeMap.size(); ++i) {
-        ridgeMask[i] = ridgeMap[i] > 0.5f;
+        ridgeMask[i] = ridgeMap[i] > 0.5f ? 1 : 0;
     }
     
     // Passo 4: Adicionar poros (se habilitado)
@@ -60,6 +62,11 @@ std::vector<float> TextureRenderer::render(const std::vector<float>& ridgeMap,
     return combined;
 }
 
+Plane<float> TextureRenderer::render(const Plane<float>& ridgeMap,
+                                     const std::vector<float>& shapeMap) const {
+    return Plane<float>(m_width, m_height, render(ridgeMap.values(), shapeMap));
+}
+
 std::vector<float> TextureRenderer::generateBackground() const {
     std::vector<float> background(m_width * m_height);
     
@@ -128,20 +135,14 @@ std::vector<float> TextureRenderer::applyTexture(const std::vector<float>& ridge
 }
 
 std::vector<float> TextureRenderer::addPores(const std::vector<float>& texturedRidges,
-                                              const std::vector<bool>& ridgeMask) const {
+                                              const std::vector<uint8_t>& ridgeMask) const {
     std::vector<float> result = texturedRidges;
     
-    // Contar pixels de crista
-    int ridgePixelCount = 0;
-    std::vector<int> ridgeIndices;
-    for (size_t i = 0; i < ridgeMask.size(); ++i) {
-        if (ridgeMask[i]) {
-            ridgePixelCount++;
-            ridgeIndices.push_back(static_cast<int>(i));
-        }
-    }
+    // Contar pixels de crista (sem materializar a lista de índices)
+    const int totalPixels = static_cast<int>(ridgeMask.size());
+    const int ridgePixelCount = static_cast<int>(std::count(ridgeMask.begin(), ridgeMask.end(), 1));
     
-    if (ridgeIndices.empty()) {
+    if (ridgePixelCount == 0) {
         return result;
     }
     
@@ -149,37 +150,37 @@ std::vector<float> TextureRenderer::addPores(const std::vector<float>& texturedR
     int numPores = static_cast<int>(ridgePixelCount * m_params.poreDensity);
     qDebug() << "[TextureRenderer] Adicionando" << numPores << "poros em" << ridgePixelCount << "pixels de crista";
     
+    // Atlas de sprites pré-computados para os tamanhos e intensidades configurados
+    PoreAtlas atlas(m_params.minPoreSize, m_params.maxPoreSize,
+                    m_params.minPoreIntensity, m_params.maxPoreIntensity);
+    
     // Distribuições para posição e tamanho dos poros
-    std::uniform_int_distribution<int> indexDist(0, static_cast<int>(ridgeIndices.size()) - 1);
+    std::uniform_int_distribution<int> indexDist(0, totalPixels - 1);
     std::uniform_real_distribution<double> sizeDist(m_params.minPoreSize, m_params.maxPoreSize);
     std::uniform_real_distribution<double> intensityDist(m_params.minPoreIntensity, m_params.maxPoreIntensity);
     
-    // Adicionar poros
-    for (int p = 0; p < numPores; ++p) {
-        int idx = ridgeIndices[indexDist(m_rng)];
+    // Amostragem por rejeição sobre a máscara: uniforme entre os pixels de
+    // crista, com custo esperado de totalPixels/ridgePixelCount sorteios por poro
+    const long long maxAttempts = static_cast<long long>(numPores) *
+                                  (totalPixels / ridgePixelCount + 1) * 8;
+    long long attempts = 0;
+    
+    for (int p = 0; p < numPores && attempts < maxAttempts; ) {
+        int idx = indexDist(m_rng);
+        ++attempts;
+        if (!ridgeMask[idx]) {
+            continue;
+        }
+        
         int x = idx % m_width;
         int y = idx / m_width;
         
         double poreSize = sizeDist(m_rng);
         double poreIntensity = intensityDist(m_rng);
         
-        // Aplicar poro como um pequeno ponto mais claro
-        int radius = static_cast<int>(std::ceil(poreSize));
-        for (int dy = -radius; dy <= radius; ++dy) {
-            for (int dx = -radius; dx <= radius; ++dx) {
-                int nx = x + dx;
-                int ny = y + dy;
-                
-                if (nx >= 0 && nx < m_width && ny >= 0 && ny < m_height) {
-                    double dist = std::sqrt(dx * dx + dy * dy);
-                    if (dist <= poreSize) {
-                        int nidx = ny * m_width + nx;
-                        // Clarear o pixel (simula reflexo de suor)
-                        result[nidx] = std::clamp(result[nidx] + static_cast<float>(poreIntensity), 0.0f, 1.0f);
-                    }
-                }
-            }
-        }
+        // Aplicar poro como um pequeno ponto mais claro (simula reflexo de suor)
+        atlas.stamp(result, m_width, m_height, x, y, poreSize, poreIntensity);
+        ++p;
     }
     
     return result;
@@ -189,30 +190,12 @@ std::vector<float> TextureRenderer::normalizeContrast(const std::vector<float>&
                                                        const std::vector<float>& shapeMap) const {
     std::vector<float> result = image;
     
-    // Coletar valores dentro da região da impressão digital
-    std::vector<float> values;
-    for (size_t i = 0; i < image.size(); ++i) {
-        float alpha = shapeMap.empty() ? 1.0f : shapeMap[i];
-        if (alpha > 0.5f) {
-            values.push_back(image[i]);
-        }
-    }
-    
-    if (values.empty()) {
+    float lowerVal = 0.0f;
+    float upperVal = 0.0f;
+    if (!findContrastPercentiles(image, shapeMap, lowerVal, upperVal)) {
         return result;
     }
     
-    // Ordenar para calcular percentis
-    std::sort(values.begin(), values.end());
-    
-    // Calcular percentis inferior e superior
-    size_t lowerIdx = static_cast<size_t>(values.size() * m_params.contrastPercentileLower / 100.0);
-    size_t upperIdx = static_cast<size_t>(values.size() * m_params.contrastPercentileUpper / 100.0);
-    upperIdx = std::min(upperIdx, values.size() - 1);
-    
-    float lowerVal = values[lowerIdx];
-    float upperVal = values[upperIdx];
-    
     if (upperVal <= lowerVal) {
         return result;
     }
@@ -226,6 +209,105 @@ std::vector<float> TextureRenderer::normalizeContrast(const std::vector<float>&
     return result;
 }
 
+bool TextureRenderer::findContrastPercentiles(const std::vector<float>& image,
+                                              const std::vector<float>& shapeMap,
+                                              float& lowerVal, float& upperVal) const {
+    // Seleção em tempo linear: histograma fino sobre [min, max] localiza o bin
+    // de cada percentil e apenas os valores desses bins são refinados com
+    // nth_element. O resultado é idêntico ao da ordenação completa.
+    auto insideMask = [&shapeMap](size_t i) {
+        return shapeMap.empty() || shapeMap[i] > 0.5f;
+    };
+    
+    // Passo 1: contagem e intervalo dos valores dentro da impressão digital
+    size_t count = 0;
+    float minVal = std::numeric_limits<float>::max();
+    float maxVal = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i < image.size(); ++i) {
+        if (insideMask(i)) {
+            minVal = std::min(minVal, image[i]);
+            maxVal = std::max(maxVal, image[i]);
+            ++count;
+        }
+    }
+    
+    if (count == 0) {
+        return false;
+    }
+    
+    // Índices dos percentis (mesma convenção da versão com std::sort)
+    size_t lowerIdx = static_cast<size_t>(count * m_params.contrastPercentileLower / 100.0);
+    size_t upperIdx = static_cast<size_t>(count * m_params.contrastPercentileUpper / 100.0);
+    lowerIdx = std::min(lowerIdx, count - 1);
+    upperIdx = std::min(upperIdx, count - 1);
+    
+    if (!(maxVal > minVal)) {
+        lowerVal = upperVal = minVal;
+        return true;
+    }
+    
+    // Passo 2: histograma
+    // Em double: com float, um intervalo subnormal levaria a escala a inf e
+    // (max - min) entre extremos opostos estouraria; o bin só precisa ser monótono
+    const int numBins = kContrastHistogramBins;
+    const double scale = numBins / (static_cast<double>(maxVal) - minVal);
+    auto binOf = [minVal, scale, numBins](float v) {
+        return static_cast<int>(std::min((static_cast<double>(v) - minVal) * scale, numBins - 1.0));
+    };
+    
+    std::vector<size_t> histogram(numBins, 0);
+    for (size_t i = 0; i < image.size(); ++i) {
+        if (insideMask(i)) {
+            histogram[binOf(image[i])]++;
+        }
+    }
+    
+    // Localizar o bin de cada percentil e o posto dentro dele (percentil
+    // inferior acima do superior é válido: o laço segue até achar os dois)
+    int lowerBin = -1, upperBin = -1;
+    size_t lowerRank = 0, upperRank = 0;
+    size_t cumulative = 0;
+    for (int b = 0; b < numBins && (lowerBin < 0 || upperBin < 0); ++b) {
+        size_t next = cumulative + histogram[b];
+        if (lowerBin < 0 && lowerIdx < next) {
+            lowerBin = b;
+            lowerRank = lowerIdx - cumulative;
+        }
+        if (upperBin < 0 && upperIdx < next) {
+            upperBin = b;
+            upperRank = upperIdx - cumulative;
+        }
+        cumulative = next;
+    }
+    
+    // Passo 3: refinamento dentro dos dois bins selecionados
+    std::vector<float> lowerValues;
+    std::vector<float> upperValues;
+    lowerValues.reserve(histogram[lowerBin]);
+    if (upperBin != lowerBin) {
+        upperValues.reserve(histogram[upperBin]);
+    }
+    for (size_t i = 0; i < image.size(); ++i) {
+        if (insideMask(i)) {
+            int b = binOf(image[i]);
+            if (b == lowerBin) {
+                lowerValues.push_back(image[i]);
+            } else if (b == upperBin) {
+                upperValues.push_back(image[i]);
+            }
+        }
+    }
+    
+    std::nth_element(lowerValues.begin(), lowerValues.begin() + lowerRank, lowerValues.end());
+    lowerVal = lowerValues[lowerRank];
+    
+    std::vector<float>& upperSource = (upperBin == lowerBin) ? lowerValues : upperValues;
+    std::nth_element(upperSource.begin(), upperSource.begin() + upperRank, upperSource.end());
+    upperVal = upperSource[upperRank];
+    
+    return true;
+}
+
 std::vector<float> TextureRenderer::applyGaussianBlur(const std::vector<float>& image, double sigma) const {
     if (sigma <= 0) {
         return image;
@@ -3,9 +3,11 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
 #include <random>
 #include "perlin_noise.h"
 #include "models/fingerprint_parameters.h"
+#include "core/plane.h"
 
 namespace SFinGe {
 
@@ -39,6 +41,15 @@ public:
     std::vector<float> render(const std::vector<float>& ridgeMap,
                               const std::vector<float>& shapeMap) const;
 
+    /**
+     * @brief Versão em plano float do pipeline (sem conversões intermediárias)
+     * @param ridgeMap Plano de intensidade das cristas [0, 1]
+     * @param shapeMap Mapa de forma da impressão digital (máscara alfa)
+     * @return Plano renderizado [0, 1]
+     */
+    Plane<float> render(const Plane<float>& ridgeMap,
+                        const std::vector<float>& shapeMap) const;
+
 private:
     /**
      * @brief Gera o fundo com vinheta e ruído
@@ -56,11 +67,11 @@ private:
     /**
      * @brief Adiciona simulação de poros de suor
      * @param texturedRidges Imagem com textura
-     * @param ridgeMask Máscara booleana das cristas
+     * @param ridgeMask Máscara das cristas (1 byte por pixel, 1 = crista)
      * @return Imagem com poros adicionados
      */
     std::vector<float> addPores(const std::vector<float>& texturedRidges,
-                                const std::vector<bool>& ridgeMask) const;
+                                const std::vector<uint8_t>& ridgeMask) const;
 
     /**
      * @brief Normaliza o contraste da imagem
@@ -71,6 +82,21 @@ private:
     std::vector<float> normalizeContrast(const std::vector<float>& image,
                                          const std::vector<float>& shapeMap) const;
 
+    /**
+     * @brief Calcula os percentis de contraste em tempo linear
+     *
+     * Usa um histograma fino para localizar os bins dos percentis e refina
+     * apenas esses bins com nth_element, evitando ordenar toda a imagem.
+     * @param image Imagem de entrada
+     * @param shapeMap Mapa de forma para mascaramento
+     * @param lowerVal Valor do percentil inferior (saída)
+     * @param upperVal Valor do percentil superior (saída)
+     * @return false se não houver pixels dentro da máscara
+     */
+    bool findContrastPercentiles(const std::vector<float>& image,
+                                 const std::vector<float>& shapeMap,
+                                 float& lowerVal, float& upperVal) const;
+
     /**
      * @brief Aplica blur gaussiano à imagem
      * @param image Imagem de entrada
@@ -79,6 +105,8 @@ private:
      */
     std::vector<float> applyGaussianBlur(const std::vector<float>& image, double sigma) const;
 
+    static constexpr int kContrastHistogramBins = 4096;
+
     RenderingParameters m_params;
     int m_width;
     int m_height;
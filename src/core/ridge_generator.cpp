@@ -1,5 +1,7 @@
 #include "ridge_generator.h"
-#include <QRandomGenerator>
+#include "raster/morphology.h"
+#include "raster/task_pool.h"
+#include "utils/image_converter.h"
 #include <cmath>
 #include <algorithm>
 #include <random>
@@ -7,9 +9,17 @@
 namespace SFinGe {
 
 RidgeGenerator::RidgeGenerator() 
-    : m_width(0), m_height(0), m_coreX(0), m_coreY(0), m_rng(std::random_device{}()) {
-    // Inicializar tabela de permutação para Perlin noise
+    : m_width(0), m_height(0), m_coreX(0), m_coreY(0) {
     m_perm.resize(512);
+    std::random_device rd;
+    reseed((static_cast<uint64_t>(rd()) << 32) | rd());
+}
+
+void RidgeGenerator::reseed(uint64_t seed) {
+    m_seed = seed;
+    Raster::seedEngine(m_rng, seed);
+    
+    // Tabela de permutação para Perlin noise
     std::vector<int> p(256);
     for (int i = 0; i < 256; ++i) p[i] = i;
     std::shuffle(p.begin(), p.end(), m_rng);
@@ -17,6 +27,13 @@ RidgeGenerator::RidgeGenerator()
         m_perm[i] = p[i];
         m_perm[256 + i] = p[i];
     }
+    setNoiseKey(Raster::streamSeed(seed, Raster::SeedStream::PixelNoise), 0);
+    m_minutiaeGenerator.reseed(Raster::streamSeed(seed, Raster::SeedStream::Minutiae));
+}
+
+void RidgeGenerator::setNoiseKey(uint64_t seed, uint32_t image) {
+    m_noiseStream = Raster::RandomStream(seed, image, Raster::NoiseStage::RidgeNoise);
+    m_phaseGenerator.setNoiseStream(Raster::RandomStream(seed, image, Raster::NoiseStage::PhaseNoise));
 }
 
 void RidgeGenerator::setParameters(const RidgeParameters& params, const DensityParameters& densityParams,
@@ -93,16 +110,17 @@ void RidgeGenerator::generateRidgeMap() {
 void RidgeGenerator::generateRidgeMapOriginal() {
     // MÉTODO ORIGINAL (com fase aleatória)
     int filterSize = m_params.gaborFilterSize * 2 + 1;
-    GaborFilterCache cache(m_params.cacheDegrees, m_params.cacheFrequencies,
-                          m_densityParams.minFrequency, m_densityParams.maxFrequency,
-                          filterSize);
+    const std::shared_ptr<const GaborFilterCache> bank = GaborFilterCache::shared(
+        m_params.cacheDegrees, m_params.cacheFrequencies,
+        m_densityParams.minFrequency, m_densityParams.maxFrequency, filterSize);
+    const GaborFilterCache& cache = *bank;
     
     m_ridgeMap.resize(m_width * m_height);
     
     // Inicialização esparsa (0.1% como no SFINGE original)
-    auto* rng = QRandomGenerator::global();
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
     for (int i = 0; i < m_width * m_height; ++i) {
-        m_ridgeMap[i] = rng->generateDouble() < 0.001 ? 1.0f : 0.0f;
+        m_ridgeMap[i] = dist(m_rng) < 0.001 ? 1.0f : 0.0f;
     }
     
     std::vector<float> newRidge(m_width * m_height, 0.0f);
@@ -110,34 +128,38 @@ void RidgeGenerator::generateRidgeMapOriginal() {
     for (int iteration = 0; iteration < m_params.maxIterations; ++iteration) {
         std::fill(newRidge.begin(), newRidge.end(), 0.0f);
         
-        for (int j = 0; j < m_height; ++j) {
-            for (int i = 0; i < m_width; ++i) {
-                int idx = j * m_width + i;
-                
-                if (m_shapeMap[idx] < 0.1f) continue;
-                
-                double theta = m_orientationMap[idx];
-                double thetaNorm = theta;
-                if (thetaNorm < 0) thetaNorm += 2.0 * M_PI;
-                
-                double freq = m_densityMap[idx];
-                
-                int degIdx = std::min(static_cast<int>(thetaNorm / (2.0 * M_PI) * m_params.cacheDegrees), 
-                                     m_params.cacheDegrees - 1);
-                int freqIdx = std::min(static_cast<int>((freq - m_densityParams.minFrequency) / 
-                                      (m_densityParams.maxFrequency - m_densityParams.minFrequency) * 
-                                      m_params.cacheFrequencies), 
-                                     m_params.cacheFrequencies - 1);
-                
-                if (degIdx < 0) degIdx = 0;
-                if (freqIdx < 0) freqIdx = 0;
-                
-                const GaborFilter& filter = cache.getFilter(degIdx, freqIdx);
-                double response = applyFilter(filter, i, j, m_ridgeMap);
-                
-                newRidge[idx] = response > 0.0 ? 1.0f : 0.0f;
+        // Iteração de Jacobi (lê m_ridgeMap, escreve newRidge): linhas independentes,
+        // divididas no pool de tarefas do lote quando houver um
+        Raster::parallelFor(0, m_height, kRowsPerTask, [&](int j0, int j1) {
+            for (int j = j0; j < j1; ++j) {
+                for (int i = 0; i < m_width; ++i) {
+                    int idx = j * m_width + i;
+                    
+                    if (m_shapeMap[idx] < 0.1f) continue;
+                    
+                    double theta = m_orientationMap[idx];
+                    double thetaNorm = theta;
+                    if (thetaNorm < 0) thetaNorm += 2.0 * M_PI;
+                    
+                    double freq = m_densityMap[idx];
+                    
+                    int degIdx = std::min(static_cast<int>(thetaNorm / (2.0 * M_PI) * m_params.cacheDegrees), 
+                                         m_params.cacheDegrees - 1);
+                    int freqIdx = std::min(static_cast<int>((freq - m_densityParams.minFrequency) / 
+                                          (m_densityParams.maxFrequency - m_densityParams.minFrequency) * 
+                                          m_params.cacheFrequencies), 
+                                         m_params.cacheFrequencies - 1);
+                    
+                    if (degIdx < 0) degIdx = 0;
+                    if (freqIdx < 0) freqIdx = 0;
+                    
+                    const GaborFilter& filter = cache.getFilter(degIdx, freqIdx);
+                    double response = applyFilter(filter, i, j, m_ridgeMap);
+                    
+                    newRidge[idx] = response > 0.0 ? 1.0f : 0.0f;
+                }
             }
-        }
+        });
         
         // Early stopping: verificar convergência a cada 5 iterações
         if (iteration % 5 == 4 || iteration == m_params.maxIterations - 1) {
@@ -244,6 +266,10 @@ void RidgeGenerator::generateRidgeMapImproved() {
 }
 
 QImage RidgeGenerator::generate() {
+    return ImageConverter::planeToGrayscale(generatePlane());
+}
+
+Plane<float> RidgeGenerator::generatePlane() {
     generateRidgeMap();
     
     // Gerar e aplicar minúcias explícitas
@@ -261,19 +287,12 @@ QImage RidgeGenerator::generate() {
     // Aplicar rendering realista (suavização e ruído)
     std::vector<float> rendered = renderFingerprint(m_ridgeMap);
     
-    QImage image(m_width, m_height, QImage::Format_Grayscale8);
-    
-    for (int j = 0; j < m_height; ++j) {
-        for (int i = 0; i < m_width; ++i) {
-            // Inverter: cristas = escuro (0), vales = claro (255)
-            int idx = j * m_width + i;
-            int gray = static_cast<int>(255 * (1.0f - rendered[idx]));
-            gray = std::clamp(gray, 0, 255);
-            image.setPixel(i, j, qRgb(gray, gray, gray));
-        }
+    // Inverter: cristas = escuro (0), vales = claro (1)
+    for (float& value : rendered) {
+        value = std::clamp(1.0f - value, 0.0f, 1.0f);
     }
     
-    return image;
+    return Plane<float>(m_width, m_height, std::move(rendered));
 }
 
 std::vector<float> RidgeGenerator::renderFingerprint(const std::vector<float>& binaryRidge) {
@@ -362,18 +381,20 @@ double RidgeGenerator::perlinNoise(double x, double y) {
 }
 
 void RidgeGenerator::applyGaussianNoise(std::vector<float>& image, double amplitude) {
-    std::normal_distribution<double> noise(0.0, amplitude);
+    // Amostras N(0, amplitude) de uma linha por vez, indexadas pelo pixel
+    std::vector<float> gaussian(m_width);
     
     for (int j = 0; j < m_height; ++j) {
+        Raster::fillNormal(m_noiseStream, static_cast<uint64_t>(j) * m_width, gaussian.data(),
+                           gaussian.size(), 0.0f, static_cast<float>(amplitude));
         for (int i = 0; i < m_width; ++i) {
             int idx = j * m_width + i;
             if (m_shapeMap[idx] > 0.1f) {
                 // Ruído Perlin para variação suave + ruído gaussiano para detalhes
                 double perlin = perlinNoise(i * m_renderParams.ridgeNoiseFrequency,
                                             j * m_renderParams.ridgeNoiseFrequency);
-                double gaussian = noise(m_rng);
                 
-                image[idx] += static_cast<float>(perlin * amplitude * 0.5 + gaussian);
+                image[idx] += static_cast<float>(perlin * amplitude * 0.5 + gaussian[i]);
                 image[idx] = std::clamp(image[idx], 0.0f, 1.0f);
             }
         }
@@ -459,44 +480,29 @@ void RidgeGenerator::applySkinCondition(std::vector<float>& image) {
     double factor = m_varParams.skinConditionFactor;
     if (std::abs(factor) < 0.01) return;
     
-    std::vector<float> result(m_width * m_height);
-    int kernelSize = 3;
-    int halfK = kernelSize / 2;
+    // factor > 0: úmida (dilata cristas = mais escuro = max)
+    // factor < 0: seca (erode cristas = menos escuro = min)
+    Raster::MorphologyOptions morph;
+    morph.radius = std::max(1, m_varParams.skinConditionRadius);
+    morph.shape = m_varParams.skinConditionDiscKernel ? Raster::StructuringElement::Disc
+                                                      : Raster::StructuringElement::Rectangle;
     
-    for (int j = 0; j < m_height; ++j) {
-        for (int i = 0; i < m_width; ++i) {
-            int idx = j * m_width + i;
-            
-            if (m_shapeMap[idx] < 0.1f) {
-                result[idx] = 0.0f;
-                continue;
-            }
-            
-            float minVal = 1.0f, maxVal = 0.0f;
-            
-            for (int dy = -halfK; dy <= halfK; ++dy) {
-                for (int dx = -halfK; dx <= halfK; ++dx) {
-                    int ni = std::clamp(i + dx, 0, m_width - 1);
-                    int nj = std::clamp(j + dy, 0, m_height - 1);
-                    float val = image[nj * m_width + ni];
-                    minVal = std::min(minVal, val);
-                    maxVal = std::max(maxVal, val);
-                }
-            }
-            
-            // factor > 0: úmida (dilata cristas = mais escuro = max)
-            // factor < 0: seca (erode cristas = menos escuro = min)
-            float original = image[idx];
-            if (factor > 0) {
-                result[idx] = original + static_cast<float>(factor * (maxVal - original));
-            } else {
-                result[idx] = original + static_cast<float>((-factor) * (minVal - original));
-            }
-            result[idx] = std::clamp(result[idx], 0.0f, 1.0f);
-        }
+    std::vector<float> filtered(m_width * m_height);
+    if (factor > 0) {
+        Raster::maxFilter(image.data(), filtered.data(), m_width, m_height, morph);
+    } else {
+        Raster::minFilter(image.data(), filtered.data(), m_width, m_height, morph);
     }
     
-    image = result;
+    float strength = static_cast<float>(std::abs(factor));
+    for (int idx = 0; idx < m_width * m_height; ++idx) {
+        if (m_shapeMap[idx] < 0.1f) {
+            image[idx] = 0.0f;
+            continue;
+        }
+        float original = image[idx];
+        image[idx] = std::clamp(original + strength * (filtered[idx] - original), 0.0f, 1.0f);
+    }
 }
 
 }
@@ -5,6 +5,8 @@
 #include <vector>
 #include <random>
 #include "models/fingerprint_parameters.h"
+#include "plane.h"
+#include "raster/random.h"
 #include "gabor_filter.h"
 #include "minutiae_generator.h"
 #include "phase_field_generator.h"
@@ -25,8 +27,19 @@ public:
     void setShapeMap(const std::vector<float>& shapeMap);
     void setCorePosition(double coreX, double coreY);
     
+    // Semente da etapa Ridge: permutação do Perlin, inicialização esparsa,
+    // minúcias e a chave do ruído por pixel derivam dela
+    void reseed(uint64_t seed);
+    
+    // Chave do ruído por pixel (cristas e campo de fase) desta impressão
+    void setNoiseKey(uint64_t seed, uint32_t image);
+    
     QImage generate();
     
+    // Mesma geração, mas devolve a intensidade em float (0 = crista, 1 = vale)
+    // para alimentar as etapas seguintes sem quantizar
+    Plane<float> generatePlane();
+    
     std::vector<float> getRidgeMap() const { return m_ridgeMap; }
     
     // Estatísticas de minúcias
@@ -36,6 +49,9 @@ public:
     const std::vector<Minutia>& getMinutiae() const { return m_minutiaeGenerator.getMinutiae(); }
     
 private:
+    // Linhas por tarefa nas iterações de Gabor (parallelFor)
+    static constexpr int kRowsPerTask = 16;
+    
     void generateRidgeMap();
     void generateRidgeMapOriginal();
     void generateRidgeMapImproved();
@@ -69,6 +85,8 @@ private:
     // Perlin noise permutation table
     std::vector<int> m_perm;
     std::mt19937 m_rng;
+    uint64_t m_seed = 0;
+    Raster::RandomStream m_noiseStream;
     MinutiaeGenerator m_minutiaeGenerator;
     
     // Novos geradores para controle melhorado
@@ -32,9 +32,11 @@ QImage ShapeGenerator::generate() {
     QImage image(m_width, m_height, QImage::Format_Grayscale8);
     
     for (int j = 0; j < m_height; ++j) {
+        // Linhas invertidas verticalmente; escrita direta na scanline
+        const float* shapeRow = &m_shapeMap[(m_height - j - 1) * m_width];
+        uchar* line = image.scanLine(j);
         for (int i = 0; i < m_width; ++i) {
-            int gray = m_shapeMap[(m_height - j - 1) * m_width + i] > 0 ? 0 : 255;
-            image.setPixel(i, j, qRgb(gray, gray, gray));
+            line[i] = shapeRow[i] > 0 ? 0 : 255;
         }
     }
     
@@ -1,10 +1,41 @@
 #include "variation_effects.h"
+#include "utils/image_converter.h"
+#include "raster/morphology.h"
 #include <cmath>
 #include <algorithm>
 #include <QDebug>
 
 namespace SFinGe {
 
+namespace {
+
+// Interpolação bilinear do campo de deslocamento (dx, dy) com as bordas estendidas
+inline void sampleDisplacement(const Plane<float>& dispX, const Plane<float>& dispY,
+                               double x, double y, double& outX, double& outY) {
+    const int width = dispX.width();
+    const int height = dispX.height();
+    x = std::clamp(x, 0.0, static_cast<double>(width - 1));
+    y = std::clamp(y, 0.0, static_cast<double>(height - 1));
+    int x0 = static_cast<int>(x);
+    int y0 = static_cast<int>(y);
+    int dx1 = x0 + 1 < width ? 1 : 0;
+    int dy1 = y0 + 1 < height ? width : 0;
+    float fx = static_cast<float>(x - x0);
+    float fy = static_cast<float>(y - y0);
+    float w00 = (1.0f - fx) * (1.0f - fy);
+    float w10 = fx * (1.0f - fy);
+    float w01 = (1.0f - fx) * fy;
+    float w11 = fx * fy;
+
+    size_t idx = static_cast<size_t>(y0) * width + x0;
+    const float* px = dispX.data() + idx;
+    const float* py = dispY.data() + idx;
+    outX = px[0] * w00 + px[dx1] * w10 + px[dy1] * w01 + px[dy1 + dx1] * w11;
+    outY = py[0] * w00 + py[dx1] * w10 + py[dy1] * w01 + py[dy1 + dx1] * w11;
+}
+
+} // namespace
+
 VariationEffects::VariationEffects(const VariationParameters& params, unsigned int seed)
     : m_params(params)
     , m_rng(seed)
@@ -17,36 +48,27 @@ QImage VariationEffects::apply(const QImage& masterImage) const {
         return QImage();
     }
 
-    int width = masterImage.width();
-    int height = masterImage.height();
-
-    qDebug() << "[VariationEffects] Aplicando variações à imagem" << width << "x" << height;
-
-    // Converter QImage para vetor de floats
-    std::vector<float> image = qimageToVector(masterImage);
-
-    // Aplicar distorção plástica
-    if (m_params.enablePlasticDistortion) {
-        image = applyPlasticDistortion(image, width, height);
-        qDebug() << "[VariationEffects] Distorção plástica aplicada";
-    }
+    // Converter uma única vez na entrada e uma única vez na saída
+    Plane<float> result = apply(ImageConverter::grayscaleToPlane(masterImage));
+    return ImageConverter::planeToGrayscale(result);
+}
 
-    // Aplicar distorção de lente
-    if (m_params.enableLensDistortion) {
-        image = applyLensDistortion(image, width, height);
-        qDebug() << "[VariationEffects] Distorção de lente aplicada";
-    }
+Plane<float> VariationEffects::apply(const Plane<float>& masterPlane) const {
+    int width = masterPlane.width();
+    int height = masterPlane.height();
 
-    // Aplicar rotação
-    if (m_params.enableRotation) {
-        image = applyRotation(image, width, height);
-        qDebug() << "[VariationEffects] Rotação aplicada";
-    }
+    qDebug() << "[VariationEffects] Aplicando variações à imagem" << width << "x" << height;
 
-    // Aplicar translação
-    if (m_params.enableTranslation) {
-        image = applyTranslation(image, width, height);
-        qDebug() << "[VariationEffects] Translação aplicada";
+    // Distorções geométricas: um único mapa inverso e uma única reamostragem
+    std::vector<float> image;
+    GeometricWarp warp = sampleGeometricWarp(width, height);
+    if (warp.isIdentity()) {
+        image = masterPlane.values();
+    } else {
+        image = applyGeometricWarp(masterPlane.values(), width, height, warp);
+        qDebug() << "[VariationEffects] Distorções geométricas aplicadas"
+                 << "(plástica:" << warp.bumps.size() << "solavancos, lente:" << warp.lens
+                 << ", rotação:" << warp.rotation << ", translação:" << warp.translation << ")";
     }
 
     // Aplicar condição da pele
@@ -55,175 +77,188 @@ QImage VariationEffects::apply(const QImage& masterImage) const {
         qDebug() << "[VariationEffects] Condição da pele aplicada";
     }
 
-    // Converter de volta para QImage
-    return vectorToQImage(image, width, height);
+    return Plane<float>(width, height, std::move(image));
 }
 
-std::vector<float> VariationEffects::applyPlasticDistortion(const std::vector<float>& image,
-                                                             int width, int height) const {
-    std::vector<float> result(width * height, 1.0f);
+VariationEffects::GeometricWarp VariationEffects::sampleGeometricWarp(int width, int height) const {
+    GeometricWarp warp;
 
-    // Criar mapas de deslocamento
-    std::vector<float> mapX(width * height);
-    std::vector<float> mapY(width * height);
-
-    // Inicializar com coordenadas identidade
-    for (int j = 0; j < height; ++j) {
-        for (int i = 0; i < width; ++i) {
-            int idx = j * width + i;
-            mapX[idx] = static_cast<float>(i);
-            mapY[idx] = static_cast<float>(j);
+    // Distorção plástica: múltiplos "solavancos" gaussianos
+    if (m_params.enablePlasticDistortion) {
+        std::uniform_real_distribution<double> centerXDist(width * 0.2, width * 0.8);
+        std::uniform_real_distribution<double> centerYDist(height * 0.2, height * 0.8);
+        std::uniform_real_distribution<double> sigmaDist(width * 0.1, width * 0.3);
+        std::uniform_real_distribution<double> magDist(-m_params.plasticDistortionStrength, 
+                                                        m_params.plasticDistortionStrength);
+        std::uniform_real_distribution<double> angleDist(0, 2.0 * M_PI);
+
+        for (int bump = 0; bump < m_params.plasticDistortionBumps; ++bump) {
+            GeometricWarp::Bump b;
+            b.cx = centerXDist(m_rng);
+            b.cy = centerYDist(m_rng);
+            b.sigma = sigmaDist(m_rng);
+            double mag = magDist(m_rng);
+            double angle = angleDist(m_rng);
+            b.dispX = mag * std::cos(angle);
+            b.dispY = mag * std::sin(angle);
+            warp.bumps.push_back(b);
         }
     }
 
-    // Distribuições para parâmetros gaussianos
-    std::uniform_real_distribution<double> centerXDist(width * 0.2, width * 0.8);
-    std::uniform_real_distribution<double> centerYDist(height * 0.2, height * 0.8);
-    std::uniform_real_distribution<double> sigmaDist(width * 0.1, width * 0.3);
-    std::uniform_real_distribution<double> magDist(-m_params.plasticDistortionStrength, 
-                                                    m_params.plasticDistortionStrength);
-    std::uniform_real_distribution<double> angleDist(0, 2.0 * M_PI);
-
-    // Adicionar múltiplos "solavancos" gaussianos
-    for (int bump = 0; bump < m_params.plasticDistortionBumps; ++bump) {
-        double cx = centerXDist(m_rng);
-        double cy = centerYDist(m_rng);
-        double sigma = sigmaDist(m_rng);
-        double mag = magDist(m_rng);
-        double angle = angleDist(m_rng);
-
-        double cosAngle = std::cos(angle);
-        double sinAngle = std::sin(angle);
-
-        for (int j = 0; j < height; ++j) {
-            for (int i = 0; i < width; ++i) {
-                int idx = j * width + i;
-
-                double dx = i - cx;
-                double dy = j - cy;
-                double distSq = dx * dx + dy * dy;
-
-                // Gaussiana 2D
-                double gaussian = std::exp(-distSq / (2.0 * sigma * sigma));
-
-                // Adicionar deslocamento
-                mapX[idx] += static_cast<float>(mag * cosAngle * gaussian);
-                mapY[idx] += static_cast<float>(mag * sinAngle * gaussian);
-            }
-        }
+    // Distorção de lente (determinística)
+    warp.lens = m_params.enableLensDistortion;
+
+    // Rotação
+    if (m_params.enableRotation) {
+        std::uniform_real_distribution<double> angleDist(-m_params.maxRotationAngle, 
+                                                          m_params.maxRotationAngle);
+        double angleDeg = angleDist(m_rng);
+        double angleRad = angleDeg * M_PI / 180.0;
+        warp.rotation = true;
+        warp.cosA = std::cos(angleRad);
+        warp.sinA = std::sin(angleRad);
+        qDebug() << "[VariationEffects] Rotação:" << angleDeg << "graus";
     }
 
-    // Aplicar remapeamento com interpolação bilinear
-    for (int j = 0; j < height; ++j) {
-        for (int i = 0; i < width; ++i) {
-            int idx = j * width + i;
-            result[idx] = bilinearSample(image, width, height, mapX[idx], mapY[idx]);
-        }
+    // Translação
+    if (m_params.enableTranslation) {
+        std::uniform_real_distribution<double> txDist(-m_params.maxTranslationX, m_params.maxTranslationX);
+        std::uniform_real_distribution<double> tyDist(-m_params.maxTranslationY, m_params.maxTranslationY);
+        warp.translation = true;
+        warp.tx = txDist(m_rng);
+        warp.ty = tyDist(m_rng);
+        qDebug() << "[VariationEffects] Translação: (" << warp.tx << "," << warp.ty << ") pixels";
     }
 
-    return result;
+    return warp;
 }
 
-std::vector<float> VariationEffects::applyLensDistortion(const std::vector<float>& image,
-                                                          int width, int height) const {
-    std::vector<float> result(width * height, 1.0f);
-
-    // Centro da imagem
-    double cx = width / 2.0;
-    double cy = height / 2.0;
-
-    // Normalização (raio máximo)
-    double maxR = std::sqrt(cx * cx + cy * cy);
+void VariationEffects::accumulatePlasticDisplacement(const GeometricWarp& warp,
+                                                     Plane<float>& dispX, Plane<float>& dispY) {
+    const int width = dispX.width();
+    const int height = dispX.height();
+
+    std::vector<double> gx;
+    std::vector<double> gy;
+
+    for (const auto& b : warp.bumps) {
+        // Além de 3 sigma a gaussiana é desprezível (< 1.2% do pico)
+        double reach = 3.0 * b.sigma;
+        int x0 = std::max(0, static_cast<int>(std::floor(b.cx - reach)));
+        int x1 = std::min(width - 1, static_cast<int>(std::ceil(b.cx + reach)));
+        int y0 = std::max(0, static_cast<int>(std::floor(b.cy - reach)));
+        int y1 = std::min(height - 1, static_cast<int>(std::ceil(b.cy + reach)));
+        if (x0 > x1 || y0 > y1) {
+            continue;
+        }
 
-    // Coeficientes de distorção radial (modelo Brown-Conrady)
-    double k1 = m_params.lensDistortionK1;
-    double k2 = m_params.lensDistortionK2;
+        // Gaussiana 2D separável: exp(-(dx²+dy²)/2σ²) = exp(-dx²/2σ²) * exp(-dy²/2σ²)
+        double inv2SigmaSq = 1.0 / (2.0 * b.sigma * b.sigma);
+        gx.resize(x1 - x0 + 1);
+        gy.resize(y1 - y0 + 1);
+        for (int i = x0; i <= x1; ++i) {
+            double dx = i - b.cx;
+            gx[i - x0] = std::exp(-dx * dx * inv2SigmaSq);
+        }
+        for (int j = y0; j <= y1; ++j) {
+            double dy = j - b.cy;
+            gy[j - y0] = std::exp(-dy * dy * inv2SigmaSq);
+        }
 
-    for (int j = 0; j < height; ++j) {
-        for (int i = 0; i < width; ++i) {
-            // Coordenadas normalizadas relativas ao centro
-            double x = (i - cx) / maxR;
-            double y = (j - cy) / maxR;
-            double r2 = x * x + y * y;
-            double r4 = r2 * r2;
-
-            // Fator de distorção radial
-            double factor = 1.0 + k1 * r2 + k2 * r4;
-
-            // Coordenadas distorcidas (invertidas para mapear de destino para origem)
-            double srcX = cx + x * maxR / factor;
-            double srcY = cy + y * maxR / factor;
-
-            int idx = j * width + i;
-            result[idx] = bilinearSample(image, width, height, 
-                                         static_cast<float>(srcX), 
-                                         static_cast<float>(srcY));
+        for (int j = y0; j <= y1; ++j) {
+            float* rowX = dispX.row(j);
+            float* rowY = dispY.row(j);
+            double wy = gy[j - y0];
+            double ax = b.dispX * wy;
+            double ay = b.dispY * wy;
+            for (int i = x0; i <= x1; ++i) {
+                double g = gx[i - x0];
+                rowX[i] += static_cast<float>(ax * g);
+                rowY[i] += static_cast<float>(ay * g);
+            }
         }
     }
-
-    return result;
 }
 
-std::vector<float> VariationEffects::applyRotation(const std::vector<float>& image,
-                                                    int width, int height) const {
+std::vector<float> VariationEffects::applyGeometricWarp(const std::vector<float>& image,
+                                                        int width, int height,
+                                                        const GeometricWarp& warp) const {
     std::vector<float> result(width * height, 1.0f);
 
-    // Gerar ângulo aleatório dentro dos limites
-    std::uniform_real_distribution<double> angleDist(-m_params.maxRotationAngle, 
-                                                      m_params.maxRotationAngle);
-    double angleDeg = angleDist(m_rng);
-    double angleRad = angleDeg * M_PI / 180.0;
+    Plane<float> dispX;
+    Plane<float> dispY;
+    const bool plastic = !warp.bumps.empty();
+    if (plastic) {
+        dispX = Plane<float>(width, height, 0.0f);
+        dispY = Plane<float>(width, height, 0.0f);
+        accumulatePlasticDisplacement(warp, dispX, dispY);
+    }
 
-    qDebug() << "[VariationEffects] Rotação:" << angleDeg << "graus";
+    // Centro da imagem e normalização da lente (quadrado do raio máximo)
+    const double cx = width / 2.0;
+    const double cy = height / 2.0;
+    const double invMaxRSq = 1.0 / (cx * cx + cy * cy);
+    const double k1 = m_params.lensDistortionK1;
+    const double k2 = m_params.lensDistortionK2;
 
-    // Centro de rotação
-    double cx = width / 2.0;
-    double cy = height / 2.0;
+    // Cada etapa original devolvia branco quando sua origem saía de
+    // [0, w-1) x [0, h-1); a composição preserva esse teste etapa a etapa
+    auto inside = [width, height](double x, double y) {
+        return x >= 0 && x < width - 1 && y >= 0 && y < height - 1;
+    };
 
-    double cosA = std::cos(angleRad);
-    double sinA = std::sin(angleRad);
+    // Só a distorção plástica: as coordenadas continuam inteiras
+    const bool onGrid = !warp.translation && !warp.rotation && !warp.lens;
 
     for (int j = 0; j < height; ++j) {
         for (int i = 0; i < width; ++i) {
-            // Coordenadas relativas ao centro
-            double x = i - cx;
-            double y = j - cy;
-
-            // Rotação inversa (de destino para origem)
-            double srcX = cx + x * cosA + y * sinA;
-            double srcY = cy - x * sinA + y * cosA;
-
-            int idx = j * width + i;
-            result[idx] = bilinearSample(image, width, height,
-                                         static_cast<float>(srcX),
-                                         static_cast<float>(srcY));
-        }
-    }
-
-    return result;
-}
-
-std::vector<float> VariationEffects::applyTranslation(const std::vector<float>& image,
-                                                       int width, int height) const {
-    std::vector<float> result(width * height, 1.0f);
-
-    // Gerar translação aleatória
-    std::uniform_real_distribution<double> txDist(-m_params.maxTranslationX, m_params.maxTranslationX);
-    std::uniform_real_distribution<double> tyDist(-m_params.maxTranslationY, m_params.maxTranslationY);
+            // Mapa inverso: da última etapa aplicada para a primeira
+            double x = i;
+            double y = j;
+
+            if (warp.translation) {
+                x -= warp.tx;
+                y -= warp.ty;
+                if (!inside(x, y)) continue;
+            }
 
-    double tx = txDist(m_rng);
-    double ty = tyDist(m_rng);
+            if (warp.rotation) {
+                double rx = x - cx;
+                double ry = y - cy;
+                x = cx + rx * warp.cosA + ry * warp.sinA;
+                y = cy - rx * warp.sinA + ry * warp.cosA;
+                if (!inside(x, y)) continue;
+            }
 
-    qDebug() << "[VariationEffects] Translação: (" << tx << "," << ty << ") pixels";
+            if (warp.lens) {
+                // Raio normalizado pelo raio máximo; origem = centro + (p - centro) / fator
+                double rx = x - cx;
+                double ry = y - cy;
+                double r2 = (rx * rx + ry * ry) * invMaxRSq;
+                double invFactor = 1.0 / (1.0 + k1 * r2 + k2 * r2 * r2);
+                x = cx + rx * invFactor;
+                y = cy + ry * invFactor;
+                if (!inside(x, y)) continue;
+            }
 
-    for (int j = 0; j < height; ++j) {
-        for (int i = 0; i < width; ++i) {
-            // Coordenadas de origem (inverso da translação)
-            float srcX = static_cast<float>(i - tx);
-            float srcY = static_cast<float>(j - ty);
+            if (plastic) {
+                if (onGrid) {
+                    // Sem etapas anteriores: leitura direta do campo
+                    size_t idx = static_cast<size_t>(j) * width + i;
+                    x += dispX.data()[idx];
+                    y += dispY.data()[idx];
+                } else {
+                    // Deslocamento interpolado (as coordenadas são fracionárias)
+                    double ddx, ddy;
+                    sampleDisplacement(dispX, dispY, x, y, ddx, ddy);
+                    x += ddx;
+                    y += ddy;
+                }
+            }
 
-            int idx = j * width + i;
-            result[idx] = bilinearSample(image, width, height, srcX, srcY);
+            result[j * width + i] = bilinearSample(image, width, height,
+                                                   static_cast<float>(x),
+                                                   static_cast<float>(y));
         }
     }
 
@@ -232,8 +267,6 @@ std::vector<float> VariationEffects::applyTranslation(const std::vector<float>&
 
 std::vector<float> VariationEffects::applySkinCondition(const std::vector<float>& image,
                                                          int width, int height) const {
-    std::vector<float> result = image;
-
     // Gerar fator aleatório baseado no parâmetro
     std::uniform_real_distribution<double> factorDist(-std::abs(m_params.skinConditionFactor),
                                                        std::abs(m_params.skinConditionFactor));
@@ -242,79 +275,32 @@ std::vector<float> VariationEffects::applySkinCondition(const std::vector<float>
     qDebug() << "[VariationEffects] Condição da pele: fator =" << factor 
              << (factor > 0 ? "(úmida - dilate)" : "(seca - erode)");
 
-    // Tamanho do kernel para erosão/dilatação
-    int kernelSize = 3;
-    int halfKernel = kernelSize / 2;
-
-    if (factor > 0) {
-        // Dilatação (pele úmida - cristas mais grossas)
-        for (int j = halfKernel; j < height - halfKernel; ++j) {
-            for (int i = halfKernel; i < width - halfKernel; ++i) {
-                float minVal = 1.0f;
-                for (int kj = -halfKernel; kj <= halfKernel; ++kj) {
-                    for (int ki = -halfKernel; ki <= halfKernel; ++ki) {
-                        int nidx = (j + kj) * width + (i + ki);
-                        minVal = std::min(minVal, image[nidx]);
-                    }
-                }
-                int idx = j * width + i;
-                // Interpolar entre original e dilatado
-                result[idx] = image[idx] * (1.0f - static_cast<float>(factor)) + 
-                              minVal * static_cast<float>(factor);
-            }
-        }
-    } else if (factor < 0) {
-        // Erosão (pele seca - cristas mais finas)
-        double absFactor = std::abs(factor);
-        for (int j = halfKernel; j < height - halfKernel; ++j) {
-            for (int i = halfKernel; i < width - halfKernel; ++i) {
-                float maxVal = 0.0f;
-                for (int kj = -halfKernel; kj <= halfKernel; ++kj) {
-                    for (int ki = -halfKernel; ki <= halfKernel; ++ki) {
-                        int nidx = (j + kj) * width + (i + ki);
-                        maxVal = std::max(maxVal, image[nidx]);
-                    }
-                }
-                int idx = j * width + i;
-                // Interpolar entre original e erodido
-                result[idx] = image[idx] * (1.0f - static_cast<float>(absFactor)) + 
-                              maxVal * static_cast<float>(absFactor);
-            }
-        }
+    if (factor == 0.0) {
+        return image;
     }
 
-    return result;
-}
-
-std::vector<float> VariationEffects::qimageToVector(const QImage& image) {
-    QImage grayscale = image.convertToFormat(QImage::Format_Grayscale8);
-    int width = grayscale.width();
-    int height = grayscale.height();
-
-    std::vector<float> result(width * height);
+    // Janela de erosão/dilatação configurável (custo constante por pixel)
+    Raster::MorphologyOptions morph;
+    morph.radius = std::max(1, m_params.skinConditionRadius);
+    morph.shape = m_params.skinConditionDiscKernel ? Raster::StructuringElement::Disc
+                                                   : Raster::StructuringElement::Rectangle;
 
-    for (int j = 0; j < height; ++j) {
-        const uchar* line = grayscale.constScanLine(j);
-        for (int i = 0; i < width; ++i) {
-            result[j * width + i] = line[i] / 255.0f;
-        }
+    std::vector<float> filtered(width * height);
+    if (factor > 0) {
+        // Dilatação (pele úmida - cristas escuras mais grossas = mínimo local)
+        Raster::minFilter(image.data(), filtered.data(), width, height, morph);
+    } else {
+        // Erosão (pele seca - cristas mais finas = máximo local)
+        Raster::maxFilter(image.data(), filtered.data(), width, height, morph);
     }
 
-    return result;
-}
-
-QImage VariationEffects::vectorToQImage(const std::vector<float>& data, int width, int height) {
-    QImage result(width, height, QImage::Format_Grayscale8);
-
-    for (int j = 0; j < height; ++j) {
-        uchar* line = result.scanLine(j);
-        for (int i = 0; i < width; ++i) {
-            float val = std::clamp(data[j * width + i], 0.0f, 1.0f);
-            line[i] = static_cast<uchar>(val * 255.0f);
-        }
+    // Interpolar entre original e filtrado
+    float strength = static_cast<float>(std::abs(factor));
+    for (size_t idx = 0; idx < filtered.size(); ++idx) {
+        filtered[idx] = image[idx] * (1.0f - strength) + filtered[idx] * strength;
     }
 
-    return result;
+    return filtered;
 }
 
 float VariationEffects::bilinearSample(const std::vector<float>& image, int width, int height,
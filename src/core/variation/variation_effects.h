@@ -5,6 +5,7 @@
 #include <vector>
 #include <random>
 #include "models/fingerprint_parameters.h"
+#include "core/plane.h"
 
 namespace SFinGe {
 
@@ -34,49 +35,72 @@ public:
      */
     QImage apply(const QImage& masterImage) const;
 
+    /**
+     * @brief Aplica as variações diretamente sobre um plano float [0, 1]
+     * @param masterPlane Impressão mestre em ponto flutuante
+     * @return Plano com variações aplicadas (sem quantização)
+     */
+    Plane<float> apply(const Plane<float>& masterPlane) const;
+
 private:
     /**
-     * @brief Aplica distorção plástica (deformação gaussiana)
-     * @param image Dados da imagem como vetor
-     * @param width Largura da imagem
-     * @param height Altura da imagem
-     * @return Imagem distorcida
+     * @brief Parâmetros sorteados das distorções geométricas de uma variação
+     *
+     * Todas as distorções (plástica, lente, rotação, translação) são
+     * compostas em um único mapa inverso de coordenadas, e a imagem é
+     * reamostrada uma única vez.
      */
-    std::vector<float> applyPlasticDistortion(const std::vector<float>& image, 
-                                               int width, int height) const;
+    struct GeometricWarp {
+        struct Bump {
+            double cx = 0.0, cy = 0.0;       // Centro do solavanco
+            double sigma = 1.0;              // Desvio padrão (pixels)
+            double dispX = 0.0, dispY = 0.0; // Deslocamento máximo (mag * cos/sin)
+        };
+
+        std::vector<Bump> bumps;         // Distorção plástica (vazio = desabilitada)
+        bool lens = false;               // Distorção de lente (Brown-Conrady)
+        bool rotation = false;
+        double cosA = 1.0, sinA = 0.0;   // Rotação em torno do centro
+        bool translation = false;
+        double tx = 0.0, ty = 0.0;       // Translação (pixels)
+
+        bool isIdentity() const { return bumps.empty() && !lens && !rotation && !translation; }
+    };
 
     /**
-     * @brief Aplica distorção de lente (modelo Brown-Conrady)
-     * @param image Dados da imagem
+     * @brief Sorteia os parâmetros geométricos na mesma ordem do pipeline original
      * @param width Largura
      * @param height Altura
-     * @return Imagem com distorção de lente
+     * @return Parâmetros da distorção composta
      */
-    std::vector<float> applyLensDistortion(const std::vector<float>& image,
-                                            int width, int height) const;
+    GeometricWarp sampleGeometricWarp(int width, int height) const;
 
     /**
-     * @brief Aplica rotação à imagem
-     * @param image Dados da imagem
-     * @param width Largura
-     * @param height Altura
-     * @return Imagem rotacionada
+     * @brief Acumula o campo de deslocamento plástico, limitado a 3 sigma por solavanco
+     * @param warp Parâmetros sorteados
+     * @param dispX Deslocamento em X (mesmo tamanho da imagem, iniciado em zero)
+     * @param dispY Deslocamento em Y
      */
-    std::vector<float> applyRotation(const std::vector<float>& image,
-                                      int width, int height) const;
+    static void accumulatePlasticDisplacement(const GeometricWarp& warp,
+                                              Plane<float>& dispX, Plane<float>& dispY);
 
     /**
-     * @brief Aplica translação à imagem
+     * @brief Aplica todas as distorções geométricas com uma única reamostragem
      * @param image Dados da imagem
      * @param width Largura
      * @param height Altura
-     * @return Imagem transladada
+     * @param warp Parâmetros sorteados
+     * @return Imagem distorcida (branco onde a origem sai da imagem)
      */
-    std::vector<float> applyTranslation(const std::vector<float>& image,
-                                         int width, int height) const;
+    std::vector<float> applyGeometricWarp(const std::vector<float>& image,
+                                          int width, int height,
+                                          const GeometricWarp& warp) const;
 
     /**
      * @brief Aplica efeito de condição da pele (erosão/dilatação)
+     *
+     * A janela (raio e forma) vem de VariationParameters; o filtro de
+     * mínimo/máximo tem custo constante por pixel para qualquer raio.
      * @param image Dados da imagem
      * @param width Largura
      * @param height Altura
@@ -85,16 +109,6 @@ private:
     std::vector<float> applySkinCondition(const std::vector<float>& image,
                                            int width, int height) const;
 
-    /**
-     * @brief Converte QImage para vetor de floats
-     */
-    static std::vector<float> qimageToVector(const QImage& image);
-
-    /**
-     * @brief Converte vetor de floats para QImage
-     */
-    static QImage vectorToQImage(const std::vector<float>& data, int width, int height);
-
     /**
      * @brief Interpolação bilinear para amostragem de pixels
      */
@@ -5,10 +5,19 @@
 #include <QThread>
 #include <QDebug>
 #include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QDir>
+#include <QMutex>
+#include <QFile>
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <iomanip>
+#include <string>
+#include <vector>
 #include "ui/mainwindow.h"
 #include "core/batch_generator.h"
+#include "raster/serve.h"
 
 static bool g_quietMode = false;
 
@@ -22,17 +31,43 @@ void printUsage() {
     std::cout << "SFINGE-Qt6 - Synthetic Fingerprint Generator\n\n";
     std::cout << "Usage:\n";
     std::cout << "  sfinge                          # Launch GUI\n";
-    std::cout << "  sfinge --batch [options]        # Batch generation (CLI)\n\n";
+    std::cout << "  sfinge --batch [options]        # Batch generation (CLI)\n";
+    std::cout << "  sfinge shard list <file.shard>...\n";
+    std::cout << "  sfinge shard extract <file.shard> <dir> [key...]\n";
+    std::cout << "  sfinge manifest jsonl <file.manifest> [out.jsonl]\n";
+    std::cout << "  sfinge merge <out.manifest> <node.manifest>...\n";
+    std::cout << "  sfinge stream list <file|->\n";
+    std::cout << "  sfinge stream extract <file|-> <dir>\n";
+    std::cout << "  sfinge ring read <name> [dir]\n";
+    std::cout << "  sfinge serve <socket> [-j <count>] [--max-queue <count>]\n\n";
     std::cout << "Batch Options:\n";
     std::cout << "  -n, --num <count>       Number of fingerprints (default: 10)\n";
     std::cout << "  -v, --versions <count>  Versions per fingerprint (default: 3)\n";
-    std::cout << "  -o, --output <dir>      Output directory (default: ./output)\n";
+    std::cout << "  -o, --output <dir>      Output directory, - for a frame stream on stdout, or shm:<name> for a\n";
+    std::cout << "                          shared-memory ring of raw crops (raster/sfinge_ring.h; default: ./output)\n";
+    std::cout << "  --ring-slots <count>    Images the shm: ring holds (default: 4 x jobs)\n";
     std::cout << "  -p, --prefix <name>     Filename prefix (default: fingerprint)\n";
     std::cout << "  -s, --start <index>     Start index (default: 0)\n";
     std::cout << "  -j, --jobs <count>      Parallel jobs (default: CPU cores)\n";
+    std::cout << "  --writers <count>       PNG encode/write threads (default: jobs / 4, min 1)\n";
+    std::cout << "  --write-queue <count>   Finished images waiting to be written (default: 2 x jobs)\n";
+    std::cout << "  --memory-budget <MiB>   Cap identities in flight (then jobs) so the estimated peak fits\n";
+    std::cout << "  --png-profile <p>       PNG encoding: fast|balanced|small (default: balanced)\n";
+    std::cout << "  --format <f>            Output: files (one image each) | shards | npy (default: files);\n";
+    std::cout << "                          with -o -, files streams encoded frames and npy raw uint8 frames\n";
+    std::cout << "  --codec <c>             Image encoding for files/shards: png|wsq (default: png)\n";
+    std::cout << "  --wsq-bitrate <bpp>     WSQ target bits per pixel (default: 0.75, about 15:1)\n";
+    std::cout << "  --shard-size <MiB>      Size at which a new shard file starts (default: 1024)\n";
+    std::cout << "  --seed <n>              Master seed; same seed + index = same image (default: random)\n";
     std::cout << "  --skip-original         Skip v0 (original) images\n";
     std::cout << "  --no-mask               Disable elliptical mask\n";
-    std::cout << "  --save-params           Save parameters JSON\n";
+    std::cout << "  --save-params           Write a ground-truth manifest (parameters, minutiae, transforms)\n";
+    std::cout << "  --shard <K/N>           Node K of N: generate only this node's part of -s/-n (needs --seed)\n";
+    std::cout << "  --shard-mode <m>        Node partition: contiguous|strided (default: contiguous)\n";
+    std::cout << "  --resume                Continue an interrupted batch from its journal (same options)\n";
+    std::cout << "  --fused-warp            Single-resample lens/perspective/rotation/crop\n";
+    std::cout << "  --warp-interp <mode>    Fused warp interpolation: bilinear|bicubic (default: bilinear)\n";
+    std::cout << "  --max-blur-sigma <px>   Max defocus sigma at the blur centre (default: 1)\n";
     std::cout << "  -q, --quiet             Suppress debug, show only elapsed time\n";
     std::cout << "  -h, --help              Show this help\n";
 }
@@ -52,9 +87,25 @@ int runBatchMode(int argc, char *argv[]) {
     parser.addOption(QCommandLineOption({"p", "prefix"}, "Filename prefix", "name", "fingerprint"));
     parser.addOption(QCommandLineOption({"s", "start"}, "Start index", "index", "0"));
     parser.addOption(QCommandLineOption({"j", "jobs"}, "Parallel jobs", "count", QString::number(QThread::idealThreadCount())));
+    parser.addOption(QCommandLineOption("ring-slots", "Images the shm: ring holds (0 = 4 x jobs)", "count", "0"));
+    parser.addOption(QCommandLineOption("writers", "PNG encode/write threads (0 = jobs / 4)", "count", "0"));
+    parser.addOption(QCommandLineOption("write-queue", "Finished images waiting to be written (0 = 2 x jobs)", "count", "0"));
+    parser.addOption(QCommandLineOption("memory-budget", "Cap identities in flight so the estimated peak fits", "MiB"));
+    parser.addOption(QCommandLineOption("png-profile", "PNG encoding (fast|balanced|small)", "profile", "balanced"));
+    parser.addOption(QCommandLineOption("format", "Output format (files|shards|npy)", "format", "files"));
+    parser.addOption(QCommandLineOption("codec", "Image encoding for files/shards (png|wsq)", "codec", "png"));
+    parser.addOption(QCommandLineOption("wsq-bitrate", "WSQ target bits per pixel", "bpp", "0.75"));
+    parser.addOption(QCommandLineOption("shard-size", "Size at which a new shard file starts", "MiB", "1024"));
+    parser.addOption(QCommandLineOption("seed", "Master seed (default: random)", "n"));
     parser.addOption(QCommandLineOption("skip-original", "Skip v0 (original) images"));
     parser.addOption(QCommandLineOption("no-mask", "Disable elliptical mask"));
-    parser.addOption(QCommandLineOption("save-params", "Save parameters JSON"));
+    parser.addOption(QCommandLineOption("save-params", "Write a ground-truth manifest"));
+    parser.addOption(QCommandLineOption("shard", "Node K of N of the batch", "K/N"));
+    parser.addOption(QCommandLineOption("shard-mode", "Node partition (contiguous|strided)", "mode", "contiguous"));
+    parser.addOption(QCommandLineOption("resume", "Continue an interrupted batch from its journal"));
+    parser.addOption(QCommandLineOption("fused-warp", "Single-resample lens/perspective/rotation/crop"));
+    parser.addOption(QCommandLineOption("warp-interp", "Fused warp interpolation (bilinear|bicubic)", "mode", "bilinear"));
+    parser.addOption(QCommandLineOption("max-blur-sigma", "Max defocus sigma at the blur centre", "px", "1"));
     parser.addOption(QCommandLineOption({"q", "quiet"}, "Suppress debug output, show only elapsed time"));
     parser.addOption(QCommandLineOption({"h", "help"}, "Show help"));
     
@@ -71,13 +122,120 @@ int runBatchMode(int argc, char *argv[]) {
     config.outputDirectory = parser.value("output");
     config.filenamePrefix = parser.value("prefix");
     config.startIndex = parser.value("start").toInt();
+    // Sem --seed a semente mestre é sorteada uma vez e impressa, para a execução poder ser repetida;
+    // um lote retomado fica com a semente do seu diário
+    config.resume = parser.isSet("resume");
+    config.fixedSeed = parser.isSet("seed") || !config.resume;
+    config.seed = parser.isSet("seed") ? parser.value("seed").toULongLong()
+                                       : QRandomGenerator::system()->generate64();
     config.skipOriginal = parser.isSet("skip-original");
     config.applyEllipticalMask = !parser.isSet("no-mask");
     config.saveParameters = parser.isSet("save-params");
+    config.fusedWarp = parser.isSet("fused-warp");
+    config.maxBlurSigma = parser.value("max-blur-sigma").toDouble();
+    config.writerThreads = parser.value("writers").toInt();
+    config.writeQueueDepth = parser.value("write-queue").toInt();
+    if (parser.isSet("memory-budget")) {
+        const qint64 mib = parser.value("memory-budget").toLongLong();
+        if (mib <= 0) {
+            std::cerr << "Memory budget must be positive (MiB)\n";
+            return 1;
+        }
+        config.memoryBudget = static_cast<quint64>(mib) << 20;
+    }
+    if (!SFinGe::Raster::parsePngProfile(parser.value("png-profile").toStdString(), config.pngProfile)) {
+        std::cerr << "Unknown PNG profile: " << parser.value("png-profile").toStdString()
+                  << " (use fast, balanced or small)\n";
+        return 1;
+    }
+    if (parser.value("format") == "shards") {
+        config.outputFormat = SFinGe::OutputFormat::Shards;
+    } else if (parser.value("format") == "npy") {
+        config.outputFormat = SFinGe::OutputFormat::Npy;
+    } else if (parser.value("format") != "files") {
+        std::cerr << "Unknown output format: " << parser.value("format").toStdString()
+                  << " (use files, shards or npy)\n";
+        return 1;
+    }
+    if (parser.value("codec") == "wsq") {
+        config.imageCodec = SFinGe::ImageCodec::Wsq;
+    } else if (parser.value("codec") != "png") {
+        std::cerr << "Unknown codec: " << parser.value("codec").toStdString() << " (use png or wsq)\n";
+        return 1;
+    }
+    config.wsqBitrate = parser.value("wsq-bitrate").toDouble();
+    if (!(config.wsqBitrate > 0.0)) {
+        std::cerr << "WSQ bitrate must be positive\n";
+        return 1;
+    }
+    config.shardBytes = parser.value("shard-size").toULongLong() << 20;
+    if (parser.value("warp-interp") == "bicubic") {
+        config.warpInterpolation = SFinGe::Raster::Interpolation::Bicubic;
+    }
+    
+    // -s/-n descrevem o lote inteiro; o nó gera só a sua parte e grava o resto no manifesto,
+    // para o merge conferir que as partes dos nós somam o lote
+    config.rangeStart = config.startIndex;
+    config.rangeCount = config.numFingerprints;
+    const bool sharded = parser.isSet("shard");
+    if (sharded) {
+        if (!SFinGe::Raster::parseShardSpec(parser.value("shard").toStdString(), config.shardIndex,
+                                            config.shardCount)) {
+            std::cerr << "Invalid shard: " << parser.value("shard").toStdString()
+                      << " (use K/N with 0 <= K < N)\n";
+            return 1;
+        }
+        SFinGe::Raster::PartitionMode mode = SFinGe::Raster::PartitionMode::Contiguous;
+        if (parser.value("shard-mode") == "strided") {
+            mode = SFinGe::Raster::PartitionMode::Strided;
+        } else if (parser.value("shard-mode") != "contiguous") {
+            std::cerr << "Unknown shard mode: " << parser.value("shard-mode").toStdString()
+                      << " (use contiguous or strided)\n";
+            return 1;
+        }
+        if (!parser.isSet("seed")) {
+            std::cerr << "--shard needs --seed: every node must draw from the same master seed\n";
+            return 1;
+        }
+        const SFinGe::Raster::IdentityRange range = SFinGe::Raster::partitionRange(
+            config.rangeStart, config.rangeCount, config.shardIndex, config.shardCount, mode);
+        config.startIndex = range.start;
+        config.numFingerprints = range.count;
+        config.identityStride = range.stride;
+        config.saveParameters = true;
+    }
     
     int jobs = parser.value("jobs").toInt();
     if (jobs < 1) jobs = QThread::idealThreadCount();
     
+    // O stdout leva os quadros, então toda mensagem vai para o stderr
+    config.streamOutput = config.outputDirectory == "-";
+    if (config.streamOutput) {
+        if (config.outputFormat == SFinGe::OutputFormat::Shards) {
+            std::cerr << "A stream (-o -) takes --format files or npy\n";
+            return 1;
+        }
+        if (config.resume || config.saveParameters || sharded) {
+            std::cerr << "A stream (-o -) leaves nothing on disk: no --resume, --save-params or --shard\n";
+            return 1;
+        }
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+    
+    // Um consumidor local mapeia o anel e lê os recortes no lugar; os quadros levam identidade e versão
+    if (config.outputDirectory.startsWith("shm:")) {
+        config.ringName = config.outputDirectory.mid(4);
+        config.ringSlots = parser.value("ring-slots").toInt();
+        if (config.outputFormat != SFinGe::OutputFormat::Files) {
+            std::cerr << "A ring (-o shm:) carries raw uint8 crops; drop --format\n";
+            return 1;
+        }
+        if (config.resume || config.saveParameters || sharded) {
+            std::cerr << "A ring (-o shm:) leaves nothing on disk: no --resume, --save-params or --shard\n";
+            return 1;
+        }
+    }
+    
     bool quietMode = parser.isSet("quiet");
     g_quietMode = quietMode;
     
@@ -87,10 +245,34 @@ int runBatchMode(int argc, char *argv[]) {
     
     std::cout << "=== SFINGE-Qt6 Batch Generation ===\n";
     std::cout << "Fingerprints: " << config.numFingerprints << "\n";
+    if (sharded) {
+        std::cout << "Node: " << config.shardIndex << "/" << config.shardCount << " of " << config.rangeCount
+                  << " from " << config.rangeStart << " (first " << config.startIndex << ", step "
+                  << config.identityStride << ")\n";
+    }
     std::cout << "Versions per FP: " << config.versionsPerFingerprint << "\n";
     std::cout << "Skip original: " << (config.skipOriginal ? "yes" : "no") << "\n";
     std::cout << "Output: " << config.outputDirectory.toStdString() << "\n";
     std::cout << "Parallel jobs: " << jobs << "\n";
+    if (config.memoryBudget > 0) {
+        std::cout << "Memory budget: " << (config.memoryBudget >> 20) << " MiB\n";
+    }
+    if (config.fixedSeed) {
+        std::cout << "Seed: " << config.seed << "\n";
+    } else {
+        std::cout << "Seed: from the journal (random if starting fresh)\n";
+    }
+    if (config.imageCodec == SFinGe::ImageCodec::Wsq) {
+        std::cout << "Codec: WSQ at " << config.wsqBitrate << " bpp\n";
+    } else {
+        std::cout << "PNG profile: " << SFinGe::Raster::pngProfileName(config.pngProfile) << "\n";
+    }
+    if (config.outputFormat == SFinGe::OutputFormat::Shards) {
+        std::cout << "Output format: shards of " << (config.shardBytes >> 20) << " MiB\n";
+    }
+    if (config.fusedWarp) {
+        std::cout << "Fused warp: " << parser.value("warp-interp").toStdString() << "\n";
+    }
     std::cout << "===================================\n\n";
     
     SFinGe::BatchGenerator generator;
@@ -101,8 +283,9 @@ int runBatchMode(int argc, char *argv[]) {
     timer.start();
     
     QObject::connect(&generator, &SFinGe::BatchGenerator::progressUpdated,
-        [&timer](int fpCompleted, int totalFps, const QString& imgCount) {
+        [&timer, &generator](int fpCompleted, int totalFps, const QString& imgCount) {
             if (fpCompleted > 0) {
+                SFinGe::Raster::WriteQueueStats writer = generator.writerStats();
                 qint64 elapsed = timer.elapsed();
                 qint64 avgTimePerFp = elapsed / fpCompleted;
                 qint64 remaining = avgTimePerFp * (totalFps - fpCompleted);
@@ -110,6 +293,7 @@ int runBatchMode(int argc, char *argv[]) {
                 int elapsedSec = elapsed / 1000;
                 std::cout << "\rFP [" << fpCompleted << "/" << totalFps << "] "
                           << "Images: " << imgCount.toStdString() << " | "
+                          << "Write queue: " << writer.depth << "/" << writer.capacity << " | "
                           << "Elapsed: " << elapsedSec << "s, ETA: " 
                           << remainingSec / 60 << ":" << std::setfill('0') << std::setw(2) << remainingSec % 60
                           << "          " << std::flush;
@@ -117,12 +301,31 @@ int runBatchMode(int argc, char *argv[]) {
         });
     
     QObject::connect(&generator, &SFinGe::BatchGenerator::batchCompleted,
-        [&timer](int generated) {
+        [&timer, &generator, &config](int generated) {
             qint64 elapsed = timer.elapsed();
             int seconds = elapsed / 1000;
             int ms = elapsed % 1000;
             std::cout << "\n\nBatch completed! Generated " << generated << " images.\n";
             std::cout << "Elapsed time: " << seconds << "." << ms << " seconds\n";
+            
+            SFinGe::Raster::WriteQueueStats writer = generator.writerStats();
+            std::cout << "Writers: " << writer.writers << " threads, "
+                      << std::fixed << std::setprecision(1) << writer.utilization() * 100.0 << "% busy, "
+                      << "queue peak " << writer.maxDepth << "/" << writer.capacity << ", "
+                      << "workers blocked " << std::setprecision(2) << writer.producerWaitSeconds << " s";
+            if (writer.failed > 0) {
+                std::cout << ", " << writer.failed << " write failures";
+            }
+            std::cout << "\n";
+            
+            std::cout << "Peak RSS: " << (SFinGe::Raster::peakRss() >> 20) << " MiB";
+            if (config.memoryBudget > 0) {
+                const SFinGe::Raster::MemoryPlan& plan = generator.memoryPlan();
+                std::cout << ", private " << (generator.memoryPeak() >> 20) << " MiB of the "
+                          << (config.memoryBudget >> 20) << " MiB budget (estimated " << (plan.estimate >> 20)
+                          << " MiB: " << plan.workers << " workers, " << plan.identities << " identities in flight)";
+            }
+            std::cout << "\n";
         });
     
     QObject::connect(&generator, &SFinGe::BatchGenerator::error,
@@ -135,7 +338,198 @@ int runBatchMode(int argc, char *argv[]) {
     return success ? 0 : 1;
 }
 
+// Grava um quadro servido com o nome que o lote daria ao arquivo (pixels crus com cabeçalho PGM, como no "stream extract")
+static bool writeFrameFile(const QString& path, const SFinGe::Raster::FrameHeader& header, const void* data) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    if (header.format == SFinGe::Raster::FrameFormat::Gray8) {
+        file.write(QString("P5\n%1 %2\n255\n").arg(header.width).arg(header.height).toLatin1());
+    }
+    const qint64 size = static_cast<qint64>(header.length);
+    return file.write(static_cast<const char*>(data), size) == size;
+}
+
+// Um pedido do "serve": as opções de lote da linha de comando como campos JSON, no pool
+// persistente do servidor. Os quadros voltam pelo gancho do fluxo, então só as imagens
+// (modo de arquivos) tocam o disco.
+static SFinGe::Raster::ServeResult serveRequest(const SFinGe::Raster::ServeRequest& request,
+                                                SFinGe::Raster::TaskPool& pool) {
+    SFinGe::Raster::ServeResult result;
+    auto reject = [&result](const std::string& error) {
+        result.error = error;
+        return result;
+    };
+    
+    SFinGe::BatchConfig config;
+    config.quietMode = true;
+    config.streamOutput = true;
+    int64_t number = 0;
+    bool flag = false;
+    if (request.has("start") && (!request.integer("start", number) || number < 0 || number > 9999999)) {
+        return reject("start must be an integer from 0 to 9999999");
+    }
+    config.startIndex = static_cast<int>(number);
+    if (request.has("count") && (!request.integer("count", number) || number < 1 || number > 10000)) {
+        return reject("count must be an integer from 1 to 10000");
+    }
+    config.numFingerprints = request.has("count") ? static_cast<int>(number) : 1;
+    if (request.has("versions") && (!request.integer("versions", number) || number < 1 || number > 99)) {
+        return reject("versions must be an integer from 1 to 99");
+    }
+    config.versionsPerFingerprint = request.has("versions") ? static_cast<int>(number) : 1;
+    if (request.flag("skipOriginal", flag)) {
+        config.skipOriginal = flag;
+    }
+    if (request.flag("mask", flag)) {
+        config.applyEllipticalMask = flag;
+    }
+    if (request.flag("fusedWarp", flag)) {
+        config.fusedWarp = flag;
+    }
+    request.real("maxBlurSigma", config.maxBlurSigma);
+    const std::string prefix = request.text("prefix", config.filenamePrefix.toStdString());
+    if (prefix.empty() || prefix.find_first_of("/\\:") != std::string::npos) {
+        return reject("prefix must be a plain file name");
+    }
+    config.filenamePrefix = QString::fromStdString(prefix);
+    
+    // Sem semente sorteia-se uma, devolvida na resposta para o pedido poder ser repetido
+    if (request.has("seed") && !request.unsignedInteger("seed", config.seed)) {
+        return reject("seed must be an unsigned 64-bit integer");
+    }
+    if (!request.has("seed")) {
+        config.seed = QRandomGenerator::system()->generate64();
+    }
+    config.fixedSeed = true;
+    result.seed = config.seed;
+    
+    const std::string codec = request.text("codec", "png");
+    if (codec == "wsq") {
+        config.imageCodec = SFinGe::ImageCodec::Wsq;
+    } else if (codec == "raw") {
+        config.outputFormat = SFinGe::OutputFormat::Npy;  // No fluxo, npy manda quadros uint8 crus
+    } else if (codec != "png") {
+        return reject("codec must be png, wsq or raw");
+    }
+    
+    // "inline" devolve as imagens codificadas na resposta; qualquer outro valor é um diretório
+    const QString output = QString::fromStdString(request.text("output", "inline"));
+    const bool inlineData = output == "inline";
+    const int imageCount = config.numFingerprints * (config.versionsPerFingerprint + (config.skipOriginal ? 0 : 1));
+    if (inlineData && imageCount > SFinGe::Raster::kMaxInlineImages) {
+        return reject("more than " + std::to_string(SFinGe::Raster::kMaxInlineImages) +
+                      " images need a directory output");
+    }
+    if (!inlineData && !QDir(output).mkpath(".")) {
+        return reject("cannot create " + output.toStdString());
+    }
+    
+    QMutex mutex;
+    std::string writeError;
+    SFinGe::BatchGenerator generator;
+    generator.setBatchConfig(config);
+    generator.setTaskPool(&pool);
+    generator.setFrameCallback([&](const SFinGe::Raster::FrameHeader& header, const void* data) {
+        SFinGe::Raster::ServeImage image;
+        image.header = header;
+        if (inlineData) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            image.data.assign(bytes, bytes + header.length);
+        } else {
+            const char* extension = header.format == SFinGe::Raster::FrameFormat::Gray8 ? "pgm"
+                                    : header.format == SFinGe::Raster::FrameFormat::Wsq  ? "wsq"
+                                                                                         : "png";
+            const QString name = QString("%1_%2_v%3.%4")
+                                     .arg(config.filenamePrefix)
+                                     .arg(header.identity, 4, 10, QChar('0'))
+                                     .arg(header.version, 2, 10, QChar('0'))
+                                     .arg(extension);
+            const QString path = QDir(output).filePath(name);
+            image.path = path.toStdString();
+            if (!writeFrameFile(path, header, data)) {
+                QMutexLocker locker(&mutex);
+                writeError = "cannot write " + image.path;
+                return false;
+            }
+        }
+        QMutexLocker locker(&mutex);
+        result.images.push_back(std::move(image));
+        return true;
+    });
+    
+    if (!generator.generateBatchParallel()) {
+        result.images.clear();
+        return reject(writeError.empty() ? "generation failed" : writeError);
+    }
+    
+    // Os quadros chegam na ordem em que ficam prontos; a resposta os lista na ordem do lote
+    std::sort(result.images.begin(), result.images.end(),
+              [](const SFinGe::Raster::ServeImage& a, const SFinGe::Raster::ServeImage& b) {
+                  return a.header.identity != b.header.identity ? a.header.identity < b.header.identity
+                                                                : a.header.version < b.header.version;
+              });
+    result.ok = true;
+    return result;
+}
+
+// sfinge serve <socket> [-j N] [--max-queue N]: um processo, um pool, muitos pedidos
+int runServeMode(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: sfinge serve <socket> [-j <count>] [--max-queue <count>]\n";
+        return 2;
+    }
+    QCoreApplication app(argc, argv);
+    g_quietMode = true;
+    qInstallMessageHandler(quietMessageHandler);
+    
+    SFinGe::Raster::ServeOptions options;
+    options.socketPath = argv[2];
+    int jobs = QThread::idealThreadCount();
+    for (int i = 3; i < argc; ++i) {
+        const QString arg(argv[i]);
+        if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+            jobs = QString(argv[++i]).toInt();
+        } else if (arg == "--max-queue" && i + 1 < argc) {
+            options.maxQueue = static_cast<size_t>(std::max(1, QString(argv[++i]).toInt()));
+        } else {
+            std::cerr << "Unknown serve option: " << arg.toStdString() << "\n";
+            return 2;
+        }
+    }
+    if (jobs < 1) jobs = QThread::idealThreadCount();
+    
+    // Criados uma vez: o estado thread_local dos workers, os bancos de Gabor compartilhados
+    // e os planos geométricos das distorções continuam quentes de um pedido para o outro
+    SFinGe::Raster::TaskPool pool(jobs);
+    std::cerr << "Workers: " << pool.size() << ", queue limit " << options.maxQueue << "\n";
+    return SFinGe::Raster::runServer(options, [&pool](const SFinGe::Raster::ServeRequest& request) {
+        return serveRequest(request, pool);
+    });
+}
+
 int main(int argc, char *argv[]) {
+    // Ferramentas de shards e de manifesto: não precisam de QApplication
+    if (argc > 1 && QString(argv[1]) == "shard") {
+        return SFinGe::Raster::runShardTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && QString(argv[1]) == "manifest") {
+        return SFinGe::Raster::runManifestTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && QString(argv[1]) == "stream") {
+        return SFinGe::Raster::runStreamTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && QString(argv[1]) == "merge") {
+        return SFinGe::Raster::runMergeTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && QString(argv[1]) == "ring") {
+        return SFinGe::Raster::runRingTool(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && QString(argv[1]) == "serve") {
+        return runServeMode(argc, argv);
+    }
+    
     // Check if batch mode is requested
     bool batchMode = false;
     for (int i = 1; i < argc; ++i) {
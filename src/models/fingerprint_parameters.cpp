@@ -147,6 +147,8 @@ QJsonObject FingerprintParameters::toJson() const {
     variationObj["maxTranslationY"] = variation.maxTranslationY;
     variationObj["enableSkinCondition"] = variation.enableSkinCondition;
     variationObj["skinConditionFactor"] = variation.skinConditionFactor;
+    variationObj["skinConditionRadius"] = variation.skinConditionRadius;
+    variationObj["skinConditionDiscKernel"] = variation.skinConditionDiscKernel;
     json["variation"] = variationObj;
     
     return json;
@@ -235,6 +237,8 @@ void FingerprintParameters::fromJson(const QJsonObject& json) {
         variation.maxTranslationY = variationObj["maxTranslationY"].toDouble(50.0);
         variation.enableSkinCondition = variationObj["enableSkinCondition"].toBool(true);
         variation.skinConditionFactor = variationObj["skinConditionFactor"].toDouble(0.3);
+        variation.skinConditionRadius = variationObj["skinConditionRadius"].toInt(1);
+        variation.skinConditionDiscKernel = variationObj["skinConditionDiscKernel"].toBool(false);
     }
 }
 
@@ -145,6 +145,8 @@ struct VariationParameters {
     // Condição da Pele
     bool enableSkinCondition = false;
     double skinConditionFactor = 0.1;
+    int skinConditionRadius = 1;          // Raio da janela de erosão/dilatação (1 = 3x3)
+    bool skinConditionDiscKernel = false; // Elemento estruturante em disco (senão quadrado)
 };
 
 struct ClassificationParameters {
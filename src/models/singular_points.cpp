@@ -1,5 +1,5 @@
 #include "singular_points.h"
-#include <QRandomGenerator>
+#include "core/raster/random.h"
 #include <QDebug>
 #include <cmath>
 #include <random>
@@ -71,18 +71,19 @@ SingularPoint SingularPoints::getDelta(int index) const {
 }
 
 void SingularPoints::generateRandomPoints(FingerprintClass fpClass, int width, int height) {
+    std::random_device rd;
+    generateRandomPoints(fpClass, width, height, (static_cast<uint64_t>(rd()) << 32) | rd());
+}
+
+void SingularPoints::generateRandomPoints(FingerprintClass fpClass, int width, int height, uint64_t seed) {
     clearAll();
     
     qDebug() << "[SingularPoints] Generating points for class" << static_cast<int>(fpClass) << "in" << width << "x" << height;
     
-    auto* rng = QRandomGenerator::global();
-    
-    // Melhorar seed: combinar tempo + classe + dimensões para maior variabilidade
-    std::random_device rd;
-    unsigned seed = rd() ^ (static_cast<unsigned>(fpClass) * 7919) ^ 
-                    (static_cast<unsigned>(width) * 104729) ^ 
-                    (static_cast<unsigned>(height) * 1299827);
-    std::mt19937 gen(seed);
+    std::mt19937 gen;
+    Raster::seedEngine(gen, seed);
+    auto uniform = [&gen]() { return std::uniform_real_distribution<double>(0.0, 1.0)(gen); };
+    auto bounded = [&gen](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi - 1)(gen); };
     
     // Jitter gaussiano: ±5% desvio padrão
     std::normal_distribution<double> gaussX(0.0, width * 0.075);
@@ -122,7 +123,7 @@ void SingularPoints::generateRandomPoints(FingerprintClass fpClass, int width, i
             // Plain Whorl: cores horizontais centro, deltas laterais-embaixo
             // Variar Y dos cores para criar spiral/circular/oval
             {
-                double coreYvariation = (rng->generateDouble() - 0.5) * 0.08; // ±4% variação
+                double coreYvariation = (uniform() - 0.5) * 0.08; // ±4% variação
                 addCore(width * 0.42 + gaussX(gen) * 0.5,
                        height * (0.45 + coreYvariation) + gaussY(gen) * 0.3);
                 addCore(width * 0.58 + gaussX(gen) * 0.5,
@@ -138,20 +139,20 @@ void SingularPoints::generateRandomPoints(FingerprintClass fpClass, int width, i
             // Double Loop: 2 CORES (loops lado a lado) + 2 deltas
             {
                 // Deltas: afastados horizontalmente, abaixo dos cores
-                double delta1X = width * 0.25 + rng->bounded(-10, 11);
-                double delta2X = width * 0.75 + rng->bounded(-10, 11);
-                double deltaY = height * 0.70 + rng->bounded(-8, 9);
+                double delta1X = width * 0.25 + bounded(-10, 11);
+                double delta2X = width * 0.75 + bounded(-10, 11);
+                double deltaY = height * 0.70 + bounded(-8, 9);
                 
                 addDelta(delta1X, deltaY);
                 addDelta(delta2X, deltaY);
                 
                 // 2 Cores: um à esquerda, outro à direita
-                double core1X = width * 0.35 + rng->bounded(-10, 11);
-                double core1Y = height * 0.38 + rng->bounded(-10, 11);
+                double core1X = width * 0.35 + bounded(-10, 11);
+                double core1Y = height * 0.38 + bounded(-10, 11);
                 addCore(core1X, core1Y);
                 
-                double core2X = width * 0.65 + rng->bounded(-10, 11);
-                double core2Y = height * 0.38 + rng->bounded(-10, 11);
+                double core2X = width * 0.65 + bounded(-10, 11);
+                double core2Y = height * 0.38 + bounded(-10, 11);
                 addCore(core2X, core2Y);
             }
             break;
@@ -165,8 +166,8 @@ void SingularPoints::generateRandomPoints(FingerprintClass fpClass, int width, i
                 addCore(core1_x, core1_y);
                 
                 // Segundo core a 1-5% de distância em ângulo aleatório
-                double distance = (0.01 + rng->bounded(4) * 0.01) * std::min(width, height);
-                double angle = rng->bounded(360) * M_PI / 180.0;
+                double distance = (0.01 + bounded(0, 4) * 0.01) * std::min(width, height);
+                double angle = bounded(0, 360) * M_PI / 180.0;
                 double core2_x = core1_x + distance * std::cos(angle);
                 double core2_y = core1_y + distance * std::sin(angle);
                 addCore(core2_x, core2_y);
@@ -194,7 +195,7 @@ void SingularPoints::generateRandomPoints(FingerprintClass fpClass, int width, i
                 addDelta(width * 0.80 + gaussX(gen),
                         height * 0.65 + gaussY(gen));
                 // Delta adicional para padrão mais complexo (50% chance)
-                if (rng->bounded(2) == 0) {
+                if (bounded(0, 2) == 0) {
                     addDelta(width * 0.50 + gaussX(gen),
                             height * 0.78 + gaussY(gen));
                 }
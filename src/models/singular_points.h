@@ -1,6 +1,7 @@
 #ifndef SINGULAR_POINTS_H
 #define SINGULAR_POINTS_H
 
+#include <cstdint>
 #include <vector>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -43,6 +44,8 @@ public:
     
     // Geração automática de pontos baseado no tipo de impressão
     void generateRandomPoints(FingerprintClass fpClass, int width, int height);
+    // Mesma geração, reprodutível: todos os sorteios vêm de seed
+    void generateRandomPoints(FingerprintClass fpClass, int width, int height, uint64_t seed);
     
     QJsonObject toJson() const;
     void fromJson(const QJsonObject& json);
@@ -70,10 +70,11 @@ void BatchDialog::setupUi() {
     m_prefixEdit->setText("fingerprint");
     outputLayout->addRow(tr("Filename prefix:"), m_prefixEdit);
     
-    // Checkbox para salvar JSON (desmarcado por padrão)
-    m_saveParamsCheckBox = new QCheckBox(tr("Save parameters as JSON"), this);
+    // Checkbox para salvar o manifesto de verdade de campo (desmarcado por padrão)
+    m_saveParamsCheckBox = new QCheckBox(tr("Save ground-truth manifest"), this);
     m_saveParamsCheckBox->setChecked(false);
-    m_saveParamsCheckBox->setToolTip(tr("Save fingerprint parameters and singular points to JSON files"));
+    m_saveParamsCheckBox->setToolTip(tr("Write parameters, singular points, minutiae and version transforms "
+                                        "to one .manifest file (convert with \"sfinge manifest jsonl\")"));
     outputLayout->addRow("", m_saveParamsCheckBox);
     
     // Checkbox para excluir original (marcado por padrão)
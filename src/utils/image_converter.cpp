@@ -1,49 +1,46 @@
 #include "image_converter.h"
+#include "core/raster/quantize.h"
 #include <algorithm>
 
 namespace SFinGe {
 
 QImage ImageConverter::floatArrayToGrayscale(const std::vector<float>& data, int width, int height) {
     QImage image(width, height, QImage::Format_Grayscale8);
-    
-    for (int j = 0; j < height; ++j) {
-        for (int i = 0; i < width; ++i) {
-            int gray = static_cast<int>(data[j * width + i] * 255.0f);
-            gray = std::clamp(gray, 0, 255);
-            image.setPixel(i, j, qRgb(gray, gray, gray));
-        }
-    }
-    
+    Raster::quantizePlane(data.data(), width, height, image.bits(), image.bytesPerLine());
     return image;
 }
 
 QImage ImageConverter::doubleArrayToGrayscale(const std::vector<double>& data, int width, int height) {
     QImage image(width, height, QImage::Format_Grayscale8);
-    
-    for (int j = 0; j < height; ++j) {
-        for (int i = 0; i < width; ++i) {
-            int gray = static_cast<int>(data[j * width + i] * 255.0);
-            gray = std::clamp(gray, 0, 255);
-            image.setPixel(i, j, qRgb(gray, gray, gray));
-        }
-    }
-    
+    Raster::quantizePlane(data.data(), width, height, image.bits(), image.bytesPerLine());
     return image;
 }
 
 std::vector<float> ImageConverter::grayscaleToFloatArray(const QImage& image) {
-    int width = image.width();
-    int height = image.height();
-    std::vector<float> data(width * height);
+    return std::move(grayscaleToPlane(image).values());
+}
+
+QImage ImageConverter::planeToGrayscale(const Plane<float>& plane) {
+    QImage image(plane.width(), plane.height(), QImage::Format_Grayscale8);
+    Raster::quantizePlane(plane.data(), plane.width(), plane.height(),
+                          image.bits(), image.bytesPerLine());
+    return image;
+}
+
+Plane<float> ImageConverter::grayscaleToPlane(const QImage& image) {
+    QImage grayscale = image.format() == QImage::Format_Grayscale8
+        ? image : image.convertToFormat(QImage::Format_Grayscale8);
+    Plane<float> plane(grayscale.width(), grayscale.height());
     
-    for (int j = 0; j < height; ++j) {
-        for (int i = 0; i < width; ++i) {
-            QRgb pixel = image.pixel(i, j);
-            data[j * width + i] = qGray(pixel) / 255.0f;
+    for (int j = 0; j < plane.height(); ++j) {
+        const uchar* line = grayscale.constScanLine(j);
+        float* row = plane.row(j);
+        for (int i = 0; i < plane.width(); ++i) {
+            row[i] = line[i] / 255.0f;
         }
     }
     
-    return data;
+    return plane;
 }
 
 QImage ImageConverter::normalizeImage(const QImage& image) {
@@ -3,6 +3,7 @@
 
 #include <QImage>
 #include <vector>
+#include "core/plane.h"
 
 namespace SFinGe {
 
@@ -12,6 +13,10 @@ public:
     static QImage doubleArrayToGrayscale(const std::vector<double>& data, int width, int height);
     static std::vector<float> grayscaleToFloatArray(const QImage& image);
     
+    // Conversões diretas entre planos float [0, 1] e Grayscale8 (linha a linha)
+    static QImage planeToGrayscale(const Plane<float>& plane);
+    static Plane<float> grayscaleToPlane(const QImage& image);
+    
     static QImage normalizeImage(const QImage& image);
 };
 
@@ -0,0 +1,140 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <string>
+#include <vector>
+#include "core/raster/checksum.h"
+#include "core/raster/frame_stream.h"
+
+class TestFrameStream : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testRoundTrip();
+    void testTruncatedStream();
+};
+
+namespace {
+
+SFinGe::Raster::FrameHeader frame(uint32_t identity, uint16_t version, const std::vector<uint8_t>& data) {
+    SFinGe::Raster::FrameHeader header;
+    header.identity = identity;
+    header.version = version;
+    header.format = SFinGe::Raster::FrameFormat::Gray8;
+    header.width = static_cast<uint32_t>(data.size());
+    header.height = 1;
+    header.length = data.size();
+    header.crc = SFinGe::Raster::crc32(0, data.data(), data.size());
+    return header;
+}
+
+// Grava os quadros num arquivo e devolve o tamanho; withEnd = false simula um gerador interrompido
+qint64 writeStream(const QString& path, const std::vector<std::vector<uint8_t>>& frames, bool withEnd) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return -1;
+    }
+    SFinGe::Raster::FrameStreamWriter writer;
+    writer.open(file.handle(), "fp");
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (!writer.write(frame(static_cast<uint32_t>(10 + i), 1, frames[i]), frames[i].data())) {
+            return -1;
+        }
+    }
+    if (withEnd && !writer.close()) {
+        return -1;
+    }
+    return static_cast<qint64>(writer.bytesWritten());
+}
+
+} // namespace
+
+void TestFrameStream::testRoundTrip() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("batch.stream");
+    const std::vector<std::vector<uint8_t>> frames = {{1, 2, 3}, {}, std::vector<uint8_t>(70000, 0x5A)};
+    const qint64 size = writeStream(path, frames, true);
+    QCOMPARE(size, qint64(16 + 2 + 4 * 32 + 3 + 70000));
+
+    SFinGe::Raster::FrameStreamReader reader;
+    QVERIFY(reader.open(path.toStdString()));
+    QCOMPARE(reader.prefix(), std::string("fp"));
+    SFinGe::Raster::FrameHeader header;
+    std::vector<uint8_t> data;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        QVERIFY2(reader.next(header, data), reader.error().c_str());
+        QCOMPARE(header.identity, uint32_t(10 + i));
+        QCOMPARE(int(header.format), int(SFinGe::Raster::FrameFormat::Gray8));
+        QVERIFY(data == frames[i]);
+    }
+    QVERIFY(!reader.next(header, data));
+    QVERIFY(reader.finished());
+    QVERIFY(reader.error().empty());
+}
+
+void TestFrameStream::testTruncatedStream() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Sem o quadro End o leitor não confunde um gerador morto com um lote completo
+    const QString unfinished = dir.filePath("unfinished.stream");
+    QVERIFY(writeStream(unfinished, {{1, 2, 3}}, false) > 0);
+    SFinGe::Raster::FrameStreamReader reader;
+    QVERIFY(reader.open(unfinished.toStdString()));
+    SFinGe::Raster::FrameHeader header;
+    std::vector<uint8_t> data;
+    QVERIFY(reader.next(header, data));
+    QVERIFY(!reader.next(header, data));
+    QVERIFY(!reader.finished());
+    QVERIFY(!reader.error().empty());
+
+    // Dados cortados no meio de um quadro
+    const QString cut = dir.filePath("cut.stream");
+    const qint64 size = writeStream(cut, {std::vector<uint8_t>(1000, 7)}, true);
+    QFile file(cut);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(size - 32 - 100));
+    file.close();
+    SFinGe::Raster::FrameStreamReader cutReader;
+    QVERIFY(cutReader.open(cut.toStdString()));
+    QVERIFY(!cutReader.next(header, data));
+    QVERIFY(!cutReader.finished());
+
+    // Um tamanho de prefixo absurdo é recusado antes de qualquer alocação
+    const QString corrupt = dir.filePath("corrupt.stream");
+    QFile bad(corrupt);
+    QVERIFY(bad.open(QIODevice::WriteOnly));
+    const char start[16] = {'S', 'F', 'S', 'T', 'R', 'E', 'A', 'M', 1, 0, 0, 0, '\xff', '\xff', '\xff', '\xff'};
+    bad.write(start, sizeof(start));
+    bad.close();
+    SFinGe::Raster::FrameStreamReader badReader;
+    QVERIFY(!badReader.open(corrupt.toStdString()));
+
+    // Quadros cujo tamanho não bate com as dimensões são recusados antes de ler os dados
+    struct Bad { uint8_t format; uint32_t width, height; uint64_t length; };
+    for (const Bad& bad : {Bad{1, 4, 3, 13}, Bad{1, 0, 0, 5}, Bad{2, 8, 8, 0xFFFFFFFFFFull},
+                           Bad{9, 4, 3, 12}}) {
+        const QString path = dir.filePath("bad.stream");
+        QVERIFY(writeStream(path, {}, false) > 0);
+        uint8_t encoded[32] = {'S', 'F', 'F', 'R'};
+        encoded[10] = bad.format;
+        for (int i = 0; i < 4; ++i) {
+            encoded[12 + i] = static_cast<uint8_t>(bad.width >> (8 * i));
+            encoded[16 + i] = static_cast<uint8_t>(bad.height >> (8 * i));
+        }
+        for (int i = 0; i < 8; ++i) {
+            encoded[20 + i] = static_cast<uint8_t>(bad.length >> (8 * i));
+        }
+        QFile tail(path);
+        QVERIFY(tail.open(QIODevice::Append));
+        tail.write(reinterpret_cast<const char*>(encoded), sizeof(encoded));
+        tail.close();
+        SFinGe::Raster::FrameStreamReader frameReader;
+        QVERIFY(frameReader.open(path.toStdString()));
+        QVERIFY(!frameReader.next(header, data));
+        QVERIFY(frameReader.error().find("truncated") == std::string::npos);
+    }
+}
+
+QTEST_MAIN(TestFrameStream)
+#include "test_frame_stream.moc"
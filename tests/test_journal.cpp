@@ -0,0 +1,170 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/raster/journal.h"
+
+class TestJournal : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testCommitSyncsDataFirst();
+    void testResumeDropsTornTail();
+    void testRecordDuringCommit();
+    void testFileSyncList();
+};
+
+namespace {
+
+SFinGe::Raster::JournalEntry entry(uint32_t identity, uint16_t version, uint16_t shard = 0) {
+    SFinGe::Raster::JournalEntry done;
+    done.identity = identity;
+    done.version = version;
+    done.shard = shard;
+    done.crc = 0x9E3779B9u ^ (identity * 31 + version);
+    return done;
+}
+
+} // namespace
+
+void TestJournal::testCommitSyncsDataFirst() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const std::string path = dir.filePath("batch.journal").toStdString();
+
+    SFinGe::Raster::CompletionJournal journal;
+    QVERIFY(journal.create(path, 42, 0xC0FFEE));
+    int syncs = 0;
+    journal.setSyncCallback([&syncs]() { ++syncs; return true; });
+
+    // Abaixo do limite do grupo nada é gravado (nem sincronizado) antes do commit
+    for (uint16_t version = 1; version <= 3; ++version) {
+        QVERIFY(journal.record(entry(7, version)));
+    }
+    QVERIFY(journal.commit());
+    QCOMPARE(syncs, 1);
+    QVERIFY(journal.commit({entry(8, 1, 3), entry(8, 2, 3)}));
+    QCOMPARE(syncs, 2);
+    QVERIFY(journal.commit());
+    QCOMPARE(syncs, 2);  // Sem pendências não há o que sincronizar
+    QVERIFY(journal.close());
+
+    SFinGe::Raster::CompletionJournal resumed;
+    QVERIFY2(resumed.resume(path), resumed.error().c_str());
+    QCOMPARE(resumed.seed(), quint64(42));
+    QCOMPARE(resumed.configHash(), 0xC0FFEEu);
+    QCOMPARE(resumed.completed().size(), size_t(5));
+    QCOMPARE(resumed.completed()[3].identity, 8u);
+    QCOMPARE(int(resumed.completed()[3].shard), 3);
+    QCOMPARE(resumed.completed()[4].crc, entry(8, 2).crc);
+
+    // Um sync que falha trava o diário sem gravar as entradas
+    resumed.setSyncCallback([]() { return false; });
+    QVERIFY(resumed.record(entry(9, 1)));
+    QVERIFY(!resumed.commit());
+    QVERIFY(!resumed.close());
+    QVERIFY(!resumed.error().empty());
+}
+
+void TestJournal::testResumeDropsTornTail() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("batch.journal");
+    {
+        SFinGe::Raster::CompletionJournal journal;
+        QVERIFY(journal.create(path.toStdString(), 1, 2));
+        for (uint32_t identity = 0; identity < 4; ++identity) {
+            QVERIFY(journal.record(entry(identity, 1)));
+        }
+        QVERIFY(journal.close());
+    }
+
+    // Queda no meio do último commit: a quarta entrada fica pela metade
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() - 7));
+    file.close();
+
+    {
+        SFinGe::Raster::CompletionJournal journal;
+        QVERIFY(journal.resume(path.toStdString()));
+        QCOMPARE(journal.completed().size(), size_t(3));
+        QVERIFY(journal.record(entry(3, 1)));
+        QVERIFY(journal.close());
+    }
+
+    // O acréscimo começa depois da última entrada válida
+    SFinGe::Raster::CompletionJournal journal;
+    QVERIFY(journal.resume(path.toStdString()));
+    QCOMPARE(journal.completed().size(), size_t(4));
+    QCOMPARE(journal.completed()[3].identity, 3u);
+    QCOMPARE(QFileInfo(path).size(), qint64(32 + 4 * 16));
+
+    QFile garbage(dir.filePath("garbage.journal"));
+    QVERIFY(garbage.open(QIODevice::WriteOnly));
+    garbage.write("not a journal at all, long enough for a header");
+    garbage.close();
+    QVERIFY(!journal.resume(garbage.fileName().toStdString()));
+}
+
+void TestJournal::testRecordDuringCommit() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const std::string path = dir.filePath("batch.journal").toStdString();
+
+    SFinGe::Raster::CompletionJournal journal;
+    QVERIFY(journal.create(path, 1, 2));
+    std::atomic<bool> syncing{false};
+    std::atomic<bool> release{false};
+    journal.setSyncCallback([&]() {
+        syncing = true;
+        while (!release) {
+            std::this_thread::yield();
+        }
+        return true;
+    });
+
+    // Um sync lento não segura os workers: record() volta mesmo com o grupo cheio
+    QVERIFY(journal.record(entry(0, 1)));
+    std::thread committer([&journal]() { journal.commit(); });
+    while (!syncing) {
+        std::this_thread::yield();
+    }
+    for (uint32_t identity = 1; identity <= SFinGe::Raster::CompletionJournal::kCommitEntries; ++identity) {
+        QVERIFY(journal.record(entry(identity, 1)));
+    }
+    release = true;
+    committer.join();
+    QVERIFY(journal.close());
+
+    SFinGe::Raster::CompletionJournal resumed;
+    QVERIFY(resumed.resume(path));
+    QCOMPARE(resumed.completed().size(), SFinGe::Raster::CompletionJournal::kCommitEntries + 1);
+    QCOMPARE(resumed.completed()[0].identity, 0u);
+}
+
+void TestJournal::testFileSyncList() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    SFinGe::Raster::FileSyncList written(dir.path().toStdString());
+    QVERIFY(written.sync());  // Nada gravado, nada a fazer
+
+    for (const char* name : {"a.png", "b.png"}) {
+        QFile file(dir.filePath(name));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("data");
+        file.close();
+        written.add(name);
+    }
+    QVERIFY(written.sync());
+
+    // Um arquivo que sumiu falha o sync; a lista é esvaziada assim mesmo
+    written.add("missing.png");
+    QVERIFY(!written.sync());
+    QVERIFY(written.sync());
+}
+
+QTEST_MAIN(TestJournal)
+#include "test_journal.moc"
@@ -0,0 +1,133 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <string>
+#include <vector>
+#include "core/raster/manifest.h"
+
+class TestManifest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testRecordsRoundTripAsJsonLines();
+    void testTruncatedTailKeepsCompleteRecords();
+};
+
+namespace {
+
+bool writeManifest(const std::string& path) {
+    SFinGe::Raster::ManifestWriter writer;
+    if (!writer.create(path)) {
+        return false;
+    }
+    for (int identity = 0; identity < 2; ++identity) {
+        SFinGe::Raster::ManifestRecord record;
+        record.addInt("identity", identity);
+        record.addUInt("seed", 18446744073709551615ull);
+        record.addReal("density.zoom", 0.1 * (identity + 1));
+        record.addBool("rendering.enablePores", identity == 1);
+        record.addText("minutiae.minutiaeDensity", "lo\"w");
+        record.addTuples("cores", {"x", "y"}, {1.5, -2.0});
+        if (!writer.append("identity", record)) {
+            return false;
+        }
+
+        SFinGe::Raster::ManifestRecord version;
+        version.addInt("identity", identity);
+        version.addInt("version", 1);
+        version.addReal("rotation", -12.25);
+        if (!writer.append("version", version)) {
+            return false;
+        }
+    }
+    return writer.close() && writer.recordCount() == 4;
+}
+
+} // namespace
+
+void TestManifest::testRecordsRoundTripAsJsonLines() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const std::string path = dir.filePath("batch.manifest").toStdString();
+    QVERIFY(writeManifest(path));
+
+    SFinGe::Raster::ManifestReader reader;
+    QVERIFY2(reader.open(path), reader.error().c_str());
+    std::vector<std::string> lines;
+    while (reader.next()) {
+        lines.push_back(reader.toJson());
+    }
+    QVERIFY2(reader.error().empty(), reader.error().c_str());
+    QCOMPARE(lines.size(), size_t(4));
+    QCOMPARE(lines[0], std::string("{\"record\":\"identity\",\"identity\":0,\"seed\":18446744073709551615,"
+                                   "\"density.zoom\":0.1,\"rendering.enablePores\":false,"
+                                   "\"minutiae.minutiaeDensity\":\"lo\\\"w\",\"cores\":[{\"x\":1.5,\"y\":-2}]}"));
+    QCOMPARE(lines[1], std::string("{\"record\":\"version\",\"identity\":0,\"version\":1,\"rotation\":-12.25}"));
+    QCOMPARE(lines[3], std::string("{\"record\":\"version\",\"identity\":1,\"version\":1,\"rotation\":-12.25}"));
+
+    // Um registro fora do esquema do seu tipo é um erro do chamador e falha o manifesto
+    SFinGe::Raster::ManifestWriter writer;
+    QVERIFY(writer.create(dir.filePath("mismatch.manifest").toStdString()));
+    SFinGe::Raster::ManifestRecord first;
+    first.addInt("identity", 0);
+    QVERIFY(writer.append("version", first));
+    SFinGe::Raster::ManifestRecord wrong;
+    wrong.addReal("identity", 1.0);
+    QVERIFY(!writer.append("version", wrong));
+    QVERIFY(!writer.close());
+    QVERIFY(!writer.error().empty());
+}
+
+void TestManifest::testTruncatedTailKeepsCompleteRecords() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("batch.manifest");
+    QVERIFY(writeManifest(path.toStdString()));
+
+    // Lote interrompido: o último registro fica pela metade
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() - 10));
+    file.close();
+
+    SFinGe::Raster::ManifestReader reader;
+    QVERIFY(reader.open(path.toStdString()));
+    int complete = 0;
+    while (reader.next()) {
+        ++complete;
+    }
+    QCOMPARE(complete, 3);
+    QVERIFY(!reader.error().empty());
+
+    // Cauda de lixo que declara um registro de 4 GiB: lida como corte, sem alocar
+    const std::string tailed = dir.filePath("tailed.manifest").toStdString();
+    QVERIFY(writeManifest(tailed));
+    const qint64 intact = QFileInfo(QString::fromStdString(tailed)).size();
+    QFile tail(QString::fromStdString(tailed));
+    QVERIFY(tail.open(QIODevice::Append));
+    const char junk[9] = {'\x01', '\xff', '\xff', '\xff', '\xff', 'j', 'u', 'n', 'k'};
+    tail.write(junk, sizeof(junk));
+    tail.close();
+    QVERIFY(reader.open(tailed));
+    complete = 0;
+    while (reader.next()) {
+        ++complete;
+    }
+    QCOMPARE(complete, 4);
+    QVERIFY(reader.error().find("truncated") != std::string::npos);
+    QCOMPARE(reader.validBytes(), quint64(intact));
+
+    // --resume corta a cauda e continua depois do último registro válido
+    SFinGe::Raster::ManifestWriter writer;
+    QVERIFY2(writer.reopen(tailed), writer.error().c_str());
+    QVERIFY(writer.close());
+    QCOMPARE(QFileInfo(QString::fromStdString(tailed)).size(), intact);
+
+    QFile garbage(dir.filePath("garbage.manifest"));
+    QVERIFY(garbage.open(QIODevice::WriteOnly));
+    garbage.write("not a manifest at all");
+    garbage.close();
+    QVERIFY(!reader.open(garbage.fileName().toStdString()));
+}
+
+QTEST_MAIN(TestManifest)
+#include "test_manifest.moc"
@@ -0,0 +1,76 @@
+#include <QtTest>
+#include <vector>
+#include "core/raster/memory_budget.h"
+
+class TestMemoryBudget : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testPlan();
+    void testTooSmall();
+    void testRss();
+};
+
+namespace {
+
+constexpr uint64_t kMiB = 1ull << 20;
+
+SFinGe::Raster::MemoryModel model() {
+    SFinGe::Raster::MemoryModel result;
+    result.baseline = 10 * kMiB;
+    result.perIdentity = 80 * kMiB;
+    result.perWorker = 10 * kMiB;
+    return result;
+}
+
+} // namespace
+
+void TestMemoryBudget::testPlan() {
+    // Folga para tudo: uma identidade por worker, não mais
+    SFinGe::Raster::MemoryPlan plan = SFinGe::Raster::planMemory(model(), 4096 * kMiB, 4, false);
+    QCOMPARE(plan.workers, 4);
+    QCOMPARE(plan.identities, 4);
+    QVERIFY(plan.fits);
+    QCOMPARE(plan.estimate, 10 * kMiB + 4 * 10 * kMiB + 4 * 80 * kMiB);
+
+    // Orçamento apertado: os workers ficam, as identidades em voo caem
+    plan = SFinGe::Raster::planMemory(model(), 250 * kMiB, 4, false);
+    QCOMPARE(plan.workers, 4);
+    QCOMPARE(plan.identities, 2);
+    QVERIFY(plan.estimate <= 250 * kMiB);
+
+    // Nem uma identidade com quatro workers: o pool próprio encolhe
+    plan = SFinGe::Raster::planMemory(model(), 110 * kMiB, 4, false);
+    QCOMPARE(plan.workers, 2);
+    QCOMPARE(plan.identities, 1);
+    QVERIFY(plan.fits);
+}
+
+void TestMemoryBudget::testTooSmall() {
+    // Um pool externo não encolhe; o lote segue com uma identidade e avisa
+    SFinGe::Raster::MemoryPlan plan = SFinGe::Raster::planMemory(model(), 110 * kMiB, 4, true);
+    QCOMPARE(plan.workers, 4);
+    QCOMPARE(plan.identities, 1);
+    QVERIFY(!plan.fits);
+
+    plan = SFinGe::Raster::planMemory(model(), 50 * kMiB, 4, false);
+    QCOMPARE(plan.workers, 1);
+    QCOMPARE(plan.identities, 1);
+    QVERIFY(!plan.fits);
+    QCOMPARE(plan.estimate, 100 * kMiB);
+}
+
+void TestMemoryBudget::testRss() {
+#ifdef __linux__
+    // 64 MiB tocados aparecem na memória privada e no pico
+    const uint64_t before = SFinGe::Raster::privateRss();
+    QVERIFY(before > 0);
+    std::vector<char> block(64 * kMiB, 1);
+    QVERIFY(SFinGe::Raster::privateRss() >= before + 60 * kMiB);
+    QVERIFY(SFinGe::Raster::peakRss() >= SFinGe::Raster::privateRss());
+    QCOMPARE(int(block[block.size() - 1]), 1);
+#endif
+}
+
+QTEST_MAIN(TestMemoryBudget)
+#include "test_memory_budget.moc"
@@ -0,0 +1,67 @@
+#include <QtTest>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "core/raster/morphology.h"
+
+class TestMorphology : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testMatchesBruteForce_data();
+    void testMatchesBruteForce();
+};
+
+void TestMorphology::testMatchesBruteForce_data() {
+    QTest::addColumn<int>("radius");
+    QTest::addColumn<bool>("disc");
+
+    QTest::newRow("rect r=1") << 1 << false;
+    QTest::newRow("rect r=4") << 4 << false;
+    QTest::newRow("disc r=3") << 3 << true;
+    QTest::newRow("disc r=6") << 6 << true;
+}
+
+void TestMorphology::testMatchesBruteForce() {
+    QFETCH(int, radius);
+    QFETCH(bool, disc);
+
+    const int width = 37;
+    const int height = 29;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> image(width * height);
+    for (float& v : image) v = dist(rng);
+
+    SFinGe::Raster::MorphologyOptions options;
+    options.radius = radius;
+    options.shape = disc ? SFinGe::Raster::StructuringElement::Disc
+                         : SFinGe::Raster::StructuringElement::Rectangle;
+    options.maxDiscRectangles = radius + 1;  // Decomposição exata do disco
+    options.threads = 2;
+
+    std::vector<float> eroded(width * height);
+    std::vector<float> dilated(width * height);
+    SFinGe::Raster::minFilter(image.data(), eroded.data(), width, height, options);
+    SFinGe::Raster::maxFilter(image.data(), dilated.data(), width, height, options);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float minVal = 1.0f, maxVal = 0.0f;
+            for (int dy = -radius; dy <= radius; ++dy) {
+                for (int dx = -radius; dx <= radius; ++dx) {
+                    if (disc && dx * dx + dy * dy > radius * radius) continue;
+                    int nx = x + dx, ny = y + dy;
+                    if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                    minVal = std::min(minVal, image[ny * width + nx]);
+                    maxVal = std::max(maxVal, image[ny * width + nx]);
+                }
+            }
+            QCOMPARE(eroded[y * width + x], minVal);
+            QCOMPARE(dilated[y * width + x], maxVal);
+        }
+    }
+}
+
+QTEST_MAIN(TestMorphology)
+#include "test_morphology.moc"
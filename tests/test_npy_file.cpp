@@ -0,0 +1,54 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <vector>
+#include "core/raster/npy_file.h"
+
+class TestNpyFile : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testSlotsLandAtFixedOffsets();
+};
+
+void TestNpyFile::testSlotsLandAtFixedOffsets() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("tensor.npy");
+
+    const int width = 5;
+    const int height = 4;
+    SFinGe::Raster::NpyFile tensor;
+    QVERIFY(tensor.create(path.toStdString(), {2, 3, height, width}));
+    QCOMPARE(tensor.slotCount(), uint64_t(6));
+
+    // Stride maior que a largura: só a região útil de cada linha vai para o slot
+    std::vector<uint8_t> pixels(height * 8);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        pixels[i] = static_cast<uint8_t>(i + 1);
+    }
+    const SFinGe::Raster::ConstGray8View view{pixels.data(), 8, width, height};
+    QVERIFY(tensor.writeSlot(4, view));
+    QVERIFY(!tensor.writeSlot(6, view));
+    QVERIFY(!tensor.writeSlot(0, SFinGe::Raster::ConstGray8View{pixels.data(), 8, width - 1, height}));
+    QVERIFY(tensor.close());
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    QVERIFY(data.startsWith("\x93NUMPY\x01"));
+    const int headerLength = static_cast<uint8_t>(data[8]) | (static_cast<uint8_t>(data[9]) << 8);
+    const int offset = 10 + headerLength;
+    QCOMPARE(offset % 64, 0);
+    QVERIFY(data.mid(10, headerLength).contains("'shape': (2, 3, 4, 5)"));
+    QCOMPARE(data.size(), offset + 6 * width * height);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            QCOMPARE(static_cast<uint8_t>(data[offset + 4 * width * height + y * width + x]), pixels[y * 8 + x]);
+        }
+    }
+    QCOMPARE(static_cast<uint8_t>(data[offset]), uint8_t(0));
+}
+
+QTEST_MAIN(TestNpyFile)
+#include "test_npy_file.moc"
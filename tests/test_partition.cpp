@@ -0,0 +1,66 @@
+#include <QtTest>
+#include <vector>
+#include "core/raster/partition.h"
+
+class TestPartition : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testPartsCoverRangeOnce();
+    void testParseShardSpec();
+};
+
+void TestPartition::testPartsCoverRangeOnce() {
+    using SFinGe::Raster::PartitionMode;
+    for (PartitionMode mode : {PartitionMode::Contiguous, PartitionMode::Strided}) {
+        for (int shards : {1, 3, 7, 12}) {
+            // Cada identidade de [100, 110) cai em exatamente um nó, inclusive com mais nós que identidades
+            std::vector<int> owners(10, 0);
+            for (int shard = 0; shard < shards; ++shard) {
+                const SFinGe::Raster::IdentityRange range =
+                    SFinGe::Raster::partitionRange(100, 10, shard, shards, mode);
+                for (int n = 0; n < range.count; ++n) {
+                    const int identity = range.start + n * range.stride;
+                    QVERIFY(identity >= 100 && identity < 110);
+                    ++owners[identity - 100];
+                }
+            }
+            for (int count : owners) {
+                QCOMPARE(count, 1);
+            }
+        }
+    }
+
+    // Na contígua os primeiros count % N nós levam uma a mais
+    SFinGe::Raster::IdentityRange range = SFinGe::Raster::partitionRange(0, 10, 0, 3, PartitionMode::Contiguous);
+    QCOMPARE(range.start, 0);
+    QCOMPARE(range.count, 4);
+    range = SFinGe::Raster::partitionRange(0, 10, 2, 3, PartitionMode::Contiguous);
+    QCOMPARE(range.start, 7);
+    QCOMPARE(range.count, 3);
+    QCOMPARE(range.stride, 1);
+
+    range = SFinGe::Raster::partitionRange(0, 10, 2, 3, PartitionMode::Strided);
+    QCOMPARE(range.start, 2);
+    QCOMPARE(range.count, 3);
+    QCOMPARE(range.stride, 3);
+}
+
+void TestPartition::testParseShardSpec() {
+    int shard = -1;
+    int shards = -1;
+    QVERIFY(SFinGe::Raster::parseShardSpec("0/1", shard, shards));
+    QVERIFY(SFinGe::Raster::parseShardSpec("3/8", shard, shards));
+    QCOMPARE(shard, 3);
+    QCOMPARE(shards, 8);
+
+    QVERIFY(!SFinGe::Raster::parseShardSpec("8/8", shard, shards));
+    QVERIFY(!SFinGe::Raster::parseShardSpec("0/0", shard, shards));
+    QVERIFY(!SFinGe::Raster::parseShardSpec("-1/4", shard, shards));
+    QVERIFY(!SFinGe::Raster::parseShardSpec("1/", shard, shards));
+    QVERIFY(!SFinGe::Raster::parseShardSpec("1/2/3", shard, shards));
+    QVERIFY(!SFinGe::Raster::parseShardSpec("2", shard, shards));
+}
+
+QTEST_MAIN(TestPartition)
+#include "test_partition.moc"
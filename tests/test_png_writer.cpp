@@ -0,0 +1,61 @@
+#include <QtTest>
+#include <QImage>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "core/raster/png_writer.h"
+
+class TestPngWriter : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testRoundTrip_data();
+    void testRoundTrip();
+};
+
+void TestPngWriter::testRoundTrip_data() {
+    QTest::addColumn<int>("profile");
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+
+    QTest::newRow("fast 500x600") << int(SFinGe::Raster::PngProfile::Fast) << 500 << 600;
+    QTest::newRow("balanced 500x600") << int(SFinGe::Raster::PngProfile::Balanced) << 500 << 600;
+    QTest::newRow("small 500x600") << int(SFinGe::Raster::PngProfile::Small) << 500 << 600;
+    QTest::newRow("balanced 1x1") << int(SFinGe::Raster::PngProfile::Balanced) << 1 << 1;
+    QTest::newRow("small 333x7") << int(SFinGe::Raster::PngProfile::Small) << 333 << 7;
+}
+
+void TestPngWriter::testRoundTrip() {
+    QFETCH(int, profile);
+    QFETCH(int, width);
+    QFETCH(int, height);
+
+    // Cristas senoidais com ruído e um trecho liso: exercita literais, casamentos longos e blocos armazenados
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> noise(-12, 12);
+    std::vector<uint8_t> pixels(width * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            int value = (y < height / 4) ? 255 : 128 + static_cast<int>(100 * std::sin(0.35 * x + 0.1 * y)) + noise(rng);
+            pixels[y * width + x] = static_cast<uint8_t>(qBound(0, value, 255));
+        }
+    }
+
+    SFinGe::Raster::PngWriter writer(static_cast<SFinGe::Raster::PngProfile>(profile));
+    const SFinGe::Raster::ConstGray8View view{pixels.data(), width, width, height};
+    const std::vector<uint8_t>& png = writer.encode(view, 500);
+
+    QImage decoded = QImage::fromData(png.data(), static_cast<int>(png.size()), "PNG");
+    QVERIFY(!decoded.isNull());
+    QCOMPARE(decoded.format(), QImage::Format_Grayscale8);
+    QCOMPARE(decoded.width(), width);
+    QCOMPARE(decoded.height(), height);
+    QCOMPARE(decoded.dotsPerMeterX(), 19685);
+    for (int y = 0; y < height; ++y) {
+        QVERIFY(memcmp(decoded.constScanLine(y), pixels.data() + y * width, width) == 0);
+    }
+}
+
+QTEST_MAIN(TestPngWriter)
+#include "test_png_writer.moc"
@@ -0,0 +1,79 @@
+#include <QtTest>
+#include <string>
+#include "core/raster/serve.h"
+
+class TestServe : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testParseRequest();
+    void testRejectRequest();
+    void testBase64();
+};
+
+void TestServe::testParseRequest() {
+    SFinGe::Raster::ServeRequest request;
+    std::string error;
+    QVERIFY2(request.parse(R"( {"id": "a\"b", "seed": 18446744073709551615, "count": 3,
+                                "maxBlurSigma": 0.5, "mask": false, "prefix": "fpé", "extra": null} )",
+                           error),
+             error.c_str());
+
+    // Sementes de 64 bits não passam por double
+    uint64_t seed = 0;
+    QVERIFY(request.unsignedInteger("seed", seed));
+    QCOMPARE(seed, uint64_t(18446744073709551615ull));
+    int64_t count = 0;
+    QVERIFY(request.integer("count", count));
+    QCOMPARE(count, int64_t(3));
+    double sigma = 0.0;
+    QVERIFY(request.real("maxBlurSigma", sigma));
+    QCOMPARE(sigma, 0.5);
+    bool mask = true;
+    QVERIFY(request.flag("mask", mask));
+    QVERIFY(!mask);
+    QCOMPARE(request.text("prefix"), std::string("fp\xc3\xa9"));
+    QCOMPARE(request.idJson(), std::string(R"("a\"b")"));
+
+    // Tipo errado ou campo ausente: o chamador fica com o padrão
+    QVERIFY(request.has("extra"));
+    QVERIFY(!request.integer("maxBlurSigma", count));
+    QVERIFY(!request.integer("prefix", count));
+    QCOMPARE(request.text("codec", "png"), std::string("png"));
+
+    // Além de 64 bits é erro, não o valor saturado
+    QVERIFY(request.parse(R"({"seed": 99999999999999999999999, "count": -9999999999999999999999})", error));
+    QVERIFY(!request.unsignedInteger("seed", seed));
+    QVERIFY(!request.integer("count", count));
+}
+
+void TestServe::testRejectRequest() {
+    SFinGe::Raster::ServeRequest request;
+    std::string error;
+    QVERIFY(!request.parse("not json", error));
+    QVERIFY(!request.parse(R"({"count": [1, 2]})", error));
+    QVERIFY(!request.parse(R"({"count": 1} trailing)", error));
+    QVERIFY(!request.parse(R"({"count": 1,})", error));
+    QVERIFY(!request.parse(R"({"prefix": "open)", error));
+    // O "id" volta como veio: só a gramática de número do JSON passa
+    QVERIFY(!request.parse(R"({"id": +5})", error));
+    QVERIFY(!request.parse(R"({"id": .5})", error));
+    QVERIFY(!request.parse(R"({"id": 05})", error));
+    QVERIFY(!request.parse(R"({"id": 1e})", error));
+    QVERIFY(request.parse(R"({"id": -0.5e+3})", error));
+    QCOMPARE(request.idJson(), std::string("-0.5e+3"));
+    QVERIFY(request.parse("{}", error));
+    QCOMPARE(request.idJson(), std::string("null"));
+}
+
+void TestServe::testBase64() {
+    const uint8_t data[] = {'f', 'o', 'o', 'b', 'a', 'r'};
+    QCOMPARE(SFinGe::Raster::base64Encode(data, 0), std::string());
+    QCOMPARE(SFinGe::Raster::base64Encode(data, 1), std::string("Zg=="));
+    QCOMPARE(SFinGe::Raster::base64Encode(data, 2), std::string("Zm8="));
+    QCOMPARE(SFinGe::Raster::base64Encode(data, 3), std::string("Zm9v"));
+    QCOMPARE(SFinGe::Raster::base64Encode(data, 6), std::string("Zm9vYmFy"));
+}
+
+QTEST_MAIN(TestServe)
+#include "test_serve.moc"
@@ -0,0 +1,63 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <string>
+#include <vector>
+#include "core/raster/shard.h"
+
+class TestShard : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testRoundTripWithRollover();
+};
+
+void TestShard::testRoundTripWithRollover() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const std::string stem = dir.filePath("batch").toStdString();
+
+    // Entradas de 100 a 1090 bytes em shards de 4 KiB: vários arquivos, nenhuma entrada partida
+    std::vector<std::vector<uint8_t>> payloads;
+    {
+        SFinGe::Raster::ShardWriter writer(stem, 4096);
+        for (int i = 0; i < 40; ++i) {
+            std::vector<uint8_t> data(100 + 90 * (i % 12));
+            for (size_t k = 0; k < data.size(); ++k) {
+                data[k] = static_cast<uint8_t>(i * 31 + k);
+            }
+            QVERIFY(writer.append("entry_" + std::to_string(i), data.data(), data.size()));
+            payloads.push_back(std::move(data));
+        }
+        QVERIFY(writer.close());
+        QVERIFY(writer.shardCount() > 1);
+        QCOMPARE(writer.entryCount(), uint64_t(40));
+    }
+
+    int found = 0;
+    std::vector<uint8_t> data;
+    for (int shard = 0; ; ++shard) {
+        const std::string path = SFinGe::Raster::ShardWriter::shardPath(stem, shard);
+        if (!QFile::exists(QString::fromStdString(path))) {
+            break;
+        }
+        SFinGe::Raster::ShardReader reader;
+        QVERIFY2(reader.open(path), reader.error().c_str());
+        for (const SFinGe::Raster::ShardEntry& entry : reader.entries()) {
+            const int i = std::stoi(entry.key.substr(6));
+            QVERIFY(reader.find(entry.key) == &entry);
+            QVERIFY(reader.read(entry, data));
+            QVERIFY(data == payloads[i]);
+            ++found;
+        }
+    }
+    QCOMPARE(found, 40);
+
+    // Shard sem rodapé (lote interrompido) é rejeitado
+    QFile truncated(QString::fromStdString(SFinGe::Raster::ShardWriter::shardPath(stem, 0)));
+    QVERIFY(truncated.resize(truncated.size() - 4));
+    SFinGe::Raster::ShardReader reader;
+    QVERIFY(!reader.open(SFinGe::Raster::ShardWriter::shardPath(stem, 0)));
+}
+
+QTEST_MAIN(TestShard)
+#include "test_shard.moc"
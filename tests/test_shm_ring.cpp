@@ -0,0 +1,132 @@
+#include <QtTest>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "core/raster/checksum.h"
+#include "core/raster/shm_ring.h"
+#include "core/raster/sfinge_ring.h"
+
+class TestShmRing : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testOutOfOrderPublish();
+    void testAbort();
+    void testConsumerTimeout();
+};
+
+namespace {
+
+const char* const kName = "/sfinge_test_ring";
+
+SFinGe::Raster::FrameHeader frame(uint32_t identity, uint32_t width, uint32_t height, const uint8_t* pixels) {
+    SFinGe::Raster::FrameHeader header;
+    header.identity = identity;
+    header.version = 1;
+    header.format = SFinGe::Raster::FrameFormat::Gray8;
+    header.width = width;
+    header.height = height;
+    header.length = static_cast<uint64_t>(width) * height;
+    header.crc = SFinGe::Raster::crc32(0, pixels, static_cast<size_t>(header.length));
+    return header;
+}
+
+} // namespace
+
+void TestShmRing::testOutOfOrderPublish() {
+    SFinGe::Raster::ShmRingWriter writer;
+    QVERIFY2(writer.create(kName, 2, 4, 3, 3, "fp"), writer.error().c_str());
+
+    sfinge_ring ring;
+    QCOMPARE(sfinge_ring_open(&ring, kName), 0);
+    QCOMPARE(ring.header->slot_count, 2u);
+    QCOMPARE(std::string(ring.header->prefix), std::string("fp"));
+
+    // Dois workers: o segundo publica antes do primeiro; o consumidor lê na ordem das sequências
+    uint64_t first = 0;
+    uint64_t second = 0;
+    uint8_t* a = writer.acquire(first);
+    uint8_t* b = writer.acquire(second);
+    QVERIFY(a && b);
+    std::memset(b, 2, 12);
+    writer.publish(second, frame(11, 4, 3, b));
+    const sfinge_ring_slot* slot = nullptr;
+    const uint8_t* pixels = nullptr;
+    QCOMPARE(sfinge_ring_next(&ring, &slot, &pixels), int(SFINGE_RING_EMPTY));
+    std::memset(a, 1, 12);
+    writer.publish(first, frame(10, 4, 3, a));
+    QCOMPARE(sfinge_ring_next(&ring, &slot, &pixels), int(SFINGE_RING_FRAME));
+    QCOMPARE(slot->identity, 10u);
+    QCOMPARE(int(pixels[0]), 1);
+    sfinge_ring_release(&ring);
+
+    // O terceiro quadro espera o slot que o consumidor acabou de liberar
+    std::thread producer([&writer]() {
+        uint64_t sequence = 0;
+        uint8_t* c = writer.acquire(sequence);
+        std::memset(c, 3, 12);
+        writer.publish(sequence, frame(12, 4, 3, c));
+        writer.close();
+    });
+    std::vector<uint32_t> identities;
+    while (sfinge_ring_wait(&ring, &slot, &pixels) == SFINGE_RING_FRAME) {
+        QCOMPARE(SFinGe::Raster::crc32(0, pixels, static_cast<size_t>(slot->length)), slot->crc);
+        identities.push_back(slot->identity);
+        sfinge_ring_release(&ring);
+    }
+    producer.join();
+    QCOMPARE(identities, std::vector<uint32_t>({11, 12}));
+    QCOMPARE(sfinge_ring_next(&ring, &slot, &pixels), int(SFINGE_RING_END));
+    sfinge_ring_close(&ring);
+
+    // close() removeu o nome
+    QVERIFY(sfinge_ring_open(&ring, kName) != 0);
+}
+
+void TestShmRing::testAbort() {
+    SFinGe::Raster::ShmRingWriter writer;
+    QVERIFY(writer.create(kName, 1, 2, 2, 0, "fp"));
+    sfinge_ring ring;
+    QCOMPARE(sfinge_ring_open(&ring, kName), 0);
+
+    // Um lote interrompido não deixa o consumidor esperando para sempre
+    writer.abort("cancelled");
+    const sfinge_ring_slot* slot = nullptr;
+    const uint8_t* pixels = nullptr;
+    QCOMPARE(sfinge_ring_wait(&ring, &slot, &pixels), int(SFINGE_RING_ERROR));
+    uint64_t sequence = 0;
+    QVERIFY(writer.acquire(sequence) == nullptr);
+    QVERIFY(!writer.close());
+    QCOMPARE(writer.error(), std::string("cancelled"));
+    sfinge_ring_close(&ring);
+}
+
+void TestShmRing::testConsumerTimeout() {
+    SFinGe::Raster::ShmRingWriter writer;
+    QVERIFY(writer.create(kName, 1, 2, 2, 0, "fp"));
+    writer.setConsumerTimeout(std::chrono::milliseconds(200));
+    sfinge_ring ring;
+    QCOMPARE(sfinge_ring_open(&ring, kName), 0);
+    QVERIFY(ring.header->heartbeat > 0);
+
+    uint64_t sequence = 0;
+    uint8_t* pixels = writer.acquire(sequence);
+    QVERIFY(pixels);
+    std::memset(pixels, 7, 4);
+    writer.publish(sequence, frame(1, 2, 2, pixels));
+
+    // O consumidor para de dar sinal (travado, ou em outro namespace de PID): o produtor desiste
+    const auto start = std::chrono::steady_clock::now();
+    QVERIFY(writer.acquire(sequence) == nullptr);
+    QVERIFY(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(200));
+    QCOMPARE(writer.error(), std::string("the consumer went away"));
+    const sfinge_ring_slot* slot = nullptr;
+    const uint8_t* read = nullptr;
+    QCOMPARE(sfinge_ring_next(&ring, &slot, &read), int(SFINGE_RING_FRAME));
+    QVERIFY(!writer.close());
+    sfinge_ring_close(&ring);
+}
+
+QTEST_MAIN(TestShmRing)
+#include "test_shm_ring.moc"
@@ -0,0 +1,95 @@
+#include <QtTest>
+#include <cmath>
+#include <vector>
+#include "core/raster/wsq.h"
+
+class TestWsq : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testRoundTrip();
+    void testRejectsDamagedStreams();
+};
+
+namespace {
+
+// Cristas senoidais que somem no fundo branco em direção às bordas
+std::vector<uint8_t> ridgeImage(int width, int height) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const double window = std::sin(M_PI * x / (width - 1)) * std::sin(M_PI * y / (height - 1));
+            pixels[y * width + x] = static_cast<uint8_t>(std::lround(255 - window * (127 + 100 * std::sin(0.7 * x + 0.2 * y))));
+        }
+    }
+    return pixels;
+}
+
+double psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    double error = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        const double d = double(a[i]) - double(b[i]);
+        error += d * d;
+    }
+    error /= a.size();
+    return error > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / error) : 99.0;
+}
+
+} // namespace
+
+void TestWsq::testRoundTrip() {
+    const int width = 301;
+    const int height = 367;
+    const std::vector<uint8_t> pixels = ridgeImage(width, height);
+    const SFinGe::Raster::ConstGray8View view(pixels.data(), width, width, height);
+
+    SFinGe::Raster::WsqWriter writer;
+    const std::vector<uint8_t> wsq = writer.encode(view, 0.75, 500);
+    QVERIFY(!wsq.empty());
+    QVERIFY(wsq.size() * 8 < pixels.size());
+
+    SFinGe::Raster::WsqReader reader;
+    QVERIFY2(reader.decode(wsq.data(), wsq.size()), reader.error().c_str());
+    QCOMPARE(reader.width(), width);
+    QCOMPARE(reader.height(), height);
+    QCOMPARE(reader.ppi(), 500);
+    const double quality = psnr(pixels, reader.pixels());
+    QVERIFY(quality > 40.0);
+
+    // Taxa maior: arquivo maior e reconstrução ao menos tão boa
+    const std::vector<uint8_t> fine = writer.encode(view, 2.25, 500);
+    QVERIFY(fine.size() > wsq.size());
+    QVERIFY(reader.decode(fine.data(), fine.size()));
+    QVERIFY(psnr(pixels, reader.pixels()) >= quality);
+
+    QVERIFY(writer.encode(SFinGe::Raster::ConstGray8View(pixels.data(), width, 32, 32)).empty());
+}
+
+void TestWsq::testRejectsDamagedStreams() {
+    const std::vector<uint8_t> pixels = ridgeImage(128, 96);
+    SFinGe::Raster::WsqWriter writer;
+    const std::vector<uint8_t> wsq = writer.encode(SFinGe::Raster::ConstGray8View(pixels.data(), 128, 128, 96));
+
+    SFinGe::Raster::WsqReader reader;
+    QVERIFY(!reader.decode(wsq.data(), wsq.size() / 2));
+    QVERIFY(!reader.decode(wsq.data(), wsq.size() - 2));
+    QVERIFY(!reader.decode(pixels.data(), pixels.size()));
+
+    // SOF adulterado: tamanho implausível recusado antes de alocar o plano, e um
+    // tamanho aceitável que os dados do arquivo não têm como preencher
+    size_t sof = 0;
+    while (sof + 1 < wsq.size() && !(wsq[sof] == 0xFF && wsq[sof + 1] == 0xA2)) {
+        ++sof;
+    }
+    QVERIFY(sof + 10 < wsq.size());
+    for (uint16_t side : {uint16_t(0xFFFF), uint16_t(4000)}) {
+        std::vector<uint8_t> damaged = wsq;
+        damaged[sof + 6] = damaged[sof + 8] = static_cast<uint8_t>(side >> 8);
+        damaged[sof + 7] = damaged[sof + 9] = static_cast<uint8_t>(side);
+        QVERIFY(!reader.decode(damaged.data(), damaged.size()));
+        QVERIFY(!reader.error().empty());
+    }
+}
+
+QTEST_MAIN(TestWsq)
+#include "test_wsq.moc"